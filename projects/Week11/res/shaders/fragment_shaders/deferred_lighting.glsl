@@ -0,0 +1,63 @@
+#version 440
+
+// Lights every pixel of the G-buffer in a single screen space pass, see DeferredShading.h.
+// Surfaces are lit exactly like fragments/surface_output.glsl would light them
+
+// We output a single color to the color buffer
+layout(location = 0) out vec4 frag_color;
+
+////////////////////////////////////////////////////////////////
+///////////// Application Level Uniforms ///////////////////////
+////////////////////////////////////////////////////////////////
+
+#include "../fragments/multiple_point_lights.glsl"
+
+////////////////////////////////////////////////////////////////
+/////////////// Frame Level Uniforms ///////////////////////////
+////////////////////////////////////////////////////////////////
+
+#include "../fragments/frame_uniforms.glsl"
+#include "../fragments/surface_shading.glsl"
+
+// The G-buffer, bound to DeferredShading::GBUFFER_TEXTURE_SLOT onwards (slots 0 and 1 hold
+// the environment and the sun's shadows)
+layout (binding = 2) uniform sampler2D s_GBufferAlbedo;
+layout (binding = 3) uniform sampler2D s_GBufferNormal;
+layout (binding = 4) uniform sampler2D s_GBufferMaterial;
+layout (binding = 5) uniform sampler2D s_GBufferDepth;
+
+// Turns positions in normalized device coordinates back into world space
+uniform mat4 u_InverseViewProjection;
+
+void main() {
+	ivec2 pixel = ivec2(gl_FragCoord.xy);
+
+	// Nothing was drawn here, leave it for the skybox
+	vec4 material = texelFetch(s_GBufferMaterial, pixel, 0);
+	int shadingModel = int(material.b * 255.0 + 0.5);
+	if (shadingModel == SHADING_MODEL_NONE) {
+		discard;
+	}
+
+	vec4  albedo = texelFetch(s_GBufferAlbedo, pixel, 0);
+	float depth  = texelFetch(s_GBufferDepth, pixel, 0).r;
+
+	Surface surface;
+	surface.Albedo       = albedo.rgb;
+	surface.Alpha        = 1.0;
+	surface.Normal       = DecodeNormal(texelFetch(s_GBufferNormal, pixel, 0).rg);
+	surface.Shininess    = albedo.a;
+	surface.Reflectivity = material.r;
+	surface.ToonSteps    = int(material.g * 255.0 + 0.5);
+	surface.ShadingModel = shadingModel;
+
+	// Rebuild the world position from the depth buffer
+	vec2 ndc = (vec2(pixel) + 0.5) / vec2(textureSize(s_GBufferDepth, 0)) * 2.0 - 1.0;
+	vec4 worldPos = u_InverseViewProjection * vec4(ndc, depth * 2.0 - 1.0, 1.0);
+	worldPos.xyz /= worldPos.w;
+
+	frag_color = vec4(ShadeSurface(surface, worldPos.xyz, GetViewDepth(depth)), 1.0);
+
+	// Copy the scene's depth over, so that forward shaded objects and the skybox are hidden behind it
+	gl_FragDepth = depth;
+}
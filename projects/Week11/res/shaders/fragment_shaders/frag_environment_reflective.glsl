@@ -2,9 +2,6 @@
 
 #include "../fragments/fs_common_inputs.glsl"
 
-// We output a single color to the color buffer
-layout(location = 0) out vec4 frag_color;
-
 ////////////////////////////////////////////////////////////////
 /////////////// Frame Level Uniforms ///////////////////////////
 ////////////////////////////////////////////////////////////////
@@ -15,15 +12,14 @@ layout(location = 0) out vec4 frag_color;
 /////////////// Instance Level Uniforms ////////////////////////
 ////////////////////////////////////////////////////////////////
 
-// Represents a collection of attributes that would define a material
-// For instance, you can think of this like material settings in 
-// Unity
-struct Material {
-	sampler2D Diffuse;
-	float     Shininess;
+// Textures for our material, these are bound to fixed slots so the material can bind
+// them all at once (slots 0 and 1 are reserved for shared textures like the environment)
+layout (binding = 2) uniform sampler2D s_Diffuse;
+
+// The value parameters for our material, these are uploaded by the material as a single block
+layout (std140, binding = 3) uniform b_Material {
+    float u_Shininess;
 };
-// Create a uniform for the material
-uniform Material u_Material;
 
 ////////////////////////////////////////////////////////////////
 ///////////// Application Level Uniforms ///////////////////////
@@ -31,6 +27,9 @@ uniform Material u_Material;
 
 #include "../fragments/multiple_point_lights.glsl"
 
+// Lights our surface, or writes it to the G-buffer, depending on the render path
+#include "../fragments/surface_output.glsl"
+
 const float LOG_MAX = 2.40823996531;
 
 // https://learnopengl.com/Advanced-Lighting/Advanced-Lighting
@@ -38,19 +37,12 @@ void main() {
 	// Normalize our input normal
 	vec3 normal = normalize(inNormal);
 
-	vec3 toEye = normalize(u_CamPos.xyz - inWorldPos);
-	vec3 environmentDir = reflect(-toEye, normal);
-	vec3 reflected = SampleEnvironmentMap(environmentDir);
-
-	// Will accumulate the contributions of all lights on this fragment
-	// This is defined in the fragment file "multiple_point_lights.glsl"
-	vec3 lightAccumulation = CalcAllLightContribution(inWorldPos, normal, u_CamPos.xyz, u_Material.Shininess);
-
 	// Get the albedo from the diffuse / albedo map
-	vec4 textureColor = texture(u_Material.Diffuse, inUV);
+	vec4 textureColor = texture(s_Diffuse, inUV);
 
-	// combine for the final result
-	vec3 result = lightAccumulation  * inColor * textureColor.rgb;
+	// The shinier the surface, the more of the environment it reflects
+	Surface surface = MakeSurface(inColor * textureColor.rgb, textureColor.a, normal, u_Shininess);
+	surface.Reflectivity = u_Shininess;
 
-	frag_color = vec4(mix(result, reflected, u_Material.Shininess), textureColor.a);
+	OutputSurface(surface, inWorldPos);
 }
\ No newline at end of file
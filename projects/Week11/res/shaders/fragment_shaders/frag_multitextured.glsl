@@ -4,9 +4,6 @@
 
 layout(location = 5) in vec2 inTextureWeights;
 
-// We output a single color to the color buffer
-layout(location = 0) out vec4 frag_color;
-
 ////////////////////////////////////////////////////////////////
 /////////////// Frame Level Uniforms ///////////////////////////
 ////////////////////////////////////////////////////////////////
@@ -17,16 +14,15 @@ layout(location = 0) out vec4 frag_color;
 /////////////// Instance Level Uniforms ////////////////////////
 ////////////////////////////////////////////////////////////////
 
-// Represents a collection of attributes that would define a material
-// For instance, you can think of this like material settings in 
-// Unity
-struct Material {
-	sampler2D DiffuseA;
-	sampler2D DiffuseB;
-	float     Shininess;
+// Textures for our material, these are bound to fixed slots so the material can bind
+// them all at once (slots 0 and 1 are reserved for shared textures like the environment)
+layout (binding = 2) uniform sampler2D s_DiffuseA;
+layout (binding = 3) uniform sampler2D s_DiffuseB;
+
+// The value parameters for our material, these are uploaded by the material as a single block
+layout (std140, binding = 3) uniform b_Material {
+    float u_Shininess;
 };
-// Create a uniform for the material
-uniform Material u_Material;
 
 ////////////////////////////////////////////////////////////////
 ///////////// Application Level Uniforms ///////////////////////
@@ -34,6 +30,9 @@ uniform Material u_Material;
 
 #include "../fragments/multiple_point_lights.glsl"
 
+// Lights our surface, or writes it to the G-buffer, depending on the render path
+#include "../fragments/surface_output.glsl"
+
 const float LOG_MAX = 2.40823996531;
 
 // https://learnopengl.com/Advanced-Lighting/Advanced-Lighting
@@ -41,21 +40,15 @@ void main() {
 	// Normalize our input normal
 	vec3 normal = normalize(inNormal);
 
-	// Will accumulate the contributions of all lights on this fragment
-	// This is defined in the fragment file "multiple_point_lights.glsl"
-	vec3 lightAccumulation = CalcAllLightContribution(inWorldPos, normal, u_CamPos.xyz, u_Material.Shininess);
-
     // By we can use this lil trick to divide our weight by the sum of all components
     // This will make all of our texture weights add up to one! 
     vec2 texWeight = inTextureWeights / dot(inTextureWeights, vec2(1,1));
 
 	// Perform our texture mixing, we'll calculate our albedo as the sum of the texture and it's weight
 	vec4 textureColor = 
-        texture(u_Material.DiffuseA, inUV) * texWeight.x + 
-        texture(u_Material.DiffuseB, inUV) * texWeight.y;
-
-	// combine for the final result
-	vec3 result = lightAccumulation  * inColor * textureColor.rgb;
+        texture(s_DiffuseA, inUV) * texWeight.x + 
+        texture(s_DiffuseB, inUV) * texWeight.y;
 
-	frag_color = vec4(result, textureColor.a);
+	// The lighting itself is done by our partial file
+	OutputSurface(MakeSurface(inColor * textureColor.rgb, textureColor.a, normal, u_Shininess), inWorldPos);
 }
\ No newline at end of file
@@ -4,9 +4,6 @@
 
 layout(location = 4) in mat3 inTBN;
 
-// We output a single color to the color buffer
-layout(location = 0) out vec4 frag_color;
-
 ////////////////////////////////////////////////////////////////
 /////////////// Frame Level Uniforms ///////////////////////////
 ////////////////////////////////////////////////////////////////
@@ -17,17 +14,16 @@ layout(location = 0) out vec4 frag_color;
 /////////////// Instance Level Uniforms ////////////////////////
 ////////////////////////////////////////////////////////////////
 
-// Represents a collection of attributes that would define a material
-// For instance, you can think of this like material settings in 
-// Unity
-struct Material {
-	sampler2D Diffuse;
-	float     Shininess;
+// Textures for our material, these are bound to fixed slots so the material can bind
+// them all at once (slots 0 and 1 are reserved for shared textures like the environment)
+layout (binding = 2) uniform sampler2D s_Diffuse;
+
+// The value parameters for our material, these are uploaded by the material as a single block
+layout (std140, binding = 3) uniform b_Material {
+    float u_Shininess;
 };
-// Create a uniform for the material
-uniform Material u_Material;
 
-uniform sampler2D s_NormalMap;
+layout (binding = 4) uniform sampler2D s_NormalMap;
 
 ////////////////////////////////////////////////////////////////
 ///////////// Application Level Uniforms ///////////////////////
@@ -35,27 +31,26 @@ uniform sampler2D s_NormalMap;
 
 #include "../fragments/multiple_point_lights.glsl"
 
+// Lights our surface, or writes it to the G-buffer, depending on the render path
+#include "../fragments/surface_output.glsl"
+
 const float LOG_MAX = 2.40823996531;
 
 // https://learnopengl.com/Advanced-Lighting/Advanced-Lighting
 void main() {
     
-    // Read our tangent from the map, and convert from the [0,1] range to [-1,1] range
-    vec3 normal = texture(s_NormalMap, inUV).rgb;
-    normal = normal * 2.0 - 1.0;
+    // Read our tangent from the map, and convert from the [0,1] range to [-1,1] range. Only red and
+    // green are used so the map can be stored as BC5, z is rebuilt since the normal is unit length
+    vec3 normal;
+    normal.xy = texture(s_NormalMap, inUV).rg * 2.0 - 1.0;
+    normal.z = sqrt(max(1.0 - dot(normal.xy, normal.xy), 0.0));
     
     // Here we apply the TBN matrix to transform the normal from tangent space to world space
     normal = normalize(inTBN * normal);
 
-	// Will accumulate the contributions of all lights on this fragment
-	// This is defined in the fragment file "multiple_point_lights.glsl"
-	vec3 lightAccumulation = CalcAllLightContribution(inWorldPos, normal, u_CamPos.xyz, u_Material.Shininess);
-
 	// Get the albedo from the diffuse / albedo map
-	vec4 textureColor = texture(u_Material.Diffuse, inUV);
-
-	// combine for the final result
-	vec3 result = lightAccumulation  * inColor * textureColor.rgb;
+	vec4 textureColor = texture(s_Diffuse, inUV);
 
-	frag_color = vec4(result, textureColor.a);
+	// The lighting itself is done by our partial file
+	OutputSurface(MakeSurface(inColor * textureColor.rgb, textureColor.a, normal, u_Shininess), inWorldPos);
 }
\ No newline at end of file
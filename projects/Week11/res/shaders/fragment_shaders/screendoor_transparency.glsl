@@ -2,29 +2,26 @@
 
 #include "../fragments/fs_common_inputs.glsl"
 
-// We output a single color to the color buffer
-layout(location = 0) out vec4 frag_color;
-
-// Represents a collection of attributes that would define a material
-// For instance, you can think of this like material settings in 
-// Unity
-struct Material {
-	sampler2D Diffuse;
-	float     Shininess;
-    float     Threshold;
+// Textures for our material, these are bound to fixed slots so the material can bind
+// them all at once (slots 0 and 1 are reserved for shared textures like the environment)
+layout (binding = 2) uniform sampler2D s_Diffuse;
+
+// The value parameters for our material, these are uploaded by the material as a single block
+layout (std140, binding = 3) uniform b_Material {
+    float u_Shininess;
+    float u_Threshold;
 };
-// Create a uniform for the material
-uniform Material u_Material;
 
 #include "../fragments/multiple_point_lights.glsl"
 #include "../fragments/frame_uniforms.glsl"
+#include "../fragments/surface_output.glsl"
 
 // https://learnopengl.com/Advanced-Lighting/Advanced-Lighting
 void main() {
 	// Get the albedo from the diffuse / albedo map
-	vec4 textureColor = texture(u_Material.Diffuse, inUV);
+	vec4 textureColor = texture(s_Diffuse, inUV);
 
-    if (textureColor.a < u_Material.Threshold) {
+    if (textureColor.a < u_Threshold) {
         discard;
     }
 
@@ -32,11 +29,5 @@ void main() {
 	vec3 normal = normalize(inNormal);
 
 	// Use the lighting calculation that we included from our partial file
-	vec3 lightAccumulation = CalcAllLightContribution(inWorldPos, normal, u_CamPos.xyz, u_Material.Shininess);
-
-
-	// combine for the final result
-	vec3 result = lightAccumulation  * inColor * textureColor.rgb;
-
-	frag_color = vec4(result, textureColor.a);
+	OutputSurface(MakeSurface(inColor * textureColor.rgb, textureColor.a, normal, u_Shininess), inWorldPos);
 }
\ No newline at end of file
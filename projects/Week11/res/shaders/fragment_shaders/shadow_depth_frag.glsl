@@ -0,0 +1,7 @@
+#version 440
+
+// Shadow maps only have a depth attachment, so there's nothing to output here.
+// Depth is written by the fixed function pipeline
+
+void main() { 
+}
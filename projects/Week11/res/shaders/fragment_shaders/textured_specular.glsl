@@ -2,23 +2,19 @@
 
 #include "../fragments/fs_common_inputs.glsl"
 
-// We output a single color to the color buffer
-layout(location = 0) out vec4 frag_color;
-
 ////////////////////////////////////////////////////////////////
 /////////////// Instance Level Uniforms ////////////////////////
 ////////////////////////////////////////////////////////////////
 
-// Represents a collection of attributes that would define a material
-// For instance, you can think of this like material settings in 
-// Unity
-struct Material {
-	sampler2D Diffuse;
-	sampler2D Specular;
-	float Shininess;
+// Textures for our material, these are bound to fixed slots so the material can bind
+// them all at once (slots 0 and 1 are reserved for shared textures like the environment)
+layout (binding = 2) uniform sampler2D s_Diffuse;
+layout (binding = 3) uniform sampler2D s_Specular;
+
+// The value parameters for our material, these are uploaded by the material as a single block
+layout (std140, binding = 3) uniform b_Material {
+    float u_Shininess;
 };
-// Create a uniform for the material
-uniform Material u_Material;
 
 ////////////////////////////////////////////////////////////////
 ///////////// Application Level Uniforms ///////////////////////
@@ -32,25 +28,23 @@ uniform Material u_Material;
 
 #include "../fragments/frame_uniforms.glsl"
 
+// Lights our surface, or writes it to the G-buffer, depending on the render path
+#include "../fragments/surface_output.glsl"
+
 // https://learnopengl.com/Advanced-Lighting/Advanced-Lighting
 void main() {
 	// Normalize our input normal
 	vec3 normal = normalize(inNormal);
 
-	float specPower = texture(u_Material.Specular, inUV).r;
-	
-	vec3 toEye = normalize(u_CamPos.xyz - inWorldPos);
-	vec3 environmentDir = reflect(-toEye, normal);
-	vec3 reflected = SampleEnvironmentMap(environmentDir);
-
-	// Use the lighting calculation that we included from our partial file
-	vec3 lightAccumulation = CalcAllLightContribution(inWorldPos, normal, u_CamPos.xyz, specPower);
+	float specPower = texture(s_Specular, inUV).r;
 
 	// Get the albedo from the diffuse / albedo map
-	vec4 textureColor = texture(u_Material.Diffuse, inUV);
+	vec4 textureColor = texture(s_Diffuse, inUV);
 
-	// combine for the final result
-	vec3 result = lightAccumulation  * inColor * textureColor.rgb;
+	// The specular map controls both the highlights and how much of the environment is reflected
+	Surface surface = MakeSurface(inColor * textureColor.rgb, textureColor.a, normal, specPower);
+	surface.Reflectivity = specPower;
 
-	frag_color = vec4(mix(result, reflected, specPower), textureColor.a);
+	// Use the lighting calculation that we included from our partial file
+	OutputSurface(surface, inWorldPos);
 }
\ No newline at end of file
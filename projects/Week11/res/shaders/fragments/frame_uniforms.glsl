@@ -13,11 +13,22 @@ layout (std140, binding = 0) uniform b_FrameLevelUniforms {
 };
 
 // Stores uniforms that change every object/instance
-layout (std140, binding = 1) uniform b_InstanceLevelUniforms {
+struct InstanceLevelUniforms {
     // Complete MVP
-    uniform mat4 u_ModelViewProjection;
+    mat4 ModelViewProjection;
     // Just the model transform, we'll do worldspace lighting
-    uniform mat4 u_Model;
+    mat4 Model;
     // Normal Matrix for transforming normals
-    uniform mat4 u_NormalMatrix;
-};
\ No newline at end of file
+    mat4 NormalMatrix;
+};
+
+// Objects are drawn in instanced batches by the RenderQueue, this buffer
+// holds one entry for every instance in the current batch
+layout (std430, binding = 1) readonly buffer b_InstanceLevelUniforms {
+    InstanceLevelUniforms u_Instances[];
+};
+
+// Shorthands for the current instance's data, only valid in vertex shaders
+#define u_ModelViewProjection u_Instances[gl_InstanceID].ModelViewProjection
+#define u_Model               u_Instances[gl_InstanceID].Model
+#define u_NormalMatrix        u_Instances[gl_InstanceID].NormalMatrix
\ No newline at end of file
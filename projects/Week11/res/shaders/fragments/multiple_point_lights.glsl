@@ -3,20 +3,30 @@
  * to their final output. Defines a common Light structure, uniform buffer
  * and light parameters that can be shared between all lighting enabled
  * shaders
+ *
+ * Lights are sorted into clusters (screen tiles and depth slices) on the CPU
+ * every frame, see ClusteredLighting.h. Each fragment only iterates over the
+ * lights in it's own cluster, so this file can only be used in fragment shaders
+ *
+ * The scene's directional light (the sun) is shadowed with cascaded shadow maps,
+ * and the closest shadow casting point lights get shadow cubes, see ShadowMapping.h
+ *
+ * Lit materials should go through surface_output.glsl rather than calling these directly,
+ * so that they can also be drawn with deferred shading
  * 
  * Usage:
  * vec3 normal = normalize(inNormal);
  * vec3 lighting = CalculateAllLightContribution(inWorldPos, normal, u_CamPos);
 */
 
-// The maximum number of lights the shader supports, increasing this will lower performance!
-#define MAX_LIGHTS 8
-
 // Represents a single light source
 struct Light {
-	vec4  Position;
+	// Stores position in xyz and range in w
+	vec4  PositionRange;
 	// Stores color in RBG and attenuation in w
 	vec4  ColorAttenuation;
+	// The layer of the light's cube in s_PointShadows, or -1 if the light has no shadows
+	int   ShadowLayer;
 };
 
 // Our uniform buffer that will store all our lighting data
@@ -27,16 +37,57 @@ layout (std140, binding = 2) uniform b_LightBlock {
 	// on the C++ side
     vec4  AmbientColAndNumLights;
 
-    // Our array of all lights
-    Light Lights[MAX_LIGHTS];
-
     // The rotation of the skybox/environment map
 	mat3  EnvironmentRotation;
+
+	// The direction that the sun's light travels in xyz
+	vec4  SunDirection;
+	// The color of the sun in rgb, black if there is no sun
+	vec4  SunColor;
+
+	// Transforms world positions into each cascade's shadow map, must match ShadowMapping::CASCADE_COUNT
+	mat4  CascadeViewProjections[4];
+	// The view depth that each cascade ends at
+	vec4  CascadeSplits;
+	// The size of a texel in world units for each cascade
+	vec4  CascadeTexelSizes;
+	// Stores the size of a cascade texel in uv space in x, the near plane of the
+	// shadow cubes in y, the size of a cube texel in uv space in z, and the
+	// number of cascades in w (0 if the sun has no shadows)
+	vec4  ShadowParams;
+};
+
+// All the lights in the scene
+layout (std430, binding = 4) readonly buffer b_Lights {
+	Light Lights[];
+};
+
+// The cluster grid, rebuilt every frame
+layout (std430, binding = 5) readonly buffer b_LightClusters {
+	// The number of clusters along each axis in xyz
+	uvec4 ClusterGridSize;
+	// Stores the size of a tile in pixels in xy, and the scale and bias
+	// to get a depth slice from log(depth) in zw
+	vec4  ClusterTileSizeAndSlices;
+	// Terms from the projection matrix used to get view depth from gl_FragCoord.z
+	vec4  ClusterDepthUnproject;
+	// Stores the offset into LightIndices in x, and number of lights in y
+	uvec2 Clusters[];
+};
+
+// The indices of the lights in each cluster, packed together
+layout (std430, binding = 6) readonly buffer b_LightIndices {
+	uint LightIndices[];
 };
 
 // Uniform for our environment map / skybox, bound to slot 0 by default
 uniform layout(binding=0) samplerCube s_EnvironmentMap;
 
+// The sun's shadow cascades, one per layer, bound to the reserved slot 1
+uniform layout(binding=1) sampler2DArrayShadow s_CascadeShadows;
+// The shadow cubes for point lights, bound to ShadowMapping::POINT_SHADOW_TEXTURE_SLOT
+uniform layout(binding=15) samplerCubeArrayShadow s_PointShadows;
+
 // Samples the environment map at a given direction. Will apply environment
 // rotation to the input
 // @param normal The direction to sample
@@ -46,6 +97,73 @@ vec3 SampleEnvironmentMap(vec3 normal) {
 	return texture(s_EnvironmentMap, transformed).rgb;
 }
 
+// Gets how much of the given light reaches the fragment, from 0 (fully shadowed) to 1
+// @param worldPos  The fragment's position in world space
+// @param normal    The fragment's normal (normalized)
+// @param Light     The light to test against
+float CalcPointShadow(vec3 worldPos, vec3 normal, Light light) {
+	if (light.ShadowLayer < 0) {
+		return 1.0;
+	}
+
+	// Push the position out along the normal by about a texel to avoid shadow acne, texels
+	// get bigger the further we are from the light
+	vec3  fromLight = worldPos - light.PositionRange.xyz;
+	float dist      = max(max(abs(fromLight.x), abs(fromLight.y)), abs(fromLight.z));
+	fromLight += normal * (2.0 * dist * ShadowParams.z);
+
+	// The cube face is picked by the largest axis, which is also the view depth for that face,
+	// so we can turn it into the depth that was stored with the face's projection
+	float n = ShadowParams.y;
+	float f = light.PositionRange.w;
+	float z = max(max(abs(fromLight.x), abs(fromLight.y)), abs(fromLight.z));
+	float depth = ((f + n) / (f - n) - (2.0 * f * n) / ((f - n) * z)) * 0.5 + 0.5;
+	return texture(s_PointShadows, vec4(fromLight, float(light.ShadowLayer)), depth);
+}
+
+// Gets how much of the sun reaches the fragment, from 0 (fully shadowed) to 1
+// @param worldPos  The fragment's position in world space
+// @param normal    The fragment's normal (normalized)
+// @param viewDepth The fragment's depth from the camera, used to pick the cascade
+float CalcSunShadow(vec3 worldPos, vec3 normal, float viewDepth) {
+	int cascadeCount = int(ShadowParams.w);
+	for (int ix = 0; ix < cascadeCount; ix++) {
+		if (viewDepth < CascadeSplits[ix]) {
+			// Push the position out along the normal by about a texel to avoid shadow acne
+			vec3 offsetPos = worldPos + normal * CascadeTexelSizes[ix] * 1.5;
+			vec4 shadowPos = CascadeViewProjections[ix] * vec4(offsetPos, 1.0);
+			shadowPos.xyz = shadowPos.xyz * 0.5 + 0.5;
+
+			// 3x3 PCF, each tap is also filtered by the hardware comparison
+			float shadow = 0.0;
+			for (int y = -1; y <= 1; y++) {
+				for (int x = -1; x <= 1; x++) {
+					vec2 uv = shadowPos.xy + vec2(x, y) * ShadowParams.x;
+					shadow += texture(s_CascadeShadows, vec4(uv, float(ix), shadowPos.z));
+				}
+			}
+			return shadow / 9.0;
+		}
+	}
+	// Past the last cascade, nothing is shadowed
+	return 1.0;
+}
+
+// Calculates the contribution of the sun for the current fragment
+// @param normal    The fragment's normal (normalized)
+// @param viewDir   Direction between camera and fragment
+// @param shininess The specular power for the fragment, between 0 and 1
+// @param shadow    How much of the sun reaches the fragment, see CalcSunShadow
+vec3 CalcSunContribution(vec3 normal, vec3 viewDir, float shininess, float shadow) {
+	vec3 toLight = normalize(-SunDirection.xyz);
+	vec3 halfDir = normalize(toLight + viewDir);
+
+	float specPower     = pow(max(dot(normal, halfDir), 0.0), pow(256, shininess));
+	float diffuseFactor = max(dot(normal, toLight), 0);
+
+	return (diffuseFactor + specPower) * SunColor.rgb * shadow;
+}
+
 // Calculates the contribution the given point light has 
 // for the current fragment
 // @param worldPos  The fragment's position in world space
@@ -55,7 +173,7 @@ vec3 SampleEnvironmentMap(vec3 normal) {
 // @param shininess The specular power for the fragment, between 0 and 1
 vec3 CalcPointLightContribution(vec3 worldPos, vec3 normal, vec3 viewDir, Light light, float shininess) {
 	// Get the direction to the light in world space
-	vec3 toLight = light.Position.xyz - worldPos;
+	vec3 toLight = light.PositionRange.xyz - worldPos;
 	// Get distance between fragment and light
 	float dist = length(toLight);
 	// Normalize toLight for other calculations
@@ -77,8 +195,39 @@ vec3 CalcPointLightContribution(vec3 worldPos, vec3 normal, vec3 viewDir, Light
 	// We'll use a modified distance squared attenuation factor to keep it simple
 	// We add the one to prevent divide by zero errors
 	float attenuation = clamp(1.0 / (1.0 + light.ColorAttenuation.w * pow(dist, 2)), 0, 1);
+	// Fade out to nothing at the light's range, so that it doesn't pop as it leaves a cluster
+	float window = clamp(1.0 - pow(dist / light.PositionRange.w, 4), 0, 1);
+	attenuation *= window * window;
 
-	return (diffuseOut + specularOut) * attenuation;
+	// Skip the shadow lookup for fragments that the light can't reach anyways
+	if (attenuation <= 0.0) {
+		return vec3(0.0);
+	}
+
+	return (diffuseOut + specularOut) * attenuation * CalcPointShadow(worldPos, normal, light);
+}
+
+// Converts a value from the depth buffer into view space depth
+// @param fragDepth The depth buffer value, between 0 and 1
+float GetViewDepth(float fragDepth) {
+	// Matches ClusteredLighting::__UnprojectDepth
+	float ndcDepth = fragDepth * 2.0 - 1.0;
+	return (ndcDepth * ClusterDepthUnproject.w - ClusterDepthUnproject.y) / (ndcDepth * ClusterDepthUnproject.z - ClusterDepthUnproject.x);
+}
+
+// Gets the view space depth of the current fragment
+float GetViewDepth() {
+	return GetViewDepth(gl_FragCoord.z);
+}
+
+// Gets the index of the cluster that the current fragment is in
+// @param depth The view space depth of the fragment, see GetViewDepth
+uint GetClusterIndex(float depth) {
+	// Slices are spaced exponentially, so the slice is linear in log(depth)
+	float slice = floor(log(max(depth, 0.0001)) * ClusterTileSizeAndSlices.z + ClusterTileSizeAndSlices.w);
+	uint  z     = uint(clamp(slice, 0.0, float(ClusterGridSize.z - 1)));
+	uvec2 tile  = min(uvec2(gl_FragCoord.xy / ClusterTileSizeAndSlices.xy), ClusterGridSize.xy - 1);
+	return (z * ClusterGridSize.y + tile.y) * ClusterGridSize.x + tile.x;
 }
 
 /*
@@ -87,19 +236,33 @@ vec3 CalcPointLightContribution(vec3 worldPos, vec3 normal, vec3 viewDir, Light
  * @param worldPos The fragment's position in world space
  * @param normal The normalized surface normal for the fragment
  * @param camPos The camera's position in world space
+ * @param depth The fragment's view space depth, for when the fragment being lit is not the one
+ *              being drawn (ex: deferred shading), see GetViewDepth
 */
-vec3 CalcAllLightContribution(vec3 worldPos, vec3 normal, vec3 camPos, float shininess) {
+vec3 CalcAllLightContribution(vec3 worldPos, vec3 normal, vec3 camPos, float shininess, float depth) {
     // Will accumulate the contributions of all lights on this fragment
 	vec3 lightAccumulation = AmbientColAndNumLights.rgb;
 
 	// Direction between camera and fragment will be shared for all lights
 	vec3 viewDir  = normalize(camPos - worldPos);
+
+	// The sun reaches everything, unless it's in shadow
+	if (dot(SunColor.rgb, SunColor.rgb) > 0.0) {
+		float shadow = CalcSunShadow(worldPos, normal, depth);
+		lightAccumulation += CalcSunContribution(normal, viewDir, shininess, shadow);
+	}
 	
-	// Iterate over all lights
-	for(int ix = 0; ix < AmbientColAndNumLights.w && ix < MAX_LIGHTS; ix++) {
+	// Iterate over only the lights that can reach our cluster
+	uvec2 cluster = Clusters[GetClusterIndex(depth)];
+	for(uint ix = 0; ix < cluster.y; ix++) {
 		// Additive lighting model
-		lightAccumulation += CalcPointLightContribution(worldPos, normal, viewDir, Lights[ix], shininess);
+		lightAccumulation += CalcPointLightContribution(worldPos, normal, viewDir, Lights[LightIndices[cluster.x + ix]], shininess);
 	}
 
 	return lightAccumulation;
+}
+
+// Calculates the lighting contribution for all lights in the scene for the fragment being drawn
+vec3 CalcAllLightContribution(vec3 worldPos, vec3 normal, vec3 camPos, float shininess) {
+	return CalcAllLightContribution(worldPos, normal, camPos, shininess, GetViewDepth());
 }
\ No newline at end of file
@@ -0,0 +1,44 @@
+/*
+ * This is a partial file that writes the surface of a lit material out to
+ * whichever render path is drawing it. Lit fragment shaders fill out a Surface
+ * (see surface_shading.glsl) and pass it to OutputSurface, instead of lighting
+ * the fragment themselves. The shader is compiled once for every ShaderVariant:
+ *  - By default, the surface is lit right away (forward shading)
+ *  - With SURFACE_GBUFFER defined, the surface is written to the G-buffer and
+ *    lit later by fragment_shaders/deferred_lighting.glsl
+ *  - With SURFACE_DEPTH_ONLY defined, nothing is written, this is used for depth
+ *    pre-passes. Fragments can still be discarded before calling OutputSurface
+ *
+ * The pragma below marks the shader as supporting these variants, see Shader::GetVariant
+ *
+ * Must be included after multiple_point_lights.glsl and frame_uniforms.glsl
+ *
+ * Usage:
+ * OutputSurface(MakeSurface(albedo, alpha, normalize(inNormal), u_Shininess), inWorldPos);
+*/
+#pragma surface_variants
+
+#include "surface_shading.glsl"
+
+#if defined(SURFACE_GBUFFER)
+// The G-buffer layout, must match DeferredShading
+layout(location = 0) out vec4 gb_AlbedoShininess;
+layout(location = 1) out vec2 gb_Normal;
+layout(location = 2) out vec4 gb_Material;
+#elif !defined(SURFACE_DEPTH_ONLY)
+// We output a single color to the color buffer
+layout(location = 0) out vec4 frag_color;
+#endif
+
+// Writes a surface out for the current render path
+// @param surface  The surface of the fragment
+// @param worldPos The fragment's position in world space
+void OutputSurface(Surface surface, vec3 worldPos) {
+#if defined(SURFACE_GBUFFER)
+	gb_AlbedoShininess = vec4(surface.Albedo, surface.Shininess);
+	gb_Normal          = EncodeNormal(surface.Normal);
+	gb_Material        = vec4(surface.Reflectivity, float(surface.ToonSteps) / 255.0, float(surface.ShadingModel) / 255.0, 0.0);
+#elif !defined(SURFACE_DEPTH_ONLY)
+	frag_color = vec4(ShadeSurface(surface, worldPos, GetViewDepth()), surface.Alpha);
+#endif
+}
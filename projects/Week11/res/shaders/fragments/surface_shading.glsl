@@ -0,0 +1,91 @@
+/*
+ * This is a partial file that describes the surface of a lit material, and
+ * how that surface is lit. It is shared by forward shading (surface_output.glsl)
+ * and deferred shading (fragment_shaders/deferred_lighting.glsl), so that both
+ * render paths give the same result
+ *
+ * Must be included after multiple_point_lights.glsl and frame_uniforms.glsl
+*/
+
+// The shading models, these are stored in the G-buffer so that the lighting pass
+// knows how to light each pixel. None marks pixels that nothing was drawn to
+#define SHADING_MODEL_NONE 0
+#define SHADING_MODEL_LIT  1
+#define SHADING_MODEL_TOON 2
+
+// Everything we need to know about a surface to light it
+struct Surface {
+	// The color of the surface, and it's alpha
+	vec3  Albedo;
+	float Alpha;
+	// The surface normal in world space (normalized)
+	vec3  Normal;
+	// The specular power of the surface, between 0 and 1
+	float Shininess;
+	// How much of the environment map the surface reflects, between 0 and 1
+	float Reflectivity;
+	// The number of color steps for SHADING_MODEL_TOON, between 1 and 255
+	int   ToonSteps;
+	// One of the SHADING_MODEL values
+	int   ShadingModel;
+};
+
+// Makes a regular lit surface that doesn't reflect the environment
+Surface MakeSurface(vec3 albedo, float alpha, vec3 normal, float shininess) {
+	Surface surface;
+	surface.Albedo       = albedo;
+	surface.Alpha        = alpha;
+	surface.Normal       = normal;
+	surface.Shininess    = shininess;
+	surface.Reflectivity = 0.0;
+	surface.ToonSteps    = 1;
+	surface.ShadingModel = SHADING_MODEL_LIT;
+	return surface;
+}
+
+// Lights a surface with all the lights in the scene
+// @param surface   The surface to light
+// @param worldPos  The position of the surface in world space
+// @param viewDepth The view space depth of the surface, see GetViewDepth
+// @returns The final RGB color of the surface
+vec3 ShadeSurface(Surface surface, vec3 worldPos, float viewDepth) {
+	vec3 lightAccumulation = CalcAllLightContribution(worldPos, surface.Normal, u_CamPos.xyz, surface.Shininess, viewDepth);
+	vec3 result = lightAccumulation * surface.Albedo;
+
+	// Blend towards the reflection of the environment
+	if (surface.Reflectivity > 0.0) {
+		vec3 toEye = normalize(u_CamPos.xyz - worldPos);
+		vec3 environmentDir = reflect(-toEye, surface.Normal);
+		result = mix(result, SampleEnvironmentMap(environmentDir), surface.Reflectivity);
+	}
+
+	// Simple way to create cel shading effect
+	if (surface.ShadingModel == SHADING_MODEL_TOON) {
+		result = round(result * surface.ToonSteps) / surface.ToonSteps;
+	}
+
+	return result;
+}
+
+// Packs a normal into 2 components with an octahedral mapping, for storing in the G-buffer
+// @param normal The normal to pack (normalized)
+// @returns The packed normal, each component is between -1 and 1
+vec2 EncodeNormal(vec3 normal) {
+	normal /= abs(normal.x) + abs(normal.y) + abs(normal.z);
+	if (normal.z < 0.0) {
+		vec2 signs = vec2(normal.x >= 0.0 ? 1.0 : -1.0, normal.y >= 0.0 ? 1.0 : -1.0);
+		return (1.0 - abs(normal.yx)) * signs;
+	}
+	return normal.xy;
+}
+
+// Unpacks a normal that was packed with EncodeNormal
+// @param encoded The packed normal
+// @returns The normal (normalized)
+vec3 DecodeNormal(vec2 encoded) {
+	vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	float fold = max(-normal.z, 0.0);
+	normal.x += normal.x >= 0.0 ? -fold : fold;
+	normal.y += normal.y >= 0.0 ? -fold : fold;
+	return normalize(normal);
+}
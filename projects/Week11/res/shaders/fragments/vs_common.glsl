@@ -5,8 +5,9 @@ layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec3 inNormal;
 layout(location = 3) in vec2 inUV;
 
-layout(location = 4) in vec3 inTangent;
-layout(location = 5) in vec3 inBiTangent;
+// The w component of the tangent holds the handedness of the bitangent, meshes that
+// don't store it get the default of 1
+layout(location = 4) in vec4 inTangent;
 
 // Standard vertex shader outputs
 layout(location = 0) out vec3 outWorldPos;
@@ -15,5 +16,9 @@ layout(location = 2) out vec3 outNormal;
 layout(location = 3) out vec2 outUV;
 layout(location = 4) out mat3 outTBN;
 
+// Depth pre-passes draw objects again with another variant of their shader (see Shader::GetVariant),
+// so positions have to come out exactly the same in every program
+invariant gl_Position;
+
 // Include the matrices and frame level parameters
 #include "frame_uniforms.glsl"
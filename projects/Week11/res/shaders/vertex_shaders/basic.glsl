@@ -15,9 +15,10 @@ void main() {
 	outNormal = mat3(u_NormalMatrix) * inNormal;
 
     // We use a TBN matrix for tangent space normal mapping
-    vec3 T = normalize(vec3(mat3(u_NormalMatrix) * inTangent));
-    vec3 B = normalize(vec3(mat3(u_NormalMatrix) * inBiTangent));
+    vec3 T = normalize(vec3(mat3(u_NormalMatrix) * inTangent.xyz));
     vec3 N = normalize(vec3(mat3(u_NormalMatrix) * inNormal));
+    // The bitangent isn't stored, we rebuild it from the normal and tangent
+    vec3 B = cross(N, T) * inTangent.w;
     mat3 TBN = mat3(T, B, N);
 
     // We can pass the TBN matrix to the fragment shader to save computation
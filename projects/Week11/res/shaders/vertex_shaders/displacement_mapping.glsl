@@ -6,8 +6,8 @@
 // For more detailed explanations, see
 // https://learnopengl.com/Advanced-Lighting/Normal-Mapping
 
-uniform sampler2D s_Heightmap;
-uniform sampler2D s_NormalMap;
+layout (binding = 5) uniform sampler2D s_Heightmap;
+layout (binding = 4) uniform sampler2D s_NormalMap;
 uniform float u_Scale;
 
 void main() {
@@ -26,17 +26,20 @@ void main() {
 	outWorldPos = (u_Model * vec4(displacedPos, 1.0)).xyz;
 
     // We use a TBN matrix for tangent space normal mapping
-    vec3 T = normalize(vec3(mat3(u_NormalMatrix) * inTangent));
-    vec3 B = normalize(vec3(mat3(u_NormalMatrix) * inBiTangent));
+    vec3 T = normalize(vec3(mat3(u_NormalMatrix) * inTangent.xyz));
     vec3 N = normalize(vec3(mat3(u_NormalMatrix) * inNormal));
+    // The bitangent isn't stored, we rebuild it from the normal and tangent
+    vec3 B = cross(N, T) * inTangent.w;
     mat3 TBN = mat3(T, B, N);
 
     // We can pass the TBN matrix to the fragment shader to save computation
     outTBN = TBN;
 
-    // Read our tangent from the map, and convert from the [0,1] range to [-1,1] range
-    vec3 normal = texture(s_NormalMap, inUV).rgb;
-    normal = normal * 2.0 - 1.0;
+    // Read our tangent from the map, and convert from the [0,1] range to [-1,1] range. Only red and
+    // green are used so the map can be stored as BC5, z is rebuilt since the normal is unit length
+    vec3 normal;
+    normal.xy = texture(s_NormalMap, inUV).rg * 2.0 - 1.0;
+    normal.z = sqrt(max(1.0 - dot(normal.xy, normal.xy), 0.0));
     
     // Here we apply the TBN matrix to transform the normal from tangent space to world space
     normal = normalize(TBN * normal);
@@ -0,0 +1,10 @@
+#version 440
+
+// Draws a single triangle that covers the whole screen, so no vertex data is needed.
+// Draw with glDrawArrays(GL_TRIANGLES, 0, 3) with any vertex array bound
+
+void main() {
+	// Vertices end up at (-1, -1), (3, -1) and (-1, 3)
+	vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+	gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
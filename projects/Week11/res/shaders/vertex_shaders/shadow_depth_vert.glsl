@@ -0,0 +1,13 @@
+#version 440
+
+// Used by ShadowMapping to render shadow casters into the shadow maps, only
+// the position is needed since we only write depth
+
+layout(location = 0) in vec3 inPosition;
+
+// Include the matrices and frame level parameters, the MVP is from the light's point of view
+#include "../fragments/frame_uniforms.glsl"
+
+void main() {
+	gl_Position = u_ModelViewProjection * vec4(inPosition, 1.0);
+}
@@ -0,0 +1,188 @@
+#include "Gameplay/ClusteredLighting.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+#include <Logging.h>
+
+#include "Utils/Profiler.h"
+
+namespace Gameplay {
+	ClusteredLighting::ClusteredLighting() :
+		_lights(),
+		_clusters(),
+		_clusterLights(),
+		_lightIndices(),
+		_buffer(nullptr),
+		_stats({ 0, 0, 0 })
+	{
+		// Enough for the cluster grid, a few hundred lights and a few thousand light indices before we need to grow
+		_buffer = StreamingBuffer::Create(BufferType::ShaderStorage, 128 * 1024);
+		_clusters.resize(CLUSTER_COUNT);
+	}
+
+	void ClusteredLighting::SetLightCount(size_t count) {
+		_lights.resize(count, LightData{ glm::vec3(0.0f), 0.0f, glm::vec3(0.0f), 1.0f, -1, { 0, 0, 0 } });
+	}
+
+	void ClusteredLighting::SetLight(size_t index, const Light& light) {
+		LOG_ASSERT(index < _lights.size(), "Light index out of range!");
+		LightData& data = _lights[index];
+		data.Position    = light.Position;
+		data.Range       = light.Range;
+		data.Color       = light.Color;
+		data.Attenuation = 1.0f / (1.0f + light.Range);
+	}
+
+	void ClusteredLighting::SetShadowLayer(size_t index, int layer) {
+		LOG_ASSERT(index < _lights.size(), "Light index out of range!");
+		_lights[index].ShadowLayer = layer;
+	}
+
+	void ClusteredLighting::Update(const glm::mat4& view, const glm::mat4& projection, const glm::ivec2& viewportSize) {
+		PROFILE_SCOPE("ClusteredLighting::Update");
+
+		ClusterHeader header;
+		header.GridSize = glm::uvec4(GRID_SIZE_X, GRID_SIZE_Y, GRID_SIZE_Z, 0);
+		header.DepthUnproject = glm::vec4(projection[2][2], projection[3][2], projection[2][3], projection[3][3]);
+
+		// Exponential slices need a near plane in front of the camera, which orthographic cameras don't always have
+		float nearDepth = std::max(__UnprojectDepth(header.DepthUnproject, -1.0f), 0.01f);
+		float farDepth  = std::max(__UnprojectDepth(header.DepthUnproject,  1.0f), nearDepth * 1.01f);
+		float logDepthRatio = std::log(farDepth / nearDepth);
+		glm::vec2 tileSize = glm::vec2(glm::max(viewportSize, glm::ivec2(1))) / glm::vec2(GRID_SIZE_X, GRID_SIZE_Y);
+		header.TileSizeAndSlices = glm::vec4(
+			tileSize,
+			GRID_SIZE_Z / logDepthRatio,
+			-GRID_SIZE_Z * std::log(nearDepth) / logDepthRatio
+		);
+
+		// Collect every cluster that each light touches
+		_stats = { 0, 0, 0 };
+		_clusterLights.clear();
+		for (size_t ix = 0; ix < _lights.size(); ix++) {
+			const LightData& light = _lights[ix];
+			if (light.Range <= 0.0f) {
+				continue;
+			}
+			glm::vec3 viewPos = glm::vec3(view * glm::vec4(light.Position, 1.0f));
+			if (_BinLight(static_cast<uint32_t>(ix), viewPos, light.Range, projection, header, nearDepth, farDepth)) {
+				_stats.VisibleLights++;
+			}
+		}
+
+		// Count the lights in each cluster, then turn the counts into offsets so we can
+		// scatter the light indices into one tightly packed list
+		std::fill(_clusters.begin(), _clusters.end(), Cluster{ 0, 0 });
+		for (const ClusterLight& item : _clusterLights) {
+			_clusters[item.Cluster].Count++;
+		}
+		uint32_t offset = 0;
+		for (Cluster& cluster : _clusters) {
+			cluster.Offset = offset;
+			offset += cluster.Count;
+			_stats.MaxLightsPerCluster = std::max(_stats.MaxLightsPerCluster, cluster.Count);
+			cluster.Count = 0;
+		}
+		_stats.LightIndices = offset;
+
+		// Shaders can't have empty buffers bound, so we always send at least one element
+		_lightIndices.resize(std::max(offset, 1u));
+		for (const ClusterLight& item : _clusterLights) {
+			Cluster& cluster = _clusters[item.Cluster];
+			_lightIndices[cluster.Offset + cluster.Count] = item.Light;
+			cluster.Count++;
+		}
+
+		// Each allocation is bound straight away, since a later allocation may grow the buffer
+		if (_lights.empty()) {
+			_buffer->BindRange(LIGHT_SSBO_BINDING, _buffer->Push(LightData()));
+		} else {
+			_buffer->BindRange(LIGHT_SSBO_BINDING, _buffer->Push(_lights.data(), _lights.size() * sizeof(LightData)));
+		}
+
+		StreamingBuffer::Allocation clusters = _buffer->Allocate(sizeof(ClusterHeader) + _clusters.size() * sizeof(Cluster));
+		memcpy(clusters.Data, &header, sizeof(ClusterHeader));
+		memcpy(clusters.Data + sizeof(ClusterHeader), _clusters.data(), _clusters.size() * sizeof(Cluster));
+		_buffer->BindRange(CLUSTER_SSBO_BINDING, clusters);
+
+		_buffer->BindRange(LIGHT_INDEX_SSBO_BINDING, _buffer->Push(_lightIndices.data(), _lightIndices.size() * sizeof(uint32_t)));
+	}
+
+	void ClusteredLighting::EndFrame() {
+		_buffer->NextFrame();
+	}
+
+	bool ClusteredLighting::_BinLight(uint32_t lightIndex, const glm::vec3& viewPos, float range, const glm::mat4& projection, const ClusterHeader& header, float nearDepth, float farDepth) {
+		// The camera looks down -Z, it's easier to work with positive depths
+		float depth    = -viewPos.z;
+		float minDepth = depth - range;
+		float maxDepth = depth + range;
+		if (maxDepth < nearDepth || minDepth > farDepth) {
+			return false;
+		}
+
+		auto sliceFromDepth = [&](float value) {
+			int slice = static_cast<int>(std::floor(std::log(value) * header.TileSizeAndSlices.z + header.TileSizeAndSlices.w));
+			return std::clamp(slice, 0, GRID_SIZE_Z - 1);
+		};
+		int firstSlice = sliceFromDepth(std::max(minDepth, nearDepth));
+		int lastSlice  = sliceFromDepth(std::min(maxDepth, farDepth));
+
+		bool isVisible = false;
+		for (int z = firstSlice; z <= lastSlice; z++) {
+			// The part of the slice that overlaps the light's sphere
+			float sliceNear = nearDepth * std::pow(farDepth / nearDepth, static_cast<float>(z) / GRID_SIZE_Z);
+			float sliceFar  = nearDepth * std::pow(farDepth / nearDepth, static_cast<float>(z + 1) / GRID_SIZE_Z);
+			sliceNear = std::max(sliceNear, std::max(minDepth, nearDepth));
+			sliceFar  = std::min(sliceFar, maxDepth);
+			if (sliceNear > sliceFar) {
+				continue;
+			}
+
+			// The radius of the sphere's widest cross section within the slice, this keeps
+			// the tiles tight at the front and back of the sphere
+			float offset = depth - std::clamp(depth, sliceNear, sliceFar);
+			float radius = std::sqrt(std::max(range * range - offset * offset, 0.0f));
+
+			// Project the corners of the box around that cross section to find the screen tiles it covers
+			glm::vec2 ndcMin = glm::vec2(std::numeric_limits<float>::max());
+			glm::vec2 ndcMax = glm::vec2(std::numeric_limits<float>::lowest());
+			for (int ix = 0; ix < 8; ix++) {
+				glm::vec4 corner = glm::vec4(
+					viewPos.x + ((ix & 1) ? radius : -radius),
+					viewPos.y + ((ix & 2) ? radius : -radius),
+					-((ix & 4) ? sliceFar : sliceNear),
+					1.0f
+				);
+				glm::vec4 clip = projection * corner;
+				glm::vec2 ndc  = glm::vec2(clip) / clip.w;
+				ndcMin = glm::min(ndcMin, ndc);
+				ndcMax = glm::max(ndcMax, ndc);
+			}
+			if (ndcMax.x < -1.0f || ndcMax.y < -1.0f || ndcMin.x > 1.0f || ndcMin.y > 1.0f) {
+				continue;
+			}
+
+			int minX = std::clamp(static_cast<int>(std::floor((ndcMin.x * 0.5f + 0.5f) * GRID_SIZE_X)), 0, GRID_SIZE_X - 1);
+			int maxX = std::clamp(static_cast<int>(std::floor((ndcMax.x * 0.5f + 0.5f) * GRID_SIZE_X)), 0, GRID_SIZE_X - 1);
+			int minY = std::clamp(static_cast<int>(std::floor((ndcMin.y * 0.5f + 0.5f) * GRID_SIZE_Y)), 0, GRID_SIZE_Y - 1);
+			int maxY = std::clamp(static_cast<int>(std::floor((ndcMax.y * 0.5f + 0.5f) * GRID_SIZE_Y)), 0, GRID_SIZE_Y - 1);
+			for (int y = minY; y <= maxY; y++) {
+				for (int x = minX; x <= maxX; x++) {
+					uint32_t cluster = static_cast<uint32_t>((z * GRID_SIZE_Y + y) * GRID_SIZE_X + x);
+					_clusterLights.push_back(ClusterLight{ cluster, lightIndex });
+				}
+			}
+			isVisible = true;
+		}
+		return isVisible;
+	}
+
+	float ClusteredLighting::__UnprojectDepth(const glm::vec4& depthUnproject, float ndcDepth) {
+		// Solves ndc = (P22 * z + P32) / (P23 * z + P33) for the view space z, works for both
+		// perspective and orthographic projections. Matches GetClusterIndex in the shader
+		return (ndcDepth * depthUnproject.w - depthUnproject.y) / (ndcDepth * depthUnproject.z - depthUnproject.x);
+	}
+}
@@ -0,0 +1,163 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <GLM/glm.hpp>
+
+#include "Gameplay/Light.h"
+#include "Graphics/StreamingBuffer.h"
+
+namespace Gameplay {
+	/// <summary>
+	/// Handles clustered forward lighting. The view frustum is split into a grid of clusters
+	/// (tiles across the screen, and exponentially spaced slices in depth), and every frame
+	/// each light is binned into the clusters that it's range overlaps. Fragment shaders find
+	/// their cluster from gl_FragCoord, and only shade the lights in that cluster, so the cost
+	/// of a fragment depends on how many lights actually reach it rather than the total number
+	/// of lights in the scene
+	///
+	/// Binning is done on the CPU, and the lights, cluster grid and light index list are all
+	/// streamed to SSBOs each frame. Shaders access them via fragments/multiple_point_lights.glsl
+	/// </summary>
+	class ClusteredLighting {
+	public:
+		typedef std::shared_ptr<ClusteredLighting> Sptr;
+
+		// The number of clusters along each axis of the view frustum
+		inline static const int GRID_SIZE_X = 16;
+		inline static const int GRID_SIZE_Y = 9;
+		inline static const int GRID_SIZE_Z = 24;
+		inline static const int CLUSTER_COUNT = GRID_SIZE_X * GRID_SIZE_Y * GRID_SIZE_Z;
+
+		// SSBO binding slots, these must match fragments/multiple_point_lights.glsl
+		inline static const int LIGHT_SSBO_BINDING       = 4;
+		inline static const int CLUSTER_SSBO_BINDING     = 5;
+		inline static const int LIGHT_INDEX_SSBO_BINDING = 6;
+
+		/// <summary>
+		/// A single light, matches the std430 layout of Light in fragments/multiple_point_lights.glsl
+		/// </summary>
+		struct LightData {
+			glm::vec3 Position;
+			float     Range;
+			glm::vec3 Color;
+			float     Attenuation;
+			// The layer of the light's shadow cube, or -1 if it has no shadows, see ShadowMapping
+			int32_t   ShadowLayer;
+			// std430 rounds the struct up to a multiple of 16 bytes
+			int32_t   _padding[3];
+		};
+
+		/// <summary>
+		/// Statistics from the last call to Update, handy for debugging
+		/// </summary>
+		struct Stats {
+			// The number of lights that overlapped the view frustum
+			uint32_t VisibleLights;
+			// The total number of light indices across all clusters
+			uint32_t LightIndices;
+			// The highest number of lights in a single cluster
+			uint32_t MaxLightsPerCluster;
+		};
+
+		// We'll disallow moving and copying, since we own GL resources
+		ClusteredLighting(const ClusteredLighting& other) = delete;
+		ClusteredLighting(ClusteredLighting&& other) = delete;
+		ClusteredLighting& operator=(const ClusteredLighting& other) = delete;
+		ClusteredLighting& operator=(ClusteredLighting&& other) = delete;
+
+		static inline Sptr Create() {
+			return std::make_shared<ClusteredLighting>();
+		}
+
+		ClusteredLighting();
+		~ClusteredLighting() = default;
+
+		/// <summary>
+		/// Sets the number of lights, any new lights will be black until they are set
+		/// </summary>
+		void SetLightCount(size_t count);
+		/// <summary>
+		/// Copies a scene light into the light data that will be sent to the GPU
+		/// </summary>
+		/// <param name="index">The index of the light, must be less than the light count</param>
+		/// <param name="light">The light to copy</param>
+		void SetLight(size_t index, const Light& light);
+		/// <summary>
+		/// Sets the layer of the shadow cube that the light should sample from
+		/// </summary>
+		/// <param name="index">The index of the light, must be less than the light count</param>
+		/// <param name="layer">The layer in the point shadow cube array, or -1 for no shadows</param>
+		void SetShadowLayer(size_t index, int layer);
+		/// <summary>
+		/// Gets the number of lights
+		/// </summary>
+		size_t GetLightCount() const { return _lights.size(); }
+
+		/// <summary>
+		/// Bins all the lights into clusters for the given camera, uploads the results and
+		/// binds them to their SSBO slots. Must be called once per frame before drawing
+		/// anything that is lit
+		/// </summary>
+		/// <param name="view">The camera's view matrix</param>
+		/// <param name="projection">The camera's projection matrix, may be perspective or orthographic</param>
+		/// <param name="viewportSize">The size of the viewport in pixels</param>
+		void Update(const glm::mat4& view, const glm::mat4& projection, const glm::ivec2& viewportSize);
+
+		/// <summary>
+		/// Marks the end of the frame, must be called once per frame after all lit
+		/// objects have been drawn so that the streaming buffer can be recycled safely
+		/// </summary>
+		void EndFrame();
+
+		/// <summary>
+		/// Gets the statistics from the last call to Update
+		/// </summary>
+		const Stats& GetStats() const { return _stats; }
+
+	protected:
+		/// <summary>
+		/// Data at the start of the cluster SSBO, matches the std430 layout of b_LightClusters
+		/// </summary>
+		struct ClusterHeader {
+			// The number of clusters along each axis, w is unused
+			glm::uvec4 GridSize;
+			// xy is the size of a tile in pixels, z and w are the scale and bias to get a slice from log(depth)
+			glm::vec4  TileSizeAndSlices;
+			// Terms of the projection matrix used to recover view depth from NDC depth
+			glm::vec4  DepthUnproject;
+		};
+
+		// A cluster's offset into the light index list, and the number of lights in it
+		struct Cluster {
+			uint32_t Offset;
+			uint32_t Count;
+		};
+
+		// A light touching a cluster, collected before being sorted into the index list
+		struct ClusterLight {
+			uint32_t Cluster;
+			uint32_t Light;
+		};
+
+		std::vector<LightData>    _lights;
+		std::vector<Cluster>      _clusters;
+		std::vector<ClusterLight> _clusterLights;
+		std::vector<uint32_t>     _lightIndices;
+
+		StreamingBuffer::Sptr     _buffer;
+
+		Stats _stats;
+
+		/// <summary>
+		/// Adds the light to every cluster that it's bounding sphere may touch
+		/// </summary>
+		/// <returns>True if the light touched any clusters</returns>
+		bool _BinLight(uint32_t lightIndex, const glm::vec3& viewPos, float range, const glm::mat4& projection, const ClusterHeader& header, float nearDepth, float farDepth);
+
+		/// <summary>
+		/// Gets the positive view space depth for a depth value in normalized device coordinates
+		/// </summary>
+		static float __UnprojectDepth(const glm::vec4& depthUnproject, float ndcDepth);
+	};
+}
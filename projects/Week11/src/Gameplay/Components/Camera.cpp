@@ -5,6 +5,7 @@
 #include "Utils/GlmDefines.h"
 #include "Gameplay/GameObject.h"
 #include "Utils/ImGuiHelper.h"
+#include "Utils/BinaryStream.h"
 
 namespace Gameplay {
 	void Camera::RenderImGui()
@@ -25,6 +26,24 @@ namespace Gameplay {
 		}
 	}
 
+	void Camera::SaveSnapshot(BinaryWriter& writer) const {
+		writer.Write(_nearPlane);
+		writer.Write(_farPlane);
+		writer.Write(_fovRadians);
+		writer.Write(_orthoVerticalScale);
+		writer.Write(_isOrtho);
+	}
+
+	void Camera::RestoreSnapshot(BinaryReader& reader) {
+		_nearPlane          = reader.Read<float>();
+		_farPlane           = reader.Read<float>();
+		_fovRadians         = reader.Read<float>();
+		_orthoVerticalScale = reader.Read<float>();
+		_isOrtho            = reader.Read<bool>();
+		_isProjectionDirty  = true;
+		_isDirty            = true;
+	}
+
 	nlohmann::json Camera::ToJson() const
 	{
 		return {
@@ -20,6 +20,8 @@ namespace Gameplay {
 	// IComponent implementation
 	public:
 		virtual void RenderImGui() override;
+		virtual void SaveSnapshot(BinaryWriter& writer) const override;
+		virtual void RestoreSnapshot(BinaryReader& reader) override;
 
 		MAKE_TYPENAME(Camera);
 
@@ -0,0 +1,73 @@
+#pragma once
+#include "EnumToString.h"
+
+namespace Gameplay {
+	/// <summary>
+	/// The shared data that a component type may touch in it's Update method
+	/// </summary>
+	ENUM_FLAGS(ComponentAccessFlags, uint32_t,
+		None       = 0,
+		// The transform of the component's own gameobject
+		Transform  = 1,
+		// Physics bodies and trigger volumes
+		Physics    = 2,
+		// Render components and materials
+		Rendering  = 4,
+		// The scene's lights
+		Lights     = 8,
+		// Cameras
+		Camera     = 16
+	);
+
+	/// <summary>
+	/// Describes what a component type does in it's Update method, so that the scene
+	/// can decide which component types are safe to update at the same time. This is
+	/// passed to ComponentManager::RegisterType
+	///
+	/// Types that may run on worker threads must only touch their own gameobject and
+	/// the shared data they declare. Anything that uses GLFW, ImGui, OpenGL or creates
+	/// or removes objects directly must run on the main thread (structural changes can
+	/// be deferred with the scene's command buffer instead)
+	/// </summary>
+	struct ComponentAccess {
+		// The data the type reads in Update
+		ComponentAccessFlags Reads;
+		// The data the type writes in Update, implies reading
+		ComponentAccessFlags Writes;
+		// True if the type must be updated on the main thread
+		bool                 IsMainThreadOnly;
+		// True if the type does not override Update, so it never needs to be updated
+		bool                 IsUpdateSkipped;
+
+		/// <summary>
+		/// Access for types that must be updated on the main thread, this is the default
+		/// </summary>
+		static ComponentAccess MainThread() {
+			return ComponentAccess{ ComponentAccessFlags::None, ComponentAccessFlags::None, true, false };
+		}
+		/// <summary>
+		/// Access for types that can be updated on any thread
+		/// </summary>
+		/// <param name="reads">The shared data the type reads</param>
+		/// <param name="writes">The shared data the type writes</param>
+		static ComponentAccess Parallel(ComponentAccessFlags reads, ComponentAccessFlags writes) {
+			return ComponentAccess{ reads, writes, false, false };
+		}
+		/// <summary>
+		/// Access for types that do not override Update
+		/// </summary>
+		static ComponentAccess NoUpdate() {
+			return ComponentAccess{ ComponentAccessFlags::None, ComponentAccessFlags::None, false, true };
+		}
+
+		/// <summary>
+		/// Returns true if the two types may not be updated at the same time, because one
+		/// writes data that the other reads or writes
+		/// </summary>
+		bool ConflictsWith(const ComponentAccess& other) const {
+			ComponentAccessFlags touched = Reads | Writes;
+			ComponentAccessFlags otherTouched = other.Reads | other.Writes;
+			return *(Writes & otherTouched) != 0 || *(other.Writes & touched) != 0;
+		}
+	};
+}
@@ -1,6 +1,8 @@
 #pragma once
 #include <functional>
+#include <type_traits>
 #include "IComponent.h"
+#include "ComponentAccess.h"
 #include <typeindex>
 #include <optional>
 
@@ -41,7 +43,7 @@ namespace Gameplay {
 					result->_weakSelfPtr = result;
 
 					// Add the component to the global pools
-					_Components[result->_realType].push_back(result);
+					_AddToPool(result.get());
 					return result;
 				}
 			}
@@ -71,7 +73,7 @@ namespace Gameplay {
 					result->_realType = typeIndex.value();
 					result->_weakSelfPtr = result;
 					// Add the component to the global pools
-					_Components[result->_realType].push_back(result);
+					_AddToPool(result.get());
 					return result;
 				}
 			}
@@ -98,7 +100,7 @@ namespace Gameplay {
 				result->_realType = type;
 				result->_weakSelfPtr = result;
 				// Add the component to the global pools
-				_Components[result->_realType].push_back(result);
+				_AddToPool(result.get());
 				return result;
 			}
 			return nullptr;
@@ -140,8 +142,8 @@ namespace Gameplay {
 			// Give the component a weak pointer to itself that it can upcast to a shared pointer when needed
 			component->_weakSelfPtr = component;
 
-			// Add to global component list for that type
-			_Components[type].push_back(component);
+			// Add to global component pool for that type
+			_AddToPool(component.get());
 
 			// Return the result
 			return component;
@@ -162,58 +164,137 @@ namespace Gameplay {
 			std::type_index type = std::type_index(typeid(ComponentType));
 			LOG_ASSERT(_TypeLoadRegistry[type] != nullptr, "You must register component types before creating them!");
 
-			// Clear any dead weak pointers
-			std::remove_if(_Components[type].begin(), _Components[type].end(), [](const std::weak_ptr<IComponent>& ptr) {
-				return ptr.expired();
-			});
-
-			// Search the component store for a component that matches that ID
-			auto& it = std::find_if(_Components[type].begin(), _Components[type].end(), [&](const std::weak_ptr<IComponent>& ptr) {
-				return (ptr.lock())->GetGUID() == id;
-			});
-
-			// If the component was found, return it. Otherwise return nullptr
-			if (it != _Components[type].end()) {
-				// We need to lock the weak pointer to convert it to a shared ptr
-				return std::dynamic_pointer_cast<ComponentType>((*it).lock());
-			} else {
-				return nullptr;
+			// Look up the component in the pool's GUID index
+			// Components remove themselves from the pool on destruction, so every entry is alive
+			const ComponentPool& pool = _Components[type];
+			auto it = pool.ByGuid.find(id);
+			if (it != pool.ByGuid.end()) {
+				// The pool only stores components of exactly this type, so a static cast is safe
+				return std::static_pointer_cast<ComponentType>(it->second->_weakSelfPtr.lock());
 			}
+			return nullptr;
 		}
 
 		/// <summary>
 		/// Iterates over all components of the given type and invokes a method with them
+		/// 
+		/// The callback should take a ComponentType&amp;, which lets us walk the dense index without
+		/// touching any reference counts. Callbacks that take a const std::shared_ptr&lt;ComponentType&gt;&amp;
+		/// are still supported, but will pay for a weak_ptr lock per component
+		/// 
+		/// The callback may safely destroy any component of this type, removals are deferred until
+		/// the iteration is done so that no component is skipped or visited twice. Components that
+		/// are destroyed before they are visited are skipped, and components created during iteration
+		/// are not visited
 		/// </summary>
 		/// <typeparam name="ComponentType">The type of component to iterate on</typeparam>
+		/// <typeparam name="Func">The type of the callback, deduced</typeparam>
 		/// <param name="callback">The callback to invoke with the components</param>
 		/// <param name="includeDisabled">True to include disabled components, false if otherwise</param>
 		template <
 			typename ComponentType,
+			typename Func,
 			typename = typename std::enable_if<std::is_base_of<IComponent, ComponentType>::value>::type>
-		static void Each(std::function<void(const std::shared_ptr<ComponentType>&)> callback, bool includeDisabled = false) {
+		static void Each(Func&& callback, bool includeDisabled = false) {
 			// We can use typeid and type_index to get a unique ID for our types
 			std::type_index type = std::type_index(typeid(ComponentType));
-			LOG_ASSERT(_TypeLoadRegistry[type] != nullptr, "You must register component types before creating them!");
+			LOG_ASSERT(_TypeLoadRegistry.find(type) != _TypeLoadRegistry.end(), "You must register component types before creating them!");
+
+			// New components are appended past the end, so we only walk the ones that were here when we started
+			ComponentPool& pool = _Components[type];
+			IterationScope scope(pool);
+			for (size_t ix = pool.Dense.size(); ix > 0; ix--) {
+				// The pool only stores components of exactly this type, so a static cast is safe
+				ComponentType* component = static_cast<ComponentType*>(pool.Dense[ix - 1]);
+				if (component == nullptr) {
+					continue;
+				}
+				if (component->IsEnabled || includeDisabled) {
+					if constexpr (std::is_invocable_v<Func, ComponentType&>) {
+						callback(*component);
+					} else {
+						callback(std::static_pointer_cast<ComponentType>(component->_weakSelfPtr.lock()));
+					}
+				}
+			}
+		}
+
+		/// <summary>
+		/// Gets the number of live components of the given type
+		/// </summary>
+		/// <typeparam name="ComponentType">The type of component to count</typeparam>
+		template <
+			typename ComponentType,
+			typename = typename std::enable_if<std::is_base_of<IComponent, ComponentType>::value>::type>
+		static size_t Count() {
+			auto it = _Components.find(std::type_index(typeid(ComponentType)));
+			return it != _Components.end() ? it->second.Dense.size() - it->second.HoleCount : 0;
+		}
 
-			// Iterate over all the components in the store
-			for (auto& wptr : _Components[type]) {
-				// Lock the weak pointer to get a shared pointer (maybe)
-				std::shared_ptr<IComponent> sptr = wptr.lock();
-				// If the pointer is alive and matches our enabled criteria, invoke the callback
-				if (sptr && sptr->IsEnabled | includeDisabled) {
-					// Upcast to component type and invoke the callback
-					callback(std::dynamic_pointer_cast<ComponentType>(sptr));
+		/// <summary>
+		/// Invokes a callback for every component of the given type, see the templated version of Each
+		/// </summary>
+		/// <param name="type">The type of component to iterate on</param>
+		/// <param name="callback">The callback to invoke with the components</param>
+		/// <param name="includeDisabled">True to include disabled components, false if otherwise</param>
+		static void Each(const std::type_index& type, const std::function<void(IComponent&)>& callback, bool includeDisabled = false) {
+			ComponentPool& pool = _Components[type];
+			IterationScope scope(pool);
+			for (size_t ix = pool.Dense.size(); ix > 0; ix--) {
+				IComponent* component = pool.Dense[ix - 1];
+				if (component == nullptr) {
+					continue;
+				}
+				if (component->IsEnabled || includeDisabled) {
+					callback(*component);
 				}
 			}
 		}
 
+		/// <summary>
+		/// Gets the dense index of live components of the given type. The contents may be reordered
+		/// whenever a component of that type is created or destroyed, so this is only meant for
+		/// splitting a pool up between threads while the pools are locked (see SetPoolsLocked).
+		/// Must not be called from inside Each, where the pool may contain null entries
+		/// </summary>
+		/// <param name="type">The type of component to get the pool for</param>
+		static const std::vector<IComponent*>& GetPool(const std::type_index& type) {
+			return _Components[type].Dense;
+		}
+
+		/// <summary>
+		/// Locks or unlocks the component pools. While locked, creating or destroying a component
+		/// is an error, which lets worker threads safely walk the pools
+		/// </summary>
+		static void SetPoolsLocked(bool locked) {
+			_isPoolLocked = locked;
+		}
+
+		/// <summary>
+		/// Gets all registered component types, in the order they were registered
+		/// </summary>
+		static const std::vector<std::type_index>& GetRegisteredTypes() {
+			return _TypeOrder;
+		}
+
+		/// <summary>
+		/// Gets the update access that a component type was registered with
+		/// </summary>
+		/// <param name="type">The type of component to get the access for, must be registered</param>
+		static const ComponentAccess& GetAccess(const std::type_index& type) {
+			auto it = _TypeAccess.find(type);
+			LOG_ASSERT(it != _TypeAccess.end(), "You must register component types before querying them!");
+			return it->second;
+		}
+
 		/// <summary>
 		/// Attempts to register a given type as a component, should be called for each component type 
 		/// at the start of you application
 		/// </summary>
 		/// <typeparam name="T">The type to register, should extend the IComponent interface and have appropriate static methods</typeparam>
+		/// <param name="access">Describes what the type touches in Update, so the scene knows if it can be updated in parallel</param>
 		template <typename T>
-		static void RegisterType() {
+		static void RegisterType(const ComponentAccess& access = ComponentAccess::MainThread()) {
 			// Make sure the component type is valid (see bottom of IComponent.h)
 			static_assert(is_valid_component<T>(), "Type is not a valid component type!");
 
@@ -227,6 +308,8 @@ namespace Gameplay {
 				_TypeLoadRegistry[type] = &ComponentManager::ParseTypeFromBlob<T>;
 				_TypeCreateRegistry[type] = &ComponentManager::Create<T>;
 				_TypeNameMap[StringTools::SanitizeClassName(typeid(T).name())] = type;
+				_TypeAccess.emplace(type, access);
+				_TypeOrder.push_back(type);
 			}
 		}
 
@@ -242,11 +325,68 @@ namespace Gameplay {
 		inline static std::unordered_map<std::type_index, LoadComponentFunc> _TypeLoadRegistry;
 		// Stores functions to load components from JSON, indexed on the type that they load
 		inline static std::unordered_map<std::type_index, CreateComponentFunc> _TypeCreateRegistry;
+		// Stores what each type touches in it's update, indexed on the type
+		inline static std::unordered_map<std::type_index, ComponentAccess> _TypeAccess;
+		// All registered types, in the order they were registered (so that updates have a stable order)
+		inline static std::vector<std::type_index> _TypeOrder;
+		// True while worker threads may be walking the pools
+		inline static bool _isPoolLocked = false;
+
+		/// <summary>
+		/// A dense per-type index of all the live components of a single type. Note that this is an array
+		/// of pointers, not of components: each component is still a separate heap allocation owned by
+		/// its gameobject via a shared pointer, and the index stores raw pointers so that it does not keep
+		/// them alive. What this buys us is iteration without walking every gameobject or locking weak
+		/// pointers. Each component stores its index in the dense array (its sparse index), so adding
+		/// and removing are both O(1), and outside of iteration there are no dead entries to skip over
+		/// 
+		/// The pool also indexes components by GUID, so that cross references can be resolved in O(1).
+		/// Note that this means a component's GUID must be final before it is added to a pool
+		/// </summary>
+		struct ComponentPool {
+			std::vector<IComponent*> Dense;
+			std::unordered_map<Guid, IComponent*> ByGuid;
+			// The number of Each calls that are currently walking this pool
+			uint32_t IterationDepth = 0;
+			// The number of null slots left in Dense by components removed during iteration
+			size_t   HoleCount = 0;
+		};
 
-		// Weak pointers let us store a reference to an object stored by a shared pointer, without
-		// actually increasing the reference count. Thus components will be destroyed at the correct
-		// time (when the only reference is the one stored here).
-		inline static std::unordered_map<std::type_index, std::vector<std::weak_ptr<IComponent>>> _Components;  
+		/// <summary>
+		/// Marks a pool as being iterated for the lifetime of the scope. While a pool is being iterated,
+		/// removed components leave a null slot behind instead of being swapped with the back, and the
+		/// holes are compacted once the outermost iteration is done
+		/// </summary>
+		struct IterationScope {
+			ComponentPool& Pool;
+			IterationScope(ComponentPool& pool) : Pool(pool) { Pool.IterationDepth++; }
+			~IterationScope() {
+				Pool.IterationDepth--;
+				if (Pool.IterationDepth == 0 && Pool.HoleCount > 0) {
+					_Compact(Pool);
+				}
+			}
+			IterationScope(const IterationScope&) = delete;
+			IterationScope& operator=(const IterationScope&) = delete;
+		};
+
+		// Stores the dense per-type component indices, indexed on the type of component they store
+		inline static std::unordered_map<std::type_index, ComponentPool> _Components;
+
+		/// <summary>
+		/// Appends a component to the end of the pool for its type
+		/// </summary>
+		/// <param name="component">The component to add, it's _realType must already be set</param>
+		inline static void _AddToPool(IComponent* component) {
+			LOG_ASSERT(component->_poolIndex == IComponent::INVALID_POOL_INDEX, "Component has already been added to a pool!");
+			LOG_ASSERT(!_isPoolLocked, "Components cannot be created during a parallel update, use the scene's command buffer instead!");
+			ComponentPool& pool = _Components[component->_realType];
+			component->_poolIndex = static_cast<uint32_t>(pool.Dense.size());
+			pool.Dense.push_back(component);
+			// If we have a duplicate GUID (ex: a scene being loaded while the old one is still alive)
+			// the newest component wins, since that's the one that is being resolved against
+			pool.ByGuid[component->GetGUID()] = component;
+		}
 
 		template <typename T>
 		static IComponent::Sptr ParseTypeFromBlob(const nlohmann::json& blob) {
@@ -256,20 +396,59 @@ namespace Gameplay {
 		/// <summary>
 		/// Removes a given component from the global pools. To be used in the IComponent destructor
 		/// </summary>
-		/// <typeparam name="ComponentType">The type of component to destroy</typeparam>
 		/// <param name="component">A raw pointer to the component to remove (should be called from IComponent destructor)</param>
-		/// <returns>True if the element was removed, false if not</returns>
-		inline static void Remove(const IComponent* component) {
-			// Make sure the component's type was one that was registered
-			LOG_ASSERT(_TypeLoadRegistry[component->_realType] != nullptr, "You must register component types before creating them!");
-
-			// Get a reference to the vector of components for easy access
-			auto& componentStore = _Components[component->_realType];
-
-			// Clear any dead weak pointers
-			std::remove_if(componentStore.begin(), componentStore.end(), [](const std::weak_ptr<IComponent>& ptr) {
-				return ptr.expired();
-			});
+		inline static void Remove(IComponent* component) {
+			// Components that were never added to a pool have nothing to clean up
+			if (component->_poolIndex == IComponent::INVALID_POOL_INDEX) {
+				return;
+			}
+
+			LOG_ASSERT(!_isPoolLocked, "Components cannot be destroyed during a parallel update!");
+
+			// Get a reference to the pool of components for easy access
+			ComponentPool& pool = _Components[component->_realType];
+			LOG_ASSERT(component->_poolIndex < pool.Dense.size() && pool.Dense[component->_poolIndex] == component, "Component pool is corrupted!");
+
+			// If the pool is being iterated, swapping would move a component that was already visited into
+			// a slot that has yet to be visited, so we leave a hole to be compacted once the iteration is done
+			if (pool.IterationDepth > 0) {
+				pool.Dense[component->_poolIndex] = nullptr;
+				pool.HoleCount++;
+			} else {
+				// Swap the last element into the removed slot and patch its index, then pop the back
+				IComponent* last = pool.Dense.back();
+				pool.Dense[component->_poolIndex] = last;
+				last->_poolIndex = component->_poolIndex;
+				pool.Dense.pop_back();
+			}
+
+			// Only drop the GUID entry if it points to us, and not a newer component with the same ID
+			auto it = pool.ByGuid.find(component->GetGUID());
+			if (it != pool.ByGuid.end() && it->second == component) {
+				pool.ByGuid.erase(it);
+			}
+
+			component->_poolIndex = IComponent::INVALID_POOL_INDEX;
+		}
+
+		/// <summary>
+		/// Removes the holes left in a pool by components that were removed while it was being iterated
+		/// </summary>
+		/// <param name="pool">The pool to compact, must not be being iterated</param>
+		inline static void _Compact(ComponentPool& pool) {
+			for (size_t ix = 0; ix < pool.Dense.size();) {
+				if (pool.Dense[ix] != nullptr) {
+					ix++;
+					continue;
+				}
+				// Fill the hole from the back, the back may be a hole too so we re-check this slot
+				pool.Dense[ix] = pool.Dense.back();
+				pool.Dense.pop_back();
+				if (ix < pool.Dense.size() && pool.Dense[ix] != nullptr) {
+					pool.Dense[ix]->_poolIndex = static_cast<uint32_t>(ix);
+				}
+			}
+			pool.HoleCount = 0;
 		}
 	};
 }
\ No newline at end of file
@@ -27,7 +27,8 @@ namespace Gameplay {
 		IResource(),
 		IsEnabled(true),
 		_realType(typeid(IComponent)),
-		_context(nullptr)
+		_context(nullptr),
+		_poolIndex(INVALID_POOL_INDEX)
 	{ }
 
 	IComponent::~IComponent() {
@@ -7,6 +7,9 @@
 #include "Utils/ResourceManager/IResource.h"
 #include "Utils/TypeHelpers.h"
 
+class BinaryWriter;
+class BinaryReader;
+
 namespace Gameplay {
 	// We pre-declare GameObject to avoid circular dependencies in the headers
 	class GameObject;
@@ -92,6 +95,21 @@ namespace Gameplay {
 		/// <param name="context">The game object that the component belongs to</param>
 		virtual void RenderImGui() = 0;
 
+		/// <summary>
+		/// Writes any state that can change while the scene is playing, so that it can be
+		/// restored in place when leaving play mode (see Scene::SaveSnapshot). Components
+		/// that have no state of their own beyond the gameobject transform do not need to
+		/// override this
+		/// </summary>
+		/// <param name="writer">The writer to append the state to</param>
+		virtual void SaveSnapshot(BinaryWriter& writer) const { };
+		/// <summary>
+		/// Restores state that was written by SaveSnapshot. This is invoked after the
+		/// gameobject's transform has been restored
+		/// </summary>
+		/// <param name="reader">The reader containing only this component's state</param>
+		virtual void RestoreSnapshot(BinaryReader& reader) { };
+
 		/// <summary>
 		/// Returns the component's type name
 		/// To override in child classes, use MAKE_TYPENAME(Type) instead of
@@ -145,8 +163,13 @@ namespace Gameplay {
 		friend class ComponentManager;
 		friend class GameObject;
 
+		// Marks a component that does not belong to a ComponentManager pool
+		inline static const uint32_t INVALID_POOL_INDEX = (uint32_t)-1;
+
 		std::type_index _realType;
 		GameObject* _context;
+		// Our index in the ComponentManager's pool for our type
+		uint32_t _poolIndex;
 
 		// By storing a weak pointer to ourselves, we can pass a pointer to this
 		// for things like bullet user pointers
@@ -3,6 +3,7 @@
 #include "Gameplay/GameObject.h"
 #include "Gameplay/Scene.h"
 #include "Utils/ImGuiHelper.h"
+#include "Utils/BinaryStream.h"
 
 void JumpBehaviour::Awake()
 {
@@ -16,6 +17,15 @@ void JumpBehaviour::RenderImGui() {
 	LABEL_LEFT(ImGui::DragFloat, "Impulse", &_impulse, 1.0f);
 }
 
+void JumpBehaviour::SaveSnapshot(BinaryWriter& writer) const {
+	writer.Write(_impulse);
+}
+
+void JumpBehaviour::RestoreSnapshot(BinaryReader& reader) {
+	_impulse = reader.Read<float>();
+	_isPressed = false;
+}
+
 nlohmann::json JumpBehaviour::ToJson() const {
 	return {
 		{ "impulse", _impulse }
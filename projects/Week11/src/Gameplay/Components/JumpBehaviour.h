@@ -18,6 +18,8 @@ public:
 
 public:
 	virtual void RenderImGui() override;
+	virtual void SaveSnapshot(BinaryWriter& writer) const override;
+	virtual void RestoreSnapshot(BinaryReader& reader) override;
 	MAKE_TYPENAME(JumpBehaviour);
 	virtual nlohmann::json ToJson() const override;
 	static JumpBehaviour::Sptr FromJson(const nlohmann::json& blob);
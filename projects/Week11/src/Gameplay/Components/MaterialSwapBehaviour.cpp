@@ -1,6 +1,7 @@
 #include "Gameplay/Components/MaterialSwapBehaviour.h"
 #include "Gameplay/Components/ComponentManager.h"
 #include "Gameplay/GameObject.h"
+#include "Utils/BinaryStream.h"
 
 MaterialSwapBehaviour::MaterialSwapBehaviour() :
 	IComponent(),
@@ -14,14 +15,14 @@ void MaterialSwapBehaviour::OnEnteredTrigger(const Gameplay::Physics::TriggerVol
 	if (_renderer && EnterMaterial) {
 		_renderer->SetMaterial(EnterMaterial);
 	}
-	LOG_INFO("Entered trigger: {}", trigger->GetGameObject()->Name);
+	LOG_INFO("Entered trigger: {}", trigger->GetGameObject()->GetName());
 }
 
 void MaterialSwapBehaviour::OnLeavingTrigger(const Gameplay::Physics::TriggerVolume::Sptr& trigger) {
 	if (_renderer && ExitMaterial) {
 		_renderer->SetMaterial(ExitMaterial);
 	}
-	LOG_INFO("Left trigger: {}", trigger->GetGameObject()->Name);
+	LOG_INFO("Left trigger: {}", trigger->GetGameObject()->GetName());
 }
 
 void MaterialSwapBehaviour::Awake() {
@@ -30,6 +31,16 @@ void MaterialSwapBehaviour::Awake() {
 
 void MaterialSwapBehaviour::RenderImGui() { }
 
+void MaterialSwapBehaviour::SaveSnapshot(BinaryWriter& writer) const {
+	writer.WriteGuid(EnterMaterial != nullptr ? EnterMaterial->GetGUID() : Guid());
+	writer.WriteGuid(ExitMaterial != nullptr ? ExitMaterial->GetGUID() : Guid());
+}
+
+void MaterialSwapBehaviour::RestoreSnapshot(BinaryReader& reader) {
+	EnterMaterial = ResourceManager::Get<Gameplay::Material>(reader.ReadGuid());
+	ExitMaterial  = ResourceManager::Get<Gameplay::Material>(reader.ReadGuid());
+}
+
 nlohmann::json MaterialSwapBehaviour::ToJson() const {
 	return {
 		{ "enter_material", EnterMaterial != nullptr ? EnterMaterial->GetGUID().str() : "null" },
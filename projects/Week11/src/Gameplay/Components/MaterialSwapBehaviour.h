@@ -24,6 +24,8 @@ public:
 	virtual void OnLeavingTrigger(const std::shared_ptr<Gameplay::Physics::TriggerVolume>& trigger) override;
 	virtual void Awake() override;
 	virtual void RenderImGui() override;
+	virtual void SaveSnapshot(BinaryWriter& writer) const override;
+	virtual void RestoreSnapshot(BinaryReader& reader) override;
 	virtual nlohmann::json ToJson() const override;
 	static MaterialSwapBehaviour::Sptr FromJson(const nlohmann::json& blob);
 	MAKE_TYPENAME(MaterialSwapBehaviour);
@@ -1,20 +1,44 @@
 #include "Gameplay/Components/RenderComponent.h"
 
+#include "Gameplay/GameObject.h"
 #include "Utils/ResourceManager/ResourceManager.h"
+#include "Utils/BinaryStream.h"
+#include <limits>
 
+// What GetMesh and SelectLod return when we have no mesh, they return references so
+// they can't hand back a temporary
+static const VertexArrayObject::Sptr NullMesh = nullptr;
 
 RenderComponent::RenderComponent(const Gameplay::MeshResource::Sptr& mesh, const Gameplay::Material::Sptr& material) :
 	_mesh(mesh), 
 	_material(material), 
-	_meshBuilderParams(std::vector<MeshBuilderParam>()) 
+	_meshBuilderParams(std::vector<MeshBuilderParam>()),
+	_cullingTree(),
+	_cullingProxy(BoundingVolumeHierarchy::NULL_NODE),
+	_boundsMesh(nullptr),
+	_boundsTransformVersion(0),
+	_worldBounds(),
+	_staticFrames(0),
+	_lodLevel(0)
 { }
 
 RenderComponent::RenderComponent() : 
 	_mesh(nullptr), 
 	_material(nullptr), 
-	_meshBuilderParams(std::vector<MeshBuilderParam>())
+	_meshBuilderParams(std::vector<MeshBuilderParam>()),
+	_cullingTree(),
+	_cullingProxy(BoundingVolumeHierarchy::NULL_NODE),
+	_boundsMesh(nullptr),
+	_boundsTransformVersion(0),
+	_worldBounds(),
+	_staticFrames(0),
+	_lodLevel(0)
 { }
 
+RenderComponent::~RenderComponent() {
+	_RemoveCullingProxy();
+}
+
 void RenderComponent::SetMesh(const Gameplay::MeshResource::Sptr& mesh) {
 	_mesh = mesh;
 }
@@ -24,7 +48,7 @@ const Gameplay::MeshResource::Sptr& RenderComponent::GetMeshResource() const {
 }
 
 const VertexArrayObject::Sptr& RenderComponent::GetMesh() const {
-	return _mesh ? _mesh->Mesh : nullptr;
+	return _mesh ? _mesh->Mesh : NullMesh;
 }
 
 void RenderComponent::SetMaterial(const Gameplay::Material::Sptr& mat) {
@@ -35,6 +59,105 @@ const Gameplay::Material::Sptr& RenderComponent::GetMaterial() const {
 	return _material;
 }
 
+bool RenderComponent::UpdateCullingProxy(const BoundingVolumeHierarchy::Sptr& tree) {
+	// We've moved to a different tree (ex: a new scene was loaded), so get out of the old one
+	if (_cullingTree.lock() != tree) {
+		_RemoveCullingProxy();
+	}
+
+	const VertexArrayObject* mesh = _mesh ? _mesh->Mesh.get() : nullptr;
+	if (mesh == nullptr || !mesh->GetBounds().IsValid()) {
+		_RemoveCullingProxy();
+		_staticFrames = 0;
+		return false;
+	}
+
+	// Nothing has changed since our last update, our proxy is still good
+	uint32_t transformVersion = GetGameObject()->GetTransformVersion();
+	if (_cullingProxy != BoundingVolumeHierarchy::NULL_NODE && mesh == _boundsMesh && transformVersion == _boundsTransformVersion) {
+		if (_staticFrames < STATIC_AFTER_FRAMES) {
+			_staticFrames++;
+		}
+		return true;
+	}
+	_staticFrames = 0;
+
+	_worldBounds = mesh->GetBounds().Transformed(GetGameObject()->GetTransform());
+	_boundsMesh = mesh;
+	_boundsTransformVersion = transformVersion;
+
+	if (_cullingProxy == BoundingVolumeHierarchy::NULL_NODE) {
+		_cullingProxy = tree->CreateProxy(_worldBounds, this);
+		_cullingTree = tree;
+	} else {
+		tree->MoveProxy(_cullingProxy, _worldBounds);
+	}
+	return true;
+}
+
+const BoundingBox& RenderComponent::GetWorldBounds() const {
+	return _worldBounds;
+}
+
+const VertexArrayObject::Sptr& RenderComponent::SelectLod(const glm::vec3& cameraPos, float projectionScale) {
+	// Without bounds (or levels) we have nothing to go on, so we draw at full detail
+	int lodCount = _mesh != nullptr ? _mesh->GetLodCount() : 0;
+	if (lodCount <= 1 || projectionScale <= 0.0f || _cullingProxy == BoundingVolumeHierarchy::NULL_NODE) {
+		_lodLevel = 0;
+		return GetMesh();
+	}
+
+	// The fraction of the screen's height covered by our bounding sphere
+	float radius = _worldBounds.GetRadius();
+	float distance = glm::max(glm::distance(cameraPos, _worldBounds.GetCenter()) - radius, 0.0f);
+	float screenSize = distance > 0.0f ? radius * projectionScale / distance : std::numeric_limits<float>::max();
+
+	// Walk down the levels, the boundaries next to our current level are pushed away from it
+	// so that we only switch once we're clearly on the other side
+	const std::vector<float>& screenSizes = _mesh->LodScreenSizes;
+	int level = 0;
+	while (level + 1 < lodCount && level < (int)screenSizes.size()) {
+		float threshold = screenSizes[level] * (_lodLevel > level ? 1.0f + LOD_HYSTERESIS : 1.0f - LOD_HYSTERESIS);
+		if (screenSize >= threshold) {
+			break;
+		}
+		level++;
+	}
+	_lodLevel = level;
+	return _mesh->GetLod(_lodLevel);
+}
+
+void RenderComponent::_RemoveCullingProxy() {
+	if (_cullingProxy != BoundingVolumeHierarchy::NULL_NODE) {
+		BoundingVolumeHierarchy::Sptr tree = _cullingTree.lock();
+		if (tree != nullptr) {
+			tree->DestroyProxy(_cullingProxy);
+		}
+		_cullingProxy = BoundingVolumeHierarchy::NULL_NODE;
+	}
+	_cullingTree.reset();
+	_boundsMesh = nullptr;
+}
+
+void RenderComponent::SaveSnapshot(BinaryWriter& writer) const {
+	// Behaviours like MaterialSwapBehaviour change our material during play, resources are
+	// stored by GUID so the snapshot stays a flat buffer
+	writer.WriteGuid(_mesh ? _mesh->GetGUID() : Guid());
+	writer.WriteGuid(_material ? _material->GetGUID() : Guid());
+}
+
+void RenderComponent::RestoreSnapshot(BinaryReader& reader) {
+	Guid mesh = reader.ReadGuid();
+	Guid material = reader.ReadGuid();
+	// Skip the lookups in the common case where nothing has changed
+	if (_mesh == nullptr || _mesh->GetGUID() != mesh) {
+		_mesh = ResourceManager::Get<Gameplay::MeshResource>(mesh);
+	}
+	if (_material == nullptr || _material->GetGUID() != material) {
+		_material = ResourceManager::Get<Gameplay::Material>(material);
+	}
+}
+
 nlohmann::json RenderComponent::ToJson() const {
 	nlohmann::json result;
 	result["mesh"] = _mesh ? _mesh->GetGUID().str() : "null";
@@ -53,6 +176,7 @@ RenderComponent::Sptr RenderComponent::FromJson(const nlohmann::json& data) {
 void RenderComponent::RenderImGui() {
 	ImGui::Text("Indexed:   %s", GetMesh() != nullptr ? (_mesh->Mesh->GetIndexBuffer() != nullptr ? "true" : "false") : "N/A");
 	ImGui::Text("Triangles: %d", GetMesh() != nullptr ? (_mesh->Mesh->GetElementCount() / 3) : 0);
+	ImGui::Text("LOD:       %d / %d", _lodLevel, _mesh != nullptr ? glm::max(_mesh->GetLodCount() - 1, 0) : 0);
 	ImGui::Text("Source:    %s", (_mesh == nullptr || _mesh->Filename.empty()) ? "Generated" : _mesh->Filename.c_str());
 	ImGui::Separator();
 	ImGui::Text("Material:  %s", _material != nullptr ? _material->Name.c_str() : "NULL");
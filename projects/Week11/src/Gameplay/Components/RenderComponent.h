@@ -3,6 +3,7 @@
 #include "Gameplay/MeshResource.h"
 #include "Gameplay/Material.h"
 #include "Utils/MeshFactory.h"
+#include "Utils/BoundingVolumeHierarchy.h"
 
 /// <summary>
 /// Provides information for a object to be rendered
@@ -13,8 +14,16 @@ class RenderComponent : public Gameplay::IComponent {
 public:
 	typedef std::shared_ptr<RenderComponent> Sptr;
 
+	// How far past a LOD's screen size an object has to go before we switch to it, as a fraction
+	// of the screen size. This stops objects right on the boundary from flickering between levels
+	inline static const float LOD_HYSTERESIS = 0.1f;
+	// The number of culling updates an object has to go without moving or changing meshes before
+	// it's considered static. Static objects have their shadows cached, see ShadowMapping
+	inline static const uint32_t STATIC_AFTER_FRAMES = 60;
+
 	RenderComponent();
 	RenderComponent(const Gameplay::MeshResource::Sptr& mesh, const Gameplay::Material::Sptr& material);
+	virtual ~RenderComponent();
 
 	/// <summary>
 	/// Gets the mesh resource which contains the mesh and serialization info for
@@ -42,9 +51,41 @@ public:
 	/// <param name="mat">The material for this object</param>
 	void SetMaterial(const Gameplay::Material::Sptr& mat);
 
+	/// <summary>
+	/// Updates this object's proxy in the given culling tree, only recalculating the world
+	/// bounds when the object's transform or mesh has changed since the last update
+	/// </summary>
+	/// <param name="tree">The tree to insert this object into</param>
+	/// <returns>False if the mesh has no bounds (ex: still loading), in which case the object should always be drawn</returns>
+	bool UpdateCullingProxy(const BoundingVolumeHierarchy::Sptr& tree);
+	/// <summary>
+	/// Gets the world space bounds of this object as of the last call to UpdateCullingProxy
+	/// </summary>
+	const BoundingBox& GetWorldBounds() const;
+	/// <summary>
+	/// Returns true if this object has not moved or changed meshes for the last STATIC_AFTER_FRAMES
+	/// calls to UpdateCullingProxy, used to decide which shadow casters can be cached
+	/// </summary>
+	bool IsStatic() const { return _staticFrames >= STATIC_AFTER_FRAMES; }
+
+	/// <summary>
+	/// Picks the level of detail to draw based on how much of the screen this object covers, and
+	/// returns it's mesh. Should be called once per frame for the main camera, after UpdateCullingProxy
+	/// </summary>
+	/// <param name="cameraPos">The world position of the camera</param>
+	/// <param name="projectionScale">The vertical scale of the camera's projection (projection[1][1]), or 0 to always use full detail</param>
+	/// <returns>The VAO for the selected level of detail</returns>
+	const VertexArrayObject::Sptr& SelectLod(const glm::vec3& cameraPos, float projectionScale);
+	/// <summary>
+	/// Gets the level of detail picked by the last call to SelectLod, where 0 is full detail
+	/// </summary>
+	int GetLodLevel() const { return _lodLevel; }
+
 	// Inherited from IComponent
 
 	virtual void RenderImGui() override;
+	virtual void SaveSnapshot(BinaryWriter& writer) const override;
+	virtual void RestoreSnapshot(BinaryReader& reader) override;
 	virtual nlohmann::json ToJson() const override;
 	static RenderComponent::Sptr FromJson(const nlohmann::json& data);
 	MAKE_TYPENAME(RenderComponent);
@@ -57,4 +98,19 @@ protected:
 
 	// If we want to use MeshFactory, we can populate this list
 	std::vector<MeshBuilderParam> _meshBuilderParams;
+
+	// The tree we are currently in, and our proxy within it
+	std::weak_ptr<BoundingVolumeHierarchy> _cullingTree;
+	int                                    _cullingProxy;
+	// The mesh and transform version that our world bounds were calculated from
+	const VertexArrayObject*               _boundsMesh;
+	uint32_t                               _boundsTransformVersion;
+	BoundingBox                            _worldBounds;
+	// The number of culling updates since our bounds last changed, stops counting at STATIC_AFTER_FRAMES
+	uint32_t                               _staticFrames;
+
+	// The level of detail we drew last frame, we stick with it until we're well past it's screen sizes
+	int _lodLevel;
+
+	void _RemoveCullingProxy();
 };
\ No newline at end of file
@@ -4,6 +4,7 @@
 
 #include "Utils/ImGuiHelper.h"
 #include "Utils/JsonGlmHelpers.h"
+#include "Utils/BinaryStream.h"
 
 void RotatingBehaviour::Update(float deltaTime) {
 	GetGameObject()->SetRotation(GetGameObject()->GetRotationEuler() + RotationSpeed * deltaTime);
@@ -13,6 +14,14 @@ void RotatingBehaviour::RenderImGui() {
 	LABEL_LEFT(ImGui::DragFloat3, "Speed", &RotationSpeed.x);
 }
 
+void RotatingBehaviour::SaveSnapshot(BinaryWriter& writer) const {
+	writer.Write(RotationSpeed);
+}
+
+void RotatingBehaviour::RestoreSnapshot(BinaryReader& reader) {
+	RotationSpeed = reader.Read<glm::vec3>();
+}
+
 nlohmann::json RotatingBehaviour::ToJson() const {
 	return {
 		{ "speed", GlmToJson(RotationSpeed) }
@@ -14,6 +14,8 @@ public:
 	virtual void Update(float deltaTime) override;
 
 	virtual void RenderImGui() override;
+	virtual void SaveSnapshot(BinaryWriter& writer) const override;
+	virtual void RestoreSnapshot(BinaryReader& reader) override;
 
 	virtual nlohmann::json ToJson() const override;
 	static RotatingBehaviour::Sptr FromJson(const nlohmann::json& data);
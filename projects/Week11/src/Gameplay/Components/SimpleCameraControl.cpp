@@ -7,6 +7,7 @@
 #include "Gameplay/Scene.h"
 #include "Utils/JsonGlmHelpers.h"
 #include "Utils/ImGuiHelper.h"
+#include "Utils/BinaryStream.h"
 
 SimpleCameraControl::SimpleCameraControl() :
 	IComponent(),
@@ -85,6 +86,21 @@ void SimpleCameraControl::RenderImGui()
 	LABEL_LEFT(ImGui::DragFloat , "Shift Multiplier ", &_shiftMultipler, 0.01f, 1.0f);
 }
 
+void SimpleCameraControl::SaveSnapshot(BinaryWriter& writer) const {
+	writer.Write(_mouseSensitivity);
+	writer.Write(_moveSpeeds);
+	writer.Write(_shiftMultipler);
+	writer.Write(_currentRot);
+}
+
+void SimpleCameraControl::RestoreSnapshot(BinaryReader& reader) {
+	_mouseSensitivity = reader.Read<glm::vec2>();
+	_moveSpeeds       = reader.Read<glm::vec3>();
+	_shiftMultipler   = reader.Read<float>();
+	_currentRot       = reader.Read<glm::vec2>();
+	_isMousePressed   = false;
+}
+
 nlohmann::json SimpleCameraControl::ToJson() const {
 	return {
 		{ "mouse_sensitivity", GlmToJson(_mouseSensitivity) },
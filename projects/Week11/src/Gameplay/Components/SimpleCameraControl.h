@@ -19,6 +19,8 @@ public:
 
 public:
 	virtual void RenderImGui() override;
+	virtual void SaveSnapshot(BinaryWriter& writer) const override;
+	virtual void RestoreSnapshot(BinaryReader& reader) override;
 	MAKE_TYPENAME(SimpleCameraControl);
 	virtual nlohmann::json ToJson() const override;
 	static SimpleCameraControl::Sptr FromJson(const nlohmann::json& blob);
@@ -1,6 +1,7 @@
 #include "Gameplay/Components/TriggerVolumeEnterBehaviour.h"
 #include "Gameplay/Components/ComponentManager.h"
 #include "Gameplay/GameObject.h"
+#include "Utils/BinaryStream.h"
 
 TriggerVolumeEnterBehaviour::TriggerVolumeEnterBehaviour() :
 	IComponent()
@@ -10,17 +11,25 @@ TriggerVolumeEnterBehaviour::~TriggerVolumeEnterBehaviour() = default;
 
 void TriggerVolumeEnterBehaviour::OnTriggerVolumeEntered(const std::shared_ptr<Gameplay::Physics::RigidBody>& body)
 {
-	LOG_INFO("Body has entered {} trigger volume: {}", GetGameObject()->Name, body->GetGameObject()->Name);
+	LOG_INFO("Body has entered {} trigger volume: {}", GetGameObject()->GetName(), body->GetGameObject()->GetName());
 	_playerInTrigger = true;
 }
 
 void TriggerVolumeEnterBehaviour::OnTriggerVolumeLeaving(const std::shared_ptr<Gameplay::Physics::RigidBody>& body) {
-	LOG_INFO("Body has left {} trigger volume: {}", GetGameObject()->Name, body->GetGameObject()->Name);
+	LOG_INFO("Body has left {} trigger volume: {}", GetGameObject()->GetName(), body->GetGameObject()->GetName());
 	_playerInTrigger = false;
 }
 
 void TriggerVolumeEnterBehaviour::RenderImGui() { }
 
+void TriggerVolumeEnterBehaviour::SaveSnapshot(BinaryWriter& writer) const {
+	writer.Write(_playerInTrigger);
+}
+
+void TriggerVolumeEnterBehaviour::RestoreSnapshot(BinaryReader& reader) {
+	_playerInTrigger = reader.Read<bool>();
+}
+
 nlohmann::json TriggerVolumeEnterBehaviour::ToJson() const {
 	return { };
 }
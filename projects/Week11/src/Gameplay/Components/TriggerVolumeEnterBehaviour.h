@@ -20,6 +20,8 @@ public:
 	virtual void OnTriggerVolumeEntered(const std::shared_ptr<Gameplay::Physics::RigidBody>& body) override;
 	virtual void OnTriggerVolumeLeaving(const std::shared_ptr<Gameplay::Physics::RigidBody>& body) override;
 	virtual void RenderImGui() override;
+	virtual void SaveSnapshot(BinaryWriter& writer) const override;
+	virtual void RestoreSnapshot(BinaryReader& reader) override;
 	virtual nlohmann::json ToJson() const override;
 	static TriggerVolumeEnterBehaviour::Sptr FromJson(const nlohmann::json& blob);
 	MAKE_TYPENAME(TriggerVolumeEnterBehaviour);
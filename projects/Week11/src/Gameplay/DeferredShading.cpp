@@ -0,0 +1,157 @@
+#include "Gameplay/DeferredShading.h"
+
+#include <Logging.h>
+
+#include "Utils/Profiler.h"
+
+namespace Gameplay {
+	// Creates a texture for one of the G-buffer's attachments, we read them back one texel per pixel
+	static GLuint CreateTarget(GLenum format, const glm::ivec2& size) {
+		GLuint handle = 0;
+		glCreateTextures(GL_TEXTURE_2D, 1, &handle);
+		glTextureStorage2D(handle, 1, format, size.x, size.y);
+		glTextureParameteri(handle, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTextureParameteri(handle, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTextureParameteri(handle, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(handle, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		return handle;
+	}
+
+	DeferredShading::DeferredShading() :
+		_framebuffer(0),
+		_albedoTexture(0),
+		_normalTexture(0),
+		_materialTexture(0),
+		_depthTexture(0),
+		_size(0),
+		_emptyVao(0),
+		_lightingShader(nullptr),
+		_isDeferred(false),
+		_isDepthPrepassEnabled(false),
+		_stats({ 0, 0, 0 })
+	{
+		glCreateFramebuffers(1, &_framebuffer);
+		glCreateVertexArrays(1, &_emptyVao);
+
+		_lightingShader = std::make_shared<Shader>(std::unordered_map<ShaderPartType, std::string>{
+			{ ShaderPartType::Vertex, "shaders/vertex_shaders/fullscreen_triangle.glsl" },
+			{ ShaderPartType::Fragment, "shaders/fragment_shaders/deferred_lighting.glsl" }
+		});
+	}
+
+	DeferredShading::~DeferredShading() {
+		GLuint textures[4] = { _albedoTexture, _normalTexture, _materialTexture, _depthTexture };
+		glDeleteTextures(4, textures);
+		glDeleteFramebuffers(1, &_framebuffer);
+		glDeleteVertexArrays(1, &_emptyVao);
+	}
+
+	void DeferredShading::Render(const RenderQueue::Sptr& queue, const glm::mat4& viewProjection, const glm::ivec2& size) {
+		_stats = { 0, 0, 0 };
+
+		if (_isDeferred) {
+			_Resize(size);
+		}
+
+		// We can't make a G-buffer until the window has a size
+		if (!_isDeferred || _size.x <= 0 || _size.y <= 0) {
+			// Every fragment that passes the pre-pass is exactly on the closest surface
+			if (_isDepthPrepassEnabled) {
+				_DepthPrepass(queue, viewProjection);
+				glDepthFunc(GL_LEQUAL);
+			}
+			queue->Flush(viewProjection);
+			_stats.ForwardItems = queue->GetStats().Items;
+			glDepthFunc(GL_LESS);
+			return;
+		}
+
+		{
+			PROFILE_GPU_SCOPE("DeferredShading::GeometryPass");
+			glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+			// A shading model of 0 marks pixels that nothing was drawn to
+			const float clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			const float clearDepth = 1.0f;
+			for (int ix = 0; ix < 3; ix++) {
+				glClearNamedFramebufferfv(_framebuffer, GL_COLOR, ix, clearColor);
+			}
+			glClearNamedFramebufferfv(_framebuffer, GL_DEPTH, 0, &clearDepth);
+
+			if (_isDepthPrepassEnabled) {
+				_DepthPrepass(queue, viewProjection);
+				glDepthFunc(GL_LEQUAL);
+			}
+			queue->FlushVariant(viewProjection, ShaderVariant::GBuffer, true);
+			_stats.DeferredItems = queue->GetStats().Items;
+			glDepthFunc(GL_LESS);
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		}
+
+		if (_stats.DeferredItems > 0) {
+			_LightingPass(viewProjection);
+		}
+
+		// Anything that can't go in the G-buffer is lit as it's drawn, on top of the lit G-buffer
+		queue->Flush(viewProjection);
+		_stats.ForwardItems = queue->GetStats().Items;
+	}
+
+	void DeferredShading::_DepthPrepass(const RenderQueue::Sptr& queue, const glm::mat4& viewProjection) {
+		PROFILE_GPU_SCOPE("DeferredShading::DepthPrepass");
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		queue->FlushVariant(viewProjection, ShaderVariant::DepthOnly, false);
+		_stats.PrepassItems = queue->GetStats().Items;
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	}
+
+	void DeferredShading::_LightingPass(const glm::mat4& viewProjection) {
+		PROFILE_GPU_SCOPE("DeferredShading::LightingPass");
+		if (!_lightingShader->IsReady()) {
+			return;
+		}
+
+		GLuint textures[4] = { _albedoTexture, _normalTexture, _materialTexture, _depthTexture };
+		glBindTextures(GBUFFER_TEXTURE_SLOT, 4, textures);
+
+		_lightingShader->Bind();
+		_lightingShader->SetUniformMatrix("u_InverseViewProjection", glm::inverse(viewProjection));
+
+		// The lighting shader writes the G-buffer's depth, and is tested against what's already been
+		// drawn (ex: physics debug lines), so anything in front of our surfaces is kept
+		glBindVertexArray(_emptyVao);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		glBindVertexArray(0);
+
+		// Materials expect to find their own textures in these slots
+		glBindTextures(GBUFFER_TEXTURE_SLOT, 4, nullptr);
+	}
+
+	void DeferredShading::_Resize(const glm::ivec2& size) {
+		if (size == _size || size.x <= 0 || size.y <= 0) {
+			return;
+		}
+		_size = size;
+
+		GLuint textures[4] = { _albedoTexture, _normalTexture, _materialTexture, _depthTexture };
+		glDeleteTextures(4, textures);
+
+		// Albedo and shininess, the normal, and the shading model with it's parameters. See
+		// fragments/surface_output.glsl for what goes in each channel
+		_albedoTexture   = CreateTarget(GL_RGBA8, size);
+		_normalTexture   = CreateTarget(GL_RG16_SNORM, size);
+		_materialTexture = CreateTarget(GL_RGBA8, size);
+		_depthTexture    = CreateTarget(GL_DEPTH_COMPONENT32F, size);
+
+		glNamedFramebufferTexture(_framebuffer, GL_COLOR_ATTACHMENT0, _albedoTexture, 0);
+		glNamedFramebufferTexture(_framebuffer, GL_COLOR_ATTACHMENT1, _normalTexture, 0);
+		glNamedFramebufferTexture(_framebuffer, GL_COLOR_ATTACHMENT2, _materialTexture, 0);
+		glNamedFramebufferTexture(_framebuffer, GL_DEPTH_ATTACHMENT, _depthTexture, 0);
+		const GLenum drawBuffers[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
+		glNamedFramebufferDrawBuffers(_framebuffer, 3, drawBuffers);
+
+		GLenum status = glCheckNamedFramebufferStatus(_framebuffer, GL_FRAMEBUFFER);
+		if (status != GL_FRAMEBUFFER_COMPLETE) {
+			LOG_ERROR("G-buffer is incomplete ({:#x}), deferred shading will not work", status);
+		}
+	}
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include <memory>
+#include <cstdint>
+#include <GLM/glm.hpp>
+#include <glad/glad.h>
+
+#include "Gameplay/RenderQueue.h"
+#include "Graphics/Shader.h"
+
+namespace Gameplay {
+	/// <summary>
+	/// Draws the contents of a render queue with either forward or deferred shading
+	///
+	/// With forward shading every fragment is lit as it is drawn, so objects that overlap each
+	/// other pay for lighting many times per pixel. With deferred shading, objects are drawn with
+	/// the G-buffer variant of their shader (see Shader::GetVariant), which only writes out their
+	/// surface: albedo and shininess, an octahedral encoded normal, and the shading model with it's
+	/// parameters. A single screen space pass (fragment_shaders/deferred_lighting.glsl) then lights
+	/// every pixel once, using the same light data and shadows as forward shading. Objects whose
+	/// shaders have no variants (or whose variants are still compiling) are drawn with forward
+	/// shading on top of the result
+	///
+	/// Either path can also start with a depth pre-pass, where objects are drawn with the depth
+	/// only variant of their shader first. Every later pass then only shades the closest surface
+	/// </summary>
+	class DeferredShading {
+	public:
+		typedef std::shared_ptr<DeferredShading> Sptr;
+
+		// The first texture slot that the G-buffer is bound to for the lighting pass, must match
+		// fragment_shaders/deferred_lighting.glsl. This is the first slot materials would use
+		inline static const int GBUFFER_TEXTURE_SLOT = 2;
+
+		/// <summary>
+		/// Statistics from the last call to Render, handy for debugging
+		/// </summary>
+		struct Stats {
+			// The number of objects drawn in the depth pre-pass
+			uint32_t PrepassItems;
+			// The number of objects drawn into the G-buffer
+			uint32_t DeferredItems;
+			// The number of objects drawn with forward shading
+			uint32_t ForwardItems;
+		};
+
+		// We'll disallow moving and copying, since we own GL resources
+		DeferredShading(const DeferredShading& other) = delete;
+		DeferredShading(DeferredShading&& other) = delete;
+		DeferredShading& operator=(const DeferredShading& other) = delete;
+		DeferredShading& operator=(DeferredShading&& other) = delete;
+
+		static inline Sptr Create() {
+			return std::make_shared<DeferredShading>();
+		}
+
+		DeferredShading();
+		~DeferredShading();
+
+		/// <summary>
+		/// Draws and clears everything in the queue into the default framebuffer, which should
+		/// already be cleared. Anything already drawn into it is depth tested against the scene.
+		/// The frame uniforms, light data, shadow maps and environment map must already be bound
+		/// </summary>
+		/// <param name="queue">The queue holding the objects to draw</param>
+		/// <param name="viewProjection">The view projection matrix of the camera we are drawing from</param>
+		/// <param name="size">The size of the default framebuffer in pixels, the G-buffer is resized to match</param>
+		void Render(const RenderQueue::Sptr& queue, const glm::mat4& viewProjection, const glm::ivec2& size);
+
+		/// <summary>
+		/// Sets whether objects are lit in a screen space pass, or as they are drawn
+		/// </summary>
+		void SetDeferred(bool isDeferred) { _isDeferred = isDeferred; }
+		bool IsDeferred() const { return _isDeferred; }
+
+		/// <summary>
+		/// Sets whether objects have their depth drawn before they are shaded
+		/// </summary>
+		void SetDepthPrepass(bool isEnabled) { _isDepthPrepassEnabled = isEnabled; }
+		bool IsDepthPrepassEnabled() const { return _isDepthPrepassEnabled; }
+
+		/// <summary>
+		/// Gets the statistics from the last call to Render
+		/// </summary>
+		const Stats& GetStats() const { return _stats; }
+
+	protected:
+		GLuint     _framebuffer;
+		// The G-buffer attachments, in the order of their texture slots
+		GLuint     _albedoTexture;
+		GLuint     _normalTexture;
+		GLuint     _materialTexture;
+		GLuint     _depthTexture;
+		glm::ivec2 _size;
+
+		// The lighting pass draws a single triangle without any vertex data, but GL still
+		// needs a vertex array to be bound
+		GLuint       _emptyVao;
+		Shader::Sptr _lightingShader;
+
+		bool  _isDeferred;
+		bool  _isDepthPrepassEnabled;
+		Stats _stats;
+
+		/// <summary>
+		/// Re-creates the G-buffer if it's not the given size
+		/// </summary>
+		void _Resize(const glm::ivec2& size);
+		/// <summary>
+		/// Draws the depth of every object in the queue that has shader variants, leaving them in the queue
+		/// </summary>
+		void _DepthPrepass(const RenderQueue::Sptr& queue, const glm::mat4& viewProjection);
+		/// <summary>
+		/// Lights every pixel of the G-buffer into the currently bound framebuffer
+		/// </summary>
+		void _LightingPass(const glm::mat4& viewProjection);
+	};
+}
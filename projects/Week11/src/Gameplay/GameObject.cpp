@@ -1,12 +1,16 @@
 #include "GameObject.h"
 
+#include <algorithm>
+
 // Utilities
 #include "Utils/JsonGlmHelpers.h"
+#include "Utils/BinaryStream.h"
 
 // GLM
 #define GLM_ENABLE_EXPERIMENTAL
 #include "GLM/gtc/matrix_transform.hpp"
 #include "GLM/gtc/quaternion.hpp"
+#include "GLM/gtc/matrix_inverse.hpp"
 #include "GLM/glm.hpp"
 #include "Utils/GlmDefines.h"
 #include "Utils/ImGuiHelper.h"
@@ -15,8 +19,8 @@
 
 namespace Gameplay {
 	GameObject::GameObject() :
-		Name("Unknown"),
 		GUID(Guid::New()),
+		_name("Unknown"),
 		_components(std::vector<IComponent::Sptr>()),
 		_scene(nullptr),
 		_position(ZERO),
@@ -24,22 +28,140 @@ namespace Gameplay {
 		_scale(ONE),
 		_transform(MAT4_IDENTITY),
 		_inverseTransform(MAT4_IDENTITY),
-		_isTransformDirty(true)
+		_isTransformDirty(true),
+		_isTransformPending(false),
+		_transformVersion(0),
+		_parent(nullptr),
+		_children(),
+		_transformIndex(TransformHierarchy::NO_NODE),
+		_sceneOrder(0)
 	{ }
 
 	void GameObject::_RecalcTransform() const
 	{
 		if (_isTransformDirty) {
-			_transform = glm::translate(MAT4_IDENTITY, _position) * glm::mat4_cast(_rotation) * glm::scale(MAT4_IDENTITY, _scale);
-			_inverseTransform = glm::inverse(_transform);
+			_transform = _CalcLocalTransform();
+			_inverseTransform = glm::affineInverse(_transform);
 			_isTransformDirty = false;
+			_transformVersion++;
+		}
+	}
+
+	glm::mat4 GameObject::_CalcLocalTransform() const
+	{
+		// Equivalent to translate * rotate * scale, without the matrix multiplications
+		glm::mat3 rotation = glm::mat3_cast(_rotation);
+		glm::mat4 result = glm::mat4(
+			glm::vec4(rotation[0] * _scale.x, 0.0f),
+			glm::vec4(rotation[1] * _scale.y, 0.0f),
+			glm::vec4(rotation[2] * _scale.z, 0.0f),
+			glm::vec4(_position, 1.0f)
+		);
+		return result;
+	}
+
+	void GameObject::_MarkTransformDirty()
+	{
+		if (_transformIndex != TransformHierarchy::NO_NODE) {
+			// Marking dirty touches our children's flags as well, so during a parallel update
+			// we hold on to the change until the scene can apply it on the main thread
+			if (_scene->_isUpdatingInParallel) {
+				_isTransformPending = true;
+			} else {
+				_scene->_transforms->MarkDirty(this);
+			}
+		} else {
+			_isTransformDirty = true;
+		}
+	}
+
+	void GameObject::_ApplyPendingTransform()
+	{
+		if (_isTransformPending) {
+			_isTransformPending = false;
+			_MarkTransformDirty();
+		}
+	}
+
+	void GameObject::SetName(const std::string& name) {
+		if (name != _name) {
+			std::string oldName = _name;
+			_name = name;
+			// Let the scene update its name lookup
+			if (_scene != nullptr) {
+				_scene->_OnObjectRenamed(this, oldName);
+			}
 		}
 	}
 
 	void GameObject::LookAt(const glm::vec3& point) {
-		glm::mat4 rot = glm::lookAt(_position, point, glm::vec3(0.0f, 0.0f, 1.0f));
+		glm::mat4 rot = glm::lookAt(GetWorldPosition(), point, glm::vec3(0.0f, 0.0f, 1.0f));
 		// Take the conjugate of the quaternion, as lookAt returns the *inverse* rotation
-		SetRotation(glm::conjugate(glm::quat_cast(rot)));
+		glm::quat worldRotation = glm::conjugate(glm::quat_cast(rot));
+		// Our rotation is relative to our parent, so we need to undo the parent's rotation
+		if (_parent != nullptr) {
+			worldRotation = glm::inverse(_parent->GetWorldRotation()) * worldRotation;
+		}
+		SetRotation(worldRotation);
+	}
+
+	void GameObject::SetParent(const GameObject::Sptr& parent, bool keepWorldTransform) {
+		GameObject* newParent = parent.get();
+		if (newParent == _parent) {
+			return;
+		}
+		if (newParent != nullptr) {
+			if (newParent->_scene != _scene) {
+				LOG_WARN("Cannot parent \"{}\" to \"{}\", they are in different scenes", _name, newParent->_name);
+				return;
+			}
+			for (GameObject* ancestor = newParent; ancestor != nullptr; ancestor = ancestor->_parent) {
+				if (ancestor == this) {
+					LOG_WARN("Cannot parent \"{}\" to one of it's own descendants", _name);
+					return;
+				}
+			}
+		}
+
+		glm::mat4 world = GetTransform();
+
+		if (_parent != nullptr) {
+			std::vector<GameObject*>& siblings = _parent->_children;
+			siblings.erase(std::remove(siblings.begin(), siblings.end(), this), siblings.end());
+		}
+		_parent = newParent;
+		if (_parent != nullptr) {
+			_parent->_children.push_back(this);
+		}
+
+		// Work out the local transform that keeps us in the same place, this won't
+		// be exact if a parent has non-uniform scale and rotation (shearing)
+		if (keepWorldTransform) {
+			glm::mat4 local = _parent != nullptr ? glm::affineInverse(_parent->GetTransform()) * world : world;
+			_position = glm::vec3(local[3]);
+			_scale = glm::vec3(glm::length(glm::vec3(local[0])), glm::length(glm::vec3(local[1])), glm::length(glm::vec3(local[2])));
+			if (glm::determinant(glm::mat3(local)) < 0.0f) {
+				_scale.x = -_scale.x;
+			}
+			_rotation = glm::quat_cast(glm::mat3(
+				glm::vec3(local[0]) / _scale.x,
+				glm::vec3(local[1]) / _scale.y,
+				glm::vec3(local[2]) / _scale.z
+			));
+		}
+
+		if (_transformIndex != TransformHierarchy::NO_NODE) {
+			_scene->_transforms->InvalidateOrder();
+		}
+		_MarkTransformDirty();
+	}
+
+	GameObject::Sptr GameObject::GetParent() const {
+		return _parent != nullptr ? _parent->_selfRef.lock() : nullptr;
+	}
+
+	GameObject::Sptr GameObject::GetChild(size_t index) const {
+		return _children[index]->_selfRef.lock();
 	}
 
 
@@ -69,25 +191,42 @@ namespace Gameplay {
 
 	void GameObject::SetPostion(const glm::vec3& position) {
 		_position = position;
-		_isTransformDirty = true;
+		_MarkTransformDirty();
 	}
 
 	const glm::vec3& GameObject::GetPosition() const {
 		return _position;
 	}
 
+	glm::vec3 GameObject::GetWorldPosition() const {
+		return _parent != nullptr ? glm::vec3(GetTransform()[3]) : _position;
+	}
+
 	void GameObject::SetRotation(const glm::quat& value) {
 		_rotation = value;
-		_isTransformDirty = true;
+		_MarkTransformDirty();
 	}
 
 	const glm::quat& GameObject::GetRotation() const {
 		return _rotation;
 	}
 
+	glm::quat GameObject::GetWorldRotation() const {
+		if (_parent == nullptr) {
+			return _rotation;
+		}
+		// Strip the scale out of the world transform to get the rotation
+		const glm::mat4& transform = GetTransform();
+		return glm::quat_cast(glm::mat3(
+			glm::normalize(glm::vec3(transform[0])),
+			glm::normalize(glm::vec3(transform[1])),
+			glm::normalize(glm::vec3(transform[2]))
+		));
+	}
+
 	void GameObject::SetRotation(const glm::vec3& eulerAngles) {
 		_rotation = glm::quat(glm::radians(eulerAngles));
-		_isTransformDirty = true;
+		_MarkTransformDirty();
 	}
 
 	glm::vec3 GameObject::GetRotationEuler() const {
@@ -96,7 +235,7 @@ namespace Gameplay {
 
 	void GameObject::SetScale(const glm::vec3& value) {
 		_scale = value;
-		_isTransformDirty = true;
+		_MarkTransformDirty();
 	}
 
 	const glm::vec3& GameObject::GetScale() const {
@@ -104,16 +243,28 @@ namespace Gameplay {
 	}
 
 	const glm::mat4& GameObject::GetTransform() const {
+		if (_transformIndex != TransformHierarchy::NO_NODE) {
+			return _scene->_transforms->GetWorld(this);
+		}
 		_RecalcTransform();
 		return _transform;
 	}
 
 
 	const glm::mat4& GameObject::GetInverseTransform() const {
+		if (_transformIndex != TransformHierarchy::NO_NODE) {
+			return _scene->_transforms->GetInverseWorld(this);
+		}
 		_RecalcTransform();
 		return _inverseTransform;
 	}
 
+	uint32_t GameObject::GetTransformVersion() const {
+		// Makes sure the version is bumped if the transform is dirty
+		GetTransform();
+		return _transformVersion;
+	}
+
 	Scene* GameObject::GetScene() const {
 		return _scene;
 	}
@@ -180,20 +331,23 @@ namespace Gameplay {
 		ImGui::PushID(this); // Push a new ImGui ID scope for this object
 		// Since we're allowing names to change, we need to use the ### to have a static ID for the header
 		static char buffer[256];
-		sprintf_s(buffer, 256, "%s###GO_HEADER", Name.c_str());
+		sprintf_s(buffer, 256, "%s###GO_HEADER", _name.c_str());
 		if (ImGui::CollapsingHeader(buffer)) {
 			ImGui::Indent();
 
 			// Draw a textbox for our name
 			static char nameBuff[256];
-			memcpy(nameBuff, Name.c_str(), Name.size());
-			nameBuff[Name.size()] = '\0';
+			memcpy(nameBuff, _name.c_str(), _name.size());
+			nameBuff[_name.size()] = '\0';
 			if (ImGui::InputText("", nameBuff, 256)) {
-				Name = nameBuff;
+				SetName(nameBuff);
 			}
-			ImGui::SameLine();
-			if (ImGuiHelper::WarningButton("Delete")) {
-				ImGui::OpenPopup("Delete GameObject");
+			// Structural changes can't be undone by the play mode snapshot, so only allow them while editing
+			if (!_scene->IsPlaying) {
+				ImGui::SameLine();
+				if (ImGuiHelper::WarningButton("Delete")) {
+					ImGui::OpenPopup("Delete GameObject");
+				}
 			}
 
 			// Draw our delete modal
@@ -218,8 +372,29 @@ namespace Gameplay {
 				ImGui::EndPopup();
 			}
 
+			// Draw a dropdown for selecting our parent, like other structural changes this is only allowed while editing
+			if (!_scene->IsPlaying && ImGui::BeginCombo("Parent", _parent != nullptr ? _parent->_name.c_str() : "None")) {
+				if (ImGui::Selectable("None", _parent == nullptr)) {
+					SetParent(nullptr);
+				}
+				for (int ix = 0; ix < _scene->NumObjects(); ix++) {
+					GameObject::Sptr object = _scene->GetObjectByIndex(ix);
+					if (object.get() == this) {
+						continue;
+					}
+					ImGui::PushID(object.get());
+					if (ImGui::Selectable(object->_name.c_str(), object.get() == _parent)) {
+						SetParent(object);
+					}
+					ImGui::PopID();
+				}
+				ImGui::EndCombo();
+			}
+
 			// Render position label
-			_isTransformDirty |= LABEL_LEFT(ImGui::DragFloat3, "Position", &_position.x, 0.01f);
+			if (LABEL_LEFT(ImGui::DragFloat3, "Position", &_position.x, 0.01f)) {
+				_MarkTransformDirty();
+			}
 			
 			// Get the ImGui storage state so we can avoid gimbal locking issues by storing euler angles in the editor
 			glm::vec3 euler = GetRotationEuler();
@@ -245,7 +420,9 @@ namespace Gameplay {
 			}
 			
 			// Draw the scale
-			_isTransformDirty |= LABEL_LEFT(ImGui::DragFloat3, "Scale   ", &_scale.x, 0.01f, 0.0f);
+			if (LABEL_LEFT(ImGui::DragFloat3, "Scale   ", &_scale.x, 0.01f, 0.0f)) {
+				_MarkTransformDirty();
+			}
 
 			ImGui::Separator();
 			ImGui::TextUnformatted("Components");
@@ -258,7 +435,7 @@ namespace Gameplay {
 					ImGui::PushID(component.get()); 
 					component->RenderImGui();
 					// Render a delete button for the component
-					if (ImGuiHelper::WarningButton("Delete")) {
+					if (!_scene->IsPlaying && ImGuiHelper::WarningButton("Delete")) {
 						_components.erase(_components.begin() + ix);
 						ix--;
 					}
@@ -270,25 +447,29 @@ namespace Gameplay {
 			// Render a combo box for selecting a component to add
 			static std::string preview = "";
 			static std::optional<std::type_index> selectedType;
-			if (ImGui::BeginCombo("##AddComponents", preview.c_str())) {
-				ComponentManager::EachType([&](const std::string& typeName, const std::type_index type) {
-					// Hide component types already added
-					if (!Has(type)) {
-						bool isSelected = typeName == preview;
-						if (ImGui::Selectable(typeName.c_str(), &isSelected)) {
-							preview = typeName;
-							selectedType = type;
+			if (_scene->IsPlaying) {
+				ImGui::TextDisabled("Components cannot be added in play mode");
+			} else {
+				if (ImGui::BeginCombo("##AddComponents", preview.c_str())) {
+					ComponentManager::EachType([&](const std::string& typeName, const std::type_index type) {
+						// Hide component types already added
+						if (!Has(type)) {
+							bool isSelected = typeName == preview;
+							if (ImGui::Selectable(typeName.c_str(), &isSelected)) {
+								preview = typeName;
+								selectedType = type;
+							}
 						}
-					}
-				});
-				ImGui::EndCombo();
-			}
-			ImGui::SameLine();
-			// Button to add component and reset the selected type
-			if (ImGui::Button("Add Component") && selectedType.has_value() && !Has(selectedType.value())) {
-				Add(selectedType.value());
-				selectedType.reset();
-				preview = "";
+					});
+					ImGui::EndCombo();
+				}
+				ImGui::SameLine();
+				// Button to add component and reset the selected type
+				if (ImGui::Button("Add Component") && selectedType.has_value() && !Has(selectedType.value())) {
+					Add(selectedType.value());
+					selectedType.reset();
+					preview = "";
+				}
 			}
 
 			ImGui::Separator();
@@ -309,7 +490,7 @@ namespace Gameplay {
 		GameObject::Sptr result(new GameObject());
 
 		// Load in basic info
-		result->Name = data["name"];
+		result->_name = data["name"];
 		result->GUID = Guid(data["guid"]);
 		result->_position = ParseJsonVec3(data["position"]);
 		result->_rotation = ParseJsonQuat(data["rotation"]);
@@ -333,14 +514,89 @@ namespace Gameplay {
 		return result;
 	}
 
+	GameObject::Sptr GameObject::FromBinary(BinaryReader& reader) {
+		GameObject::Sptr result(new GameObject());
+
+		result->GUID      = reader.ReadGuid();
+		result->_name     = reader.ReadString();
+		result->_position = reader.Read<glm::vec3>();
+		result->_rotation = reader.Read<glm::quat>();
+		result->_scale    = reader.Read<glm::vec3>();
+		result->_isTransformDirty = true;
+
+		uint32_t componentCount = reader.Read<uint32_t>();
+		result->_components.reserve(componentCount);
+		for (uint32_t ix = 0; ix < componentCount && reader.IsValid(); ix++) {
+			std::string typeName(reader.ReadString());
+			BinaryReader payload = reader.ReadBlob();
+			if (!payload.IsValid()) {
+				break;
+			}
+
+			// Components only know how to load themselves from JSON, but decoding a small
+			// MessagePack blob is far cheaper than parsing the text for the whole scene
+			nlohmann::json blob = nlohmann::json::from_msgpack(payload.GetData(), payload.GetData() + payload.GetSize(), true, false);
+			if (blob.is_discarded()) {
+				LOG_WARN("Skipping corrupt \"{}\" component on \"{}\"", typeName, result->_name);
+				continue;
+			}
+			IComponent::Sptr component = ComponentManager::Load(typeName, blob);
+			if (component == nullptr) {
+				continue;
+			}
+			component->_context = result.get();
+
+			result->_components.push_back(component);
+			component->OnLoad();
+		}
+		return result;
+	}
+
+	void GameObject::ToBinary(BinaryWriter& writer) const {
+		writer.WriteGuid(GUID);
+		writer.WriteString(_name);
+		writer.Write(_position);
+		writer.Write(_rotation);
+		writer.Write(_scale);
+
+		writer.Write<uint32_t>(static_cast<uint32_t>(_components.size()));
+		for (auto& component : _components) {
+			nlohmann::json blob = component->ToJson();
+			IComponent::SaveBaseJson(component, blob);
+			writer.WriteString(component->ComponentTypeName());
+			writer.WriteBlob(nlohmann::json::to_msgpack(blob));
+		}
+	}
+
+	void GameObject::JsonToBinary(const nlohmann::json& data, BinaryWriter& writer) {
+		writer.WriteGuid(Guid(data["guid"].get<std::string>()));
+		writer.WriteString(data["name"].get<std::string>());
+		writer.Write(ParseJsonVec3(data["position"]));
+		writer.Write(ParseJsonQuat(data["rotation"]));
+		writer.Write(ParseJsonVec3(data["scale"]));
+
+		const nlohmann::json& components = data["components"];
+		writer.Write<uint32_t>(components.is_object() ? static_cast<uint32_t>(components.size()) : 0);
+		if (components.is_object()) {
+			for (auto& [typeName, value] : components.items()) {
+				writer.WriteString(typeName);
+				writer.WriteBlob(nlohmann::json::to_msgpack(value));
+			}
+		}
+	}
+
 	nlohmann::json GameObject::ToJson() const {
 		nlohmann::json result = {
-			{ "name", Name },
+			{ "name", _name },
 			{ "guid", GUID.str() },
 			{ "position", GlmToJson(_position) },
 			{ "rotation", GlmToJson(_rotation) },
 			{ "scale",    GlmToJson(_scale) },
 		};
+		// Parents are linked up by the scene once all the objects are loaded
+		if (_parent != nullptr) {
+			result["parent"] = _parent->GUID.str();
+		}
 		result["components"] = nlohmann::json();
 		for (auto& component : _components) {
 			result["components"][component->ComponentTypeName()] = component->ToJson();
@@ -12,6 +12,9 @@
 #include "Gameplay/Components/IComponent.h"
 #include "Gameplay/Components/ComponentManager.h"
 
+class BinaryWriter;
+class BinaryReader;
+
 namespace Gameplay {
 // Predeclaration for Scene
 	class Scene;
@@ -28,16 +31,48 @@ namespace Gameplay {
 	struct GameObject {
 		typedef std::shared_ptr<GameObject> Sptr;
 
-		// Human readable name for the object
-		std::string             Name;
-		// Unique ID for the object
+		// Unique ID for the object, should not be changed once the object
+		// has been added to a scene, since the scene indexes objects by GUID
 		Guid                    GUID;
 
+		/// <summary>
+		/// Gets the human readable name for the object
+		/// </summary>
+		const std::string& GetName() const { return _name; }
+		/// <summary>
+		/// Sets the human readable name for the object, notifying the scene
+		/// so that FindObjectByName stays up to date
+		/// </summary>
+		/// <param name="name">The new name for the object</param>
+		void SetName(const std::string& name);
+
 		/// <summary>
 		/// Rotates this object to look at the given point in world coordinates
 		/// </summary>
 		void LookAt(const glm::vec3& point);
 
+		/// <summary>
+		/// Attaches this object to a parent, so that it's position, rotation and scale are relative
+		/// to the parent's transform. Objects are removed from the scene along with their parent
+		/// 
+		/// Note that physics bodies work in world space, so they should only be attached to root objects
+		/// </summary>
+		/// <param name="parent">The new parent, or nullptr to make this a root object. Must be in the same scene, and must not be a descendant of this object</param>
+		/// <param name="keepWorldTransform">If true, the local transform is adjusted so the object stays where it is in the world</param>
+		void SetParent(const std::shared_ptr<GameObject>& parent, bool keepWorldTransform = true);
+		/// <summary>
+		/// Gets the object that this object is attached to, or nullptr if this is a root object
+		/// </summary>
+		std::shared_ptr<GameObject> GetParent() const;
+		/// <summary>
+		/// Gets the number of objects that are directly attached to this one
+		/// </summary>
+		size_t GetChildCount() const { return _children.size(); }
+		/// <summary>
+		/// Gets one of the objects directly attached to this one
+		/// </summary>
+		std::shared_ptr<GameObject> GetChild(size_t index) const;
+
 		/// <summary>
 		/// Invoked when the rigidbody attached to this game object (if any) enters
 		/// a trigger volume for the first time
@@ -65,24 +100,32 @@ namespace Gameplay {
 		void OnTriggerVolumeLeaving(const std::shared_ptr<Physics::RigidBody>& body);
 
 		/// <summary>
-		/// Sets the game object's world position
+		/// Sets the game object's position relative to it's parent (or the world for root objects)
 		/// </summary>
-		/// <param name="position">The new position for the object in world space</param>
+		/// <param name="position">The new local position for the object</param>
 		void SetPostion(const glm::vec3& position);
 		/// <summary>
-		/// Gets the object's position in world space
+		/// Gets the object's position relative to it's parent (or the world for root objects)
 		/// </summary>
 		const glm::vec3& GetPosition() const;
+		/// <summary>
+		/// Gets the object's position in world space
+		/// </summary>
+		glm::vec3 GetWorldPosition() const;
 
 		/// <summary>
-		/// Sets the rotation of this object to a quaternion value
+		/// Sets the rotation of this object relative to it's parent to a quaternion value
 		/// </summary>
 		/// <param name="value">The rotation quaternion for the object</param>
 		void SetRotation(const glm::quat& value);
 		/// <summary>
-		/// Gets the object's rotation as a quaternion value
+		/// Gets the object's rotation relative to it's parent as a quaternion value
 		/// </summary>
 		const glm::quat& GetRotation() const;
+		/// <summary>
+		/// Gets the object's rotation in world space
+		/// </summary>
+		glm::quat GetWorldRotation() const;
 
 		/// <summary>
 		/// Sets the rotation of the object in euler degrees (yaw, pitch, roll)
@@ -95,7 +138,7 @@ namespace Gameplay {
 		glm::vec3 GetRotationEuler() const;
 
 		/// <summary>
-		/// Sets the scaling factor for the game object, should be non-zero
+		/// Sets the scaling factor for the game object relative to it's parent, should be non-zero
 		/// </summary>
 		/// <param name="value">The new scaling factor for the game object</param>
 		void SetScale(const glm::vec3& value);
@@ -107,13 +150,24 @@ namespace Gameplay {
 		/// <summary>
 		/// Gets or recalculates and gets the object's world transform
 		/// This matrix transforms points from local space to world space
+		/// 
+		/// The reference is only valid until objects are added, removed or re-parented in the scene.
+		/// During a parallel update, changes to the local transform are not reflected here until the
+		/// component types that are running at the same time have finished
 		/// </summary>
 		const glm::mat4& GetTransform() const;
 		/// <summary>
 		/// Gets or recalculates the inverse of this object's world transform
 		/// This matrix transforms points from world space to local space
+		/// 
+		/// The reference is only valid until objects are added, removed or re-parented in the scene
 		/// </summary>
 		const glm::mat4& GetInverseTransform() const;
+		/// <summary>
+		/// Gets a counter that changes every time the world transform is recalculated, so
+		/// that systems can cache data derived from the transform (such as world bounds)
+		/// </summary>
+		uint32_t GetTransformVersion() const;
 
 		/// <summary>
 		/// Returns a pointer to the scene that this GameObject belongs to
@@ -212,8 +266,27 @@ namespace Gameplay {
 		/// </summary>
 		nlohmann::json ToJson() const;
 
+		/// <summary>
+		/// Loads a game object from a record in a binary scene file
+		/// </summary>
+		static GameObject::Sptr FromBinary(BinaryReader& reader);
+		/// <summary>
+		/// Writes this object as a record in a binary scene file. Transform data is
+		/// stored raw, components are stored as MessagePack encoded JSON blobs
+		/// </summary>
+		void ToBinary(BinaryWriter& writer) const;
+		/// <summary>
+		/// Converts the JSON representation of an object (as produced by ToJson)
+		/// directly to a binary record, without needing to load the object
+		/// </summary>
+		static void JsonToBinary(const nlohmann::json& data, BinaryWriter& writer);
+
 	private:
 		friend class Scene;
+		friend class TransformHierarchy;
+
+		// Human readable name for the object
+		std::string _name;
 
 		// Rotation of the object as a quaternion
 		glm::quat _rotation;
@@ -222,10 +295,24 @@ namespace Gameplay {
 		// The scale of the object
 		glm::vec3 _scale;
 
-		// The object's world transform
+		// The object's world transform, only used when the object is not in a scene's
+		// transform hierarchy (ex: while it is being loaded)
 		mutable glm::mat4 _transform;
 		mutable glm::mat4 _inverseTransform;
 		mutable bool _isTransformDirty;
+		// Set when our local transform changes during a parallel update, see _ApplyPendingTransform
+		bool _isTransformPending;
+		mutable uint32_t _transformVersion;
+
+		// The object we are attached to, and the objects attached to us. These are raw
+		// pointers since the scene owns all objects, and unlinks them when they are removed
+		GameObject*              _parent;
+		std::vector<GameObject*> _children;
+		// Our index in the scene's TransformHierarchy, or -1 if we are not in it
+		int                      _transformIndex;
+		// Increases with every object added to the scene, so objects can be ordered
+		// the way they appear in the scene without searching it
+		uint32_t                 _sceneOrder;
 
 		// The components that this game object has attached to it
 		std::vector<IComponent::Sptr> _components;
@@ -241,7 +328,14 @@ namespace Gameplay {
 		/// </summary>
 		GameObject();
 
-		// Recalculates the transform matrix for the object when required
+		// Recalculates the transform matrix for the object when required, only used
+		// when the object is not in a transform hierarchy
 		void _RecalcTransform() const;
+		// Calculates the transform from our local space to our parent's space
+		glm::mat4 _CalcLocalTransform() const;
+		// Flags our world transform (and our children's) for recalculation
+		void _MarkTransformDirty();
+		// Marks our transform as dirty if it was changed during a parallel update, main thread only
+		void _ApplyPendingTransform();
 	};
 }
\ No newline at end of file
@@ -19,6 +19,11 @@ namespace Gameplay {
 		/// The approximate range of our light in world units (meters)
 		/// </summary>
 		float Range = 4.0f;
+		/// <summary>
+		/// True if this light should cast shadows, only the shadow casting lights that are
+		/// closest to the camera get shadow maps, see ShadowMapping::MAX_POINT_SHADOWS
+		/// </summary>
+		bool CastShadows = false;
 
 		/// <summary>
 		/// Loads a light from a JSON blob
@@ -28,6 +33,7 @@ namespace Gameplay {
 			result.Position = ParseJsonVec3(data["position"]);
 			result.Color = ParseJsonVec3(data["color"]);
 			result.Range = data["range"].get<float>();
+			result.CastShadows = JsonGet(data, "cast_shadows", false);
 			return result;
 		}
 
@@ -39,8 +45,50 @@ namespace Gameplay {
 				{ "position", GlmToJson(Position) },
 				{ "color", GlmToJson(Color) },
 				{ "range", Range },
+				{ "cast_shadows", CastShadows },
 			};
 		}
 
 	};
+
+	/// <summary>
+	/// Represents a light that is infinitely far away (ex: the sun), which lights the
+	/// whole scene from a single direction
+	/// </summary>
+	struct DirectionalLight {
+		/// <summary>
+		/// The direction that the light travels in, does not need to be normalized
+		/// </summary>
+		glm::vec3 Direction = glm::vec3(0.0f, 0.0f, -1.0f);
+		/// <summary>
+		/// The color of the light in RGB, black disables the light
+		/// </summary>
+		glm::vec3 Color = glm::vec3(0.0f);
+		/// <summary>
+		/// True if this light should cast shadows, see ShadowMapping
+		/// </summary>
+		bool CastShadows = true;
+
+		/// <summary>
+		/// Loads a directional light from a JSON blob
+		/// </summary>
+		inline static DirectionalLight FromJson(const nlohmann::json& data) {
+			DirectionalLight result;
+			result.Direction = ParseJsonVec3(data["direction"]);
+			result.Color = ParseJsonVec3(data["color"]);
+			result.CastShadows = JsonGet(data, "cast_shadows", true);
+			return result;
+		}
+
+		/// <summary>
+		/// Converts this object into it's JSON representation for storage
+		/// </summary>
+		inline nlohmann::json ToJson() const {
+			return {
+				{ "direction", GlmToJson(Direction) },
+				{ "color", GlmToJson(Color) },
+				{ "cast_shadows", CastShadows },
+			};
+		}
+	};
 }
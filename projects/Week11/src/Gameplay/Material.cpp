@@ -5,19 +5,27 @@
 #include "Graphics/Texture2D.h"
 #include "Logging.h"
 #include "Utils/ImGuiHelper.h"
+#include <algorithm>
 
 namespace Gameplay {
 
 	Material::Material(const Shader::Sptr& shader) :
 		IResource(),
 		_shader(shader),
-		_uniforms(std::unordered_map<std::string, UniformData>())
+		_uniforms(std::unordered_map<std::string, UniformData>()),
+		_blockData(),
+		_blockBuffer(nullptr),
+		_blockBinding(-1),
+		_isBlockDirty(true),
+		_textureTable(),
+		_firstTextureSlot(RESERVED_TEXTURE_SLOTS),
+		_textureHandles(),
+		_looseUniforms(),
+		_isLayoutDirty(true)
 	{ }
 
 	Material::Material() :
-		IResource(),
-		_shader(nullptr),
-		_uniforms(std::unordered_map<std::string, UniformData>())
+		Material(nullptr)
 	{ }
 
 	void Material::Set(const std::string& name, ShaderDataType type, const void* value, size_t arraySize)
@@ -45,6 +53,11 @@ namespace Gameplay {
 				else {
 					memcpy(uniform.Value, value, ShaderDataTypeSize(type));
 				}
+
+				// The block will need to be re-uploaded next time we're applied
+				if (uniform.IsBlockMember) {
+					_isBlockDirty = true;
+				}
 			}
 		}
 		// We couldn't find that uniform, log a warning
@@ -57,32 +70,59 @@ namespace Gameplay {
 		return _shader;
 	}
 
-	void Material::Apply() {
+	void Material::Apply(ShaderVariant variant) {
 		if (_shader != nullptr) {
-			// Skip the reserved # of texture slots
-			int textureSlot = RESERVED_TEXTURE_SLOTS;
-			
-			// Iterate over the uniforms map
-			for (auto&[name, data] : _uniforms) {
-				// The typecode is basically the underlying type of the uniform
-				// ex: float, matrix, texture, etc...
-				ShaderDataTypecode typeCode = GetShaderDataTypeCode(data.Type);
-
-				// If the uniform is a texture, we try and bind it, then move to the next slot
-				if (typeCode == ShaderDataTypecode::Texture) {
-					ITexture::Sptr texture = data.TextureAsset;
-					if (texture != nullptr) {
-						texture->Bind(textureSlot);
-					} else {
-						ITexture::Unbind(textureSlot);
+			// Variants share our block and texture bindings, but they may put loose uniforms at other locations
+			Shader* program = _shader->GetVariant(variant);
+			if (program == nullptr) {
+				return;
+			}
+			auto getLocation = [&](const UniformData* data) {
+				Shader::UniformInfo info;
+				if (program == _shader.get()) {
+					return data->Location;
+				}
+				return program->FindUniform(data->Name, &info) ? info.Location : -1;
+			};
+
+			if (_isLayoutDirty) {
+				_BuildLayout();
+			}
+
+			// Upload our block only if something has changed, then bind it in one go
+			if (_blockBuffer != nullptr) {
+				if (_isBlockDirty) {
+					for (auto& [name, data] : _uniforms) {
+						if (data.IsBlockMember) {
+							data.WriteToBlock(_blockData.data(), _blockData.size());
+						}
 					}
-					// Send the slot to the shader
-					_shader->SetUniform(data.Location, data.Type, &textureSlot);
-					textureSlot++;
+					_blockBuffer->LoadData(_blockData.data(), 1, _blockData.size());
+					_isBlockDirty = false;
 				}
-				// The uniform is a plain ol' value type, send it in
-				else {
-					_shader->SetUniform(data.Location, data.Type, data.ArraySize > 1 ? data.ArrayBlock : data.Value, data.ArraySize);
+				_blockBuffer->Bind(_blockBinding);
+			}
+
+			// Textures may change or finish loading at any time, so we grab the handles here, but
+			// we can bind all of them with a single call (slots we don't use are left as 0)
+			if (!_textureTable.empty()) {
+				for (const TextureBinding& binding : _textureTable) {
+					ITexture::Sptr& texture = binding.Uniform->TextureAsset;
+					_textureHandles[binding.Slot - _firstTextureSlot] = texture != nullptr ? texture->GetBindHandle() : 0;
+					// Samplers without a binding in the shader need to be told which slot to use
+					if (binding.SetSamplerUniform) {
+						int slot = binding.Slot;
+						program->SetUniform(getLocation(binding.Uniform), binding.Uniform->Type, &slot);
+					}
+				}
+				glBindTextures(_firstTextureSlot, static_cast<GLsizei>(_textureHandles.size()), _textureHandles.data());
+			}
+
+			// Anything outside of the block is a plain ol' uniform, send it in
+			for (UniformData* data : _looseUniforms) {
+				int location = getLocation(data);
+				if (location != -1) {
+					program->SetUniform(location, data->Type, data->ArraySize > 1 ? data->ArrayBlock : data->Value, data->ArraySize);
 				}
 			}
 		}
@@ -95,7 +135,9 @@ namespace Gameplay {
 			// Draw all of our valid uniforms
 			for (auto&[key, value] : _uniforms) {
 				if (value.Location != -2 && value.Location != -1) {
-					value.RenderImGui();
+					if (value.RenderImGui() && value.IsBlockMember) {
+						_isBlockDirty = true;
+					}
 				}
 			}
 
@@ -118,6 +160,8 @@ namespace Gameplay {
 		result->OverrideGUID(Guid(data["guid"]));
 		result->Name = data["name"].get<std::string>();
 		result->_shader = ResourceManager::Get<Shader>(Guid(data["shader"]));
+		// We need the shader's uniforms to load our parameters, so it can't still be loading
+		ResourceManager::EnsureLoaded(result->_shader);
 
 		// material specific parameters'
 		if (data.contains("parameters") && data["parameters"].is_object()) {
@@ -155,17 +199,124 @@ namespace Gameplay {
 	{
 		UniformData& data = _uniforms[name];
 		if (data.Location == -2) {
-			Shader::UniformInfo uniform;
-			if (_shader->FindUniform(name, &uniform)) {
-				data = UniformData(name, _shader);
-			} else {
+			data = UniformData(name, _shader);
+			if (data.Location == -2) {
 				data.Location = -1;
 			}
+			_isLayoutDirty = true;
 		}
 		return data;
 	}
 
-	void Material::UniformData::RenderImGui() {
+	void Material::_BuildLayout() {
+		_textureTable.clear();
+		_textureHandles.clear();
+		_looseUniforms.clear();
+		_blockData.clear();
+		_blockBuffer = nullptr;
+		_blockBinding = -1;
+
+		// If the shader has a material block, we'll need a buffer to back it
+		Shader::UniformBlockInfo block;
+		if (_shader->FindUniformBlock(UNIFORM_BLOCK_NAME, &block)) {
+			_blockData.resize(block.SizeInBytes, 0);
+			_blockBuffer = std::make_shared<AbstractUniformBuffer>(block.SizeInBytes, BufferUsage::DynamicDraw);
+			_blockBinding = block.CurrentBinding;
+		}
+
+		// Textures that the shader has bound to a slot keep that slot, the rest get
+		// assigned slots after the highest one in use
+		int nextFreeSlot = RESERVED_TEXTURE_SLOTS;
+		for (auto& [name, data] : _uniforms) {
+			if (data.IsTextureResource() && data.Binding >= RESERVED_TEXTURE_SLOTS) {
+				nextFreeSlot = std::max(nextFreeSlot, data.Binding + 1);
+			}
+		}
+
+		for (auto& [name, data] : _uniforms) {
+			if (data.Location < 0) {
+				continue;
+			}
+			if (data.IsBlockMember) {
+				continue;
+			}
+			if (data.IsTextureResource()) {
+				if (data.Binding >= RESERVED_TEXTURE_SLOTS) {
+					_textureTable.push_back({ data.Binding, &data, false });
+				} else {
+					_textureTable.push_back({ nextFreeSlot++, &data, true });
+				}
+			} else {
+				_looseUniforms.push_back(&data);
+			}
+		}
+
+		// Work out the range of slots we need to cover with glBindTextures
+		if (!_textureTable.empty()) {
+			int minSlot = _textureTable[0].Slot;
+			int maxSlot = _textureTable[0].Slot;
+			for (const TextureBinding& binding : _textureTable) {
+				minSlot = std::min(minSlot, binding.Slot);
+				maxSlot = std::max(maxSlot, binding.Slot);
+			}
+			_firstTextureSlot = minSlot;
+			_textureHandles.resize(maxSlot - minSlot + 1, 0);
+		}
+
+		if (!_looseUniforms.empty()) {
+			LOG_TRACE("Material \"{}\" has {} uniforms outside of {}, these will be set individually", Name, _looseUniforms.size(), UNIFORM_BLOCK_NAME);
+		}
+
+		_isBlockDirty = true;
+		_isLayoutDirty = false;
+	}
+
+	void Material::UniformData::WriteToBlock(uint8_t* block, size_t blockSize) const {
+		ShaderDataTypecode typeCode = GetShaderDataTypeCode(Type);
+		size_t elementSize = ShaderDataTypeSize(Type);
+		const uint8_t* source = ArraySize > 1 ? (const uint8_t*)ArrayBlock : Value;
+		if (source == nullptr) {
+			return;
+		}
+
+		for (size_t ix = 0; ix < ArraySize; ix++) {
+			const uint8_t* element = source + elementSize * ix;
+			uint8_t* dest = block + Location + ArrayStride * ix;
+			LOG_ASSERT(dest + elementSize <= block + blockSize, "Uniform \"{}\" exceeds the bounds of the material block", Name);
+
+			switch (typeCode) {
+				// std140 pads matrix columns out, so we need to copy a column at a time
+				case ShaderDataTypecode::Matrix:
+				case ShaderDataTypecode::MatrixD:
+				{
+					uint32_t rows       = (uint32_t)Type & ShaderDataType_Size1Mask;
+					uint32_t columns    = ((uint32_t)Type & ShaderDataType_Size2Mask) >> 3;
+					size_t   columnSize = rows * (typeCode == ShaderDataTypecode::MatrixD ? sizeof(double) : sizeof(float));
+					for (uint32_t col = 0; col < columns; col++) {
+						memcpy(dest + MatrixStride * col, element + columnSize * col, columnSize);
+					}
+					break;
+				}
+				// GLSL bools are 4 bytes in a block
+				case ShaderDataTypecode::Bool:
+				{
+					uint32_t components = ShaderDataTypeComponentCount(Type);
+					for (uint32_t c = 0; c < components; c++) {
+						uint32_t value = reinterpret_cast<const bool*>(element)[c] ? 1 : 0;
+						memcpy(dest + sizeof(uint32_t) * c, &value, sizeof(uint32_t));
+					}
+					break;
+				}
+				default:
+					memcpy(dest, element, elementSize);
+					break;
+			}
+		}
+	}
+
+	bool Material::UniformData::RenderImGui() {
+		bool isModified = false;
+
 		ImGui::PushID(Name.c_str());
 
 		// Will store names for fields
@@ -220,7 +371,7 @@ namespace Gameplay {
 				case ShaderDataTypecode::Bool:
 					for (int e = 0; e < numElements; e++) {
 						ImGui::PushID(e);
-						ImGui::Checkbox("", ((bool*)elem) + e);
+						isModified |= ImGui::Checkbox("", ((bool*)elem) + e);
 						if (e < numElements - 1) { ImGui::SameLine(); }
 						ImGui::PopID();
 					}
@@ -228,7 +379,7 @@ namespace Gameplay {
 				case ShaderDataTypecode::Float:
 					for (int e = 0; e < numElements; e++) {
 						ImGui::PushID(e);
-						ImGui::DragFloat("", ((float*)elem) + e, 0.1f);
+						isModified |= ImGui::DragFloat("", ((float*)elem) + e, 0.1f);
 						if (e < numElements - 1) { ImGui::SameLine(); }
 						ImGui::PopID();
 					}
@@ -236,7 +387,7 @@ namespace Gameplay {
 				case ShaderDataTypecode::Double:
 					for (int e = 0; e < numElements; e++) {
 						ImGui::PushID(e);
-						ImGui::DragScalar("", ImGuiDataType_Double, ((double*)elem) + e, 0.1f);
+						isModified |= ImGui::DragScalar("", ImGuiDataType_Double, ((double*)elem) + e, 0.1f);
 						if (e < numElements - 1) { ImGui::SameLine(); }
 						ImGui::PopID();
 					}
@@ -244,7 +395,7 @@ namespace Gameplay {
 				case ShaderDataTypecode::Int:
 					for (int e = 0; e < numElements; e++) {
 						ImGui::PushID(e);
-						ImGui::DragScalar("", ImGuiDataType_S32, ((int*)elem) + e, 0.1f);
+						isModified |= ImGui::DragScalar("", ImGuiDataType_S32, ((int*)elem) + e, 0.1f);
 						if (e < numElements - 1) { ImGui::SameLine(); }
 						ImGui::PopID();
 					}
@@ -252,7 +403,7 @@ namespace Gameplay {
 				case ShaderDataTypecode::Uint:
 					for (int e = 0; e < numElements; e++) {
 						ImGui::PushID(e);
-						ImGui::DragScalar("", ImGuiDataType_U32, ((int*)elem) + e, 0.1f);
+						isModified |= ImGui::DragScalar("", ImGuiDataType_U32, ((int*)elem) + e, 0.1f);
 						if (e < numElements - 1) { ImGui::SameLine(); }
 						ImGui::PopID();
 					}
@@ -272,6 +423,7 @@ namespace Gameplay {
 			ImGui::Unindent();
 		}
 		ImGui::PopID();
+		return isModified;
 	}
 
 	////////////////////////////////////////////////////////////////
@@ -299,11 +451,29 @@ namespace Gameplay {
 	{
 		// We extract the uniform info from the shader to populate our info
 		Shader::UniformInfo uniform;
-		if (shader != nullptr && shader->FindUniform(uniformName, &uniform)) {
+		bool isFound = shader != nullptr && shader->FindUniform(uniformName, &uniform);
+
+		// If it's not a regular uniform, it may be a member of the material block
+		Shader::UniformBlockInfo block;
+		if (!isFound && shader != nullptr && shader->FindUniformBlock(Material::UNIFORM_BLOCK_NAME, &block)) {
+			for (const Shader::UniformInfo& member : block.SubUniforms) {
+				if (member.Name == uniformName) {
+					uniform = member;
+					isFound = true;
+					IsBlockMember = true;
+					break;
+				}
+			}
+		}
+
+		if (isFound) {
 			Name = uniformName;
 			Location = uniform.Location;
 			Type = uniform.Type;
 			ArraySize = uniform.ArraySize;
+			ArrayStride = uniform.ArrayStride;
+			MatrixStride = uniform.MatrixStride;
+			Binding = uniform.Binding;
 			
 			// Allocate memory for array if the uniform is an array
 			if (ArraySize > 1) {
@@ -319,6 +489,10 @@ namespace Gameplay {
 		Location = other.Location;
 		ArraySize = other.ArraySize;
 		Type = other.Type;
+		IsBlockMember = other.IsBlockMember;
+		ArrayStride = other.ArrayStride;
+		MatrixStride = other.MatrixStride;
+		Binding = other.Binding;
 
 		if (GetShaderDataTypeCode(Type) == ShaderDataTypecode::Texture) {
 			TextureAsset = other.TextureAsset;
@@ -335,10 +509,14 @@ namespace Gameplay {
 	Material::UniformData::UniformData(UniformData&& other) :
 		TextureAsset(nullptr) 
 	{
-		Name      = other.Name;
-		Location  = other.Location;
-		ArraySize = other.ArraySize;
-		Type      = other.Type;
+		Name          = other.Name;
+		Location      = other.Location;
+		ArraySize     = other.ArraySize;
+		Type          = other.Type;
+		IsBlockMember = other.IsBlockMember;
+		ArrayStride   = other.ArrayStride;
+		MatrixStride  = other.MatrixStride;
+		Binding       = other.Binding;
 
 		if (GetShaderDataTypeCode(Type) == ShaderDataTypecode::Texture) {
 			TextureAsset = other.TextureAsset;
@@ -2,11 +2,18 @@
 #include <memory>
 #include "Graphics/Shader.h"
 #include "Graphics/ITexture.h"
+#include "Graphics/UniformBuffer.h"
 
 namespace Gameplay {
 	/// <summary>
 	/// Helper structure for material parameters to our shader
 	/// THIS IS VERY TEMPORARY
+	///
+	/// Value parameters that live in the shader's b_Material uniform block are baked into a
+	/// std140 buffer owned by the material, which is only re-uploaded when a parameter changes.
+	/// Textures are bound from a slot table built once from the shader's sampler bindings, so
+	/// applying a material is one buffer bind and one glBindTextures call. Any parameters
+	/// outside of the block are still set one uniform at a time
 	/// </summary>
 	struct Material : public IResource {
 	public:
@@ -18,6 +25,10 @@ namespace Gameplay {
 		/// as the environment map. We'll specify a number of reserved slots here
 		/// </summary>
 		static const int RESERVED_TEXTURE_SLOTS = 2;
+		/// <summary>
+		/// The name of the uniform block that holds a material's value parameters
+		/// </summary>
+		inline static const std::string UNIFORM_BLOCK_NAME = "b_Material";
 
 		/// <summary>
 		/// A human readable name for the material
@@ -62,9 +73,11 @@ namespace Gameplay {
 
 		/// <summary>
 		/// Handles applying this material's state to the OpenGL pipeline
-		/// Will bind the shader, update material uniforms, and bind textures
+		/// Will bind the material's uniform block (uploading it if it has changed), bind
+		/// textures, and set any uniforms that are not part of the block
 		/// </summary>
-		virtual void Apply();
+		/// <param name="variant">The variant of our shader that we're being drawn with, uniforms outside of the block are set on that program</param>
+		virtual void Apply(ShaderVariant variant = ShaderVariant::Forward);
 
 		/// <summary>
 		/// Renders some UI controls for manipulating a material at runtime
@@ -93,7 +106,7 @@ namespace Gameplay {
 		struct UniformData {
 			// The name of the uniform in the shader
 			std::string    Name;
-			// Location of the uniform within the shader
+			// Location of the uniform within the shader, or it's byte offset for block members
 			int            Location = -2;
 			union {
 				// A space to store non-array values, can store up to a dmat4
@@ -110,13 +123,25 @@ namespace Gameplay {
 
 			// The type of uniform
 			ShaderDataType Type = ShaderDataType::None;
+
+			// True if the uniform is part of the material's uniform block
+			bool           IsBlockMember = false;
+			// The std140 strides for block members, in bytes
+			int            ArrayStride = 0;
+			int            MatrixStride = 0;
+			// For textures, the slot the shader has the sampler bound to
+			int            Binding = -1;
 			
 			UniformData() :
 				Name("<unknown>"),
 				Location(-2),
 				TextureAsset(nullptr),
 				ArraySize(0),
-				Type(ShaderDataType::None) 
+				Type(ShaderDataType::None),
+				IsBlockMember(false),
+				ArrayStride(0),
+				MatrixStride(0),
+				Binding(-1)
 			{ }
 			UniformData(const UniformData& other);
 			UniformData(UniformData&& other);
@@ -128,7 +153,15 @@ namespace Gameplay {
 			/// <summary>
 			/// Renders GUI for this uniform
 			/// </summary>
-			void RenderImGui();
+			/// <returns>True if the value was modified</returns>
+			bool RenderImGui();
+
+			/// <summary>
+			/// Writes this uniform's value into a std140 block, using the offset and strides from the shader
+			/// </summary>
+			/// <param name="block">The start of the block's data</param>
+			/// <param name="blockSize">The size of the block in bytes</param>
+			void WriteToBlock(uint8_t* block, size_t blockSize) const;
 
 			/// <summary>
 			/// Converts this uniform into a JSON representation
@@ -173,7 +206,37 @@ namespace Gameplay {
 		/// </summary>
 		std::unordered_map<std::string, UniformData> _uniforms;
 
+		// A texture uniform and the slot it will be bound to
+		struct TextureBinding {
+			int          Slot;
+			UniformData* Uniform;
+			// True if the sampler has no binding in the shader, and we need to set it's uniform
+			bool         SetSamplerUniform;
+		};
+
+		// The std140 data for our uniform block, and the buffer we upload it to
+		std::vector<uint8_t>        _blockData;
+		AbstractUniformBuffer::Sptr _blockBuffer;
+		int                         _blockBinding;
+		bool                        _isBlockDirty;
+
+		// Our texture slot table, and the handles for glBindTextures covering the slots we use
+		std::vector<TextureBinding> _textureTable;
+		int                         _firstTextureSlot;
+		std::vector<GLuint>         _textureHandles;
+
+		// Uniforms that are not part of the block, these are set individually
+		std::vector<UniformData*>   _looseUniforms;
+
+		// Set when the set of uniforms changes, and we need to rebuild our block and tables
+		bool                        _isLayoutDirty;
+
 		UniformData& _GetUniform(const std::string& name);
+		/// <summary>
+		/// Sorts our uniforms into the block, the texture table, and the uniforms we need
+		/// to set individually. Pointers into _uniforms are safe to keep since it's node based
+		/// </summary>
+		void _BuildLayout();
 
 	};
 }
\ No newline at end of file
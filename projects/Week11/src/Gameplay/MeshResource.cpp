@@ -1,7 +1,8 @@
 #include "MeshResource.h"
 #include <filesystem>
+#include <cstring>
 
-#include "Utils/ObjLoader.h"
+#include "Utils/OptimizedObjLoader.h"
 
 namespace Gameplay {
 	MeshResource::MeshResource() :
@@ -9,7 +10,14 @@ namespace Gameplay {
 		Filename(""),
 		MeshBuilderParams(std::vector<MeshBuilderParam>()),
 		Mesh(nullptr),
-		BulletTriMesh(nullptr)
+		LodScreenSizes(),
+		LodReduction(DEFAULT_LOD_REDUCTION),
+		Lods(),
+		ColliderMeshData(nullptr),
+		KeepCpuData(false),
+		CpuPositions(),
+		CpuIndices(),
+		ConvexHull(nullptr)
 	{ }
 
 	MeshResource::MeshResource(const std::string& filename) :
@@ -17,9 +25,18 @@ namespace Gameplay {
 		Filename(filename),
 		MeshBuilderParams(std::vector<MeshBuilderParam>()),
 		Mesh(nullptr),
-		BulletTriMesh(nullptr)
+		LodScreenSizes(),
+		LodReduction(DEFAULT_LOD_REDUCTION),
+		Lods(),
+		ColliderMeshData(nullptr),
+		KeepCpuData(false),
+		CpuPositions(),
+		CpuIndices(),
+		ConvexHull(nullptr)
 	{
-		Mesh = ObjLoader::LoadFromFile(filename);
+		if (_LoadDeferred()) {
+			_FinishDeferredLoad();
+		}
 	}
 
 	MeshResource::~MeshResource() = default;
@@ -36,45 +53,126 @@ namespace Gameplay {
 		} else {
 			result["filename"] = Filename.empty() ? "null" : Filename;
 		}
+		result["keep_cpu_data"] = KeepCpuData;
+		result["lod_screen_sizes"] = LodScreenSizes;
+		result["lod_reduction"] = LodReduction;
 		return result;
 	}
 
 	MeshResource::Sptr MeshResource::FromJson(const nlohmann::json & blob)
 	{
 		MeshResource::Sptr result = std::make_shared<MeshResource>();
+		result->KeepCpuData = JsonGet(blob, "keep_cpu_data", false);
+		result->LodScreenSizes = JsonGet(blob, "lod_screen_sizes", std::vector<float>());
+		result->LodReduction = JsonGet(blob, "lod_reduction", DEFAULT_LOD_REDUCTION);
 		if (blob.contains("params") && blob["params"].is_array()) {
 			std::vector<nlohmann::json> meshbuilderParams = blob["params"].get<std::vector<nlohmann::json>>();
-			MeshBuilder<VertexPosNormTexCol> mesh;
 			for (int ix = 0; ix < meshbuilderParams.size(); ix++) {
-				MeshBuilderParam p = MeshBuilderParam::FromJson(meshbuilderParams[ix]);
-				result->MeshBuilderParams.push_back(p);
-				MeshFactory::AddParameterized(mesh, p);
+				result->MeshBuilderParams.push_back(MeshBuilderParam::FromJson(meshbuilderParams[ix]));
 			}
-			result->Mesh = mesh.Bake();
+			result->GenerateMesh();
 		} else {
 			result->Filename = JsonGet<std::string>(blob, "filename", "null");
 			if (result->Filename != "null" && std::filesystem::exists(result->Filename)) {
-				#ifdef OPTIMIZED_OBJ_LOADER
-				result->Mesh = OptimizedObjLoader::LoadFromFile(result->Filename);
-				#else
-				result->Mesh = ObjLoader::LoadFromFile(result->Filename);
-				#endif
-
+				// Parsing is done in the background by the resource manager, see _LoadDeferred
+				result->_loadState = ResourceLoadState::Pending;
 			}
 		}
 		return result;
 	}
 
+	bool MeshResource::_LoadDeferred() {
+		OptimizedObjLoader::LodSettings lods(static_cast<uint32_t>(LodScreenSizes.size()), LodReduction);
+		if (!OptimizedObjLoader::LoadMeshData(Filename, _pendingMesh, true, lods)) {
+			return false;
+		}
+		// We're still on a worker thread, so this is the cheapest place to pull out our CPU copy
+		_RetainCpuData(
+			_pendingMesh.VertexData, _pendingMesh.VertexCount,
+			sizeof(OptimizedObjLoader::VertexType), offsetof(OptimizedObjLoader::VertexType, Position),
+			_pendingMesh.IndexData, _pendingMesh.IndexCount, GetIndexTypeSize(_pendingMesh.IndexFormat)
+		);
+		return true;
+	}
+
+	void MeshResource::_FinishDeferredLoad() {
+		Mesh = OptimizedObjLoader::Upload(_pendingMesh);
+		Lods = OptimizedObjLoader::UploadLods(_pendingMesh, Mesh);
+		// Release the parsed data (or unmap the cache file)
+		_pendingMesh = OptimizedObjLoader::MeshData();
+	}
+
 	void MeshResource::GenerateMesh() {
 		MeshBuilder<VertexPosNormTexColTangents> mesh;
 		for (auto& param : MeshBuilderParams) {
 			MeshFactory::AddParameterized(mesh, param);
 		}
 		MeshFactory::CalculateTBN(mesh);
-		Mesh = mesh.Bake();
+		MeshFactory::Optimize(mesh);
+		Mesh = MeshFactory::BakePacked(mesh);
+		Lods = MeshFactory::BakeLods(mesh, Mesh, static_cast<int>(LodScreenSizes.size()), LodReduction);
+		_RetainCpuData(mesh);
 	}
 
 	void MeshResource::AddParam(const MeshBuilderParam & param) {
 		MeshBuilderParams.push_back(param);
 	}
+
+	void MeshResource::ReleaseCpuData() {
+		// swap with empty vectors so the memory is actually freed
+		std::vector<glm::vec3>().swap(CpuPositions);
+		std::vector<uint32_t>().swap(CpuIndices);
+	}
+
+	bool MeshResource::LoadCpuData() {
+		KeepCpuData = true;
+		if (!CpuPositions.empty()) {
+			return true;
+		}
+
+		if (MeshBuilderParams.size() > 0) {
+			// Build the mesh the same way GenerateMesh does, so we end up with the same vertices
+			MeshBuilder<VertexPosNormTexColTangents> mesh;
+			for (auto& param : MeshBuilderParams) {
+				MeshFactory::AddParameterized(mesh, param);
+			}
+			MeshFactory::CalculateTBN(mesh);
+			MeshFactory::Optimize(mesh);
+			_RetainCpuData(mesh);
+		} else if (!Filename.empty() && Filename != "null") {
+			// Use the same LOD settings as the original load, so that we hit the mesh cache
+			OptimizedObjLoader::MeshData data;
+			OptimizedObjLoader::LodSettings lods(static_cast<uint32_t>(LodScreenSizes.size()), LodReduction);
+			if (OptimizedObjLoader::LoadMeshData(Filename, data, true, lods)) {
+				_RetainCpuData(
+					data.VertexData, data.VertexCount,
+					sizeof(OptimizedObjLoader::VertexType), offsetof(OptimizedObjLoader::VertexType, Position),
+					data.IndexData, data.IndexCount, GetIndexTypeSize(data.IndexFormat)
+				);
+			}
+		}
+		return !CpuPositions.empty();
+	}
+
+	void MeshResource::_RetainCpuData(const void* vertexData, size_t vertexCount, size_t stride, size_t positionOffset, const void* indexData, size_t indexCount, size_t indexSize) {
+		// The mesh may have been regenerated, so the old hull no longer matches
+		ConvexHull = nullptr;
+		if (!KeepCpuData) {
+			ReleaseCpuData();
+			return;
+		}
+
+		const uint8_t* vertices = reinterpret_cast<const uint8_t*>(vertexData) + positionOffset;
+		CpuPositions.resize(vertexCount);
+		for (size_t ix = 0; ix < vertexCount; ix++) {
+			memcpy(&CpuPositions[ix], vertices + ix * stride, sizeof(glm::vec3));
+		}
+		if (indexSize == sizeof(uint16_t)) {
+			const uint16_t* indices = reinterpret_cast<const uint16_t*>(indexData);
+			CpuIndices.assign(indices, indices + indexCount);
+		} else {
+			const uint32_t* indices = reinterpret_cast<const uint32_t*>(indexData);
+			CpuIndices.assign(indices, indices + indexCount);
+		}
+	}
 }
\ No newline at end of file
@@ -2,9 +2,7 @@
 #include "Utils/ResourceManager/IResource.h"
 #include "Graphics/VertexArrayObject.h"
 #include "Utils/MeshFactory.h"
-
-// bullet triangle mesh pre-declaration
-class btTriangleMesh;
+#include "Utils/OptimizedObjLoader.h"
 
 namespace Gameplay {
 	/// <summary>
@@ -16,6 +14,9 @@ namespace Gameplay {
 	public:
 		typedef std::shared_ptr<MeshResource> Sptr;
 
+		// The fraction of triangles each level of detail keeps, if not specified in the manifest
+		inline static const float DEFAULT_LOD_REDUCTION = 0.5f;
+
 		// Default constructor
 		MeshResource();
 		/// <summary>
@@ -41,15 +42,48 @@ namespace Gameplay {
 		/// </summary>
 		VertexArrayObject::Sptr         Mesh;
 
+		/// <summary>
+		/// The fractions of the screen's height that the mesh's bounds must shrink below to switch
+		/// to each level of detail, from most to least detailed. The number of entries is the
+		/// number of levels to generate, ex: { 0.25f, 0.1f, 0.04f }. Empty by default, so meshes
+		/// only get levels of detail if they ask for them (ex: with lod_screen_sizes in the manifest).
+		/// Changes take effect the next time the mesh is loaded or generated
+		/// </summary>
+		std::vector<float>              LodScreenSizes;
+		/// <summary>
+		/// The fraction of triangles each level of detail keeps from the level before it
+		/// </summary>
+		float                           LodReduction;
+		/// <summary>
+		/// The VAOs for each level of detail after the full detail Mesh, these share Mesh's vertex
+		/// buffers. Can have fewer levels than LodScreenSizes, if the mesh could not be simplified that far
+		/// </summary>
+		std::vector<VertexArrayObject::Sptr> Lods;
+
 
 		/// <summary>
 		/// The optional mesh resource for generating colliders from this mesh
 		/// </summary>
 		MeshResource::Sptr             ColliderMeshData;
+
+		/// <summary>
+		/// True to keep a copy of the mesh's positions and indices in CPU memory when it is
+		/// loaded or generated, this is needed to build colliders from the mesh. Defaults to false,
+		/// ConvexMeshCollider turns it on for the meshes it uses (see LoadCpuData)
+		/// </summary>
+		bool                            KeepCpuData;
 		/// <summary>
-		/// Allows for bullet to generate a triangle mesh from this mesh and cache it
+		/// The vertex positions of the mesh, only populated if KeepCpuData was set when the mesh was loaded
 		/// </summary>
-		std::shared_ptr<btTriangleMesh> BulletTriMesh;
+		std::vector<glm::vec3>          CpuPositions;
+		/// <summary>
+		/// The triangle indices of the mesh, empty if the mesh is not indexed (every 3 positions is a triangle)
+		/// </summary>
+		std::vector<uint32_t>           CpuIndices;
+		/// <summary>
+		/// The simplified convex hull of the mesh, cooked the first time a collider needs it. See Physics::CollisionCooker
+		/// </summary>
+		std::shared_ptr<const std::vector<glm::vec3>> ConvexHull;
 
 		/// <summary>
 		/// Generates a new mesh from the mesh builder parameters
@@ -60,10 +94,47 @@ namespace Gameplay {
 		/// </summary>
 		/// <param name="param">The parameter to add</param>
 		void AddParam(const MeshBuilderParam& param);
+		/// <summary>
+		/// Gets the number of levels of detail that are ready to draw, including the full detail mesh
+		/// </summary>
+		int GetLodCount() const { return Mesh != nullptr ? static_cast<int>(Lods.size()) + 1 : 0; }
+		/// <summary>
+		/// Gets the VAO for a level of detail, where 0 is the full detail mesh
+		/// </summary>
+		/// <param name="level">The level to get, must be less than GetLodCount</param>
+		const VertexArrayObject::Sptr& GetLod(int level) const { return level == 0 ? Mesh : Lods[level - 1]; }
+		/// <summary>
+		/// Frees the CPU copy of the mesh data, cooked collision data is kept
+		/// </summary>
+		void ReleaseCpuData();
+		/// <summary>
+		/// Makes sure the CPU copy of the mesh is resident, and sets KeepCpuData so that it is kept
+		/// from the start the next time the mesh is loaded. File meshes are read back from their
+		/// mesh cache, and generated meshes are rebuilt without touching OpenGL
+		/// </summary>
+		/// <returns>True if the CPU data is available</returns>
+		bool LoadCpuData();
 
 		// Inherited from IResource
 
 		virtual nlohmann::json ToJson() const override;
 		static MeshResource::Sptr FromJson(const nlohmann::json& blob);
+
+	protected:
+		// The vertex and index data parsed by _LoadDeferred, waiting to be uploaded
+		OptimizedObjLoader::MeshData _pendingMesh;
+
+		virtual bool _LoadDeferred() override;
+		virtual void _FinishDeferredLoad() override;
+
+		/// <summary>
+		/// Copies positions and indices out of interleaved vertex data into CpuPositions and CpuIndices,
+		/// if KeepCpuData is set. Indices may be 16 or 32 bit, see indexSize
+		/// </summary>
+		void _RetainCpuData(const void* vertexData, size_t vertexCount, size_t stride, size_t positionOffset, const void* indexData, size_t indexCount, size_t indexSize);
+		template <typename VertType>
+		void _RetainCpuData(const MeshBuilder<VertType>& mesh) {
+			_RetainCpuData(mesh.GetVertexDataPtr(), mesh.GetVertexCount(), sizeof(VertType), offsetof(VertType, Position), mesh.GetIndexDataPtr(), mesh.GetIndexCount(), sizeof(uint32_t));
+		}
 	};
 }
\ No newline at end of file
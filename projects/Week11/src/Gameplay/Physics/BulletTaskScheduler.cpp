@@ -0,0 +1,62 @@
+#include "Gameplay/Physics/BulletTaskScheduler.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "Utils/JobSystem.h"
+
+namespace Gameplay::Physics {
+	BulletTaskScheduler::BulletTaskScheduler() :
+		btITaskScheduler("JobSystem")
+	{ }
+
+	void BulletTaskScheduler::Install() {
+		// Bullet keeps a pointer to the scheduler for the life of the program
+		static BulletTaskScheduler scheduler;
+		if (btGetTaskScheduler() != &scheduler) {
+			btSetTaskScheduler(&scheduler);
+		}
+	}
+
+	int BulletTaskScheduler::getMaxNumThreads() const {
+		return BT_MAX_THREAD_COUNT;
+	}
+
+	int BulletTaskScheduler::getNumThreads() const {
+		// The thread that starts a loop helps run it
+		return std::min(static_cast<int>(JobSystem::GetWorkerCount()) + 1, static_cast<int>(BT_MAX_THREAD_COUNT));
+	}
+
+	void BulletTaskScheduler::setNumThreads(int /*numThreads*/) {
+		// The job system owns it's threads, so there's nothing to do here
+	}
+
+	void BulletTaskScheduler::parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body) {
+		if (iEnd <= iBegin) {
+			return;
+		}
+		JobSystem::ParallelFor(iEnd - iBegin, std::max(grainSize, 1), [iBegin, &body](size_t start, size_t end) {
+			body.forLoop(iBegin + static_cast<int>(start), iBegin + static_cast<int>(end));
+		});
+	}
+
+	btScalar BulletTaskScheduler::parallelSum(int iBegin, int iEnd, int grainSize, const btIParallelSumBody& body) {
+		if (iEnd <= iBegin) {
+			return btScalar(0);
+		}
+
+		// Each batch writes it's own slot, so we don't need any atomics
+		size_t batchSize = std::max(grainSize, 1);
+		size_t count = iEnd - iBegin;
+		std::vector<btScalar> sums((count + batchSize - 1) / batchSize, btScalar(0));
+		JobSystem::ParallelFor(count, batchSize, [iBegin, batchSize, &body, &sums](size_t start, size_t end) {
+			sums[start / batchSize] = body.sumLoop(iBegin + static_cast<int>(start), iBegin + static_cast<int>(end));
+		});
+
+		btScalar result = btScalar(0);
+		for (btScalar sum : sums) {
+			result += sum;
+		}
+		return result;
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <LinearMath/btThreads.h>
+
+namespace Gameplay::Physics {
+	/// <summary>
+	/// Lets Bullet's multithreaded world and solvers split their work across the
+	/// job system, rather than starting a second pool of threads that would fight
+	/// with ours for the cores
+	///
+	/// Note that Bullet only calls into the scheduler if it was built with BT_THREADSAFE,
+	/// otherwise the parallel loops just run on the calling thread
+	/// </summary>
+	class BulletTaskScheduler : public btITaskScheduler {
+	public:
+		BulletTaskScheduler();
+		virtual ~BulletTaskScheduler() = default;
+
+		BulletTaskScheduler(const BulletTaskScheduler& other) = delete;
+		BulletTaskScheduler(BulletTaskScheduler&& other) = delete;
+		BulletTaskScheduler& operator=(const BulletTaskScheduler& other) = delete;
+		BulletTaskScheduler& operator=(BulletTaskScheduler&& other) = delete;
+
+		/// <summary>
+		/// Installs the scheduler as Bullet's global task scheduler, if it is not already.
+		/// Must be called before creating any of Bullet's "Mt" classes
+		/// </summary>
+		static void Install();
+
+		// Inherited from btITaskScheduler
+		virtual int getMaxNumThreads() const override;
+		virtual int getNumThreads() const override;
+		virtual void setNumThreads(int numThreads) override;
+		virtual void parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body) override;
+		virtual btScalar parallelSum(int iBegin, int iEnd, int grainSize, const btIParallelSumBody& body) override;
+	};
+}
@@ -19,7 +19,8 @@ namespace Gameplay::Physics {
 		virtual void FromJson(const nlohmann::json& data) override;
 
 	protected:
-		btTriangleMesh* _triMesh;
+		// The cooked hull of our mesh, shared with the mesh resource
+		std::shared_ptr<const std::vector<glm::vec3>> _hull;
 		ConvexMeshCollider();
 
 		virtual btCollisionShape* CreateShape() const override;
@@ -0,0 +1,127 @@
+#include "Gameplay/Physics/CollisionCooker.h"
+
+#include <filesystem>
+#include <BulletCollision/CollisionShapes/btConvexHullShape.h>
+#include <BulletCollision/CollisionShapes/btShapeHull.h>
+#include <Logging.h>
+
+#include "Utils/ChunkedFile.h"
+
+// Chunk IDs and versions for our hull cache files, bump the version if the
+// cooking changes to invalidate old caches
+static const uint32_t HULL_CACHE_CHUNK   = MakeFourCC("HULL");
+static const uint32_t HULL_CACHE_VERSION = 1;
+
+namespace Gameplay::Physics {
+	std::shared_ptr<const std::vector<glm::vec3>> CollisionCooker::GetConvexHull(const MeshResource::Sptr& mesh) {
+		if (mesh->ConvexHull != nullptr) {
+			return mesh->ConvexHull;
+		}
+		if (mesh->CpuPositions.empty()) {
+			return nullptr;
+		}
+
+		uint64_t sourceHash = _HashMeshData(mesh);
+		std::string path = CACHE_DIRECTORY + mesh->GetGUID().str() + HULL_EXTENSION;
+
+		std::vector<glm::vec3> hull;
+		if (!_LoadHull(path, sourceHash, hull)) {
+			hull = _CookConvexHull(mesh->CpuPositions);
+			if (hull.empty()) {
+				return nullptr;
+			}
+			_SaveHull(path, sourceHash, hull);
+			LOG_TRACE("Cooked convex hull for mesh {} ({} vertices -> {} points)", mesh->GetGUID().str(), mesh->CpuPositions.size(), hull.size());
+		}
+
+		mesh->ConvexHull = std::make_shared<const std::vector<glm::vec3>>(std::move(hull));
+		return mesh->ConvexHull;
+	}
+
+	uint64_t CollisionCooker::_HashMeshData(const MeshResource::Sptr& mesh) {
+		// 64 bit FNV-1a, we only need to spot changes so this doesn't need to be fancy
+		uint64_t hash = 14695981039346656037ull;
+		auto hashBytes = [&hash](const void* data, size_t size) {
+			const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+			for (size_t ix = 0; ix < size; ix++) {
+				hash ^= bytes[ix];
+				hash *= 1099511628211ull;
+			}
+		};
+		uint64_t counts[2] = { mesh->CpuPositions.size(), mesh->CpuIndices.size() };
+		hashBytes(counts, sizeof(counts));
+		hashBytes(mesh->CpuPositions.data(), mesh->CpuPositions.size() * sizeof(glm::vec3));
+		return hash;
+	}
+
+	std::vector<glm::vec3> CollisionCooker::_CookConvexHull(const std::vector<glm::vec3>& positions) {
+		// Wrap all the positions in a hull, then let the shape hull pick a small set of
+		// points that approximate it. Bullet's docs recommend keeping hulls under ~100 points
+		btConvexHullShape source(&positions[0].x, static_cast<int>(positions.size()), sizeof(glm::vec3));
+		btShapeHull shapeHull(&source);
+		if (!shapeHull.buildHull(source.getMargin())) {
+			LOG_WARN("Failed to build convex hull for mesh with {} vertices", positions.size());
+			return std::vector<glm::vec3>();
+		}
+
+		std::vector<glm::vec3> result;
+		result.reserve(shapeHull.numVertices());
+		const btVector3* vertices = shapeHull.getVertexPointer();
+		for (int ix = 0; ix < shapeHull.numVertices(); ix++) {
+			result.push_back(glm::vec3(vertices[ix].x(), vertices[ix].y(), vertices[ix].z()));
+		}
+		return result;
+	}
+
+	bool CollisionCooker::_LoadHull(const std::string& path, uint64_t sourceHash, std::vector<glm::vec3>& result) {
+		if (!std::filesystem::exists(path)) {
+			return false;
+		}
+
+		ChunkedFileReader::Sptr file = ChunkedFileReader::Open(path);
+		if (file == nullptr) {
+			return false;
+		}
+
+		uint32_t version = 0;
+		BinaryReader data = file->GetChunk(HULL_CACHE_CHUNK, &version);
+		if (version != HULL_CACHE_VERSION) {
+			return false;
+		}
+
+		uint64_t hash = data.Read<uint64_t>();
+		uint32_t count = data.Read<uint32_t>();
+		if (!data.IsValid() || hash != sourceHash || count == 0) {
+			return false;
+		}
+		// Don't trust the count until we know the chunk actually holds that many points,
+		// otherwise a corrupt file could have us make a huge allocation
+		if (static_cast<size_t>(count) * sizeof(glm::vec3) != data.GetRemaining()) {
+			return false;
+		}
+
+		result.resize(count);
+		for (uint32_t ix = 0; ix < count; ix++) {
+			result[ix] = data.Read<glm::vec3>();
+		}
+		return data.IsValid();
+	}
+
+	void CollisionCooker::_SaveHull(const std::string& path, uint64_t sourceHash, const std::vector<glm::vec3>& hull) {
+		std::error_code error;
+		std::filesystem::create_directories(CACHE_DIRECTORY, error);
+
+		BinaryWriter data;
+		data.Write(sourceHash);
+		data.Write<uint32_t>(static_cast<uint32_t>(hull.size()));
+		for (const glm::vec3& point : hull) {
+			data.Write(point);
+		}
+
+		ChunkedFileWriter file;
+		file.AddChunk(HULL_CACHE_CHUNK, HULL_CACHE_VERSION, data.Release());
+		if (!file.Save(path)) {
+			LOG_WARN("Failed to write collision cache \"{}\"", path);
+		}
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <GLM/glm.hpp>
+
+#include "Gameplay/MeshResource.h"
+
+namespace Gameplay::Physics {
+	/// <summary>
+	/// Turns the CPU copy of a mesh into collision data that Bullet can use directly.
+	/// Cooked data is stored on the mesh resource so that it is only built once, and
+	/// is written to a cache file keyed by the mesh's GUID so that later runs can skip
+	/// cooking entirely. The cache is rebuilt if the mesh data changes
+	/// </summary>
+	class CollisionCooker {
+	public:
+		// The folder that cooked collision data is written to
+		inline static const std::string CACHE_DIRECTORY = "cache/collision/";
+		// The extension for cooked convex hull files
+		inline static const std::string HULL_EXTENSION = ".hull";
+
+		/// <summary>
+		/// Gets the simplified convex hull for a mesh, cooking it or loading it from the cache
+		/// if the mesh does not have one yet. The mesh must have it's CPU data (see MeshResource::LoadCpuData)
+		/// </summary>
+		/// <param name="mesh">The mesh to get the hull for</param>
+		/// <returns>The points on the hull, or nullptr if the mesh has no data to cook</returns>
+		static std::shared_ptr<const std::vector<glm::vec3>> GetConvexHull(const MeshResource::Sptr& mesh);
+
+	protected:
+		CollisionCooker() = default;
+		~CollisionCooker() = default;
+
+		/// <summary>
+		/// Hashes the CPU data of a mesh, used to detect stale cache files
+		/// </summary>
+		static uint64_t _HashMeshData(const MeshResource::Sptr& mesh);
+		/// <summary>
+		/// Builds a simplified convex hull around the mesh's positions
+		/// </summary>
+		static std::vector<glm::vec3> _CookConvexHull(const std::vector<glm::vec3>& positions);
+		/// <summary>
+		/// Attempts to load a cooked hull from the cache
+		/// </summary>
+		/// <returns>True if the hull was loaded, false if it is missing or stale</returns>
+		static bool _LoadHull(const std::string& path, uint64_t sourceHash, std::vector<glm::vec3>& result);
+		static void _SaveHull(const std::string& path, uint64_t sourceHash, const std::vector<glm::vec3>& hull);
+	};
+}
@@ -12,6 +12,7 @@ int PhysicsBase::_editorSelectedColliderType = 0;
 	PhysicsBase::PhysicsBase() : 
 		IComponent(),
 		_scene(nullptr),
+		_sceneIndex(-1),
 		_colliders(std::vector<ICollider::Sptr>()),
 		_shape(nullptr),
 		_isShapeDirty(true),
@@ -147,6 +148,10 @@ int PhysicsBase::_editorSelectedColliderType = 0;
 	}
 
 	void PhysicsBase::RemoveCollider(const ICollider::Sptr& collider) {
+		// Our shape may be in use by the physics thread
+		if (_scene != nullptr) {
+			_scene->SyncPhysics();
+		}
 		auto& it = std::find(_colliders.begin(), _colliders.end(), collider);
 		if (it != _colliders.end()) {
 			if (collider->GetShape() != nullptr) {
@@ -87,7 +87,12 @@ namespace Gameplay {
 
 			virtual void Awake() = 0;
 		protected:
+			// The scene keeps a list of it's physics objects for stepping
+			friend class Gameplay::Scene;
+
 			Scene*        _scene;
+			// Our index in the scene's list of physics objects of our type, or -1
+			int           _sceneIndex;
 
 			// Stores the bullet shape associated with the physics object
 			btCompoundShape* _shape;
@@ -0,0 +1,108 @@
+#pragma once
+#include <EnumToString.h>
+#include "json.hpp"
+#include "Utils/JsonGlmHelpers.h"
+#include "Utils/BinaryStream.h"
+
+ENUM(BroadphaseType, int,
+	// A dynamic AABB tree, works for any size of world. Good for worlds with lots of moving objects
+	Dbvt      = 0,
+	// Sweep and prune along each axis, needs to know the bounds of the world ahead of time.
+	// Good for worlds with lots of objects that are mostly asleep
+	AxisSweep = 1
+);
+
+namespace Gameplay::Physics {
+	/// <summary>
+	/// Describes how a scene's Bullet world is put together, these are stored in the
+	/// "physics" block of the scene file
+	/// </summary>
+	struct PhysicsWorldSettings {
+		/// <summary>
+		/// True to use Bullet's multithreaded world, dispatcher and solver pool, which split
+		/// their work across the job system
+		/// </summary>
+		bool           IsMultithreaded = false;
+		/// <summary>
+		/// The broadphase used to find pairs of objects that may be touching
+		/// </summary>
+		BroadphaseType Broadphase = BroadphaseType::Dbvt;
+		/// <summary>
+		/// The bounds of the world, only used by the axis sweep broadphase. Objects outside
+		/// of the bounds still work, but are much slower
+		/// </summary>
+		glm::vec3      WorldMin = glm::vec3(-1000.0f);
+		glm::vec3      WorldMax = glm::vec3(1000.0f);
+		/// <summary>
+		/// The number of iterations the constraint solver runs per step, more iterations make
+		/// stacks more stable at the cost of performance
+		/// </summary>
+		int            SolverIterations = 10;
+		/// <summary>
+		/// The number of solvers in the pool for the multithreaded world, or 0 to use one per thread
+		/// </summary>
+		int            SolverPoolSize = 0;
+		/// <summary>
+		/// The time between fixed physics steps in seconds, or 0 to step once per frame
+		/// </summary>
+		float          Timestep = 1.0f / 60.0f;
+
+		/// <summary>
+		/// Loads settings from a JSON blob, anything missing keeps it's default value
+		/// </summary>
+		inline static PhysicsWorldSettings FromJson(const nlohmann::json& data) {
+			PhysicsWorldSettings result;
+			result.IsMultithreaded  = data.value("multithreaded", result.IsMultithreaded);
+			if (data.contains("broadphase")) {
+				result.Broadphase = ParseBroadphaseType(data["broadphase"].get<std::string>(), BroadphaseType::Dbvt);
+			}
+			if (data.contains("world_min")) {
+				result.WorldMin = ParseJsonVec3(data["world_min"]);
+			}
+			if (data.contains("world_max")) {
+				result.WorldMax = ParseJsonVec3(data["world_max"]);
+			}
+			result.SolverIterations = data.value("solver_iterations", result.SolverIterations);
+			result.SolverPoolSize   = data.value("solver_pool_size", result.SolverPoolSize);
+			result.Timestep         = data.value("timestep", result.Timestep);
+			return result;
+		}
+
+		/// <summary>
+		/// Converts the settings into their JSON representation for storage
+		/// </summary>
+		inline nlohmann::json ToJson() const {
+			return {
+				{ "multithreaded", IsMultithreaded },
+				{ "broadphase", ~Broadphase },
+				{ "world_min", GlmToJson(WorldMin) },
+				{ "world_max", GlmToJson(WorldMax) },
+				{ "solver_iterations", SolverIterations },
+				{ "solver_pool_size", SolverPoolSize },
+				{ "timestep", Timestep },
+			};
+		}
+
+		inline void ToBinary(BinaryWriter& writer) const {
+			writer.Write<uint8_t>(IsMultithreaded ? 1 : 0);
+			writer.Write<int32_t>(static_cast<int32_t>(Broadphase));
+			writer.Write(WorldMin);
+			writer.Write(WorldMax);
+			writer.Write<int32_t>(SolverIterations);
+			writer.Write<int32_t>(SolverPoolSize);
+			writer.Write(Timestep);
+		}
+
+		inline static PhysicsWorldSettings FromBinary(BinaryReader& reader) {
+			PhysicsWorldSettings result;
+			result.IsMultithreaded  = reader.Read<uint8_t>() != 0;
+			result.Broadphase       = static_cast<BroadphaseType>(reader.Read<int32_t>());
+			result.WorldMin         = reader.Read<glm::vec3>();
+			result.WorldMax         = reader.Read<glm::vec3>();
+			result.SolverIterations = reader.Read<int32_t>();
+			result.SolverPoolSize   = reader.Read<int32_t>();
+			result.Timestep         = reader.Read<float>();
+			return result;
+		}
+	};
+}
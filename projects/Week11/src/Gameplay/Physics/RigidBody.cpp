@@ -10,6 +10,7 @@
 #include "Utils/ImGuiHelper.h"
 #include "Utils/JsonGlmHelpers.h"
 #include "Utils/GlmBulletConversions.h"
+#include "Utils/BinaryStream.h"
 
 namespace Gameplay::Physics {
 	RigidBody::RigidBody(RigidBodyType type) :
@@ -27,13 +28,18 @@ namespace Gameplay::Physics {
 		_angularVelocity(btVector3(0, 0, 0)),
 		_angularVelocityDirty(false),
 		_angularFactor(btVector3(1,1,1)),
-		_angularFactorDirty(false)
+		_angularFactorDirty(false),
+		_previousStep(btTransform::getIdentity()),
+		_currentStep(btTransform::getIdentity()),
+		_appliedPosition(glm::vec3(0.0f)),
+		_appliedRotation(glm::quat(1.0f, 0.0f, 0.0f, 0.0f))
 	{ }
 
 	RigidBody::~RigidBody() {
 		if (_body != nullptr) {
 			// Remove from the physics world
 			_scene->GetPhysicsWorld()->removeRigidBody(_body);
+			_scene->_UnregisterPhysics(this);
 
 			// Clean up all our memory
 			delete _motionState;
@@ -101,30 +107,39 @@ namespace Gameplay::Physics {
 	}
 
 	void RigidBody::ApplyForce(const glm::vec3& worldForce) {
+		_scene->SyncPhysics();
 		_body->applyCentralForce(ToBt(worldForce));
 	}
 
 	void RigidBody::ApplyForce(const glm::vec3& worldForce, const glm::vec3& localOffset) {
+		_scene->SyncPhysics();
 		_body->applyForce(ToBt(worldForce), ToBt(localOffset));
 	}
 
 	void RigidBody::ApplyImpulse(const glm::vec3& worldForce) {
+		_scene->SyncPhysics();
 		_body->applyCentralImpulse(ToBt(worldForce));
 	}
 
 	void RigidBody::ApplyImpulse(const glm::vec3& worldForce, const glm::vec3& localOffset) {
+		_scene->SyncPhysics();
 		_body->applyImpulse(ToBt(worldForce), ToBt(localOffset));
 	}
 
 	void RigidBody::ApplyTorque(const glm::vec3& worldTorque) {
+		_scene->SyncPhysics();
 		_body->applyTorque(ToBt(worldTorque));
 	}
 
 	void RigidBody::ApplyTorqueImpulse(const glm::vec3& worldTorque) {
+		_scene->SyncPhysics();
 		_body->applyTorqueImpulse(ToBt(worldTorque));
 	}
 
 	void RigidBody::SetType(RigidBodyType type) {
+		if (_scene != nullptr) {
+			_scene->SyncPhysics();
+		}
 		_type = type;
 		if (_body != nullptr) {
 			// Remove any static or kinematic flags for the object
@@ -161,7 +176,13 @@ namespace Gameplay::Physics {
 
 			// Copy to body and to it's motion state
 			if (_type == RigidBodyType::Dynamic) {
-				_body->setWorldTransform(transform);
+				// We move the gameobject ourselves every frame, so we only need to send it's transform
+				// to Bullet if something else (ex: the editor or a script) has moved it
+				GameObject* context = GetGameObject();
+				if (context->GetPosition() != _appliedPosition || context->GetRotation() != _appliedRotation) {
+					_body->setWorldTransform(transform);
+					_ResetSteps(transform);
+				}
 			} else {
 				// Kinematics prefer to be driven my motion state for some reason :|
 				_body->getMotionState()->setWorldTransform(transform);
@@ -171,10 +192,8 @@ namespace Gameplay::Physics {
 
 	void RigidBody::PhysicsPostStep(float dt) {
 		// Kinematics are driven externally and statics don't move, so only need to get data out for dynamics!
+		// The transform is handled by the scene, since it may be interpolated between steps
 		if (_type == RigidBodyType::Dynamic) {
-			btTransform transform = _body->getWorldTransform();
-			_CopyGameobjectTransformFrom(transform);
-
 			// Store a copy of our velocities
 			_linearVelocity = _body->getLinearVelocity();
 			_angularVelocity = _body->getAngularVelocity();
@@ -217,9 +236,12 @@ namespace Gameplay::Physics {
 		// Create the bullet rigidbody and add it to the physics scene
 		_body = new btRigidBody(_mass, _motionState, _shape, _inertia);
 		// Add a pointer to our own weak reference to allow getting this component as a shared_ptr later
-		_body->setUserPointer(&SelfRef());
+		// Lets trigger volumes get back to us directly from the physics world
+		_body->setUserPointer(this);
 
 		_scene->GetPhysicsWorld()->addRigidBody(_body);
+		_scene->_RegisterPhysics(this);
+		_ResetSteps(transform);
 
 		// If the object is kinematic (driven by a controller), tell bullet that
 		if (_type == RigidBodyType::Kinematic) {
@@ -244,6 +266,60 @@ namespace Gameplay::Physics {
 		_RenderImGuiBase();
 	}
 
+	void RigidBody::SaveSnapshot(BinaryWriter& writer) const {
+		writer.Write(_type);
+		writer.Write(_mass);
+		writer.Write(_linearDamping);
+		writer.Write(_angularDamping);
+		writer.Write(ToGlm(_linearVelocity));
+		writer.Write(ToGlm(_angularVelocity));
+		writer.Write(ToGlm(_angularFactor));
+		writer.Write(_collisionGroup);
+		writer.Write(_collisionMask);
+	}
+
+	void RigidBody::RestoreSnapshot(BinaryReader& reader) {
+		RigidBodyType type = reader.Read<RigidBodyType>();
+		_mass             = reader.Read<float>();
+		_linearDamping    = reader.Read<float>();
+		_angularDamping   = reader.Read<float>();
+		_linearVelocity   = ToBt(reader.Read<glm::vec3>());
+		_angularVelocity  = ToBt(reader.Read<glm::vec3>());
+		_angularFactor    = ToBt(reader.Read<glm::vec3>());
+		_collisionGroup   = reader.Read<int>();
+		_collisionMask    = reader.Read<int>();
+
+		// Let the next pre-step push mass, damping and filtering to Bullet
+		_isMassDirty      = true;
+		_isDampingDirty   = true;
+		_isGroupMaskDirty = true;
+
+		if (type != _type) {
+			SetType(type);
+		}
+
+		// The body may have moved and picked up forces during play, so we need to reset it's
+		// state directly, otherwise bullet would interpolate from where it was left
+		if (_body != nullptr) {
+			btTransform transform;
+			_CopyGameobjectTransformTo(transform);
+			_body->setWorldTransform(transform);
+			_body->setInterpolationWorldTransform(transform);
+			_body->getMotionState()->setWorldTransform(transform);
+			_ResetSteps(transform);
+
+			_body->setLinearVelocity(_linearVelocity);
+			_body->setAngularVelocity(_angularVelocity);
+			_body->setInterpolationLinearVelocity(_linearVelocity);
+			_body->setInterpolationAngularVelocity(_angularVelocity);
+			_body->setAngularFactor(_angularFactor);
+			_body->clearForces();
+		}
+		_linearVelocityDirty  = false;
+		_angularVelocityDirty = false;
+		_angularFactorDirty   = false;
+	}
+
 	nlohmann::json RigidBody::ToJson() const {
 		nlohmann::json result;
 		// Write out RigidBody data
@@ -314,6 +390,37 @@ namespace Gameplay::Physics {
 		}
 	}
 
+	void RigidBody::_StoreStep() {
+		if (_type == RigidBodyType::Dynamic) {
+			_previousStep = _currentStep;
+			_currentStep  = _body->getWorldTransform();
+		}
+	}
+
+	void RigidBody::_ApplyStepTransform(float alpha) {
+		if (_type != RigidBodyType::Dynamic) {
+			return;
+		}
+
+		btTransform transform;
+		transform.setOrigin(_previousStep.getOrigin().lerp(_currentStep.getOrigin(), alpha));
+		transform.setRotation(_previousStep.getRotation().slerp(_currentStep.getRotation(), alpha));
+		_CopyGameobjectTransformFrom(transform);
+
+		GameObject* context = GetGameObject();
+		_appliedPosition = context->GetPosition();
+		_appliedRotation = context->GetRotation();
+	}
+
+	void RigidBody::_ResetSteps(const btTransform& transform) {
+		_previousStep = transform;
+		_currentStep  = transform;
+
+		GameObject* context = GetGameObject();
+		_appliedPosition = context->GetPosition();
+		_appliedRotation = context->GetRotation();
+	}
+
 	btBroadphaseProxy* RigidBody::_GetBroadphaseHandle() {
 		return _body != nullptr ? _body->getBroadphaseProxy() : nullptr;
 	}
@@ -2,6 +2,7 @@
 #include <EnumToString.h>
 #include <btBulletCollisionCommon.h>
 #include <btBulletDynamicsCommon.h>
+#include <GLM/gtc/quaternion.hpp>
 
 #include "Gameplay/Components/IComponent.h"
 #include "Gameplay/Physics/ICollider.h"
@@ -168,6 +169,8 @@ namespace Gameplay::Physics {
 		// Inherited from IComponent
 		virtual void Awake() override;
 		virtual void RenderImGui() override;
+		virtual void SaveSnapshot(BinaryWriter& writer) const override;
+		virtual void RestoreSnapshot(BinaryReader& reader) override;
 		virtual nlohmann::json ToJson() const override;
 		static RigidBody::Sptr FromJson(const nlohmann::json& data);
 		MAKE_TYPENAME(RigidBody)
@@ -198,9 +201,33 @@ namespace Gameplay::Physics {
 		btVector3        _angularFactor;
 		bool             _angularFactorDirty;
 
+		// The body's transform after the last two physics steps, written by whichever
+		// thread steps the world and read by the main thread to interpolate between them
+		btTransform      _previousStep;
+		btTransform      _currentStep;
+		// The transform we last gave our gameobject, so we can tell when something else moves it
+		glm::vec3        _appliedPosition;
+		glm::quat        _appliedRotation;
+
 		// Handles resolving any dirty state stuff for our object
 		void _HandleStateDirty();
 
+		// The scene handles stepping and interpolation for us
+		friend class Gameplay::Scene;
+		/// <summary>
+		/// Records the result of a physics step, invoked by the scene after every step
+		/// </summary>
+		void _StoreStep();
+		/// <summary>
+		/// Moves a dynamic body's gameobject to a point between the last two physics steps
+		/// </summary>
+		/// <param name="alpha">How far between the previous step (0) and the current step (1) to move the object</param>
+		void _ApplyStepTransform(float alpha);
+		/// <summary>
+		/// Teleports the body to a transform, resetting the stored steps so it does not interpolate from it's old position
+		/// </summary>
+		void _ResetSteps(const btTransform& transform);
+
 		virtual btBroadphaseProxy* _GetBroadphaseHandle() override;
 	};
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <BulletCollision/CollisionDispatch/btGhostObject.h>
 
 #include "Utils/GlmBulletConversions.h"
+#include "Utils/BinaryStream.h"
 
 #include "Gameplay/GameObject.h"
 #include "Gameplay/Scene.h"
@@ -12,13 +13,17 @@ namespace Gameplay::Physics {
 	TriggerVolume::TriggerVolume() :
 		PhysicsBase(),
 		_ghost(nullptr),
-		_typeFlags(TriggerTypeFlags::Dynamics)
+		_typeFlags(TriggerTypeFlags::Dynamics),
+		_overlaps(),
+		_previousOverlaps(),
+		_pendingEvents(nullptr)
 	{
 	}
 
 	TriggerVolume::~TriggerVolume() {
 		if (_ghost != nullptr) {
 			_scene->GetPhysicsWorld()->removeCollisionObject(_ghost);
+			_scene->_UnregisterPhysics(this);
 			delete _ghost;
 		}
 	}
@@ -37,102 +42,69 @@ namespace Gameplay::Physics {
 	}
 
 	void TriggerVolume::PhysicsPostStep(float dt) {
-		// This will store all the objects inside the trigger this frame
-		std::vector<std::weak_ptr<RigidBody>> thisFrameCollision;
-
-		// Get all our collisions from from the world
-		_scene->GetPhysicsWorld()->getDispatcher()->dispatchAllCollisionPairs(_ghost->getOverlappingPairCache(), _scene->GetPhysicsWorld()->getDispatchInfo(), _scene->GetPhysicsWorld()->getDispatcher());
-		btBroadphasePairArray& collisionPairs = _ghost->getOverlappingPairCache()->getOverlappingPairArray();
-
-		// Determine how many objects are intersecting the volume
-		const int numObjects=collisionPairs.size();
-		thisFrameCollision.reserve(numObjects);
-
-		// Will store our contact manifolds, can be static to be shared between frames and instances
-		static btManifoldArray	m_manifoldArray;
-
-		// Iterate over all the objects that we're colliding with
-		for (int i = 0; i < numObjects; ++i) {
-			// resize the number of manifolds to zero for everything we collide with
-			m_manifoldArray.resize(0);
-
-			// Get the btCollisionObject that we're colliding with
-			btCollisionObject *obj = _ghost->getOverlappingObject(i);
-
-			// Get the contact pair and resolve contact manifolds
-			btBroadphasePair* pair = &collisionPairs[i];
-			if (pair != nullptr && pair->m_algorithm != nullptr) {
-				pair->m_algorithm->getAllContactManifolds(m_manifoldArray);
-			} else {
-				continue;
-			}
+		if (_pendingEvents == nullptr) {
+			return;
+		}
 
-			// Iterate over all the contact manifolds and check if any of them have contacts
-			bool hasCollision = false;
-			for (int j=0; j < m_manifoldArray.size(); j++) {
-				btPersistentManifold* manifold = m_manifoldArray[j];
-				if (manifold != nullptr && manifold->getNumContacts() > 0) {
-					hasCollision = true;
-					break;
-				}
+		// Anything we're touching now that we weren't last step has entered
+		for (const btCollisionObject* object : _overlaps) {
+			if (!_previousOverlaps.Contains(object)) {
+				RigidBody* body = reinterpret_cast<RigidBody*>(object->getUserPointer());
+				_pendingEvents->push_back(Event{
+					std::dynamic_pointer_cast<TriggerVolume>(SelfRef().lock()),
+					std::dynamic_pointer_cast<RigidBody>(body->SelfRef().lock()),
+					true
+				});
 			}
+		}
+		// And anything we were touching that we aren't now has left
+		for (const btCollisionObject* object : _previousOverlaps) {
+			if (!_overlaps.Contains(object)) {
+				RigidBody* body = reinterpret_cast<RigidBody*>(object->getUserPointer());
+				_pendingEvents->push_back(Event{
+					std::dynamic_pointer_cast<TriggerVolume>(SelfRef().lock()),
+					std::dynamic_pointer_cast<RigidBody>(body->SelfRef().lock()),
+					false
+				});
+			}
+		}
 
-			// If we have contacts and the object's group matches our mask (since this isn't filtered for us)
-			if (hasCollision && (obj->getBroadphaseHandle()->m_collisionFilterGroup & _collisionMask)) {
-				// Make sure the internal type is a bullet rigid body (no trigger-trigger interactions)
-				if (obj->getInternalType() == btCollisionObject::CO_RIGID_BODY) {
-					// Get the collision object as a btRigidBody
-					const btRigidBody *body = (const btRigidBody *)obj;
-
-					// Make sure that the object is not a kinematic or static object (note: you may want
-					// to modify this behaviour depending on your game)
-					if ((body->getCollisionFlags() & btCollisionObject::CF_STATIC_OBJECT & btCollisionObject::CF_KINEMATIC_OBJECT == 0) ||
-						((body->getCollisionFlags() & btCollisionObject::CF_STATIC_OBJECT) == *(_typeFlags & TriggerTypeFlags::Statics)) ||
-						((body->getCollisionFlags() & btCollisionObject::CF_KINEMATIC_OBJECT) == *(_typeFlags & TriggerTypeFlags::Kinematics))) {
-
-						// Extract the weak pointer that we stored in all our rigidbody user pointers
-						std::weak_ptr<IComponent> rawPtr = *reinterpret_cast<std::weak_ptr<IComponent>*>(body->getUserPointer());
-						// Cast lock the raw pointer and cast up to a RigidBody
-						std::shared_ptr<RigidBody> physicsPtr = std::dynamic_pointer_cast<RigidBody>(rawPtr.lock());
-
-						// As long as we got a pointer out, we can proceed to try and invoke
-						if (physicsPtr != nullptr && physicsPtr->GetGameObject() != GetGameObject()) {
-							// Add the object to the known collisions for this frame
-							thisFrameCollision.push_back(physicsPtr);
-
-							// Check to see if the object has been added to our object cache
-							auto& it = std::find_if(_currentCollisions.begin(), _currentCollisions.end(), [&](const std::weak_ptr<RigidBody>& item) {
-								return item.lock() == physicsPtr;
-							});
-
-							// If the object is NOT in the cache, we invoke all the callbacks
-							if (it == _currentCollisions.end()) {
-								physicsPtr->GetGameObject()->OnEnteredTrigger(std::dynamic_pointer_cast<TriggerVolume>(SelfRef().lock()));
-								GetGameObject()->OnTriggerVolumeEntered(physicsPtr);
-							}
-						}
-					}
-				}
+		// This step becomes the last step, the old set gets cleared and reused next step
+		_previousOverlaps.Swap(_overlaps);
+		_overlaps.Clear();
+	}
 
-			}
+	void TriggerVolume::_AddOverlap(const btCollisionObject* object) {
+		// Triggers only respond to rigid bodies (no trigger-trigger interactions)
+		if (object->getInternalType() != btCollisionObject::CO_RIGID_BODY) {
+			return;
 		}
-	
-		// Compare our current frame list to the previous frame to see if anything has left
-		for (auto& weakPtr : _currentCollisions) {
-			// Search the the current list to see if the item still exists
-			auto& it = std::find_if(thisFrameCollision.begin(), thisFrameCollision.end(), [&](const std::weak_ptr<RigidBody>& item) {
-				return item.lock() == weakPtr.lock();
-			});
-
-			// If the item no longer exists in the list, we need to invoke exit callbacks
-			if (it == thisFrameCollision.end()) {
-				weakPtr.lock()->GetGameObject()->OnLeavingTrigger(std::dynamic_pointer_cast<TriggerVolume>(SelfRef().lock()));
-				GetGameObject()->OnTriggerVolumeLeaving(weakPtr.lock());
-			}
+		// Make sure the object's group matches our mask, since the world only filters in one direction
+		if ((object->getBroadphaseHandle()->m_collisionFilterGroup & _collisionMask) == 0) {
+			return;
 		}
 
-		// Load the contents of the current collision items into the cache
-		_currentCollisions.swap(thisFrameCollision);
+		// Dynamic objects always count, statics and kinematics only if our flags ask for them
+		int flags = object->getCollisionFlags();
+		if ((flags & btCollisionObject::CF_STATIC_OBJECT) && *(_typeFlags & TriggerTypeFlags::Statics) == 0) {
+			return;
+		}
+		if ((flags & btCollisionObject::CF_KINEMATIC_OBJECT) && *(_typeFlags & TriggerTypeFlags::Kinematics) == 0) {
+			return;
+		}
+
+		// Ignore bodies on our own game object
+		RigidBody* body = reinterpret_cast<RigidBody*>(object->getUserPointer());
+		if (body == nullptr || body->GetGameObject() == GetGameObject()) {
+			return;
+		}
+
+		_overlaps.Insert(object);
+	}
+
+	void TriggerVolume::_ForgetOverlap(const btCollisionObject* object) {
+		_overlaps.Remove(object);
+		_previousOverlaps.Remove(object);
 	}
 
 	void TriggerVolume::Awake() {
@@ -154,9 +126,11 @@ namespace Gameplay::Physics {
 		}
 
 		// Create the ghost object
-		_ghost = new btPairCachingGhostObject();
+		// We don't use the ghost's own pair cache, the scene finds our contacts from the world's manifolds
+		_ghost = new btGhostObject();
 		_ghost->setCollisionShape(_shape);
-		_ghost->setUserPointer(&SelfRef());
+		// Lets the scene get back to us directly from the manifolds
+		_ghost->setUserPointer(this);
 		_ghost->setCollisionFlags(_ghost->getCollisionFlags() | btCollisionObject::CF_NO_CONTACT_RESPONSE);
 
 		// Get the transform and send it to the ghost
@@ -166,6 +140,7 @@ namespace Gameplay::Physics {
 
 		// Add the object to the scene
 		_scene->GetPhysicsWorld()->addCollisionObject(_ghost);
+		_scene->_RegisterPhysics(this);
 		
 		// Copy over group and mask info
 		_ghost->getBroadphaseHandle()->m_collisionFilterGroup = _collisionGroup;
@@ -176,6 +151,25 @@ namespace Gameplay::Physics {
 		_RenderImGuiBase();
 	}
 
+	void TriggerVolume::SaveSnapshot(BinaryWriter& writer) const {
+		writer.Write(_typeFlags);
+		writer.Write(_collisionGroup);
+		writer.Write(_collisionMask);
+	}
+
+	void TriggerVolume::RestoreSnapshot(BinaryReader& reader) {
+		_typeFlags        = reader.Read<TriggerTypeFlags>();
+		_collisionGroup   = reader.Read<int>();
+		_collisionMask    = reader.Read<int>();
+		_isGroupMaskDirty = true;
+
+		// Forget about anything that was inside the trigger during play, the components
+		// that react to triggers restore their own state, and we don't want leave events
+		// firing the next time we enter play mode
+		_overlaps.Clear();
+		_previousOverlaps.Clear();
+	}
+
 	nlohmann::json TriggerVolume::ToJson() const {
 		nlohmann::json result;
 		ToJsonBase(result);
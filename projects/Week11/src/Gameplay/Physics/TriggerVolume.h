@@ -3,8 +3,10 @@
 #include "Gameplay/Physics/PhysicsBase.h"
 #include "Gameplay/Physics/RigidBody.h"
 #include "EnumToString.h"
+#include "Utils/PointerHashSet.h"
 
-class btPairCachingGhostObject;
+class btGhostObject;
+class btCollisionObject;
 
 namespace Gameplay::Physics {
 
@@ -33,8 +35,9 @@ namespace Gameplay::Physics {
 		/// <param name="dt">The time in seconds since the last frame</param>
 		virtual void PhysicsPreStep(float dt) override;
 		/// <summary>
-		/// Invoked for each RigidBody after the physics world is stepped forward a frame,
-		/// handles copying transform to the OpenGL state
+		/// Invoked after the scene has collected the objects touching the trigger, compares them to
+		/// the last step and records enter and exit events. The events are sent by the scene once
+		/// every trigger has been processed (see Scene::_ProcessTriggers)
 		/// </summary>
 		/// <param name="dt">The time in seconds since the last frame</param>
 		virtual void PhysicsPostStep(float dt) override;
@@ -46,15 +49,44 @@ namespace Gameplay::Physics {
 
 		virtual void Awake() override;
 		virtual void RenderImGui() override;
+		virtual void SaveSnapshot(BinaryWriter& writer) const override;
+		virtual void RestoreSnapshot(BinaryReader& reader) override;
 		virtual nlohmann::json ToJson() const override;
 		static TriggerVolume::Sptr FromJson(const nlohmann::json& data);
 		MAKE_TYPENAME(TriggerVolume);
 
 	protected:
-		btPairCachingGhostObject*   _ghost;
+		// The scene moves our ghost over when it rebuilds it's physics world, and fills
+		// our overlaps from the world's contact manifolds
+		friend class Gameplay::Scene;
+
+		/// <summary>
+		/// An enter or exit that is waiting to be sent, we hold on to both objects so that
+		/// callbacks for earlier events can't destroy them out from under us
+		/// </summary>
+		struct Event {
+			TriggerVolume::Sptr         Trigger;
+			std::shared_ptr<RigidBody>  Body;
+			bool                        IsEnter;
+		};
+
+		btGhostObject*              _ghost;
 		TriggerTypeFlags            _typeFlags;
 
-		std::vector<std::weak_ptr<RigidBody>> _currentCollisions;
+		// The bodies touching the trigger this step, and the bodies that were touching it last step
+		PointerHashSet<const btCollisionObject> _overlaps;
+		PointerHashSet<const btCollisionObject> _previousOverlaps;
+		// Events recorded by PhysicsPostStep, owned by the scene
+		std::vector<Event>*         _pendingEvents;
+
+		/// <summary>
+		/// Adds an object that has contacts with our ghost to this step's overlaps, if it passes our filters
+		/// </summary>
+		void _AddOverlap(const btCollisionObject* object);
+		/// <summary>
+		/// Forgets about an object that is being removed from the world, without sending any events
+		/// </summary>
+		void _ForgetOverlap(const btCollisionObject* object);
 
 		virtual btBroadphaseProxy* _GetBroadphaseHandle() override;
 
@@ -0,0 +1,210 @@
+#include "Gameplay/RenderQueue.h"
+
+#include <algorithm>
+#include <Logging.h>
+
+#include "Utils/Profiler.h"
+
+namespace Gameplay {
+	RenderQueue::RenderQueue() :
+		_items(),
+		_transforms(),
+		_batches(),
+		_instanceBuffer(nullptr),
+		_stats({ 0, 0, 0, 0 })
+	{
+		// Enough for a few thousand instances per frame before we need to grow
+		_instanceBuffer = StreamingBuffer::Create(BufferType::ShaderStorage, 1024 * sizeof(InstanceLevelUniforms));
+	}
+
+	void RenderQueue::Submit(const Material::Sptr& material, const VertexArrayObject::Sptr& mesh, const glm::mat4& transform) {
+		LOG_ASSERT(material != nullptr && mesh != nullptr, "Cannot submit an item without a material and mesh!");
+
+		const Shader::Sptr& shader = material->GetShader();
+		if (shader == nullptr || !shader->IsReady()) {
+			return;
+		}
+
+		DrawItem item;
+		item.ShaderHandle   = shader->GetHandle();
+		item.Program        = shader.get();
+		item.MeshHandle     = mesh->GetHandle();
+		item.Mat            = material.get();
+		item.Mesh           = mesh.get();
+		item.TransformIndex = static_cast<uint32_t>(_transforms.size());
+		_items.push_back(item);
+		_transforms.push_back(transform);
+	}
+
+	void RenderQueue::Flush(const glm::mat4& viewProjection) {
+		PROFILE_GPU_SCOPE("RenderQueue::Flush");
+		_Draw(_items.size(), viewProjection, ShaderVariant::Forward);
+		Clear();
+	}
+
+	void RenderQueue::FlushVariant(const glm::mat4& viewProjection, ShaderVariant variant, bool removeDrawn) {
+		PROFILE_GPU_SCOPE("RenderQueue::FlushVariant");
+		// Move the items that can be drawn with the variant to the front, those are the ones we draw
+		auto firstSkipped = std::partition(_items.begin(), _items.end(), [variant](const DrawItem& item) {
+			return item.Mat->GetShader()->GetVariant(variant) != nullptr;
+		});
+		size_t count = static_cast<size_t>(firstSkipped - _items.begin());
+		_Draw(count, viewProjection, variant);
+
+		// Transforms are looked up by index, so we leave those alone until the queue is cleared
+		if (removeDrawn) {
+			_items.erase(_items.begin(), firstSkipped);
+		}
+	}
+
+	void RenderQueue::_Draw(size_t count, const glm::mat4& viewProjection, ShaderVariant variant) {
+		_stats = { static_cast<uint32_t>(count), 0, 0, 0 };
+		if (count == 0) {
+			return;
+		}
+
+		// Variants are separate programs, so they need to be picked before we sort
+		for (size_t ix = 0; ix < count; ix++) {
+			_items[ix].Program      = _items[ix].Mat->GetShader()->GetVariant(variant);
+			_items[ix].ShaderHandle = _items[ix].Program->GetHandle();
+		}
+
+		// Sort so that all items sharing a shader are together, then all items sharing a
+		// material, then by mesh. Identical mesh + material pairs end up adjacent
+		std::sort(_items.begin(), _items.begin() + count, [](const DrawItem& a, const DrawItem& b) {
+			if (a.ShaderHandle != b.ShaderHandle) return a.ShaderHandle < b.ShaderHandle;
+			if (a.Mat != b.Mat) return a.Mat < b.Mat;
+			return a.MeshHandle < b.MeshHandle;
+		});
+
+		StreamingBuffer::Allocation instances = _UploadInstances(viewProjection, count, true, true);
+		const size_t stride = sizeof(InstanceLevelUniforms);
+
+		GLuint currentShader = 0;
+		Material* currentMat = nullptr;
+		VertexArrayObject* currentMesh = nullptr;
+
+		for (size_t batchIx = 0; batchIx < _batches.size(); batchIx++) {
+			size_t firstItem = _batches[batchIx].FirstItem;
+			size_t lastItem = batchIx + 1 < _batches.size() ? _batches[batchIx + 1].FirstItem : count;
+			size_t instanceOffset = _batches[batchIx].InstanceOffset;
+			uint32_t instanceCount = static_cast<uint32_t>(lastItem - firstItem);
+
+			const DrawItem& item = _items[firstItem];
+
+			// Only re-bind the shader and material when they actually change
+			if (item.ShaderHandle != currentShader) {
+				item.Program->Bind();
+				currentShader = item.ShaderHandle;
+				currentMat = nullptr;
+				_stats.ShaderBinds++;
+			}
+			if (item.Mat != currentMat) {
+				item.Mat->Apply(variant);
+				currentMat = item.Mat;
+				_stats.MaterialBinds++;
+			}
+			if (item.Mesh != currentMesh) {
+				item.Mesh->Bind();
+				currentMesh = item.Mesh;
+			}
+
+			_instanceBuffer->BindRange(INSTANCE_SSBO_BINDING, instances, instanceOffset * stride, instanceCount * stride);
+			item.Mesh->DrawInstanced(instanceCount);
+			_stats.DrawCalls++;
+		}
+
+		VertexArrayObject::Unbind();
+	}
+
+	void RenderQueue::FlushDepth(const glm::mat4& viewProjection, const Shader::Sptr& shader) {
+		_stats = { static_cast<uint32_t>(_items.size()), 0, 0, 0 };
+		if (_items.empty() || shader == nullptr || !shader->IsReady()) {
+			Clear();
+			return;
+		}
+
+		// Materials don't matter here, so everything sharing a mesh can go in one batch
+		std::sort(_items.begin(), _items.end(), [](const DrawItem& a, const DrawItem& b) {
+			return a.MeshHandle < b.MeshHandle;
+		});
+
+		StreamingBuffer::Allocation instances = _UploadInstances(viewProjection, _items.size(), false, false);
+		const size_t stride = sizeof(InstanceLevelUniforms);
+
+		shader->Bind();
+		_stats.ShaderBinds++;
+
+		for (size_t batchIx = 0; batchIx < _batches.size(); batchIx++) {
+			size_t firstItem = _batches[batchIx].FirstItem;
+			size_t lastItem = batchIx + 1 < _batches.size() ? _batches[batchIx + 1].FirstItem : _items.size();
+			size_t instanceOffset = _batches[batchIx].InstanceOffset;
+			uint32_t instanceCount = static_cast<uint32_t>(lastItem - firstItem);
+
+			VertexArrayObject* mesh = _items[firstItem].Mesh;
+			mesh->Bind();
+			_instanceBuffer->BindRange(INSTANCE_SSBO_BINDING, instances, instanceOffset * stride, instanceCount * stride);
+			mesh->DrawInstanced(instanceCount);
+			_stats.DrawCalls++;
+		}
+
+		VertexArrayObject::Unbind();
+		Clear();
+	}
+
+	StreamingBuffer::Allocation RenderQueue::_UploadInstances(const glm::mat4& viewProjection, size_t count, bool splitByMaterial, bool calculateNormals) {
+		// Each batch has to start at an offset that the driver will accept for glBindBufferRange,
+		// so we may need to pad between batches
+		const size_t alignment = _instanceBuffer->GetOffsetAlignment();
+		const size_t stride = sizeof(InstanceLevelUniforms);
+
+		// Helper for determining where a batch should start in the instance buffer
+		auto alignIndex = [&](size_t index) {
+			while ((index * stride) % alignment != 0) {
+				index++;
+			}
+			return index;
+		};
+
+		// Work out our batches first, so we know how much space to allocate for the instance data
+		_batches.clear();
+		size_t totalInstances = 0;
+		for (size_t ix = 0; ix < count; ix++) {
+			const DrawItem& item = _items[ix];
+			if (ix == 0 || (splitByMaterial && item.Mat != _items[ix - 1].Mat) || item.MeshHandle != _items[ix - 1].MeshHandle) {
+				totalInstances = alignIndex(totalInstances);
+				_batches.push_back({ ix, totalInstances });
+			}
+			totalInstances++;
+		}
+
+		// Write the instance data in sorted order straight into the mapped buffer, so that every
+		// batch is a contiguous range. Padding between batches is left uninitialized
+		StreamingBuffer::Allocation instances = _instanceBuffer->Allocate(totalInstances * stride);
+		InstanceLevelUniforms* instanceData = reinterpret_cast<InstanceLevelUniforms*>(instances.Data);
+		for (size_t batchIx = 0; batchIx < _batches.size(); batchIx++) {
+			size_t firstItem = _batches[batchIx].FirstItem;
+			size_t lastItem = batchIx + 1 < _batches.size() ? _batches[batchIx + 1].FirstItem : count;
+			InstanceLevelUniforms* instance = instanceData + _batches[batchIx].InstanceOffset;
+			for (size_t ix = firstItem; ix < lastItem; ix++, instance++) {
+				const glm::mat4& model = _transforms[_items[ix].TransformIndex];
+				instance->u_Model = model;
+				instance->u_ModelViewProjection = viewProjection * model;
+				// Only the upper 3x3 is needed for normals, which is much cheaper to invert than the full matrix
+				if (calculateNormals) {
+					instance->u_NormalMatrix = glm::mat4(glm::transpose(glm::inverse(glm::mat3(model))));
+				}
+			}
+		}
+		return instances;
+	}
+
+	void RenderQueue::Clear() {
+		_items.clear();
+		_transforms.clear();
+	}
+
+	void RenderQueue::EndFrame() {
+		_instanceBuffer->NextFrame();
+	}
+}
@@ -0,0 +1,156 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <GLM/glm.hpp>
+
+#include "Gameplay/Material.h"
+#include "Graphics/VertexArrayObject.h"
+#include "Graphics/StreamingBuffer.h"
+
+namespace Gameplay {
+	/// <summary>
+	/// Collects draw items over the course of a frame, then sorts them by shader,
+	/// material and mesh so that state changes are minimized. Items that share a
+	/// mesh and material are drawn in a single instanced draw call, with their
+	/// per-instance transforms stored in a shader storage buffer
+	///
+	/// Shaders access the instance data via the b_InstanceLevelUniforms block in
+	/// fragments/frame_uniforms.glsl
+	/// </summary>
+	class RenderQueue {
+	public:
+		typedef std::shared_ptr<RenderQueue> Sptr;
+
+		// The SSBO binding slot for the per-instance data, matches fragments/frame_uniforms.glsl
+		inline static const int INSTANCE_SSBO_BINDING = 1;
+
+		/// <summary>
+		/// Per-instance data that is uploaded to the instance SSBO, matches the
+		/// std430 layout of InstanceLevelUniforms in fragments/frame_uniforms.glsl
+		/// </summary>
+		struct InstanceLevelUniforms {
+			// Complete MVP
+			glm::mat4 u_ModelViewProjection;
+			// Just the model transform, we'll do worldspace lighting
+			glm::mat4 u_Model;
+			// Normal Matrix for transforming normals
+			glm::mat4 u_NormalMatrix;
+		};
+
+		/// <summary>
+		/// Basic statistics about the last call to Flush, handy for debugging
+		/// </summary>
+		struct Stats {
+			uint32_t Items;
+			uint32_t DrawCalls;
+			uint32_t ShaderBinds;
+			uint32_t MaterialBinds;
+		};
+
+		// We'll disallow moving and copying, since we own GL resources
+		RenderQueue(const RenderQueue& other) = delete;
+		RenderQueue(RenderQueue&& other) = delete;
+		RenderQueue& operator=(const RenderQueue& other) = delete;
+		RenderQueue& operator=(RenderQueue&& other) = delete;
+
+		static inline Sptr Create() {
+			return std::make_shared<RenderQueue>();
+		}
+
+		RenderQueue();
+		~RenderQueue() = default;
+
+		/// <summary>
+		/// Adds an item to the queue, to be drawn on the next call to Flush
+		/// </summary>
+		/// <param name="material">The material to draw with, must not be null and must outlive the next Flush</param>
+		/// <param name="mesh">The mesh to draw, must not be null and must outlive the next Flush</param>
+		/// <param name="transform">The world transform of the item</param>
+		void Submit(const Material::Sptr& material, const VertexArrayObject::Sptr& mesh, const glm::mat4& transform);
+
+		/// <summary>
+		/// Sorts all submitted items, uploads their instance data, and draws them,
+		/// clearing the queue afterwards
+		/// </summary>
+		/// <param name="viewProjection">The view projection matrix of the camera we are drawing from</param>
+		void Flush(const glm::mat4& viewProjection);
+		/// <summary>
+		/// Draws all submitted items with a single shader, ignoring their materials, and clears the
+		/// queue afterwards. Items are only sorted by mesh, so every mesh is one instanced draw call.
+		/// Used for depth only passes such as shadow maps, the shader only gets u_ModelViewProjection
+		/// and u_Model, the normal matrix is not calculated
+		/// </summary>
+		/// <param name="viewProjection">The view projection matrix of the camera or light we are drawing from</param>
+		/// <param name="shader">The shader to draw every item with</param>
+		void FlushDepth(const glm::mat4& viewProjection, const Shader::Sptr& shader);
+		/// <summary>
+		/// Draws the submitted items whose shader has the given variant ready, using that variant (see
+		/// Shader::GetVariant). Items that can't be drawn with the variant are left in the queue, so
+		/// that they can be drawn by a later call to Flush
+		/// </summary>
+		/// <param name="viewProjection">The view projection matrix of the camera we are drawing from</param>
+		/// <param name="variant">The shader variant to draw with</param>
+		/// <param name="removeDrawn">True to remove the items that were drawn from the queue, false to keep them for another pass</param>
+		void FlushVariant(const glm::mat4& viewProjection, ShaderVariant variant, bool removeDrawn);
+
+		/// <summary>
+		/// Removes all submitted items without drawing them
+		/// </summary>
+		void Clear();
+
+		/// <summary>
+		/// Marks the end of the frame, must be called once per frame after the last
+		/// call to Flush so that the instance buffer can be recycled safely
+		/// </summary>
+		void EndFrame();
+
+		/// <summary>
+		/// Gets the statistics from the last call to Flush
+		/// </summary>
+		const Stats& GetStats() const { return _stats; }
+
+	protected:
+		// A single draw item, kept small so sorting does not move matrices around.
+		// We store raw pointers to avoid refcount traffic, the resources are owned
+		// by the render components and must outlive the call to Flush
+		struct DrawItem {
+			GLuint             ShaderHandle;
+			GLuint             MeshHandle;
+			// The program we draw with, either the material's shader or one of it's variants
+			Shader*            Program;
+			Material*          Mat;
+			VertexArrayObject* Mesh;
+			uint32_t           TransformIndex;
+		};
+
+		// A run of items that share a mesh and material, drawn with one instanced draw call
+		struct Batch {
+			size_t FirstItem;
+			size_t InstanceOffset;
+		};
+
+		std::vector<DrawItem>              _items;
+		std::vector<glm::mat4>             _transforms;
+		std::vector<Batch>                 _batches;
+
+		// Instance data is written straight into persistently mapped memory
+		StreamingBuffer::Sptr              _instanceBuffer;
+
+		Stats _stats;
+
+		/// <summary>
+		/// Sorts the first count items and draws them with the given variant of their shaders,
+		/// every item's shader must have that variant ready
+		/// </summary>
+		void _Draw(size_t count, const glm::mat4& viewProjection, ShaderVariant variant);
+		/// <summary>
+		/// Splits the sorted items into batches and writes their instance data into the instance buffer
+		/// </summary>
+		/// <param name="viewProjection">The view projection matrix to build the MVP matrices with</param>
+		/// <param name="count">The number of items from the front of the queue to write</param>
+		/// <param name="splitByMaterial">True if items with different materials need to be in different batches</param>
+		/// <param name="calculateNormals">True to calculate the normal matrix for every instance</param>
+		/// <returns>The allocation holding the instance data, batch offsets are relative to it</returns>
+		StreamingBuffer::Allocation _UploadInstances(const glm::mat4& viewProjection, size_t count, bool splitByMaterial, bool calculateNormals);
+	};
+}
@@ -1,13 +1,24 @@
 #include "Scene.h"
 
+#include <algorithm>
+#include <cstring>
+#include <unordered_set>
 #include <GLFW/glfw3.h>
+#include <BulletCollision/BroadphaseCollision/btAxisSweep3.h>
+#include <BulletCollision/CollisionDispatch/btCollisionDispatcherMt.h>
+#include <BulletDynamics/Dynamics/btDiscreteDynamicsWorldMt.h>
 
 #include "Utils/FileHelpers.h"
+#include "Utils/ChunkedFile.h"
 #include "Utils/GlmBulletConversions.h"
+#include "Utils/Profiler.h"
+#include "Utils/JobSystem.h"
 
 #include "Gameplay/Physics/RigidBody.h"
 #include "Gameplay/Physics/TriggerVolume.h"
+#include "Gameplay/Physics/BulletTaskScheduler.h"
 #include "Gameplay/MeshResource.h"
+#include "Gameplay/Components/RenderComponent.h"
 
 #include "Graphics/DebugDraw.h"
 #include "Graphics/TextureCube.h"
@@ -19,6 +30,8 @@ namespace Gameplay {
 		_deletionQueue(std::vector<std::weak_ptr<GameObject>>()),
 		Lights(std::vector<Light>()),
 		IsPlaying(false),
+		IsCullingEnabled(true),
+		IsParallelUpdateEnabled(true),
 		MainCamera(nullptr),
 		DefaultMaterial(nullptr),
 		_isAwake(false),
@@ -27,23 +40,45 @@ namespace Gameplay {
 		_skyboxMesh(nullptr),
 		_skyboxTexture(nullptr),
 		_skyboxRotation(glm::mat3(1.0f)),
-		_gravity(glm::vec3(0.0f, 0.0f, -9.81f))
+		_gravity(glm::vec3(0.0f, 0.0f, -9.81f)),
+		_nextObjectOrder(0),
+		_transforms(TransformHierarchy::Create()),
+		_cullingTree(BoundingVolumeHierarchy::Create()),
+		_updateStages(),
+		_updateStageTypeCount(0),
+		_commandBuffer(),
+		_isUpdatingInParallel(false),
+		_bulletDebugDraw(nullptr),
+		_physicsSettings(),
+		_rigidBodies(),
+		_triggerVolumes(),
+		_physicsThread(nullptr),
+		_physicsTimestep(1.0f / 60.0f),
+		_physicsAccumulator(0.0f),
+		_physicsBatchSteps(0)
 	{
 		_lightingUbo = std::make_shared<UniformBuffer<LightingUboStruct>>();
 		_lightingUbo->GetData().AmbientCol = glm::vec3(0.1f);
 		_lightingUbo->Update();
 		_lightingUbo->Bind(LIGHT_UBO_BINDING_SLOT);
 
+		_clusteredLighting = ClusteredLighting::Create();
+		_shadowMapping = ShadowMapping::Create();
+
 		_InitPhysics();
 
 	}
 
 	Scene::~Scene() {
+		SyncPhysics();
+		_objectsByGuid.clear();
+		_objectsByName.clear();
 		_objects.clear();
 		_CleanupPhysics();
 	}
 
 	void Scene::SetPhysicsDebugDrawMode(BulletDebugMode mode) {
+		SyncPhysics();
 		_bulletDebugDraw->setDebugMode((btIDebugDraw::DebugDrawModes)mode);
 	}
 
@@ -65,7 +100,7 @@ namespace Gameplay {
 
 	void Scene::SetSkyboxRotation(const glm::mat3& value) {
 		_skyboxRotation = value;
-		_lightingUbo->GetData().EnvironmentRotation = value;
+		_lightingUbo->GetData().EnvironmentRotation = glm::mat3x4(value);
 		_lightingUbo->Update();
 	}
 
@@ -75,30 +110,39 @@ namespace Gameplay {
 
 	GameObject::Sptr Scene::CreateGameObject(const std::string& name)
 	{
+		LOG_ASSERT(!_isUpdatingInParallel, "Objects cannot be created during a parallel update, use the scene's command buffer instead!");
 		GameObject::Sptr result(new GameObject());
-		result->Name = name;
+		result->_name = name;
 		result->_scene = this;
 		result->_selfRef = result;
-		_objects.push_back(result);
+		_AddObject(result);
 		return result;
 	}
 
 	void Scene::RemoveGameObject(const GameObject::Sptr& object) {
+		// The deletion queue is not thread safe, so we go through the command buffer
+		if (_isUpdatingInParallel) {
+			_commandBuffer.RemoveGameObject(object);
+			return;
+		}
 		_deletionQueue.push_back(object);
 	}
 
 	GameObject::Sptr Scene::FindObjectByName(const std::string name) {
-		auto it = std::find_if(_objects.begin(), _objects.end(), [&](const GameObject::Sptr& obj) {
-			return obj->Name == name;
-		});
-		return it == _objects.end() ? nullptr : *it;
+		// Objects are never reordered in _objects, so the lowest order is the first in the scene
+		auto range = _objectsByName.equal_range(name);
+		GameObject::Sptr result = nullptr;
+		for (auto it = range.first; it != range.second; ++it) {
+			if (result == nullptr || it->second->_sceneOrder < result->_sceneOrder) {
+				result = it->second;
+			}
+		}
+		return result;
 	}
 
 	GameObject::Sptr Scene::FindObjectByGUID(Guid id) {
-		auto it = std::find_if(_objects.begin(), _objects.end(), [&](const GameObject::Sptr& obj) {
-			return obj->GUID == id;
-		});
-		return it == _objects.end() ? nullptr : *it;
+		auto it = _objectsByGuid.find(id);
+		return it == _objectsByGuid.end() ? nullptr : it->second;
 	}
 
 	void Scene::SetAmbientLight(const glm::vec3& value) {
@@ -135,57 +179,295 @@ namespace Gameplay {
 	}
 
 	void Scene::DoPhysics(float dt) {
-		ComponentManager::Each<Gameplay::Physics::RigidBody>([=](const std::shared_ptr<Gameplay::Physics::RigidBody>& body) {
-			body->PhysicsPreStep(dt);
-		});
-		ComponentManager::Each<Gameplay::Physics::TriggerVolume>([=](const std::shared_ptr<Gameplay::Physics::TriggerVolume>& body) {
+		PROFILE_SCOPE("Scene::DoPhysics");
+		{
+			PROFILE_SCOPE("Scene::SyncPhysics");
+			SyncPhysics();
+		}
+
+		// Hand the results of the last batch of fixed steps to the main thread, this is where
+		// velocities are read back and trigger events are fired
+		if (_physicsBatchSteps > 0) {
+			float batchTime = _physicsBatchSteps * _physicsTimestep;
+			for (Physics::RigidBody* body : _rigidBodies) {
+				body->PhysicsPostStep(batchTime);
+			}
+			_ProcessTriggers(batchTime);
+			_physicsBatchSteps = 0;
+		}
+
+		// Copy anything that changed on the main thread over to Bullet
+		for (Physics::RigidBody* body : _rigidBodies) {
 			body->PhysicsPreStep(dt);
-		});
+		}
+		for (Physics::TriggerVolume* trigger : _triggerVolumes) {
+			trigger->PhysicsPreStep(dt);
+		}
 
 		if (IsPlaying) {
+			if (_physicsTimestep > 0.0f) {
+				// The committed steps are from the batch we started last frame. The time left over
+				// after that batch tells us how far along we are to the next step
+				float alpha = glm::clamp(_physicsAccumulator / _physicsTimestep, 0.0f, 1.0f);
+				for (Physics::RigidBody* body : _rigidBodies) {
+					body->_ApplyStepTransform(alpha);
+				}
+
+				_physicsAccumulator += dt;
+				int steps = static_cast<int>(_physicsAccumulator / _physicsTimestep);
+				if (steps > MAX_PHYSICS_STEPS_PER_FRAME) {
+					steps = MAX_PHYSICS_STEPS_PER_FRAME;
+					_physicsAccumulator = steps * _physicsTimestep;
+				}
+				_physicsAccumulator -= steps * _physicsTimestep;
+
+				// Debug drawing reads the world, so it has to happen before the physics thread starts
+				if (_bulletDebugDraw->getDebugMode() != btIDebugDraw::DBG_NoDebug) {
+					_physicsWorld->debugDrawWorld();
+					DebugDrawer::Get().FlushAll();
+				}
+
+				if (steps > 0) {
+					_physicsBatchSteps = steps;
+					float timestep = _physicsTimestep;
+					_physicsThread->Submit([this, steps, timestep]() {
+						PROFILE_SCOPE("Physics Steps");
+						_physicsWorld->stepSimulation(steps * timestep, steps, timestep);
+					});
+				}
+			} else {
+				_physicsWorld->stepSimulation(dt, 15);
+
+				for (Physics::RigidBody* body : _rigidBodies) {
+					body->PhysicsPostStep(dt);
+					body->_ApplyStepTransform(1.0f);
+				}
+				_ProcessTriggers(dt);
+				if (_bulletDebugDraw->getDebugMode() != btIDebugDraw::DBG_NoDebug) {
+					_physicsWorld->debugDrawWorld();
+					DebugDrawer::Get().FlushAll();
+				}
+			}
+		}
+	}
 
-			_physicsWorld->stepSimulation(dt, 15);
+	void Scene::SetPhysicsTimestep(float seconds) {
+		SyncPhysics();
+		_physicsTimestep = glm::max(seconds, 0.0f);
+		_physicsAccumulator = 0.0f;
+	}
 
-			ComponentManager::Each<Gameplay::Physics::RigidBody>([=](const std::shared_ptr<Gameplay::Physics::RigidBody>& body) {
-				body->PhysicsPostStep(dt);
-			});
-			ComponentManager::Each<Gameplay::Physics::TriggerVolume>([=](const std::shared_ptr<Gameplay::Physics::TriggerVolume>& body) {
-				body->PhysicsPostStep(dt);
-			});
-			if (_bulletDebugDraw->getDebugMode() != btIDebugDraw::DBG_NoDebug) {
-				_physicsWorld->debugDrawWorld();
-				DebugDrawer::Get().FlushAll();
-			}
+	void Scene::SetPhysicsSettings(const Physics::PhysicsWorldSettings& settings) {
+		SyncPhysics();
+
+		// Pull everything out of the old world before we destroy it, the bodies and
+		// their shapes stay alive and are added to the new world as-is
+		for (Physics::RigidBody* body : _rigidBodies) {
+			_physicsWorld->removeRigidBody(body->_body);
+		}
+		for (Physics::TriggerVolume* trigger : _triggerVolumes) {
+			_physicsWorld->removeCollisionObject(trigger->_ghost);
+		}
+		_CleanupPhysics();
+
+		_physicsSettings = settings;
+		_InitPhysics();
+
+		for (Physics::RigidBody* body : _rigidBodies) {
+			_physicsWorld->addRigidBody(body->_body);
+		}
+		for (Physics::TriggerVolume* trigger : _triggerVolumes) {
+			_physicsWorld->addCollisionObject(trigger->_ghost);
+		}
+
+		SetPhysicsTimestep(settings.Timestep);
+		_physicsBatchSteps = 0;
+	}
+
+	Physics::PhysicsWorldSettings Scene::GetPhysicsSettings() const {
+		Physics::PhysicsWorldSettings result = _physicsSettings;
+		result.Timestep = _physicsTimestep;
+		return result;
+	}
+
+	float Scene::GetPhysicsTimestep() const {
+		return _physicsTimestep;
+	}
+
+	void Scene::SyncPhysics() const {
+		if (_physicsThread != nullptr) {
+			_physicsThread->Wait();
 		}
 	}
 
 	void Scene::Update(float dt) {
+		PROFILE_SCOPE("Scene::Update");
+		// Components may poke at their physics bodies, so the physics thread needs to be done
+		SyncPhysics();
 		_FlushDeleteQueue();
 		if (IsPlaying) {
-			for (auto& obj : _objects) {
-				obj->Update(dt);
+			if (IsParallelUpdateEnabled && JobSystem::GetWorkerCount() > 0) {
+				_UpdateParallel(dt);
+			} else {
+				for (auto& obj : _objects) {
+					obj->Update(dt);
+				}
 			}
 		}
+		_commandBuffer.Execute(*this);
 		_FlushDeleteQueue();
 	}
 
-	void Scene::PreRender() {
+	void Scene::_UpdateParallel(float dt) {
+		if (_updateStageTypeCount != ComponentManager::GetRegisteredTypes().size()) {
+			_BuildUpdateStages();
+		}
+
+		for (const UpdateStage& stage : _updateStages) {
+			if (stage.Access.IsMainThreadOnly) {
+				for (const std::type_index& type : stage.Types) {
+					ComponentManager::Each(type, [&](IComponent& component) {
+						if (component.GetGameObject()->GetScene() == this) {
+							component.Update(dt);
+						}
+					});
+				}
+				continue;
+			}
+
+			PROFILE_SCOPE("Scene::ParallelStage");
+			// With no dirty transforms, reading a world transform from a worker never has to write anything
+			_transforms->Update();
+
+			ComponentManager::SetPoolsLocked(true);
+			_isUpdatingInParallel = true;
+			JobSystem::Counter counter;
+			for (const std::type_index& type : stage.Types) {
+				const std::vector<IComponent*>& pool = ComponentManager::GetPool(type);
+				for (size_t start = 0; start < pool.size(); start += PARALLEL_UPDATE_BATCH_SIZE) {
+					size_t end = std::min(start + PARALLEL_UPDATE_BATCH_SIZE, pool.size());
+					JobSystem::Run(counter, [this, &pool, &type, start, end, dt]() {
+						for (size_t ix = start; ix < end; ix++) {
+							IComponent* component = pool[ix];
+							if (component->IsEnabled && component->GetGameObject()->GetScene() == this && _IsFirstOfType(component, type)) {
+								component->Update(dt);
+							}
+						}
+					});
+				}
+			}
+			JobSystem::Wait(counter);
+
+			// Any extra components of the same type on one object were skipped above, we still
+			// need to update them with the pools locked so they see the same rules as the workers
+			for (const std::type_index& type : stage.Types) {
+				for (IComponent* component : ComponentManager::GetPool(type)) {
+					if (component->IsEnabled && component->GetGameObject()->GetScene() == this && !_IsFirstOfType(component, type)) {
+						component->Update(dt);
+					}
+				}
+			}
+			_isUpdatingInParallel = false;
+			ComponentManager::SetPoolsLocked(false);
+
+			// Now that we're back to one thread, we can push any transform changes down the hierarchy
+			if (*(stage.Access.Writes & ComponentAccessFlags::Transform) != 0) {
+				for (const std::type_index& type : stage.Types) {
+					for (IComponent* component : ComponentManager::GetPool(type)) {
+						if (component->GetGameObject()->GetScene() == this) {
+							component->GetGameObject()->_ApplyPendingTransform();
+						}
+					}
+				}
+			}
+		}
+	}
+
+	bool Scene::_IsFirstOfType(const IComponent* component, const std::type_index& type) {
+		for (const IComponent::Sptr& other : component->GetGameObject()->_components) {
+			if (std::type_index(typeid(*other)) == type) {
+				return other.get() == component;
+			}
+		}
+		return true;
+	}
+
+	void Scene::_BuildUpdateStages() {
+		_updateStages.clear();
+		for (const std::type_index& type : ComponentManager::GetRegisteredTypes()) {
+			const ComponentAccess& access = ComponentManager::GetAccess(type);
+			if (access.IsUpdateSkipped) {
+				continue;
+			}
+
+			// Consecutive types can share a stage as long as they don't conflict, main thread
+			// types are only grouped with other main thread types
+			bool canJoin = false;
+			if (!_updateStages.empty()) {
+				const ComponentAccess& stageAccess = _updateStages.back().Access;
+				canJoin = access.IsMainThreadOnly ? stageAccess.IsMainThreadOnly :
+					!stageAccess.IsMainThreadOnly && !stageAccess.ConflictsWith(access);
+			}
+			if (!canJoin) {
+				_updateStages.push_back(UpdateStage{ {}, access });
+			}
+
+			UpdateStage& stage = _updateStages.back();
+			stage.Types.push_back(type);
+			stage.Access.Reads  |= access.Reads;
+			stage.Access.Writes |= access.Writes;
+		}
+		_updateStageTypeCount = ComponentManager::GetRegisteredTypes().size();
+	}
+
+	void Scene::PreRender(const glm::ivec2& viewportSize) {
+		// Scripts and physics are done moving things for this frame, so we can update all the
+		// world transforms in one pass instead of on demand
+		_transforms->Update();
+
+		// Lights were added or removed without calling SetupShaderAndLights
+		if (_clusteredLighting->GetLightCount() != Lights.size()) {
+			SetupShaderAndLights();
+		}
+		if (MainCamera != nullptr) {
+			// Shadowed lights need to know their shadow layers before they are uploaded
+			_shadowMapping->Prepare(Sun, Lights, MainCamera->GetView(), MainCamera->GetProjection());
+			for (size_t ix = 0; ix < Lights.size(); ix++) {
+				_clusteredLighting->SetShadowLayer(ix, _shadowMapping->GetShadowLayer(ix));
+			}
+			_clusteredLighting->Update(MainCamera->GetView(), MainCamera->GetProjection(), viewportSize);
+		}
+
+		// The cascades only move every so often, so we only upload the light UBO when something has changed
+		LightingUboStruct& data = _lightingUbo->GetData();
+		glm::vec4 sunDirection = glm::vec4(glm::length(Sun.Direction) > 0.0f ? glm::normalize(Sun.Direction) : glm::vec3(0.0f, 0.0f, -1.0f), 0.0f);
+		glm::vec4 sunColor = glm::vec4(Sun.Color, 0.0f);
+		const ShadowMapping::ShadowUniforms& shadows = _shadowMapping->GetUniforms();
+		if (data.SunDirection != sunDirection || data.SunColor != sunColor || memcmp(&data.Shadows, &shadows, sizeof(ShadowMapping::ShadowUniforms)) != 0) {
+			data.SunDirection = sunDirection;
+			data.SunColor = sunColor;
+			data.Shadows = shadows;
+			_lightingUbo->Update();
+		}
+
 		_lightingUbo->Bind(LIGHT_UBO_BINDING);
+		_shadowMapping->Bind();
 	}
 
-	void Scene::SetShaderLight(int index, bool update /*= true*/) {
-		if (index >= 0 && index < Lights.size() && index < MAX_LIGHTS) {
-			// Get a reference to the light UBO data so we can update it
-			LightingUboStruct& data = _lightingUbo->GetData();
-			Light& light = Lights[index];
+	void Scene::RenderShadows() {
+		if (MainCamera != nullptr) {
+			_shadowMapping->Render(_cullingTree);
+		}
+	}
 
-			// Copy to the ubo data
-			data.Lights[index].Position = light.Position;
-			data.Lights[index].Color = light.Color;
-			data.Lights[index].Attenuation = 1.0f / (1.0f + light.Range);
+	void Scene::PostRender() {
+		_clusteredLighting->EndFrame();
+		_shadowMapping->EndFrame();
+	}
 
-			// If requested, send the new data to the UBO
-			if (update)	_lightingUbo->Update();
+	void Scene::SetShaderLight(int index) {
+		if (index >= 0 && index < Lights.size() && index < _clusteredLighting->GetLightCount()) {
+			_clusteredLighting->SetLight(index, Lights[index]);
 		}
 	}
 
@@ -196,16 +478,22 @@ namespace Gameplay {
 		data.AmbientCol = glm::vec3(0.1f);
 		data.NumLights = Lights.size();
 
-		// Iterate over all lights that are enabled and configure them
+		// Copy all the lights over, they'll be uploaded and sorted into clusters in PreRender
+		_clusteredLighting->SetLightCount(Lights.size());
 		for (int ix = 0; ix < Lights.size(); ix++) {
-			SetShaderLight(ix, false);
+			SetShaderLight(ix);
 		}
 
 		// Send updated data to OpenGL
 		_lightingUbo->Update();
 	}
 
+	const ClusteredLighting::Stats& Scene::GetLightingStats() const {
+		return _clusteredLighting->GetStats();
+	}
+
 	btDynamicsWorld* Scene::GetPhysicsWorld() const {
+		SyncPhysics();
 		return _physicsWorld;
 	}
 
@@ -226,13 +514,24 @@ namespace Gameplay {
 			result->_skyboxRotation = glm::mat3_cast(ParseJsonQuat(blob["orientation"]));
 		}
 
+		// Physics settings are optional, older scenes use the defaults
+		if (data.contains("physics") && data["physics"].is_object()) {
+			result->SetPhysicsSettings(Physics::PhysicsWorldSettings::FromJson(data["physics"]));
+		}
+
 		// Make sure the scene has objects, then load them all in!
 		LOG_ASSERT(data["objects"].is_array(), "Objects not present in scene!");
 		for (auto& object : data["objects"]) {
 			GameObject::Sptr obj = GameObject::FromJson(object);
 			obj->_scene = result.get();
 			obj->_selfRef = obj;
-			result->_objects.push_back(obj);
+			result->_AddObject(obj);
+		}
+		// Children may be listed before their parents, so we link them up once everything is loaded
+		for (auto& object : data["objects"]) {
+			if (object.contains("parent") && object["parent"].is_string()) {
+				result->_LinkParent(Guid(object["guid"]), Guid(object["parent"]));
+			}
 		}
 
 		// Make sure the scene has lights, then load all
@@ -240,6 +539,10 @@ namespace Gameplay {
 		for (auto& light : data["lights"]) {
 			result->Lights.push_back(Light::FromJson(light));
 		}
+		// The sun is optional, older scenes don't have one
+		if (data.contains("sun") && data["sun"].is_object()) {
+			result->Sun = DirectionalLight::FromJson(data["sun"]);
+		}
 
 		// Create and load camera config
 		result->MainCamera = ComponentManager::GetComponentByGUID<Camera>(Guid(data["main_camera"]));
@@ -261,6 +564,8 @@ namespace Gameplay {
 		blob["skybox"]["texture"] = _skyboxTexture ? _skyboxTexture->GetGUID().str() : "null";
 		blob["skybox"]["orientation"] = GlmToJson(_skyboxRotation);
 
+		blob["physics"] = GetPhysicsSettings().ToJson();
+
 		// Save renderables
 		std::vector<nlohmann::json> objects;
 		objects.resize(_objects.size());
@@ -276,6 +581,7 @@ namespace Gameplay {
 			lights[ix] = Lights[ix].ToJson();
 		}
 		blob["lights"] = lights;
+		blob["sun"] = Sun.ToJson();
 
 		// Save camera info
 		blob["main_camera"] = MainCamera != nullptr ? MainCamera->GetGUID().str() : "null";
@@ -290,8 +596,364 @@ namespace Gameplay {
 		LOG_INFO("Saved scene to \"{}\"", path);
 	}
 
+	void Scene::SaveSnapshot(Snapshot& snapshot) const {
+		// Clearing keeps the memory from the last snapshot around, so we don't churn the allocator
+		snapshot.Data.Clear();
+		snapshot.Objects.clear();
+		snapshot.Objects.reserve(_objects.size());
+
+		BinaryWriter& data = snapshot.Data;
+		data.Write<uint32_t>(static_cast<uint32_t>(Lights.size()));
+		for (const Light& light : Lights) {
+			data.Write(light.Position);
+			data.Write(light.Color);
+			data.Write(light.Range);
+			data.Write<uint8_t>(light.CastShadows ? 1 : 0);
+		}
+		data.Write(Sun.Direction);
+		data.Write(Sun.Color);
+		data.Write<uint8_t>(Sun.CastShadows ? 1 : 0);
+		data.Write(_skyboxRotation);
+
+		for (const auto& object : _objects) {
+			snapshot.Objects.push_back(object);
+
+			// Each record is length prefixed so that it can be skipped if the object is gone
+			size_t recordStart = data.GetSize();
+			data.Write<uint32_t>(0);
+			data.Write(object->_position);
+			data.Write(object->_rotation);
+			data.Write(object->_scale);
+			data.WriteGuid(object->_parent != nullptr ? object->_parent->GUID : Guid());
+			data.Write<uint32_t>(static_cast<uint32_t>(object->_components.size()));
+			for (const auto& component : object->_components) {
+				data.Write<uint8_t>(component->IsEnabled ? 1 : 0);
+				size_t componentStart = data.GetSize();
+				data.Write<uint32_t>(0);
+				component->SaveSnapshot(data);
+				data.WriteAt<uint32_t>(componentStart, static_cast<uint32_t>(data.GetSize() - componentStart - sizeof(uint32_t)));
+			}
+			data.WriteAt<uint32_t>(recordStart, static_cast<uint32_t>(data.GetSize() - recordStart - sizeof(uint32_t)));
+		}
+	}
+
+	void Scene::RestoreSnapshot(const Snapshot& snapshot) {
+		// Physics bodies are reset in place, and anything left over from play mode should not be simulated
+		SyncPhysics();
+		_physicsAccumulator = 0.0f;
+		_physicsBatchSteps = 0;
+
+		BinaryReader reader(snapshot.Data.GetData().data(), snapshot.Data.GetSize());
+
+		uint32_t lightCount = reader.Read<uint32_t>();
+		Lights.resize(lightCount);
+		for (Light& light : Lights) {
+			light.Position    = reader.Read<glm::vec3>();
+			light.Color       = reader.Read<glm::vec3>();
+			light.Range       = reader.Read<float>();
+			light.CastShadows = reader.Read<uint8_t>() != 0;
+		}
+		Sun.Direction   = reader.Read<glm::vec3>();
+		Sun.Color       = reader.Read<glm::vec3>();
+		Sun.CastShadows = reader.Read<uint8_t>() != 0;
+		SetSkyboxRotation(reader.Read<glm::mat3>());
+		SetupShaderAndLights();
+
+		// Objects can only be appended while playing, and removal preserves order, so we can
+		// walk both lists together to find the objects that were created after the snapshot
+		size_t snapshotIx = 0;
+		for (const auto& object : _objects) {
+			while (snapshotIx < snapshot.Objects.size() && snapshot.Objects[snapshotIx].expired()) {
+				snapshotIx++;
+			}
+			if (snapshotIx < snapshot.Objects.size() && snapshot.Objects[snapshotIx].lock() == object) {
+				snapshotIx++;
+			} else {
+				RemoveGameObject(object);
+			}
+		}
+		_FlushDeleteQueue();
+
+		std::vector<std::pair<Guid, Guid>> relink;
+		for (const auto& weakObject : snapshot.Objects) {
+			BinaryReader record = reader.ReadBlob();
+			GameObject::Sptr object = weakObject.lock();
+			if (object == nullptr || object->_scene != this) {
+				LOG_WARN("An object was deleted during play mode and cannot be restored from the snapshot");
+				continue;
+			}
+
+			object->_position = record.Read<glm::vec3>();
+			object->_rotation = record.Read<glm::quat>();
+			object->_scale    = record.Read<glm::vec3>();
+			object->_MarkTransformDirty();
+
+			// Scripts may have re-parented the object, the local transform we restored is relative to the old parent.
+			// We detach it for now and re-link once every object is restored, so we never create a cycle part way through
+			Guid parent = record.ReadGuid();
+			if ((object->_parent != nullptr ? object->_parent->GUID : Guid()) != parent) {
+				object->SetParent(nullptr, false);
+				if (parent.isValid()) {
+					relink.push_back(std::make_pair(object->GUID, parent));
+				}
+			}
+
+			uint32_t componentCount = record.Read<uint32_t>();
+			if (componentCount != object->_components.size()) {
+				LOG_WARN("Components on \"{}\" changed during play mode, only it's transform was restored", object->_name);
+				continue;
+			}
+			for (const auto& component : object->_components) {
+				component->IsEnabled = record.Read<uint8_t>() != 0;
+				BinaryReader state = record.ReadBlob();
+				component->RestoreSnapshot(state);
+			}
+		}
+		for (const auto& link : relink) {
+			_LinkParent(link.first, link.second);
+		}
+
+		LOG_ASSERT(reader.IsValid(), "Scene snapshot is corrupt!");
+	}
+
+	void Scene::SaveBinary(const std::string& path) {
+		ChunkedFileWriter file;
+
+		BinaryWriter header;
+		header.WriteGuid(DefaultMaterial ? DefaultMaterial->GetGUID() : Guid());
+		header.Write(GetAmbientLight());
+		header.WriteGuid(_skyboxMesh ? _skyboxMesh->GetGUID() : Guid());
+		header.WriteGuid(_skyboxShader ? _skyboxShader->GetGUID() : Guid());
+		header.WriteGuid(_skyboxTexture ? _skyboxTexture->GetGUID() : Guid());
+		header.Write(glm::quat_cast(_skyboxRotation));
+		header.WriteGuid(MainCamera != nullptr ? MainCamera->GetGUID() : Guid());
+		file.AddChunk(MakeFourCC("SCNE"), BINARY_SCENE_VERSION, header.Release());
+
+		BinaryWriter lights;
+		lights.Write<uint32_t>(static_cast<uint32_t>(Lights.size()));
+		for (const Light& light : Lights) {
+			lights.Write(light.Position);
+			lights.Write(light.Color);
+			lights.Write(light.Range);
+			lights.Write<uint8_t>(light.CastShadows ? 1 : 0);
+		}
+		file.AddChunk(MakeFourCC("LGHT"), BINARY_LIGHTS_VERSION, lights.Release());
+
+		BinaryWriter sun;
+		sun.Write(Sun.Direction);
+		sun.Write(Sun.Color);
+		sun.Write<uint8_t>(Sun.CastShadows ? 1 : 0);
+		file.AddChunk(MakeFourCC("SUNL"), BINARY_SUN_VERSION, sun.Release());
+
+		BinaryWriter objects;
+		objects.Write<uint32_t>(static_cast<uint32_t>(_objects.size()));
+		for (const auto& object : _objects) {
+			object->ToBinary(objects);
+		}
+		file.AddChunk(MakeFourCC("GOBJ"), BINARY_OBJECTS_VERSION, objects.Release());
+
+		// Parents are stored separately as (child, parent) pairs, so objects can be loaded in any order
+		BinaryWriter hierarchy;
+		uint32_t linkCount = 0;
+		hierarchy.Write<uint32_t>(0);
+		for (const auto& object : _objects) {
+			if (object->_parent != nullptr) {
+				hierarchy.WriteGuid(object->GUID);
+				hierarchy.WriteGuid(object->_parent->GUID);
+				linkCount++;
+			}
+		}
+		hierarchy.WriteAt<uint32_t>(0, linkCount);
+		file.AddChunk(MakeFourCC("HIER"), BINARY_HIERARCHY_VERSION, hierarchy.Release());
+
+		BinaryWriter physics;
+		GetPhysicsSettings().ToBinary(physics);
+		file.AddChunk(MakeFourCC("PHYS"), BINARY_PHYSICS_VERSION, physics.Release());
+
+		if (file.Save(path)) {
+			_filePath = path;
+			LOG_INFO("Saved binary scene to \"{}\"", path);
+		}
+	}
+
+	bool Scene::ConvertJsonToBinary(const nlohmann::json& data, const std::string& path) {
+		// Resource GUIDs are stored as "null" when missing, which parses to an empty GUID
+		auto parseGuid = [](const nlohmann::json& value) {
+			return value.is_string() ? Guid(value.get<std::string>()) : Guid();
+		};
+
+		ChunkedFileWriter file;
+
+		BinaryWriter header;
+		header.WriteGuid(parseGuid(data["default_material"]));
+		header.Write(data.contains("ambient") ? ParseJsonVec3(data["ambient"]) : glm::vec3(0.1f));
+		if (data.contains("skybox") && data["skybox"].is_object()) {
+			const nlohmann::json& blob = data["skybox"];
+			header.WriteGuid(parseGuid(blob["mesh"]));
+			header.WriteGuid(parseGuid(blob["shader"]));
+			header.WriteGuid(parseGuid(blob["texture"]));
+			header.Write(ParseJsonQuat(blob["orientation"]));
+		} else {
+			header.WriteGuid(Guid());
+			header.WriteGuid(Guid());
+			header.WriteGuid(Guid());
+			header.Write(glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+		}
+		header.WriteGuid(parseGuid(data["main_camera"]));
+		file.AddChunk(MakeFourCC("SCNE"), BINARY_SCENE_VERSION, header.Release());
+
+		LOG_ASSERT(data["lights"].is_array(), "Lights not present in scene!");
+		BinaryWriter lights;
+		lights.Write<uint32_t>(static_cast<uint32_t>(data["lights"].size()));
+		for (auto& blob : data["lights"]) {
+			Light light = Light::FromJson(blob);
+			lights.Write(light.Position);
+			lights.Write(light.Color);
+			lights.Write(light.Range);
+			lights.Write<uint8_t>(light.CastShadows ? 1 : 0);
+		}
+		file.AddChunk(MakeFourCC("LGHT"), BINARY_LIGHTS_VERSION, lights.Release());
+
+		if (data.contains("sun") && data["sun"].is_object()) {
+			DirectionalLight light = DirectionalLight::FromJson(data["sun"]);
+			BinaryWriter sun;
+			sun.Write(light.Direction);
+			sun.Write(light.Color);
+			sun.Write<uint8_t>(light.CastShadows ? 1 : 0);
+			file.AddChunk(MakeFourCC("SUNL"), BINARY_SUN_VERSION, sun.Release());
+		}
+
+		LOG_ASSERT(data["objects"].is_array(), "Objects not present in scene!");
+		BinaryWriter objects;
+		objects.Write<uint32_t>(static_cast<uint32_t>(data["objects"].size()));
+		for (auto& blob : data["objects"]) {
+			GameObject::JsonToBinary(blob, objects);
+		}
+		file.AddChunk(MakeFourCC("GOBJ"), BINARY_OBJECTS_VERSION, objects.Release());
+
+		BinaryWriter hierarchy;
+		uint32_t linkCount = 0;
+		hierarchy.Write<uint32_t>(0);
+		for (auto& blob : data["objects"]) {
+			if (blob.contains("parent") && blob["parent"].is_string()) {
+				hierarchy.WriteGuid(Guid(blob["guid"].get<std::string>()));
+				hierarchy.WriteGuid(Guid(blob["parent"].get<std::string>()));
+				linkCount++;
+			}
+		}
+		hierarchy.WriteAt<uint32_t>(0, linkCount);
+		file.AddChunk(MakeFourCC("HIER"), BINARY_HIERARCHY_VERSION, hierarchy.Release());
+
+		if (data.contains("physics") && data["physics"].is_object()) {
+			BinaryWriter physics;
+			Physics::PhysicsWorldSettings::FromJson(data["physics"]).ToBinary(physics);
+			file.AddChunk(MakeFourCC("PHYS"), BINARY_PHYSICS_VERSION, physics.Release());
+		}
+
+		return file.Save(path);
+	}
+
+	Scene::Sptr Scene::LoadBinary(const std::string& path) {
+		LOG_INFO("Loading binary scene from \"{}\"", path);
+		ChunkedFileReader::Sptr file = ChunkedFileReader::Open(path);
+		if (file == nullptr) {
+			return nullptr;
+		}
+
+		uint32_t headerVersion = 0, lightsVersion = 0, objectsVersion = 0;
+		BinaryReader header  = file->GetChunk(MakeFourCC("SCNE"), &headerVersion);
+		BinaryReader lights  = file->GetChunk(MakeFourCC("LGHT"), &lightsVersion);
+		BinaryReader objects = file->GetChunk(MakeFourCC("GOBJ"), &objectsVersion);
+		if (!header.IsValid() || !lights.IsValid() || !objects.IsValid()) {
+			LOG_ERROR("Binary scene \"{}\" is missing required chunks", path);
+			return nullptr;
+		}
+		if (headerVersion > BINARY_SCENE_VERSION || lightsVersion > BINARY_LIGHTS_VERSION || objectsVersion > BINARY_OBJECTS_VERSION) {
+			LOG_ERROR("Binary scene \"{}\" was written by a newer version of the engine", path);
+			return nullptr;
+		}
+
+		Scene::Sptr result = std::make_shared<Scene>();
+
+		// Like the hierarchy, the physics chunk is optional
+		uint32_t physicsVersion = 0;
+		BinaryReader physics = file->GetChunk(MakeFourCC("PHYS"), &physicsVersion);
+		if (physics.IsValid() && physicsVersion <= BINARY_PHYSICS_VERSION) {
+			Physics::PhysicsWorldSettings settings = Physics::PhysicsWorldSettings::FromBinary(physics);
+			if (physics.IsValid()) {
+				result->SetPhysicsSettings(settings);
+			}
+		}
+
+		result->DefaultMaterial = ResourceManager::Get<Material>(header.ReadGuid());
+		result->SetAmbientLight(header.Read<glm::vec3>());
+		result->_skyboxMesh     = ResourceManager::Get<MeshResource>(header.ReadGuid());
+		result->_skyboxShader   = ResourceManager::Get<Shader>(header.ReadGuid());
+		result->_skyboxTexture  = ResourceManager::Get<TextureCube>(header.ReadGuid());
+		result->_skyboxRotation = glm::mat3_cast(header.Read<glm::quat>());
+		Guid mainCamera = header.ReadGuid();
+
+		uint32_t lightCount = lights.Read<uint32_t>();
+		result->Lights.reserve(lightCount);
+		for (uint32_t ix = 0; ix < lightCount && lights.IsValid(); ix++) {
+			Light light;
+			light.Position = lights.Read<glm::vec3>();
+			light.Color    = lights.Read<glm::vec3>();
+			light.Range    = lights.Read<float>();
+			// Shadows were added in version 2
+			if (lightsVersion >= 2) {
+				light.CastShadows = lights.Read<uint8_t>() != 0;
+			}
+			result->Lights.push_back(light);
+		}
+
+		// Like the physics settings, the sun is optional
+		uint32_t sunVersion = 0;
+		BinaryReader sun = file->GetChunk(MakeFourCC("SUNL"), &sunVersion);
+		if (sun.IsValid() && sunVersion <= BINARY_SUN_VERSION) {
+			result->Sun.Direction   = sun.Read<glm::vec3>();
+			result->Sun.Color       = sun.Read<glm::vec3>();
+			result->Sun.CastShadows = sun.Read<uint8_t>() != 0;
+		}
+
+		uint32_t objectCount = objects.Read<uint32_t>();
+		result->_objects.reserve(objectCount);
+		result->_objectsByGuid.reserve(objectCount);
+		result->_objectsByName.reserve(objectCount);
+		for (uint32_t ix = 0; ix < objectCount && objects.IsValid(); ix++) {
+			GameObject::Sptr obj = GameObject::FromBinary(objects);
+			obj->_scene = result.get();
+			obj->_selfRef = obj;
+			result->_AddObject(obj);
+		}
+
+		// The hierarchy chunk is optional, scenes saved before it was added have no parents
+		uint32_t hierarchyVersion = 0;
+		BinaryReader hierarchy = file->GetChunk(MakeFourCC("HIER"), &hierarchyVersion);
+		if (hierarchy.IsValid() && hierarchyVersion <= BINARY_HIERARCHY_VERSION) {
+			uint32_t linkCount = hierarchy.Read<uint32_t>();
+			for (uint32_t ix = 0; ix < linkCount && hierarchy.IsValid(); ix++) {
+				Guid child  = hierarchy.ReadGuid();
+				Guid parent = hierarchy.ReadGuid();
+				result->_LinkParent(child, parent);
+			}
+		}
+
+		if (!header.IsValid() || !lights.IsValid() || !objects.IsValid()) {
+			LOG_ERROR("Binary scene \"{}\" is corrupt, some data may be missing", path);
+		}
+
+		result->MainCamera = ComponentManager::GetComponentByGUID<Camera>(mainCamera);
+		result->_filePath = path;
+		return result;
+	}
+
 	Scene::Sptr Scene::Load(const std::string& path)
 	{
+		if (ChunkedFile::IsChunkedFile(path)) {
+			return LoadBinary(path);
+		}
+
 		LOG_INFO("Loading scene from \"{}\"", path);
 		std::string content = FileHelpers::ReadFile(path);
 		nlohmann::json blob = nlohmann::json::parse(content);
@@ -309,44 +971,273 @@ namespace Gameplay {
 	}
 
 	void Scene::_InitPhysics() {
+		const Physics::PhysicsWorldSettings& settings = _physicsSettings;
+
+		// The Mt classes grab the task scheduler when they are created
+		if (settings.IsMultithreaded) {
+			Physics::BulletTaskScheduler::Install();
+		}
+
 		_collisionConfig = new btDefaultCollisionConfiguration();
-		_collisionDispatcher = new btCollisionDispatcher(_collisionConfig);
-		_broadphaseInterface = new btDbvtBroadphase();
-		_ghostCallback = new btGhostPairCallback();
-		_broadphaseInterface->getOverlappingPairCache()->setInternalGhostPairCallback(_ghostCallback);
-		_constraintSolver = new btSequentialImpulseConstraintSolver();
-		_physicsWorld = new btDiscreteDynamicsWorld(
-			_collisionDispatcher,
-			_broadphaseInterface,
-			_constraintSolver,
-			_collisionConfig
-		);
+		if (settings.IsMultithreaded) {
+			_collisionDispatcher = new btCollisionDispatcherMt(_collisionConfig);
+		} else {
+			_collisionDispatcher = new btCollisionDispatcher(_collisionConfig);
+		}
+
+		switch (settings.Broadphase) {
+			case BroadphaseType::AxisSweep:
+				_broadphaseInterface = new btAxisSweep3(
+					btVector3(settings.WorldMin.x, settings.WorldMin.y, settings.WorldMin.z),
+					btVector3(settings.WorldMax.x, settings.WorldMax.y, settings.WorldMax.z)
+				);
+				break;
+			case BroadphaseType::Dbvt:
+			default:
+				_broadphaseInterface = new btDbvtBroadphase();
+				break;
+		}
+
+		if (settings.IsMultithreaded) {
+			int poolSize = settings.SolverPoolSize > 0 ? settings.SolverPoolSize : btGetTaskScheduler()->getNumThreads();
+			btConstraintSolverPoolMt* solverPool = new btConstraintSolverPoolMt(poolSize);
+			_constraintSolver = solverPool;
+			_physicsWorld = new btDiscreteDynamicsWorldMt(
+				_collisionDispatcher,
+				_broadphaseInterface,
+				solverPool,
+				nullptr,
+				_collisionConfig
+			);
+		} else {
+			_constraintSolver = new btSequentialImpulseConstraintSolver();
+			_physicsWorld = new btDiscreteDynamicsWorld(
+				_collisionDispatcher,
+				_broadphaseInterface,
+				_constraintSolver,
+				_collisionConfig
+			);
+		}
+		_physicsWorld->getSolverInfo().m_numIterations = glm::max(settings.SolverIterations, 1);
 		_physicsWorld->setGravity(ToBt(_gravity));
-		// TODO bullet debug drawing
-		_bulletDebugDraw = new BulletDebugDraw();
+		_physicsWorld->setInternalTickCallback(&Scene::_OnPhysicsTick, this);
+		_physicsThread = WorkerThread::Create();
+
+		// The debug drawer outlives the world, so that the draw mode is kept when the world is rebuilt
+		if (_bulletDebugDraw == nullptr) {
+			_bulletDebugDraw = new BulletDebugDraw();
+			_bulletDebugDraw->setDebugMode(btIDebugDraw::DBG_NoDebug);
+		}
 		_physicsWorld->setDebugDrawer(_bulletDebugDraw);
-		_bulletDebugDraw->setDebugMode(btIDebugDraw::DBG_NoDebug);
 	}
 
 	void Scene::_CleanupPhysics() {
+		_physicsThread = nullptr;
 		delete _physicsWorld;
 		delete _constraintSolver;
 		delete _broadphaseInterface;
-		delete _ghostCallback;
 		delete _collisionDispatcher;
 		delete _collisionConfig;
 	}
 
 
 	void Scene::_FlushDeleteQueue() {
+		if (_deletionQueue.empty()) {
+			return;
+		}
+
+		// Drop the objects from our indices and collect them into a set, so that we can
+		// remove them all from the object list in a single pass
+		std::unordered_set<GameObject*> toRemove;
+		toRemove.reserve(_deletionQueue.size());
 		for (auto& weakPtr : _deletionQueue) {
-			if (weakPtr.expired()) continue;
-			auto& it = std::find(_objects.begin(), _objects.end(), weakPtr.lock());
-			if (it != _objects.end()) {
-				_objects.erase(it);
+			GameObject::Sptr object = weakPtr.lock();
+			if (object == nullptr || object->_scene != this) continue;
+			if (toRemove.insert(object.get()).second) {
+				_RemoveObjectFromIndices(object.get());
 			}
 		}
 		_deletionQueue.clear();
+
+		// Children are removed along with their parents
+		std::vector<GameObject*> stack(toRemove.begin(), toRemove.end());
+		while (!stack.empty()) {
+			GameObject* object = stack.back();
+			stack.pop_back();
+			for (GameObject* child : object->_children) {
+				if (toRemove.insert(child).second) {
+					_RemoveObjectFromIndices(child);
+					stack.push_back(child);
+				}
+			}
+		}
+
+		// Unlink the objects from the hierarchy, the removed objects may outlive the scene's references to them
+		for (GameObject* object : toRemove) {
+			if (object->_parent != nullptr && toRemove.count(object->_parent) == 0) {
+				std::vector<GameObject*>& siblings = object->_parent->_children;
+				siblings.erase(std::remove(siblings.begin(), siblings.end(), object), siblings.end());
+			}
+			if (object->_transformIndex != TransformHierarchy::NO_NODE) {
+				_transforms->Remove(object);
+			}
+		}
+		for (GameObject* object : toRemove) {
+			object->_parent = nullptr;
+			object->_children.clear();
+			object->_isTransformDirty = true;
+		}
+
+		// Erase while preserving the order of the remaining objects
+		_objects.erase(std::remove_if(_objects.begin(), _objects.end(), [&](const GameObject::Sptr& object) {
+			return toRemove.count(object.get()) > 0;
+		}), _objects.end());
+	}
+
+	void Scene::_OnPhysicsTick(btDynamicsWorld* world, btScalar timeStep) {
+		// Keep the last two step results for each body, so the main thread can interpolate between them
+		Scene* scene = static_cast<Scene*>(world->getWorldUserInfo());
+		for (Physics::RigidBody* body : scene->_rigidBodies) {
+			body->_StoreStep();
+		}
+	}
+
+	void Scene::_ProcessTriggers(float dt) {
+		PROFILE_SCOPE("Scene::ProcessTriggers");
+		if (_triggerVolumes.empty()) {
+			return;
+		}
+
+		// The world has already run the narrowphase for every pair (including pairs with our ghosts)
+		// while stepping, so we can find everything that is touching a trigger in one pass over the
+		// manifolds, rather than having each trigger dispatch it's own pairs again
+		btDispatcher* dispatcher = _physicsWorld->getDispatcher();
+		int manifoldCount = dispatcher->getNumManifolds();
+		for (int ix = 0; ix < manifoldCount; ix++) {
+			const btPersistentManifold* manifold = dispatcher->getManifoldByIndexInternal(ix);
+			if (manifold->getNumContacts() == 0) {
+				continue;
+			}
+			const btCollisionObject* a = manifold->getBody0();
+			const btCollisionObject* b = manifold->getBody1();
+			if (a->getInternalType() == btCollisionObject::CO_GHOST_OBJECT) {
+				reinterpret_cast<Physics::TriggerVolume*>(a->getUserPointer())->_AddOverlap(b);
+			}
+			if (b->getInternalType() == btCollisionObject::CO_GHOST_OBJECT) {
+				reinterpret_cast<Physics::TriggerVolume*>(b->getUserPointer())->_AddOverlap(a);
+			}
+		}
+
+		// Each trigger compares against it's last step and records it's events, which we send
+		// once all the triggers are done, so callbacks can't change the scene out from under us
+		std::vector<Physics::TriggerVolume::Event> events;
+		for (Physics::TriggerVolume* trigger : _triggerVolumes) {
+			trigger->_pendingEvents = &events;
+			trigger->PhysicsPostStep(dt);
+			trigger->_pendingEvents = nullptr;
+		}
+
+		for (const Physics::TriggerVolume::Event& event : events) {
+			if (event.Trigger == nullptr || event.Body == nullptr) {
+				continue;
+			}
+			if (event.IsEnter) {
+				event.Body->GetGameObject()->OnEnteredTrigger(event.Trigger);
+				event.Trigger->GetGameObject()->OnTriggerVolumeEntered(event.Body);
+			} else {
+				event.Body->GetGameObject()->OnLeavingTrigger(event.Trigger);
+				event.Trigger->GetGameObject()->OnTriggerVolumeLeaving(event.Body);
+			}
+		}
+	}
+
+	void Scene::_RegisterPhysics(Physics::RigidBody* body) {
+		_AddToPhysicsList(_rigidBodies, body);
+	}
+
+	void Scene::_RegisterPhysics(Physics::TriggerVolume* trigger) {
+		_AddToPhysicsList(_triggerVolumes, trigger);
+	}
+
+	void Scene::_UnregisterPhysics(Physics::RigidBody* body) {
+		_RemoveFromPhysicsList(_rigidBodies, body);
+		// Triggers key their overlaps by collision object, so they can't be left holding on to a body that's going away
+		for (Physics::TriggerVolume* trigger : _triggerVolumes) {
+			trigger->_ForgetOverlap(body->_body);
+		}
+	}
+
+	void Scene::_UnregisterPhysics(Physics::TriggerVolume* trigger) {
+		_RemoveFromPhysicsList(_triggerVolumes, trigger);
+	}
+
+	template <typename T>
+	void Scene::_AddToPhysicsList(std::vector<T*>& list, T* object) {
+		SyncPhysics();
+		LOG_ASSERT(object->_sceneIndex == -1, "Physics object has already been registered with a scene!");
+		object->_sceneIndex = static_cast<int>(list.size());
+		list.push_back(object);
+	}
+
+	template <typename T>
+	void Scene::_RemoveFromPhysicsList(std::vector<T*>& list, T* object) {
+		SyncPhysics();
+		int index = object->_sceneIndex;
+		LOG_ASSERT(index >= 0 && index < (int)list.size() && list[index] == object, "Physics object is not registered with this scene!");
+		// Swap the last object into the removed slot, order doesn't matter
+		list[index] = list.back();
+		list[index]->_sceneIndex = index;
+		list.pop_back();
+		object->_sceneIndex = -1;
+	}
+
+	void Scene::_AddObject(const GameObject::Sptr& object) {
+		object->_sceneOrder = _nextObjectOrder++;
+		_objects.push_back(object);
+		_transforms->Add(object.get());
+		auto result = _objectsByGuid.emplace(object->GUID, object);
+		if (!result.second) {
+			LOG_WARN("Duplicate GameObject GUID {} in scene, lookups will only find the first object", object->GUID.str());
+		}
+		_objectsByName.emplace(object->_name, object);
+	}
+
+	void Scene::_LinkParent(Guid child, Guid parent) {
+		GameObject::Sptr childObject = FindObjectByGUID(child);
+		GameObject::Sptr parentObject = FindObjectByGUID(parent);
+		if (childObject == nullptr || parentObject == nullptr) {
+			LOG_WARN("Could not find parent {} for object {}, leaving it as a root object", parent.str(), child.str());
+			return;
+		}
+		// The stored transform is already relative to the parent
+		childObject->SetParent(parentObject, false);
+	}
+
+	void Scene::_RemoveObjectFromIndices(GameObject* object) {
+		auto guidIt = _objectsByGuid.find(object->GUID);
+		if (guidIt != _objectsByGuid.end() && guidIt->second.get() == object) {
+			_objectsByGuid.erase(guidIt);
+		}
+
+		auto range = _objectsByName.equal_range(object->_name);
+		for (auto it = range.first; it != range.second; ++it) {
+			if (it->second.get() == object) {
+				_objectsByName.erase(it);
+				break;
+			}
+		}
+	}
+
+	void Scene::_OnObjectRenamed(GameObject* object, const std::string& oldName) {
+		auto range = _objectsByName.equal_range(oldName);
+		for (auto it = range.first; it != range.second; ++it) {
+			if (it->second.get() == object) {
+				GameObject::Sptr ptr = it->second;
+				_objectsByName.erase(it);
+				_objectsByName.emplace(object->_name, ptr);
+				return;
+			}
+		}
 	}
 
 	void Scene::DrawAllGameObjectGUIs()
@@ -366,7 +1257,9 @@ namespace Gameplay {
 
 	void Scene::DrawSkybox()
 	{
+		PROFILE_GPU_SCOPE("Scene::DrawSkybox");
 		if (_skyboxShader != nullptr &&
+			_skyboxShader->IsReady() &&
 			_skyboxMesh != nullptr &&
 			_skyboxMesh->Mesh != nullptr &&
 			_skyboxTexture != nullptr &&
@@ -389,4 +1282,37 @@ namespace Gameplay {
 		}
 	}
 
+	void Scene::CullRenderables(const glm::mat4& viewProjection, std::vector<RenderComponent*>& visible)
+	{
+		PROFILE_SCOPE("Scene::CullRenderables");
+
+		// Sync the tree with any objects that have moved or changed meshes. Anything we can't
+		// get bounds for gets drawn regardless, since we can't know if it's visible
+		ComponentManager::Each<RenderComponent>([&](RenderComponent& renderable) {
+			if (renderable.GetGameObject()->GetScene() != this) {
+				return;
+			}
+			if (!renderable.UpdateCullingProxy(_cullingTree) || !IsCullingEnabled) {
+				visible.push_back(&renderable);
+			}
+		});
+
+		if (!IsCullingEnabled) {
+			return;
+		}
+
+		Frustum frustum(viewProjection);
+		_cullingTree->Query(frustum, [&](void* userData) {
+			RenderComponent* renderable = static_cast<RenderComponent*>(userData);
+			// Disabled components keep their proxies so they don't need to be re-inserted when re-enabled
+			if (renderable->IsEnabled) {
+				visible.push_back(renderable);
+			}
+		});
+	}
+
+	int Scene::GetCullableCount() const {
+		return _cullingTree->GetProxyCount();
+	}
+
 }
\ No newline at end of file
@@ -1,25 +1,38 @@
 #pragma once
+#include <unordered_map>
 #include <btBulletDynamicsCommon.h>
 #include "BulletCollision/CollisionDispatch/btGhostObject.h"
 
 #include "Gameplay/Components/Camera.h"
 #include "Gameplay/GameObject.h"
 #include "Gameplay/Light.h"
+#include "Gameplay/ClusteredLighting.h"
+#include "Gameplay/ShadowMapping.h"
+#include "Gameplay/TransformHierarchy.h"
+#include "Gameplay/SceneCommandBuffer.h"
 
 #include "Physics/BulletDebugDraw.h"
+#include "Physics/PhysicsWorldSettings.h"
 
 #include "Graphics/UniformBuffer.h"
 
+#include "Utils/BinaryStream.h"
+#include "Utils/BoundingVolumeHierarchy.h"
+#include "Utils/WorkerThread.h"
+
 struct GLFWwindow;
 
 class TextureCube;
 class Shader;
+class RenderComponent;
 
 const int LIGHT_UBO_BINDING_SLOT = 0;
 
 namespace Gameplay {
 	namespace Physics {
+		class PhysicsBase;
 		class RigidBody;
+		class TriggerVolume;
 	}
 
 	class MeshResource;
@@ -34,11 +47,24 @@ namespace Gameplay {
 	public:
 		typedef std::shared_ptr<Scene> Sptr;
 
-		static const int MAX_LIGHTS = 8;
+		/// <summary>
+		/// A flat copy of all the scene state that can change while the scene is playing,
+		/// see SaveSnapshot and RestoreSnapshot. A snapshot can be re-used to avoid
+		/// re-allocating every time we enter play mode
+		/// </summary>
+		struct Snapshot {
+			// Lights, then one record per object with it's transform and component state
+			BinaryWriter Data;
+			// The objects that were in the scene when the snapshot was taken, in the same order as Data
+			std::vector<std::weak_ptr<GameObject>> Objects;
+		};
+
 		static const int LIGHT_UBO_BINDING = 2;
 
 		// Stores all the lights in our scene
 		std::vector<Light>         Lights;
+		// The scene's directional light, black by default so that it's disabled
+		DirectionalLight           Sun;
 		// The camera for our scene
 		Camera::Sptr               MainCamera;
 
@@ -49,6 +75,10 @@ namespace Gameplay {
 
 		// Whether the application is in "play mode", lets us leverage editors!
 		bool                       IsPlaying;
+		// Whether CullRenderables should test objects against the camera frustum, or return everything
+		bool                       IsCullingEnabled;
+		// Whether Update should spread component updates across the job system's worker threads
+		bool                       IsParallelUpdateEnabled;
 
 
 		Scene();
@@ -73,6 +103,8 @@ namespace Gameplay {
 		/// <summary>
 		/// Creates a game object with the given name
 		/// CreateGameObject is the only way to create game objects
+		/// 
+		/// Must not be called from a parallel update, use GetCommandBuffer().CreateGameObject instead
 		/// </summary>
 		/// <param name="name">The name of the gameobject to create</param>
 		/// <returns>A new gameobject with the given name</returns>
@@ -85,16 +117,21 @@ namespace Gameplay {
 		void RemoveGameObject(const GameObject::Sptr& object);
 
 		/// <summary>
-		/// Searches all objects in the scene and returns the first
-		/// one who's name matches the one given, or nullptr if no object
-		/// is found
+		/// Gets the buffer for changes to the scene's structure that are made during a parallel
+		/// update. Commands are executed on the main thread at the end of Update
+		/// </summary>
+		SceneCommandBuffer& GetCommandBuffer() { return _commandBuffer; }
+
+		/// <summary>
+		/// Searches all objects in the scene and returns one who's name
+		/// matches the one given, or nullptr if no object is found. If
+		/// multiple objects share a name, the first one in the scene is returned
 		/// </summary>
 		/// <param name="name">The name of the object to find</param>
 		GameObject::Sptr FindObjectByName(const std::string name);
 		/// <summary>
-		/// Searches all render objects in the scene and returns the first
-		/// one who's guid matches the one given, or nullptr if no object
-		/// is found
+		/// Searches all objects in the scene and returns the one who's guid
+		/// matches the one given, or nullptr if no object is found
 		/// </summary>
 		/// <param name="id">The guid of the object to find</param>
 		GameObject::Sptr FindObjectByGUID(Guid id);
@@ -124,37 +161,95 @@ namespace Gameplay {
 		/// Performs physics updates for all physics bodies in this scene,
 		/// should be called after Update in the main loop
 		/// 
+		/// With a fixed timestep (see SetPhysicsTimestep), this collects the results of the steps
+		/// that ran on the physics thread since the last call, sends any changes made on the main
+		/// thread to Bullet, moves dynamic objects to their interpolated transforms, then starts
+		/// the next batch of steps on the physics thread, which runs while we render. Rendered
+		/// objects trail the simulation by up to one step, so that we never extrapolate
+		/// 
 		/// Only invokes events if IsPlaying is true
 		/// </summary>
 		/// <param name="dt">The time in seconds since the last frame</param>
 		void DoPhysics(float dt);
 
+		/// <summary>
+		/// Sets how often the physics world is stepped. Above zero, the world is stepped at a fixed
+		/// rate on it's own thread, so the simulation does not depend on the frame rate. Zero steps
+		/// the world once per frame on the main thread
+		/// </summary>
+		/// <param name="seconds">The time between physics steps in seconds, or 0 to step once per frame</param>
+		void SetPhysicsTimestep(float seconds);
+		/// <summary>
+		/// Gets the time between physics steps in seconds, or 0 if the world is stepped once per frame
+		/// </summary>
+		float GetPhysicsTimestep() const;
+		/// <summary>
+		/// Waits for the physics thread to finish it's current batch of steps. This must be called
+		/// before touching Bullet objects from the main thread outside of Update and DoPhysics.
+		/// GetPhysicsWorld does this for you
+		/// </summary>
+		void SyncPhysics() const;
+		/// <summary>
+		/// Rebuilds the physics world with new settings. Bodies that are already in the world are
+		/// moved over to the new one, so this can be called at any time
+		/// </summary>
+		/// <param name="settings">The new settings for the physics world</param>
+		void SetPhysicsSettings(const Physics::PhysicsWorldSettings& settings);
+		/// <summary>
+		/// Gets the settings that the physics world was built with
+		/// </summary>
+		Physics::PhysicsWorldSettings GetPhysicsSettings() const;
+
 		/// <summary>
 		/// Performs updates on all enabled components and gameobjects in the
 		/// scene
 		/// 
+		/// If IsParallelUpdateEnabled is set, components are updated by type rather than by object.
+		/// Types are split into stages in the order they were registered, where each stage holds
+		/// types whose declared access does not conflict (see ComponentAccess). The components in
+		/// each stage are spread across the job system's threads, and types that must run on the
+		/// main thread get stages of their own
+		/// 
 		/// Only invokes events if IsPlaying is true
 		/// </summary>
 		/// <param name="dt">The time in seconds since the last frame</param>
 		void Update(float dt);
 
 		/// <summary>
-		/// Performs setup before rendering
+		/// Performs setup before rendering, updating all the world transforms that have changed,
+		/// binding the lighting UBO and sorting the lights into clusters for the main camera
 		/// </summary>
-		void PreRender();
+		/// <param name="viewportSize">The size of the viewport we are rendering to, in pixels</param>
+		void PreRender(const glm::ivec2& viewportSize);
+		/// <summary>
+		/// Renders any of the scene's shadow maps that are out of date, see ShadowMapping. Must be
+		/// called after PreRender and CullRenderables (which updates the culling tree), and before
+		/// drawing any lit objects. The viewport is restored, but the default framebuffer is bound afterwards
+		/// </summary>
+		void RenderShadows();
+		/// <summary>
+		/// Should be called once all lit objects for the frame have been drawn
+		/// </summary>
+		void PostRender();
 
 		/// <summary>
-		/// Handles setting the shader uniforms for our light structure in our array of lights
+		/// Copies a light into the lighting data that is sent to our shaders, should be called
+		/// whenever a light is changed (lights may be updated every frame)
 		/// </summary>
-		/// <param name="shader">The pointer to the shader</param>
-		/// <param name="uniformName">The name of the uniform (ex: u_Lights)</param>
 		/// <param name="index">The index of the light to set</param>
-		/// <param name="light">The light data to copy over</param>
-		void SetShaderLight(int index, bool update = true);
+		void SetShaderLight(int index);
 		/// <summary>
-		/// Creates the shader and sets up all the lights
+		/// Sets up the lighting UBO and copies all the lights, should be called when lights are added or removed
 		/// </summary>
 		void SetupShaderAndLights();
+		/// <summary>
+		/// Gets the statistics from the last time the lights were sorted into clusters
+		/// </summary>
+		const ClusteredLighting::Stats& GetLightingStats() const;
+		/// <summary>
+		/// Gets the scene's shadow maps, which can be used to change the shadow settings and get statistics
+		/// </summary>
+		const ShadowMapping::Sptr& GetShadowMapping() const { return _shadowMapping; }
 
 		/// <summary>
 		/// Draws ImGui stuff for all gameobjects in the scene
@@ -164,10 +259,38 @@ namespace Gameplay {
 		void DrawSkybox();
 
 		/// <summary>
-		/// Gets the scene's Bullet physics world
+		/// Collects all the enabled render components in this scene that may be visible with the given
+		/// view projection. Objects that have moved since the last call are updated in the culling tree,
+		/// and objects without bounds (ex: meshes that are still loading) are always considered visible
+		/// </summary>
+		/// <param name="viewProjection">The view projection matrix of the camera to cull against</param>
+		/// <param name="visible">The list to append the visible objects to</param>
+		void CullRenderables(const glm::mat4& viewProjection, std::vector<RenderComponent*>& visible);
+		/// <summary>
+		/// Gets the number of objects in the scene's culling tree
+		/// </summary>
+		int GetCullableCount() const;
+
+		/// <summary>
+		/// Gets the scene's Bullet physics world, waiting for the physics thread if it is running
 		/// </summary>
 		btDynamicsWorld* GetPhysicsWorld() const;
 
+		/// <summary>
+		/// Captures the state of the scene that may change during play mode (lights, object
+		/// transforms, and component state via IComponent::SaveSnapshot) into a snapshot. Note
+		/// that the scene's structure is not captured, objects are referenced and not copied
+		/// </summary>
+		/// <param name="snapshot">The snapshot to write to, any existing contents are replaced</param>
+		void SaveSnapshot(Snapshot& snapshot) const;
+		/// <summary>
+		/// Restores the scene to the state captured in a snapshot, in place. Objects that have been
+		/// created since the snapshot was taken are removed. This is much cheaper than re-loading
+		/// the scene, since the physics world, objects and components are all kept alive
+		/// </summary>
+		/// <param name="snapshot">The snapshot to restore, must have been taken from this scene</param>
+		void RestoreSnapshot(const Snapshot& snapshot);
+
 		/// <summary>
 		/// Loads a scene from a JSON blob
 		/// </summary>
@@ -183,17 +306,52 @@ namespace Gameplay {
 		/// <param name="path">The path of the file to write to</param>
 		void Save(const std::string& path);
 		/// <summary>
-		/// Loads a scene from an input JSON file
+		/// Saves this scene to a binary scene file, which is much faster to load
+		/// than the JSON representation. See ConvertJsonToBinary for the layout
+		/// </summary>
+		/// <param name="path">The path of the file to write to</param>
+		void SaveBinary(const std::string& path);
+		/// <summary>
+		/// Loads a scene from an input file, which may be either a JSON scene or
+		/// a binary scene (detected by the file's magic number)
 		/// </summary>
 		/// <param name="path">The path of the file to read from</param>
-		/// <returns>A new scene loaded from the file</returns>
+		/// <returns>A new scene loaded from the file, or nullptr if a binary scene could not be read</returns>
 		static Scene::Sptr Load(const std::string& path);
+		/// <summary>
+		/// Loads a scene from a binary scene file
+		/// </summary>
+		/// <param name="path">The path of the file to read from</param>
+		/// <returns>A new scene loaded from the file, or nullptr if the file could not be read</returns>
+		static Scene::Sptr LoadBinary(const std::string& path);
+
+		/// <summary>
+		/// Converts the JSON representation of a scene (as produced by ToJson) into a binary
+		/// scene file, without needing to load the scene or any of it's resources. This
+		/// lets us keep JSON as the authoring format, and ship the binary version
+		///
+		/// The file is a chunked file (see Utils/ChunkedFile.h) with the following chunks:
+		///    SCNE - Default material, ambient light, skybox, and main camera
+		///    LGHT - The scene's lights
+		///    GOBJ - Game object records, see GameObject::ToBinary
+		///    SUNL - The scene's directional light (optional)
+		/// </summary>
+		/// <param name="data">The JSON representation of the scene</param>
+		/// <param name="path">The path of the file to write to</param>
+		/// <returns>True if the file was written successfully</returns>
+		static bool ConvertJsonToBinary(const nlohmann::json& data, const std::string& path);
 
 
 		int NumObjects() const;
 		GameObject::Sptr GetObjectByIndex(int index) const;
 
 	protected:
+		// Allow game objects to notify us when they are renamed
+		friend class GameObject;
+		// Physics objects register themselves with us when they wake up
+		friend class Physics::RigidBody;
+		friend class Physics::TriggerVolume;
+
 		// Bullet physics stuff world
 		btDynamicsWorld*          _physicsWorld;
 		// Our bullet physics configuration
@@ -204,10 +362,27 @@ namespace Gameplay {
 		btBroadphaseInterface*    _broadphaseInterface;
 		// Resolves contraints (ex: hinge constraints, angle axis, etc...)
 		btConstraintSolver*       _constraintSolver;
-		// this is what allows us to get our pairs from the trigger volumes
-		btGhostPairCallback*      _ghostCallback;
 
 		BulletDebugDraw* _bulletDebugDraw;
+		// The settings that our physics world was built with
+		Physics::PhysicsWorldSettings _physicsSettings;
+
+		// The physics objects in this scene, each object stores it's index in the list
+		std::vector<Physics::RigidBody*>     _rigidBodies;
+		std::vector<Physics::TriggerVolume*> _triggerVolumes;
+
+		// Runs batches of fixed physics steps while the main thread renders
+		WorkerThread::Sptr _physicsThread;
+		// The time between fixed physics steps, or 0 to step once per frame
+		float              _physicsTimestep;
+		// Time that has passed but has not been simulated yet
+		float              _physicsAccumulator;
+		// The number of steps in the batch that was last started on the physics thread
+		int                _physicsBatchSteps;
+
+		// The most fixed steps we will run in a frame, any more time than this is dropped so
+		// that a slow frame can't make the next frame even slower
+		inline static const int MAX_PHYSICS_STEPS_PER_FRAME = 8;
 
 		// The path that we've saved or loaded this scene from
 		std::string             _filePath;
@@ -219,6 +394,18 @@ namespace Gameplay {
 		std::vector<GameObject::Sptr>  _objects;
 		std::vector<std::weak_ptr<GameObject>>  _deletionQueue;
 
+		// Hash indices for fast object lookups, kept in sync with _objects
+		std::unordered_map<Guid, GameObject::Sptr>             _objectsByGuid;
+		std::unordered_multimap<std::string, GameObject::Sptr> _objectsByName;
+		// The next GameObject::_sceneOrder to hand out, so duplicate names resolve in scene order
+		uint32_t                                               _nextObjectOrder;
+
+		// World transforms for all our objects, sorted by depth in the hierarchy
+		TransformHierarchy::Sptr _transforms;
+
+		// Dynamic tree of render component bounds, used for frustum culling
+		BoundingVolumeHierarchy::Sptr _cullingTree;
+
 		// Info for rendering our skybox will be stored in the scene itself
 		std::shared_ptr<Shader>       _skyboxShader;
 		std::shared_ptr<MeshResource> _skyboxMesh;
@@ -233,33 +420,68 @@ namespace Gameplay {
 		/// thing for packing structures to sizeof(vec4)
 		/// </summary>
 		struct LightingUboStruct {
-			struct Light {
-				// This lets us continue to access Position as a vec3, but also allocates space for the
-				// pack at the end (since objects are vec4 aligned)
-				union {
-					glm::vec3 Position;
-					glm::vec4 Position4;
-				};
-				// Since these are tightly packed, will match the vec4 in light
-				glm::vec3 Color;
-				float     Attenuation;
-			};
-
 			// Since these are tightly packed, will match the vec4 in the UBO
 			glm::vec3 AmbientCol;
 			float     NumLights;
 
-			Light     Lights[MAX_LIGHTS];
 			// NOTE: our shaders expect a mat3, but due to the STD140 layout, each column of the
-			// vec3 needs to be padded to the size of a vec4, hence the use of a mat4 here
-			glm::mat4 EnvironmentRotation;
+			// vec3 needs to be padded to the size of a vec4, hence the use of a mat3x4 here
+			glm::mat3x4 EnvironmentRotation;
+
+			// The direction the sun's light travels in xyz, and it's color in rgb
+			glm::vec4 SunDirection;
+			glm::vec4 SunColor;
+
+			// The cascades and shadow settings, see ShadowMapping
+			ShadowMapping::ShadowUniforms Shadows;
 		};
 		UniformBuffer<LightingUboStruct>::Sptr _lightingUbo;
+		// The lights themselves are stored in an SSBO, and sorted into clusters every frame
+		ClusteredLighting::Sptr                _clusteredLighting;
+		// Shadow maps for the sun and point lights
+		ShadowMapping::Sptr                    _shadowMapping;
 
 		bool                       _isAwake;
 
 		/// <summary>
-		/// Handles configuring our bullet physics stuff
+		/// A group of component types that are updated together, see Update
+		/// </summary>
+		struct UpdateStage {
+			std::vector<std::type_index> Types;
+			// The combined access of all the types in the stage
+			ComponentAccess              Access;
+		};
+		std::vector<UpdateStage>   _updateStages;
+		// The number of registered component types when the stages were built
+		size_t                     _updateStageTypeCount;
+
+		// Structural changes recorded during a parallel update
+		SceneCommandBuffer         _commandBuffer;
+		// True while worker threads are updating components
+		bool                       _isUpdatingInParallel;
+
+		// The number of components in each job when updating in parallel
+		inline static const size_t PARALLEL_UPDATE_BATCH_SIZE = 64;
+
+		/// <summary>
+		/// Updates all our components by type, spreading the work across the job system
+		/// </summary>
+		void _UpdateParallel(float dt);
+		/// <summary>
+		/// Groups all the registered component types into update stages
+		/// </summary>
+		void _BuildUpdateStages();
+		/// <summary>
+		/// Checks if a component is the first of it's type on it's gameobject. Loaded objects may have
+		/// more than one component of a type, and those would race on the object if they were updated
+		/// on different workers, so only the first one is updated in parallel
+		/// </summary>
+		/// <param name="component">The component to check</param>
+		/// <param name="type">The type of the component</param>
+		static bool _IsFirstOfType(const IComponent* component, const std::type_index& type);
+
+		/// <summary>
+		/// Handles configuring our bullet physics stuff, based on _physicsSettings
 		/// </summary>
 		void _InitPhysics();
 		/// <summary>
@@ -267,6 +489,54 @@ namespace Gameplay {
 		/// </summary>
 		void _CleanupPhysics();
 
+		/// <summary>
+		/// Invoked by Bullet after every internal step, on whichever thread is stepping the world
+		/// </summary>
+		static void _OnPhysicsTick(btDynamicsWorld* world, btScalar timeStep);
+
+		/// <summary>
+		/// Finds everything touching our trigger volumes from the world's contact manifolds,
+		/// then sends out enter and exit events. Must be called after the world has been stepped
+		/// </summary>
+		void _ProcessTriggers(float dt);
+
+		/// <summary>
+		/// Adds or removes physics objects from our lists, these wait for the physics thread first
+		/// </summary>
+		void _RegisterPhysics(Physics::RigidBody* body);
+		void _RegisterPhysics(Physics::TriggerVolume* trigger);
+		void _UnregisterPhysics(Physics::RigidBody* body);
+		void _UnregisterPhysics(Physics::TriggerVolume* trigger);
+		template <typename T>
+		void _AddToPhysicsList(std::vector<T*>& list, T* object);
+		template <typename T>
+		void _RemoveFromPhysicsList(std::vector<T*>& list, T* object);
+
 		void _FlushDeleteQueue();
+
+		// Chunk IDs and versions for binary scene files
+		inline static const uint32_t BINARY_SCENE_VERSION   = 1;
+		inline static const uint32_t BINARY_LIGHTS_VERSION  = 2;
+		inline static const uint32_t BINARY_OBJECTS_VERSION = 1;
+		inline static const uint32_t BINARY_HIERARCHY_VERSION = 1;
+		inline static const uint32_t BINARY_PHYSICS_VERSION   = 1;
+		inline static const uint32_t BINARY_SUN_VERSION       = 1;
+
+		/// <summary>
+		/// Adds an object to the scene's object list and lookup indices
+		/// </summary>
+		void _AddObject(const GameObject::Sptr& object);
+		/// <summary>
+		/// Removes an object from the scene's lookup indices
+		/// </summary>
+		void _RemoveObjectFromIndices(GameObject* object);
+		/// <summary>
+		/// Attaches an object to it's parent when loading, logging a warning if either is missing
+		/// </summary>
+		void _LinkParent(Guid child, Guid parent);
+		/// <summary>
+		/// Invoked by GameObject::SetName to keep the name index up to date
+		/// </summary>
+		void _OnObjectRenamed(GameObject* object, const std::string& oldName);
 	};
 }
\ No newline at end of file
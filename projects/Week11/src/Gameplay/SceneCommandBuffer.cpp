@@ -0,0 +1,58 @@
+#include "Gameplay/SceneCommandBuffer.h"
+
+#include "Gameplay/Scene.h"
+#include "Gameplay/GameObject.h"
+
+namespace Gameplay {
+	SceneCommandBuffer::SceneCommandBuffer() :
+		_mutex(),
+		_commands(),
+		_executing()
+	{ }
+
+	void SceneCommandBuffer::Push(Command&& command) {
+		std::lock_guard<std::mutex> lock(_mutex);
+		_commands.push_back(std::move(command));
+	}
+
+	void SceneCommandBuffer::CreateGameObject(const std::string& name, std::function<void(const GameObject::Sptr&)>&& setup) {
+		Push([name, setup = std::move(setup)](Scene& scene) {
+			GameObject::Sptr object = scene.CreateGameObject(name);
+			if (setup) {
+				setup(object);
+			}
+		});
+	}
+
+	void SceneCommandBuffer::RemoveGameObject(const GameObject::Sptr& object) {
+		// We don't want to keep the object alive just because it's waiting to be removed
+		std::weak_ptr<GameObject> weakObject = object;
+		Push([weakObject](Scene& scene) {
+			GameObject::Sptr object = weakObject.lock();
+			if (object != nullptr) {
+				scene.RemoveGameObject(object);
+			}
+		});
+	}
+
+	void SceneCommandBuffer::Execute(Scene& scene) {
+		while (true) {
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				if (_commands.empty()) {
+					return;
+				}
+				std::swap(_commands, _executing);
+			}
+			for (Command& command : _executing) {
+				command(scene);
+			}
+			_executing.clear();
+		}
+	}
+
+	bool SceneCommandBuffer::IsEmpty() {
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _commands.empty();
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <memory>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Gameplay {
+	class Scene;
+	struct GameObject;
+
+	/// <summary>
+	/// Records changes to the structure of a scene (creating and removing objects,
+	/// adding components, etc...) so that they can be made from worker threads during
+	/// a parallel update. Commands are recorded from any thread, and are executed on the
+	/// main thread in the order they were recorded once the update has finished
+	/// </summary>
+	class SceneCommandBuffer {
+	public:
+		typedef std::function<void(Scene& scene)> Command;
+
+		SceneCommandBuffer();
+		~SceneCommandBuffer() = default;
+
+		SceneCommandBuffer(const SceneCommandBuffer& other) = delete;
+		SceneCommandBuffer(SceneCommandBuffer&& other) = delete;
+		SceneCommandBuffer& operator=(const SceneCommandBuffer& other) = delete;
+		SceneCommandBuffer& operator=(SceneCommandBuffer&& other) = delete;
+
+		/// <summary>
+		/// Records a command to run on the main thread, the command may do anything
+		/// </summary>
+		void Push(Command&& command);
+
+		/// <summary>
+		/// Records the creation of a new game object
+		/// </summary>
+		/// <param name="name">The name of the object to create</param>
+		/// <param name="setup">An optional callback to set up the object (add components, etc...) once it has been created</param>
+		void CreateGameObject(const std::string& name, std::function<void(const std::shared_ptr<GameObject>&)>&& setup = nullptr);
+		/// <summary>
+		/// Records the removal of a game object
+		/// </summary>
+		/// <param name="object">The object to remove, if it has already been removed this does nothing</param>
+		void RemoveGameObject(const std::shared_ptr<GameObject>& object);
+
+		/// <summary>
+		/// Runs all the recorded commands and clears the buffer. Commands may record more
+		/// commands, which are run in the same call. Must be called on the main thread
+		/// </summary>
+		void Execute(Scene& scene);
+
+		/// <summary>
+		/// Returns true if there are no commands waiting to be executed
+		/// </summary>
+		bool IsEmpty();
+
+	protected:
+		std::mutex           _mutex;
+		std::vector<Command> _commands;
+		// Swapped with _commands when executing, so we can run commands without holding the lock
+		std::vector<Command> _executing;
+	};
+}
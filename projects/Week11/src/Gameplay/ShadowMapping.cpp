@@ -0,0 +1,489 @@
+#include "Gameplay/ShadowMapping.h"
+
+#include <cmath>
+#include <algorithm>
+#include <GLM/gtc/matrix_transform.hpp>
+#include <GLM/gtc/constants.hpp>
+#include <Logging.h>
+
+#include "Gameplay/GameObject.h"
+#include "Gameplay/Components/RenderComponent.h"
+#include "Utils/Profiler.h"
+
+namespace Gameplay {
+	// Only enabled objects that would actually be drawn cast shadows
+	static bool IsShadowCaster(const RenderComponent* renderable) {
+		return renderable->IsEnabled && renderable->GetMesh() != nullptr && renderable->GetMaterial() != nullptr;
+	}
+
+	// Scrambles the bits of a value, so that hashes can be combined by adding them
+	static uint64_t MixBits(uint64_t value) {
+		value ^= value >> 30;
+		value *= 0xbf58476d1ce4e5b9ull;
+		value ^= value >> 27;
+		value *= 0x94d049bb133111ebull;
+		value ^= value >> 31;
+		return value;
+	}
+
+	ShadowMapping::ShadowMapping() :
+		_cascadeTexture(0),
+		_cascadeCacheTexture(0),
+		_pointShadowTexture(0),
+		_framebuffer(0),
+		_depthShader(nullptr),
+		_queue(nullptr),
+		_cascades(),
+		_lightView(1.0f),
+		_sunDirection(0.0f),
+		_hasSunShadows(false),
+		_shadowDistance(DEFAULT_SHADOW_DISTANCE),
+		_pointShadows(),
+		_lightLayers(),
+		_faceBudget(DEFAULT_FACE_BUDGET),
+		_uniforms(),
+		_stats({ 0, 0, 0, 0, 0, 0 }),
+		_frame(0),
+		_staticCasters(),
+		_dynamicCasters(),
+		_lightCandidates(),
+		_pendingFaces()
+	{
+		_cascadeTexture      = __CreateDepthTexture(GL_TEXTURE_2D_ARRAY, CASCADE_RESOLUTION, CASCADE_COUNT, true);
+		_cascadeCacheTexture = __CreateDepthTexture(GL_TEXTURE_2D_ARRAY, CASCADE_RESOLUTION, CASCADE_COUNT, false);
+		_pointShadowTexture  = __CreateDepthTexture(GL_TEXTURE_CUBE_MAP_ARRAY, POINT_SHADOW_RESOLUTION, MAX_POINT_SHADOWS * 6, true);
+
+		// Shadow maps only have depth, so we don't draw or read any colors
+		glCreateFramebuffers(1, &_framebuffer);
+		glNamedFramebufferDrawBuffer(_framebuffer, GL_NONE);
+		glNamedFramebufferReadBuffer(_framebuffer, GL_NONE);
+
+		_depthShader = std::make_shared<Shader>(std::unordered_map<ShaderPartType, std::string>{
+			{ ShaderPartType::Vertex, "shaders/vertex_shaders/shadow_depth_vert.glsl" },
+			{ ShaderPartType::Fragment, "shaders/fragment_shaders/shadow_depth_frag.glsl" }
+		});
+		_queue = RenderQueue::Create();
+
+		for (PointShadow& shadow : _pointShadows) {
+			shadow.LightIndex = -1;
+		}
+		Invalidate();
+	}
+
+	ShadowMapping::~ShadowMapping() {
+		glDeleteFramebuffers(1, &_framebuffer);
+		glDeleteTextures(1, &_cascadeTexture);
+		glDeleteTextures(1, &_cascadeCacheTexture);
+		glDeleteTextures(1, &_pointShadowTexture);
+	}
+
+	void ShadowMapping::Prepare(const DirectionalLight& sun, const std::vector<Light>& lights, const glm::mat4& view, const glm::mat4& projection) {
+		PROFILE_SCOPE("ShadowMapping::Prepare");
+
+		// Changing the sun's direction moves every texel of every cascade
+		glm::vec3 direction = glm::length(sun.Direction) > 0.0f ? glm::normalize(sun.Direction) : glm::vec3(0.0f, 0.0f, -1.0f);
+		if (direction != _sunDirection) {
+			_sunDirection = direction;
+			glm::vec3 up = std::abs(direction.z) > 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(0.0f, 0.0f, 1.0f);
+			_lightView = glm::lookAt(glm::vec3(0.0f), direction, up);
+			for (Cascade& cascade : _cascades) {
+				cascade.Radius = -1.0f;
+			}
+		}
+
+		_hasSunShadows = sun.CastShadows && glm::dot(sun.Color, sun.Color) > 0.0f;
+		if (_hasSunShadows) {
+			_FitCascades(view, projection);
+		}
+
+		glm::vec3 cameraPos = glm::vec3(glm::inverse(view)[3]);
+		_AssignPointShadows(lights, cameraPos);
+
+		_uniforms.Params = glm::vec4(
+			1.0f / CASCADE_RESOLUTION,
+			POINT_SHADOW_NEAR_PLANE,
+			1.0f / POINT_SHADOW_RESOLUTION,
+			_hasSunShadows ? static_cast<float>(CASCADE_COUNT) : 0.0f
+		);
+	}
+
+	void ShadowMapping::_FitCascades(const glm::mat4& view, const glm::mat4& projection) {
+		// Find the corners of the camera's frustum in view space, so this works for orthographic cameras too
+		static const glm::vec2 ndcCorners[4] = { { -1.0f, -1.0f }, { 1.0f, -1.0f }, { 1.0f, 1.0f }, { -1.0f, 1.0f } };
+		glm::mat4 inverseProjection = glm::inverse(projection);
+		glm::vec3 nearCorners[4];
+		glm::vec3 farCorners[4];
+		for (int ix = 0; ix < 4; ix++) {
+			glm::vec4 nearCorner = inverseProjection * glm::vec4(ndcCorners[ix], -1.0f, 1.0f);
+			glm::vec4 farCorner  = inverseProjection * glm::vec4(ndcCorners[ix],  1.0f, 1.0f);
+			nearCorners[ix] = glm::vec3(nearCorner) / nearCorner.w;
+			farCorners[ix]  = glm::vec3(farCorner) / farCorner.w;
+		}
+
+		// Logarithmic splits need a near plane in front of the camera
+		float nearDepth = std::max(-nearCorners[0].z, 0.01f);
+		float farDepth  = std::max(std::min(-farCorners[0].z, _shadowDistance), nearDepth * 1.01f);
+
+		glm::mat4 viewToLight = _lightView * glm::inverse(view);
+		float splitNear = nearDepth;
+		for (int cascadeIx = 0; cascadeIx < CASCADE_COUNT; cascadeIx++) {
+			// Practical split scheme, blending uniform and logarithmic splits
+			float t = static_cast<float>(cascadeIx + 1) / CASCADE_COUNT;
+			float uniformSplit = nearDepth + (farDepth - nearDepth) * t;
+			float logSplit = nearDepth * std::pow(farDepth / nearDepth, t);
+			float splitFar = glm::mix(uniformSplit, logSplit, CASCADE_SPLIT_LAMBDA);
+
+			// Get the corners of our slice of the frustum, view depth is linear along the frustum's edges
+			glm::vec3 corners[8];
+			glm::vec3 center = glm::vec3(0.0f);
+			for (int ix = 0; ix < 4; ix++) {
+				float edgeNear = -nearCorners[ix].z;
+				float edgeLength = -farCorners[ix].z - edgeNear;
+				corners[ix]     = glm::mix(nearCorners[ix], farCorners[ix], (splitNear - edgeNear) / edgeLength);
+				corners[ix + 4] = glm::mix(nearCorners[ix], farCorners[ix], (splitFar - edgeNear) / edgeLength);
+				center += corners[ix] + corners[ix + 4];
+			}
+			center /= 8.0f;
+
+			// A sphere around the slice doesn't change size as the camera turns, which keeps the texel
+			// size constant. We round the radius up so that float noise can't change it either
+			float radius = 0.0f;
+			for (const glm::vec3& corner : corners) {
+				radius = std::max(radius, glm::length(corner - center));
+			}
+			radius = std::ceil(radius * 16.0f) / 16.0f;
+
+			// Only move the cascade if the slice has left it's area, so that the cached casters stay valid
+			Cascade& cascade = _cascades[cascadeIx];
+			glm::vec3 lightCenter = glm::vec3(viewToLight * glm::vec4(center, 1.0f));
+			glm::vec3 offset = glm::abs(lightCenter - cascade.Center) + radius;
+			if (radius != cascade.Radius || offset.x > cascade.HalfSize || offset.y > cascade.HalfSize || offset.z > cascade.HalfSize) {
+				cascade.Radius = radius;
+				cascade.HalfSize = radius * (1.0f + CASCADE_MARGIN);
+
+				// Snapping to the texel grid stops the shadow edges from crawling when the cascade moves
+				float texelSize = 2.0f * cascade.HalfSize / CASCADE_RESOLUTION;
+				cascade.Center = glm::vec3(
+					std::floor(lightCenter.x / texelSize) * texelSize,
+					std::floor(lightCenter.y / texelSize) * texelSize,
+					lightCenter.z
+				);
+
+				// Light space looks down -Z, so the near and far planes are the negated Z coordinates
+				float left   = cascade.Center.x - cascade.HalfSize;
+				float right  = cascade.Center.x + cascade.HalfSize;
+				float bottom = cascade.Center.y - cascade.HalfSize;
+				float top    = cascade.Center.y + cascade.HalfSize;
+				float zNear  = -cascade.Center.z - cascade.HalfSize;
+				float zFar   = -cascade.Center.z + cascade.HalfSize;
+				cascade.ViewProjection = glm::ortho(left, right, bottom, top, zNear, zFar) * _lightView;
+				// Casters between the sun and the cascade still need to be drawn
+				cascade.CasterFrustum = Frustum(glm::ortho(left, right, bottom, top, zNear - CASTER_DISTANCE, zFar) * _lightView);
+				cascade.IsCacheValid = false;
+			}
+
+			_uniforms.CascadeViewProjections[cascadeIx] = cascade.ViewProjection;
+			_uniforms.CascadeSplits[cascadeIx] = splitFar;
+			_uniforms.CascadeTexelSizes[cascadeIx] = 2.0f * cascade.HalfSize / CASCADE_RESOLUTION;
+
+			splitNear = splitFar;
+		}
+	}
+
+	void ShadowMapping::_AssignPointShadows(const std::vector<Light>& lights, const glm::vec3& cameraPos) {
+		// Lights that can reach the camera first, then by how close they come to it
+		_lightCandidates.clear();
+		for (int ix = 0; ix < static_cast<int>(lights.size()); ix++) {
+			const Light& light = lights[ix];
+			if (!light.CastShadows || light.Range <= POINT_SHADOW_NEAR_PLANE || glm::dot(light.Color, light.Color) <= 0.0f) {
+				continue;
+			}
+			float distance = std::max(glm::length(light.Position - cameraPos) - light.Range, 0.0f);
+			_lightCandidates.push_back({ distance, ix });
+		}
+		std::sort(_lightCandidates.begin(), _lightCandidates.end());
+		if (_lightCandidates.size() > MAX_POINT_SHADOWS) {
+			_lightCandidates.resize(MAX_POINT_SHADOWS);
+		}
+
+		// Lights that were picked last frame keep their layers, so their cubes don't need to be re-rendered
+		_lightLayers.assign(lights.size(), -1);
+		for (int layer = 0; layer < MAX_POINT_SHADOWS; layer++) {
+			PointShadow& shadow = _pointShadows[layer];
+			auto it = std::find_if(_lightCandidates.begin(), _lightCandidates.end(), [&](const std::pair<float, int>& candidate) {
+				return candidate.second == shadow.LightIndex;
+			});
+			if (it != _lightCandidates.end()) {
+				_lightLayers[shadow.LightIndex] = layer;
+			} else {
+				shadow.LightIndex = -1;
+			}
+		}
+
+		// New lights take the free layers
+		int freeLayer = 0;
+		for (const auto& [distance, lightIx] : _lightCandidates) {
+			if (_lightLayers[lightIx] >= 0) {
+				continue;
+			}
+			while (_pointShadows[freeLayer].LightIndex >= 0) {
+				freeLayer++;
+			}
+			PointShadow& shadow = _pointShadows[freeLayer];
+			shadow.LightIndex = lightIx;
+			shadow.Range = -1.0f;
+			for (int face = 0; face < 6; face++) {
+				shadow.FaceRenderedFrame[face] = 0;
+			}
+			_lightLayers[lightIx] = freeLayer;
+		}
+
+		// Any light that has moved or changed range needs all of it's faces re-rendered
+		_stats.PointLights = 0;
+		for (PointShadow& shadow : _pointShadows) {
+			if (shadow.LightIndex < 0) {
+				continue;
+			}
+			_stats.PointLights++;
+			const Light& light = lights[shadow.LightIndex];
+			if (light.Position != shadow.Position || light.Range != shadow.Range) {
+				shadow.Position = light.Position;
+				shadow.Range = light.Range;
+				for (int face = 0; face < 6; face++) {
+					shadow.IsFaceDirty[face] = true;
+				}
+			}
+		}
+	}
+
+	void ShadowMapping::Render(const BoundingVolumeHierarchy::Sptr& tree) {
+		PROFILE_GPU_SCOPE("ShadowMapping::Render");
+		_frame++;
+		_stats.CascadesCached = 0;
+		_stats.CascadesUpdated = 0;
+		_stats.FacesRendered = 0;
+		_stats.FacesPending = 0;
+		_stats.CastersDrawn = 0;
+
+		// Nothing is drawn until the shader is ready, so the caches stay invalid until then
+		if (_depthShader == nullptr || !_depthShader->IsReady()) {
+			return;
+		}
+
+		GLint viewport[4];
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+
+		// We draw both sides of every caster so that open meshes (ex: planes) still cast
+		// shadows, and offset the depth by the slope to help with shadow acne
+		glDisable(GL_CULL_FACE);
+		glEnable(GL_POLYGON_OFFSET_FILL);
+		glPolygonOffset(2.0f, 2.0f);
+
+		_RenderCascades(tree);
+		_RenderPointShadows(tree);
+
+		glPolygonOffset(0.0f, 0.0f);
+		glDisable(GL_POLYGON_OFFSET_FILL);
+		glEnable(GL_CULL_FACE);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+	}
+
+	void ShadowMapping::_RenderCascades(const BoundingVolumeHierarchy::Sptr& tree) {
+		if (!_hasSunShadows) {
+			return;
+		}
+
+		// Casters in front of the near plane get flattened onto it instead of being clipped
+		glEnable(GL_DEPTH_CLAMP);
+
+		for (int cascadeIx = 0; cascadeIx < CASCADE_COUNT; cascadeIx++) {
+			Cascade& cascade = _cascades[cascadeIx];
+
+			_staticCasters.clear();
+			_dynamicCasters.clear();
+			tree->Query(cascade.CasterFrustum, [&](void* userData) {
+				RenderComponent* caster = static_cast<RenderComponent*>(userData);
+				if (IsShadowCaster(caster)) {
+					(caster->IsStatic() ? _staticCasters : _dynamicCasters).push_back(caster);
+				}
+			});
+
+			// Rebuild the cache when the cascade moves, or objects become (or stop being) static
+			uint64_t staticHash = __HashCasters(_staticCasters, false);
+			if (!cascade.IsCacheValid || staticHash != cascade.StaticHash) {
+				_BindTarget(_cascadeCacheTexture, cascadeIx, CASCADE_RESOLUTION, true);
+				_DrawCasters(_staticCasters, cascade.ViewProjection);
+				cascade.StaticHash = staticHash;
+				cascade.IsCacheValid = true;
+				cascade.IsCacheCurrent = false;
+				_stats.CascadesCached++;
+			}
+
+			// Start from the cached static casters, then draw the dynamic ones on top. If there's
+			// nothing dynamic and the cascade already matches the cache, we don't need to do anything
+			if (!_dynamicCasters.empty() || !cascade.IsCacheCurrent) {
+				glCopyImageSubData(
+					_cascadeCacheTexture, GL_TEXTURE_2D_ARRAY, 0, 0, 0, cascadeIx,
+					_cascadeTexture,      GL_TEXTURE_2D_ARRAY, 0, 0, 0, cascadeIx,
+					CASCADE_RESOLUTION, CASCADE_RESOLUTION, 1
+				);
+				_BindTarget(_cascadeTexture, cascadeIx, CASCADE_RESOLUTION, false);
+				_DrawCasters(_dynamicCasters, cascade.ViewProjection);
+				cascade.IsCacheCurrent = _dynamicCasters.empty();
+				_stats.CascadesUpdated++;
+			}
+		}
+
+		glDisable(GL_DEPTH_CLAMP);
+	}
+
+	void ShadowMapping::_RenderPointShadows(const BoundingVolumeHierarchy::Sptr& tree) {
+		// Find every face that has had casters move, appear or disappear since we last checked
+		_pendingFaces.clear();
+		for (int layer = 0; layer < MAX_POINT_SHADOWS; layer++) {
+			PointShadow& shadow = _pointShadows[layer];
+			if (shadow.LightIndex < 0) {
+				continue;
+			}
+			for (int face = 0; face < 6; face++) {
+				_CollectFaceCasters(tree, shadow, Frustum(__GetFaceViewProjection(shadow.Position, shadow.Range, face)), _dynamicCasters);
+				uint64_t hash = __HashCasters(_dynamicCasters, true);
+				if (hash != shadow.FaceHashes[face]) {
+					shadow.FaceHashes[face] = hash;
+					shadow.IsFaceDirty[face] = true;
+				}
+				if (shadow.IsFaceDirty[face]) {
+					_pendingFaces.push_back({ layer, face, shadow.FaceRenderedFrame[face] });
+				}
+			}
+		}
+
+		// Render the faces that have been waiting the longest first, so that no light is starved
+		std::sort(_pendingFaces.begin(), _pendingFaces.end(), [](const PendingFace& a, const PendingFace& b) {
+			return a.RenderedFrame < b.RenderedFrame;
+		});
+		size_t faceCount = std::min(_pendingFaces.size(), static_cast<size_t>(std::max(_faceBudget, 0)));
+		for (size_t ix = 0; ix < faceCount; ix++) {
+			const PendingFace& pending = _pendingFaces[ix];
+			PointShadow& shadow = _pointShadows[pending.Layer];
+
+			glm::mat4 viewProjection = __GetFaceViewProjection(shadow.Position, shadow.Range, pending.Face);
+			_CollectFaceCasters(tree, shadow, Frustum(viewProjection), _dynamicCasters);
+			_BindTarget(_pointShadowTexture, pending.Layer * 6 + pending.Face, POINT_SHADOW_RESOLUTION, true);
+			_DrawCasters(_dynamicCasters, viewProjection);
+
+			shadow.IsFaceDirty[pending.Face] = false;
+			shadow.FaceRenderedFrame[pending.Face] = _frame;
+			_stats.FacesRendered++;
+		}
+		_stats.FacesPending = static_cast<uint32_t>(_pendingFaces.size() - faceCount);
+	}
+
+	void ShadowMapping::_CollectFaceCasters(const BoundingVolumeHierarchy::Sptr& tree, const PointShadow& shadow, const Frustum& frustum, std::vector<RenderComponent*>& casters) {
+		casters.clear();
+		BoundingBox range(shadow.Position - glm::vec3(shadow.Range), shadow.Position + glm::vec3(shadow.Range));
+		tree->Query(range, [&](void* userData) {
+			RenderComponent* caster = static_cast<RenderComponent*>(userData);
+			if (IsShadowCaster(caster) && frustum.Intersects(caster->GetWorldBounds())) {
+				casters.push_back(caster);
+			}
+		});
+	}
+
+	void ShadowMapping::_BindTarget(GLuint texture, int layer, int resolution, bool clear) {
+		glNamedFramebufferTextureLayer(_framebuffer, GL_DEPTH_ATTACHMENT, texture, 0, layer);
+		glViewport(0, 0, resolution, resolution);
+		if (clear) {
+			float depth = 1.0f;
+			glClearNamedFramebufferfv(_framebuffer, GL_DEPTH, 0, &depth);
+		}
+	}
+
+	void ShadowMapping::_DrawCasters(const std::vector<RenderComponent*>& casters, const glm::mat4& viewProjection) {
+		for (RenderComponent* caster : casters) {
+			_queue->Submit(caster->GetMaterial(), caster->GetMesh(), caster->GetGameObject()->GetTransform());
+		}
+		_queue->FlushDepth(viewProjection, _depthShader);
+		_stats.CastersDrawn += static_cast<uint32_t>(casters.size());
+	}
+
+	void ShadowMapping::Bind() const {
+		glBindTextureUnit(CASCADE_TEXTURE_SLOT, _cascadeTexture);
+		glBindTextureUnit(POINT_SHADOW_TEXTURE_SLOT, _pointShadowTexture);
+	}
+
+	void ShadowMapping::EndFrame() {
+		_queue->EndFrame();
+	}
+
+	void ShadowMapping::Invalidate() {
+		for (Cascade& cascade : _cascades) {
+			cascade.Radius = -1.0f;
+			cascade.IsCacheValid = false;
+			cascade.IsCacheCurrent = false;
+		}
+		for (PointShadow& shadow : _pointShadows) {
+			for (int face = 0; face < 6; face++) {
+				shadow.IsFaceDirty[face] = true;
+			}
+		}
+	}
+
+	int ShadowMapping::GetShadowLayer(size_t lightIndex) const {
+		return lightIndex < _lightLayers.size() ? _lightLayers[lightIndex] : -1;
+	}
+
+	glm::mat4 ShadowMapping::__GetFaceViewProjection(const glm::vec3& position, float range, int face) {
+		// These follow the orientation of OpenGL's cube map faces, so the shadow cube can be sampled with the direction from the light
+		static const glm::vec3 directions[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+		static const glm::vec3 ups[6]        = { { 0, -1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 }, { 0, -1, 0 }, { 0, -1, 0 } };
+		glm::mat4 projection = glm::perspective(glm::half_pi<float>(), 1.0f, POINT_SHADOW_NEAR_PLANE, range);
+		return projection * glm::lookAt(position, position + directions[face], ups[face]);
+	}
+
+	uint64_t ShadowMapping::__HashCasters(const std::vector<RenderComponent*>& casters, bool includeTransforms) {
+		// Adding the hashes together means the order the tree gives us the casters in doesn't matter
+		uint64_t result = 0;
+		for (const RenderComponent* caster : casters) {
+			uint64_t hash = MixBits(reinterpret_cast<uintptr_t>(caster)) ^ MixBits(reinterpret_cast<uintptr_t>(caster->GetMesh().get()) + 1);
+			if (includeTransforms) {
+				hash = MixBits(hash + caster->GetGameObject()->GetTransformVersion());
+			}
+			result += hash;
+		}
+		return result;
+	}
+
+	GLuint ShadowMapping::__CreateDepthTexture(GLenum type, int resolution, int layers, bool isCompared) {
+		GLuint handle = 0;
+		glCreateTextures(type, 1, &handle);
+		glTextureStorage3D(handle, 1, GL_DEPTH_COMPONENT32F, resolution, resolution, layers);
+		glTextureParameteri(handle, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTextureParameteri(handle, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		if (type == GL_TEXTURE_2D_ARRAY) {
+			// Anything outside of a cascade is lit
+			float border[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+			glTextureParameteri(handle, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+			glTextureParameteri(handle, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+			glTextureParameterfv(handle, GL_TEXTURE_BORDER_COLOR, border);
+		} else {
+			glTextureParameteri(handle, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTextureParameteri(handle, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		}
+
+		// Compared textures give us hardware filtered shadow tests with sampler*Shadow
+		if (isCompared) {
+			glTextureParameteri(handle, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+			glTextureParameteri(handle, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+		}
+
+		// Nothing is shadowed until the shadow maps have been rendered
+		float depth = 1.0f;
+		glClearTexImage(handle, 0, GL_DEPTH_COMPONENT, GL_FLOAT, &depth);
+		return handle;
+	}
+}
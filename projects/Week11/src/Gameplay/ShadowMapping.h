@@ -0,0 +1,295 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <GLM/glm.hpp>
+#include <glad/glad.h>
+
+#include "Gameplay/Light.h"
+#include "Gameplay/RenderQueue.h"
+#include "Graphics/Shader.h"
+#include "Utils/Bounds.h"
+#include "Utils/BoundingVolumeHierarchy.h"
+
+class RenderComponent;
+
+namespace Gameplay {
+	/// <summary>
+	/// Renders and caches the shadow maps for the scene's lights
+	///
+	/// The sun gets cascaded shadow maps. The camera's view is split into CASCADE_COUNT slices,
+	/// and each slice is covered by an orthographic shadow map that is fit around a sphere, snapped
+	/// to it's texels and padded by CASCADE_MARGIN. A cascade only moves when the camera's slice
+	/// leaves the padded area, so the shadow map stays put for most frames. Static casters (see
+	/// RenderComponent::IsStatic) are rendered into a cache that is only rebuilt when the cascade
+	/// moves or the static casters it covers change, and each frame the cache is copied into the
+	/// cascade and only the dynamic casters are drawn on top
+	///
+	/// Point lights that cast shadows get a layer in a cube map array, up to MAX_POINT_SHADOWS
+	/// lights closest to the camera. Each cube face tracks the casters inside it, and is only
+	/// re-rendered when the light moves or one of those casters moves, appears or disappears.
+	/// Only a limited number of faces are rendered each frame (see SetFaceBudget), the faces that
+	/// have waited the longest go first, so the cost of shadows doesn't grow with the number of lights
+	///
+	/// Casters are found with the scene's culling tree, shaders sample the results via
+	/// fragments/multiple_point_lights.glsl
+	/// </summary>
+	class ShadowMapping {
+	public:
+		typedef std::shared_ptr<ShadowMapping> Sptr;
+
+		// The number of cascades for the sun, must match fragments/multiple_point_lights.glsl
+		inline static const int   CASCADE_COUNT = 4;
+		// The width and height of each cascade's shadow map in texels
+		inline static const int   CASCADE_RESOLUTION = 2048;
+		// How much bigger than the camera's slice a cascade is, as a fraction of the slice's radius.
+		// Bigger margins mean the cascades move (and are re-cached) less often, but are blurrier
+		inline static const float CASCADE_MARGIN = 0.25f;
+		// Blends between uniform (0) and logarithmic (1) cascade splits
+		inline static const float CASCADE_SPLIT_LAMBDA = 0.75f;
+		// How far towards the sun we look for casters past the edge of a cascade, these are
+		// flattened onto the near plane of the cascade by depth clamping
+		inline static const float CASTER_DISTANCE = 100.0f;
+		// The default distance from the camera that the sun's shadows reach
+		inline static const float DEFAULT_SHADOW_DISTANCE = 50.0f;
+
+		// The most point lights that can have shadows at the same time
+		inline static const int   MAX_POINT_SHADOWS = 8;
+		// The width and height of each face of a point light's shadow cube in texels
+		inline static const int   POINT_SHADOW_RESOLUTION = 512;
+		// The near plane for rendering point light shadows
+		inline static const float POINT_SHADOW_NEAR_PLANE = 0.05f;
+		// The default number of cube faces that can be rendered each frame
+		inline static const int   DEFAULT_FACE_BUDGET = 12;
+
+		// Texture slots for the shadow maps, must match fragments/multiple_point_lights.glsl. The
+		// cascades use one of the material system's reserved slots, and the point shadows go well
+		// above any slot a material would use
+		inline static const int   CASCADE_TEXTURE_SLOT = 1;
+		inline static const int   POINT_SHADOW_TEXTURE_SLOT = 15;
+
+		/// <summary>
+		/// The shadow parameters that shaders need, matches the end of b_LightBlock in
+		/// fragments/multiple_point_lights.glsl
+		/// </summary>
+		struct ShadowUniforms {
+			// Transforms world positions into each cascade's clip space
+			glm::mat4 CascadeViewProjections[CASCADE_COUNT];
+			// The view depth that each cascade ends at
+			glm::vec4 CascadeSplits;
+			// The world size of a texel in each cascade
+			glm::vec4 CascadeTexelSizes;
+			// x is the size of a cascade texel in uv space, y is the point shadow near plane, z is
+			// the size of a cube texel in uv space, and w is the number of cascades (0 if the sun
+			// has no shadows)
+			glm::vec4 Params;
+		};
+
+		/// <summary>
+		/// Statistics from the last call to Render, handy for debugging
+		/// </summary>
+		struct Stats {
+			// The number of cascades that had their static caster cache rebuilt
+			uint32_t CascadesCached;
+			// The number of cascades that had dynamic casters drawn into them
+			uint32_t CascadesUpdated;
+			// The number of point lights that have shadows
+			uint32_t PointLights;
+			// The number of cube faces that were rendered
+			uint32_t FacesRendered;
+			// The number of cube faces that are out of date, but didn't fit in the budget
+			uint32_t FacesPending;
+			// The number of objects drawn into any shadow map
+			uint32_t CastersDrawn;
+		};
+
+		// We'll disallow moving and copying, since we own GL resources
+		ShadowMapping(const ShadowMapping& other) = delete;
+		ShadowMapping(ShadowMapping&& other) = delete;
+		ShadowMapping& operator=(const ShadowMapping& other) = delete;
+		ShadowMapping& operator=(ShadowMapping&& other) = delete;
+
+		static inline Sptr Create() {
+			return std::make_shared<ShadowMapping>();
+		}
+
+		ShadowMapping();
+		~ShadowMapping();
+
+		/// <summary>
+		/// Fits the cascades to the camera and picks which point lights get shadows. Must be called
+		/// once per frame before the light data is uploaded, since the lights need their shadow layers
+		/// </summary>
+		/// <param name="sun">The scene's directional light</param>
+		/// <param name="lights">The scene's point lights</param>
+		/// <param name="view">The camera's view matrix</param>
+		/// <param name="projection">The camera's projection matrix, may be perspective or orthographic</param>
+		void Prepare(const DirectionalLight& sun, const std::vector<Light>& lights, const glm::mat4& view, const glm::mat4& projection);
+
+		/// <summary>
+		/// Renders any shadow maps that are out of date. Should be called once per frame after Prepare,
+		/// once the culling tree is up to date. This changes the bound framebuffer, and the viewport
+		/// is restored afterwards
+		/// </summary>
+		/// <param name="tree">The tree to find shadow casters in, user data must be RenderComponents</param>
+		void Render(const BoundingVolumeHierarchy::Sptr& tree);
+
+		/// <summary>
+		/// Binds the shadow maps to their texture slots
+		/// </summary>
+		void Bind() const;
+
+		/// <summary>
+		/// Marks the end of the frame, must be called once per frame so that the instance buffer
+		/// used for drawing casters can be recycled safely
+		/// </summary>
+		void EndFrame();
+
+		/// <summary>
+		/// Throws away every cached shadow map, so that they are all re-rendered
+		/// </summary>
+		void Invalidate();
+
+		/// <summary>
+		/// Gets the layer of the shadow cube assigned to the given light by the last call to Prepare
+		/// </summary>
+		/// <returns>The layer in the point shadow array, or -1 if the light has no shadows</returns>
+		int GetShadowLayer(size_t lightIndex) const;
+
+		/// <summary>
+		/// Gets the shader parameters from the last call to Prepare
+		/// </summary>
+		const ShadowUniforms& GetUniforms() const { return _uniforms; }
+
+		/// <summary>
+		/// Sets the number of cube faces that can be rendered each frame, across all point lights
+		/// </summary>
+		void SetFaceBudget(int faces) { _faceBudget = faces; }
+		int GetFaceBudget() const { return _faceBudget; }
+
+		/// <summary>
+		/// Sets how far from the camera the sun's shadows reach
+		/// </summary>
+		void SetShadowDistance(float distance) { _shadowDistance = distance; }
+		float GetShadowDistance() const { return _shadowDistance; }
+
+		/// <summary>
+		/// Gets the statistics from the last call to Render
+		/// </summary>
+		const Stats& GetStats() const { return _stats; }
+
+	protected:
+		// The shadow map for one slice of the camera's view
+		struct Cascade {
+			// The light space center and half size of the area covered by the shadow map
+			glm::vec3 Center;
+			float     HalfSize;
+			// The radius of the camera slice we were fit to, we re-fit if it changes
+			float     Radius;
+			// The matrix used to render the cascade, and the volume we look for casters in
+			glm::mat4 ViewProjection;
+			Frustum   CasterFrustum;
+			// The combined hash of the static casters in the cache
+			uint64_t  StaticHash;
+			// True if the static cache is up to date
+			bool      IsCacheValid;
+			// True if the cascade holds exactly what's in the cache, so there's no need to copy it
+			bool      IsCacheCurrent;
+		};
+
+		// A shadow cube for a single point light
+		struct PointShadow {
+			// The index of the light in the scene, or -1 if this layer is free
+			int       LightIndex;
+			glm::vec3 Position;
+			float     Range;
+			// The combined hash of the casters that were in each face when it was last checked
+			uint64_t  FaceHashes[6];
+			// The frame that each face was last rendered in, faces that waited longest go first
+			uint32_t  FaceRenderedFrame[6];
+			// True if the face needs to be rendered
+			bool      IsFaceDirty[6];
+		};
+
+		// A cube face that is waiting to be rendered
+		struct PendingFace {
+			int      Layer;
+			int      Face;
+			uint32_t RenderedFrame;
+		};
+
+		GLuint _cascadeTexture;
+		GLuint _cascadeCacheTexture;
+		GLuint _pointShadowTexture;
+		GLuint _framebuffer;
+
+		Shader::Sptr      _depthShader;
+		RenderQueue::Sptr _queue;
+
+		Cascade     _cascades[CASCADE_COUNT];
+		glm::mat4   _lightView;
+		glm::vec3   _sunDirection;
+		bool        _hasSunShadows;
+		float       _shadowDistance;
+
+		PointShadow _pointShadows[MAX_POINT_SHADOWS];
+		// The layer assigned to each light in the scene
+		std::vector<int> _lightLayers;
+		int         _faceBudget;
+
+		ShadowUniforms _uniforms;
+		Stats          _stats;
+		uint32_t       _frame;
+
+		// Scratch lists re-used every frame so we don't churn the allocator
+		std::vector<RenderComponent*> _staticCasters;
+		std::vector<RenderComponent*> _dynamicCasters;
+		std::vector<std::pair<float, int>> _lightCandidates;
+		std::vector<PendingFace> _pendingFaces;
+
+		/// <summary>
+		/// Fits the cascades to the camera, moving them only if the camera has left their area
+		/// </summary>
+		void _FitCascades(const glm::mat4& view, const glm::mat4& projection);
+		/// <summary>
+		/// Picks the point lights that get shadow cubes, lights keep their layers while they are picked
+		/// </summary>
+		void _AssignPointShadows(const std::vector<Light>& lights, const glm::vec3& cameraPos);
+
+		/// <summary>
+		/// Updates the cached static casters for every cascade, then draws the dynamic casters on top
+		/// </summary>
+		void _RenderCascades(const BoundingVolumeHierarchy::Sptr& tree);
+		/// <summary>
+		/// Finds the cube faces that are out of date, then renders as many as the budget allows
+		/// </summary>
+		void _RenderPointShadows(const BoundingVolumeHierarchy::Sptr& tree);
+
+		/// <summary>
+		/// Collects all the casters in range of a point light that are inside one of it's faces
+		/// </summary>
+		void _CollectFaceCasters(const BoundingVolumeHierarchy::Sptr& tree, const PointShadow& shadow, const Frustum& frustum, std::vector<RenderComponent*>& casters);
+		/// <summary>
+		/// Attaches a layer of a depth texture to our framebuffer and sets the viewport to cover it
+		/// </summary>
+		void _BindTarget(GLuint texture, int layer, int resolution, bool clear);
+		/// <summary>
+		/// Draws all the given casters into the current target
+		/// </summary>
+		void _DrawCasters(const std::vector<RenderComponent*>& casters, const glm::mat4& viewProjection);
+
+		/// <summary>
+		/// Gets the view projection matrix for rendering one face of a point light's shadow cube
+		/// </summary>
+		static glm::mat4 __GetFaceViewProjection(const glm::vec3& position, float range, int face);
+		/// <summary>
+		/// Gets a hash for a set of casters that doesn't depend on their order
+		/// </summary>
+		/// <param name="includeTransforms">True if the hash should change when the casters move</param>
+		static uint64_t __HashCasters(const std::vector<RenderComponent*>& casters, bool includeTransforms);
+		/// <summary>
+		/// Creates a depth texture for shadow maps, cleared to the far plane
+		/// </summary>
+		static GLuint __CreateDepthTexture(GLenum type, int resolution, int layers, bool isCompared);
+	};
+}
@@ -0,0 +1,167 @@
+#include "Gameplay/TransformHierarchy.h"
+
+#include <algorithm>
+#include <Logging.h>
+#include "GLM/gtc/matrix_inverse.hpp"
+
+#include "Gameplay/GameObject.h"
+#include "Utils/Profiler.h"
+
+namespace Gameplay {
+	TransformHierarchy::TransformHierarchy() :
+		_objects(),
+		_parents(),
+		_dirty(),
+		_world(),
+		_inverseWorld(),
+		_isOrderDirty(false),
+		_lastUpdateCount(0)
+	{ }
+
+	void TransformHierarchy::Add(GameObject* object) {
+		LOG_ASSERT(object->_transformIndex == NO_NODE, "Object is already in a transform hierarchy!");
+
+		int parent = NO_NODE;
+		if (object->_parent != nullptr) {
+			parent = object->_parent->_transformIndex;
+			// Our parent hasn't been added yet, so appending would break the ordering
+			if (parent == NO_NODE) {
+				_isOrderDirty = true;
+			}
+		}
+
+		object->_transformIndex = static_cast<int>(_objects.size());
+		_objects.push_back(object);
+		_parents.push_back(parent);
+		_dirty.push_back(1);
+		_world.push_back(glm::mat4(1.0f));
+		_inverseWorld.push_back(glm::mat4(1.0f));
+	}
+
+	void TransformHierarchy::Remove(GameObject* object) {
+		int index = object->_transformIndex;
+		LOG_ASSERT(index >= 0 && index < (int)_objects.size() && _objects[index] == object, "Object is not in this transform hierarchy!");
+
+		// The slot is cleaned up the next time we sort, the object may be deleted before then
+		_objects[index] = nullptr;
+		_dirty[index] = 0;
+		object->_transformIndex = NO_NODE;
+		_isOrderDirty = true;
+	}
+
+	void TransformHierarchy::InvalidateOrder() {
+		_isOrderDirty = true;
+	}
+
+	void TransformHierarchy::MarkDirty(GameObject* object) {
+		int index = object->_transformIndex;
+		// If the node is already dirty, all of it's descendants are too
+		if (index == NO_NODE || _dirty[index]) {
+			return;
+		}
+		_dirty[index] = 1;
+		for (GameObject* child : object->_children) {
+			MarkDirty(child);
+		}
+	}
+
+	const glm::mat4& TransformHierarchy::GetWorld(const GameObject* object) {
+		_Resolve(object->_transformIndex);
+		return _world[object->_transformIndex];
+	}
+
+	const glm::mat4& TransformHierarchy::GetInverseWorld(const GameObject* object) {
+		_Resolve(object->_transformIndex);
+		return _inverseWorld[object->_transformIndex];
+	}
+
+	void TransformHierarchy::Update() {
+		PROFILE_SCOPE("TransformHierarchy::Update");
+		if (_isOrderDirty) {
+			_RebuildOrder();
+		}
+
+		// Parents always come before their children, so a parent's world transform
+		// is already up to date by the time we get to any of it's children
+		_lastUpdateCount = 0;
+		for (size_t ix = 0; ix < _objects.size(); ix++) {
+			if (_dirty[ix]) {
+				int parent = _parents[ix];
+				_Recalculate(static_cast<int>(ix), parent == NO_NODE ? nullptr : &_world[parent]);
+				_lastUpdateCount++;
+			}
+		}
+	}
+
+	void TransformHierarchy::_RebuildOrder() {
+		std::vector<GameObject*> objects;
+		objects.reserve(_objects.size());
+
+		// Breadth first, so every level of the hierarchy comes after the level above it
+		for (GameObject* object : _objects) {
+			if (object != nullptr && object->_parent == nullptr) {
+				objects.push_back(object);
+			}
+		}
+		for (size_t ix = 0; ix < objects.size(); ix++) {
+			for (GameObject* child : objects[ix]->_children) {
+				objects.push_back(child);
+			}
+		}
+
+		// Carry the existing transforms over so that clean nodes stay clean
+		std::vector<int>       parents(objects.size());
+		std::vector<uint8_t>   dirty(objects.size());
+		std::vector<glm::mat4> world(objects.size());
+		std::vector<glm::mat4> inverseWorld(objects.size());
+		for (size_t ix = 0; ix < objects.size(); ix++) {
+			int oldIndex = objects[ix]->_transformIndex;
+			LOG_ASSERT(oldIndex >= 0 && oldIndex < (int)_objects.size(), "Object in hierarchy is missing from the transform arrays!");
+			dirty[ix]        = _dirty[oldIndex];
+			world[ix]        = _world[oldIndex];
+			inverseWorld[ix] = _inverseWorld[oldIndex];
+		}
+		for (size_t ix = 0; ix < objects.size(); ix++) {
+			objects[ix]->_transformIndex = static_cast<int>(ix);
+		}
+		for (size_t ix = 0; ix < objects.size(); ix++) {
+			GameObject* parent = objects[ix]->_parent;
+			parents[ix] = parent == nullptr ? NO_NODE : parent->_transformIndex;
+		}
+
+		LOG_ASSERT(objects.size() == _objects.size() - std::count(_objects.begin(), _objects.end(), nullptr), "Some objects in the hierarchy are not reachable from a root!");
+
+		_objects      = std::move(objects);
+		_parents      = std::move(parents);
+		_dirty        = std::move(dirty);
+		_world        = std::move(world);
+		_inverseWorld = std::move(inverseWorld);
+		_isOrderDirty = false;
+	}
+
+	void TransformHierarchy::_Resolve(int index) {
+		if (!_dirty[index]) {
+			return;
+		}
+		// We follow the object's parent pointer rather than _parents, since the arrays
+		// may not have been re-sorted since the parent changed
+		const glm::mat4* parentWorld = nullptr;
+		GameObject* parent = _objects[index]->_parent;
+		if (parent != nullptr && parent->_transformIndex != NO_NODE) {
+			_Resolve(parent->_transformIndex);
+			parentWorld = &_world[parent->_transformIndex];
+		}
+		_Recalculate(index, parentWorld);
+	}
+
+	void TransformHierarchy::_Recalculate(int index, const glm::mat4* parentWorld) {
+		GameObject* object = _objects[index];
+		glm::mat4 local = object->_CalcLocalTransform();
+		_world[index] = parentWorld != nullptr ? (*parentWorld) * local : local;
+		// Transforms are always affine, so we can invert the 3x3 part and the translation
+		// separately instead of doing a full 4x4 inverse
+		_inverseWorld[index] = glm::affineInverse(_world[index]);
+		_dirty[index] = 0;
+		object->_transformVersion++;
+	}
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <GLM/glm.hpp>
+
+namespace Gameplay {
+	struct GameObject;
+
+	/// <summary>
+	/// Stores the world transforms for all the game objects in a scene, sorted by their depth
+	/// in the hierarchy so that parents always come before their children
+	///
+	/// World and inverse world matrices are stored in flat arrays along with each node's parent
+	/// index and dirty flag. When an object's local transform changes, it and all of it's
+	/// descendants are flagged as dirty, and Update recalculates only the dirty nodes in a
+	/// single linear pass (since parents are always earlier in the arrays, their world matrix
+	/// is always up to date by the time we reach their children). Transforms that are accessed
+	/// before the pass are resolved on demand
+	/// </summary>
+	class TransformHierarchy {
+	public:
+		typedef std::shared_ptr<TransformHierarchy> Sptr;
+
+		// Index used to indicate that an object is not in the hierarchy, or has no parent
+		inline static const int NO_NODE = -1;
+
+		static inline Sptr Create() {
+			return std::make_shared<TransformHierarchy>();
+		}
+
+		TransformHierarchy();
+		~TransformHierarchy() = default;
+
+		TransformHierarchy(const TransformHierarchy& other) = delete;
+		TransformHierarchy(TransformHierarchy&& other) = delete;
+		TransformHierarchy& operator=(const TransformHierarchy& other) = delete;
+		TransformHierarchy& operator=(TransformHierarchy&& other) = delete;
+
+		/// <summary>
+		/// Adds an object to the hierarchy, it's transform will be dirty until the next update
+		/// </summary>
+		void Add(GameObject* object);
+		/// <summary>
+		/// Removes an object from the hierarchy, the object's children must be removed or re-parented as well
+		/// </summary>
+		void Remove(GameObject* object);
+		/// <summary>
+		/// Notifies the hierarchy that an object's parent has changed, so the nodes need to be re-sorted
+		/// </summary>
+		void InvalidateOrder();
+
+		/// <summary>
+		/// Flags an object and all of it's descendants as needing their world transforms recalculated
+		/// </summary>
+		void MarkDirty(GameObject* object);
+
+		/// <summary>
+		/// Gets the world transform for an object, recalculating it and any dirty ancestors if needed.
+		/// The reference is invalidated when objects are added, removed or re-parented
+		/// </summary>
+		const glm::mat4& GetWorld(const GameObject* object);
+		/// <summary>
+		/// Gets the inverse of the world transform for an object, recalculating it and any dirty ancestors if needed.
+		/// The reference is invalidated when objects are added, removed or re-parented
+		/// </summary>
+		const glm::mat4& GetInverseWorld(const GameObject* object);
+
+		/// <summary>
+		/// Re-sorts the nodes if the hierarchy has changed, then recalculates all dirty world transforms
+		/// </summary>
+		void Update();
+
+		/// <summary>
+		/// Gets the number of objects in the hierarchy
+		/// </summary>
+		size_t GetCount() const { return _objects.size(); }
+		/// <summary>
+		/// Gets the number of transforms that were recalculated in the last call to Update
+		/// </summary>
+		size_t GetLastUpdateCount() const { return _lastUpdateCount; }
+
+	protected:
+		// These are all parallel arrays, sorted by depth in the hierarchy. Removed objects
+		// leave a nullptr behind until the next time the nodes are sorted
+		std::vector<GameObject*> _objects;
+		std::vector<int>         _parents;
+		std::vector<uint8_t>     _dirty;
+		std::vector<glm::mat4>   _world;
+		std::vector<glm::mat4>   _inverseWorld;
+
+		bool   _isOrderDirty;
+		size_t _lastUpdateCount;
+
+		/// <summary>
+		/// Sorts the nodes so that all roots come first, followed by each level of children,
+		/// and removes any nodes left behind by removed objects
+		/// </summary>
+		void _RebuildOrder();
+		/// <summary>
+		/// Recalculates a dirty node, first recalculating any dirty ancestors
+		/// </summary>
+		void _Resolve(int index);
+		/// <summary>
+		/// Recalculates the world and inverse world transforms for a node and clears it's dirty flag
+		/// </summary>
+		void _Recalculate(int index, const glm::mat4* parentWorld);
+	};
+}
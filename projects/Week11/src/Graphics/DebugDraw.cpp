@@ -3,24 +3,23 @@
 DebugDrawer::DebugDrawer() :
 	_colorStack(std::stack<glm::vec3>()),
 	_transformStack(std::stack<glm::mat4>()),
+	_isWorldIdentity(true),
 	_viewProjection(glm::mat4(1.0f)),
-	_lineOffset(0),
-	_triangleOffset(0)
+	_lines(),
+	_tris()
 {
-	_linesVBO = VertexBuffer::Create(BufferUsage::DynamicDraw);
-	_linesVBO->LoadData<VertexPosCol>(nullptr, LINE_BATCH_SIZE * 2);
-	_linesVAO = VertexArrayObject::Create();
-	_linesVAO->AddVertexBuffer(_linesVBO, VertexPosCol::V_DECL);
-
-	_trisVBO = VertexBuffer::Create(BufferUsage::DynamicDraw);
-	_trisVBO->LoadData<VertexPosCol>(nullptr, TRI_BATCH_SIZE * 3);
-	_trisVAO = VertexArrayObject::Create();
-	_trisVAO->AddVertexBuffer(_trisVBO, VertexPosCol::V_DECL);
+	_InitBatch(_lines, LINE_BATCH_SIZE * 2, DrawMode::LineList);
+	_InitBatch(_tris, TRI_BATCH_SIZE * 3, DrawMode::TriangleList);
 
 	_colorStack.push(glm::vec3(1.0f));
 	_transformStack.push(glm::mat4(1.0f));
 }
 
+DebugDrawer::~DebugDrawer() {
+	glDeleteVertexArrays(1, &_lines.VertexArray);
+	glDeleteVertexArrays(1, &_tris.VertexArray);
+}
+
 void DebugDrawer::PushColor(const glm::vec3& color) {
 	_colorStack.push(color);
 }
@@ -33,15 +32,14 @@ glm::vec3 DebugDrawer::PopColor() {
 }
 
 void DebugDrawer::PushWorldMatrix(const glm::mat4& value) {
-	FlushAll();
 	_transformStack.push(value);
+	_isWorldIdentity = value == glm::mat4(1.0f);
 }
 
 void DebugDrawer::PopWorldMatrix() {
 	LOG_ASSERT(_transformStack.size() > 1, "Attempting to pop more transforms than you are pushing! Check your code!");
-	FlushAll();
 	_transformStack.pop();
-
+	_isWorldIdentity = _transformStack.top() == glm::mat4(1.0f);
 }
 
 void DebugDrawer::DrawLine(const glm::vec3& p1, const glm::vec3& p2) {
@@ -54,34 +52,14 @@ void DebugDrawer::DrawLine(const glm::vec3& p1, const glm::vec3& p2, const glm::
 
 void DebugDrawer::DrawLine(const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& color1, const glm::vec3& color2)
 {
-	_lineBuffer[_lineOffset + 0].Color = glm::vec4(color1, 1.0f);
-	_lineBuffer[_lineOffset + 0].Position = p1;
-	_lineBuffer[_lineOffset + 1].Color = glm::vec4(color2, 1.0f);
-	_lineBuffer[_lineOffset + 1].Position = p2;
-
-	_lineOffset += 2;
-	if (_lineOffset >= LINE_BATCH_SIZE) {
-		FlushLines();
-	}
+	VertexPosCol* vertices = _Reserve(_lines, 2);
+	vertices[0] = VertexPosCol(_ToWorld(p1), glm::vec4(color1, 1.0f));
+	vertices[1] = VertexPosCol(_ToWorld(p2), glm::vec4(color2, 1.0f));
 }
 
 void DebugDrawer::FlushLines()
 {
-	if (_lineOffset > 0) {
-		__Shader->Bind();
-		__Shader->SetUniformMatrix("u_MVP", _viewProjection * _transformStack.top());
-		int restorePoint = 0;
-		glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &restorePoint);
-		VertexArrayObject::Unbind();
-		_linesVBO->LoadData<VertexPosCol>(_lineBuffer, LINE_BATCH_SIZE * 2);
-		_linesVAO->Bind();
-		_linesVAO->Draw(DrawMode::LineList);
-		_linesVAO->Unbind();
-		_lineOffset = 0;
-		if (restorePoint != 0) {
-			glBindVertexArray(restorePoint);
-		}
-	}
+	_Flush(_lines);
 }
 
 void DebugDrawer::DrawTri(const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3) {
@@ -95,36 +73,15 @@ void DebugDrawer::DrawTri(const glm::vec3& p1, const glm::vec3& p2, const glm::v
 
 void DebugDrawer::DrawTri(const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, const glm::vec3& c1, const glm::vec3& c2, const glm::vec3& c3)
 {
-	_triBuffer[_triangleOffset + 0].Color = glm::vec4(c1, 1.0f);
-	_triBuffer[_triangleOffset + 0].Position = p1;
-	_triBuffer[_triangleOffset + 1].Color = glm::vec4(c2, 1.0f);
-	_triBuffer[_triangleOffset + 1].Position = p2;
-	_triBuffer[_triangleOffset + 2].Color = glm::vec4(c3, 1.0f);
-	_triBuffer[_triangleOffset + 2].Position = p3;
-
-	_triangleOffset += 3;
-	if (_triangleOffset >= TRI_BATCH_SIZE) {
-		FlushTris();
-	}
+	VertexPosCol* vertices = _Reserve(_tris, 3);
+	vertices[0] = VertexPosCol(_ToWorld(p1), glm::vec4(c1, 1.0f));
+	vertices[1] = VertexPosCol(_ToWorld(p2), glm::vec4(c2, 1.0f));
+	vertices[2] = VertexPosCol(_ToWorld(p3), glm::vec4(c3, 1.0f));
 }
 
 void DebugDrawer::FlushTris()
 {
-	if (_triangleOffset > 0) {
-		__Shader->Bind();
-		__Shader->SetUniformMatrix("u_MVP", _viewProjection * _transformStack.top());
-		int restorePoint = 0;
-		glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &restorePoint);
-		VertexArrayObject::Unbind();
-		_trisVBO->LoadData<VertexPosCol>(_triBuffer, TRI_BATCH_SIZE * 3);
-		_trisVAO->Bind();
-		_trisVAO->Draw(DrawMode::LineList);
-		_trisVAO->Unbind();
-		_triangleOffset = 0;
-		if (restorePoint != 0) {
-			glBindVertexArray(restorePoint);
-		}
-	}
+	_Flush(_tris);
 }
 
 void DebugDrawer::FlushAll()
@@ -133,11 +90,69 @@ void DebugDrawer::FlushAll()
 	FlushTris();
 }
 
+void DebugDrawer::NextFrame()
+{
+	FlushAll();
+	_lines.Buffer->NextFrame();
+	_tris.Buffer->NextFrame();
+}
+
 void DebugDrawer::SetViewProjection(const glm::mat4& viewProjection)
 {
 	_viewProjection = viewProjection;
 }
 
+void DebugDrawer::_InitBatch(Batch& batch, size_t vertexCapacity, DrawMode mode) {
+	// Leave room for a couple of full batches per frame, the buffer will grow if we need more
+	batch.Buffer   = StreamingBuffer::Create(BufferType::Vertex, vertexCapacity * sizeof(VertexPosCol) * 2);
+	batch.Capacity = vertexCapacity;
+	batch.Mode     = mode;
+
+	// We point the VAO at a different part of the buffer every flush, so we set up the
+	// attribute formats once with DSA and only swap out the buffer binding
+	glCreateVertexArrays(1, &batch.VertexArray);
+	for (const BufferAttribute& attrib : VertexPosCol::V_DECL) {
+		glEnableVertexArrayAttrib(batch.VertexArray, attrib.Slot);
+		glVertexArrayAttribFormat(batch.VertexArray, attrib.Slot, attrib.Size, (GLenum)attrib.Type, attrib.Normalized, attrib.Offset);
+		glVertexArrayAttribBinding(batch.VertexArray, attrib.Slot, 0);
+	}
+}
+
+VertexPosCol* DebugDrawer::_Reserve(Batch& batch, size_t vertexCount) {
+	if (batch.Vertices != nullptr && batch.Count + vertexCount > batch.Capacity) {
+		_Flush(batch);
+	}
+	// Grab a full batch worth of space, _Flush gives back whatever we don't use
+	if (batch.Vertices == nullptr) {
+		batch.Allocation = batch.Buffer->Allocate(batch.Capacity * sizeof(VertexPosCol));
+		batch.Vertices   = reinterpret_cast<VertexPosCol*>(batch.Allocation.Data);
+		batch.Count      = 0;
+	}
+	VertexPosCol* result = batch.Vertices + batch.Count;
+	batch.Count += vertexCount;
+	return result;
+}
+
+void DebugDrawer::_Flush(Batch& batch) {
+	if (batch.Vertices == nullptr) {
+		return;
+	}
+	batch.Buffer->Shrink(batch.Allocation, batch.Count * sizeof(VertexPosCol));
+
+	if (batch.Count > 0) {
+		// Vertices are already in world space
+		__Shader->Bind();
+		__Shader->SetUniformMatrix(0, &_viewProjection);
+		glVertexArrayVertexBuffer(batch.VertexArray, 0, batch.Allocation.Buffer, batch.Allocation.Offset, sizeof(VertexPosCol));
+		glBindVertexArray(batch.VertexArray);
+		glDrawArrays((GLenum)batch.Mode, 0, static_cast<GLsizei>(batch.Count));
+		VertexArrayObject::Unbind();
+	}
+
+	batch.Vertices = nullptr;
+	batch.Count    = 0;
+}
+
 DebugDrawer& DebugDrawer::Get() {
 	if (__Instance == nullptr) {
 		__Instance = new DebugDrawer();
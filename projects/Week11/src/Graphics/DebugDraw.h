@@ -3,16 +3,22 @@
 #include <stack>
 #include "Graphics/VertexTypes.h"
 #include "Graphics/Shader.h"
+#include "Graphics/StreamingBuffer.h"
 
 /// <summary>
 /// Utility class for drawing lines and triangles in an immediate mode style
 /// 
 /// Includes a stack for transformations and color, to ease implementation of complex
 /// debuggers
+///
+/// Vertices are written straight into persistently mapped streaming buffers, and are
+/// transformed by the world matrix as they are added, so changing the world matrix
+/// does not need to flush. Each flush only draws the vertices that were written
 /// </summary>
 class DebugDrawer
 {
 public:
+	// The most lines or triangles we will draw in a single batch
 	inline static const size_t LINE_BATCH_SIZE = 8192;
 	inline static const size_t TRI_BATCH_SIZE = 4096;
 
@@ -23,7 +29,7 @@ public:
 	DebugDrawer& operator =(const DebugDrawer& other) = delete;
 	DebugDrawer& operator =(DebugDrawer&& other) = delete;
 
-	virtual ~DebugDrawer() = default;
+	virtual ~DebugDrawer();
 
 	/// <summary>
 	/// Gets the singleton instance of the debug drawer
@@ -47,12 +53,12 @@ public:
 	glm::vec3 PopColor();
 
 	/// <summary>
-	/// Pushes a new transform to the stack, replacing the existing value and flushing all lines and tris
+	/// Pushes a new transform to the stack, replacing the existing value. Only affects elements drawn after this call
 	/// </summary>
 	/// <param name="world">The new world transform to use for drawing</param>
 	void PushWorldMatrix(const glm::mat4& world);
 	/// <summary>
-	/// Pops a transform from the stack, replacing the existing value and flushing all lines and tris
+	/// Pops a transform from the stack, replacing the existing value. Only affects elements drawn after this call
 	/// </summary>
 	void PopWorldMatrix();
 
@@ -120,6 +126,12 @@ public:
 	/// </summary>
 	void FlushAll();
 
+	/// <summary>
+	/// Flushes anything that is left and moves our streaming buffers on to the next frame.
+	/// Must be called once per frame, after all debug drawing is done
+	/// </summary>
+	void NextFrame();
+
 	/// <summary>
 	/// Set the view projection matrix used by this debug drawer
 	/// </summary>
@@ -128,20 +140,40 @@ public:
 protected:
 	DebugDrawer();
 
+	/// <summary>
+	/// A batch of vertices being written into a streaming buffer
+	/// </summary>
+	struct Batch {
+		StreamingBuffer::Sptr       Buffer;
+		// The region of the buffer we're writing to, or empty if nothing has been written since the last flush
+		StreamingBuffer::Allocation Allocation;
+		VertexPosCol*               Vertices = nullptr;
+		size_t                      Count    = 0;
+		size_t                      Capacity = 0;
+		// A VAO that reads from Buffer, the buffer's offset is set on each flush
+		GLuint                      VertexArray = 0;
+		DrawMode                    Mode = DrawMode::LineList;
+	};
+
 	std::stack<glm::vec3> _colorStack;
 	std::stack<glm::mat4> _transformStack;
+	// True if the top of the transform stack is the identity, so we can skip transforming vertices
+	bool         _isWorldIdentity;
 	glm::mat4    _viewProjection;
-	glm::mat4    _worldMatrix;
 
-	size_t       _lineOffset;
-	VertexPosCol _lineBuffer[LINE_BATCH_SIZE * 2];
-	size_t       _triangleOffset;
-	VertexPosCol _triBuffer[TRI_BATCH_SIZE * 3];
+	Batch        _lines;
+	Batch        _tris;
 
-	VertexBuffer::Sptr _linesVBO;
-	VertexArrayObject::Sptr _linesVAO;
-	VertexBuffer::Sptr _trisVBO;
-	VertexArrayObject::Sptr _trisVAO;
+	void _InitBatch(Batch& batch, size_t vertexCapacity, DrawMode mode);
+	/// <summary>
+	/// Gets space for some vertices in a batch, flushing it first if it is full. Note that the
+	/// returned memory is write-only!
+	/// </summary>
+	VertexPosCol* _Reserve(Batch& batch, size_t vertexCount);
+	void _Flush(Batch& batch);
+	inline glm::vec3 _ToWorld(const glm::vec3& point) const {
+		return _isWorldIdentity ? point : glm::vec3(_transformStack.top() * glm::vec4(point, 1.0f));
+	}
 
 	inline static DebugDrawer* __Instance = nullptr;
 	inline static Shader::Sptr __Shader = nullptr;
@@ -1,11 +1,14 @@
 #include "ITexture.h"
+#include "Graphics/TextureStreamer.h"
 
 ITexture::Limits ITexture::__limits = ITexture::Limits();
 bool ITexture::__isStaticInit = false;
+std::unordered_map<TextureType, GLuint> ITexture::__placeholders;
 
 ITexture::ITexture(TextureType type) :
 	_type(type),
-	_handle(0)
+	_handle(0),
+	_lastUsedFrame(0)
 {
 	__StaticInit();
 	_Recreate();
@@ -27,12 +30,18 @@ ITexture::~ITexture() {
 }
 
 void ITexture::Bind(int slot) {
-	if (_handle != 0) {
+	GLuint handle = GetBindHandle();
+	if (handle != 0) {
 		// Instead of glActiveTexture + glBindTexture, we can one line it now :D
-		glBindTextureUnit(slot, _handle); 
+		glBindTextureUnit(slot, handle); 
 	}
 }
 
+GLuint ITexture::GetBindHandle() const {
+	_lastUsedFrame = TextureStreamer::GetFrame();
+	return IsReady() ? _handle : __GetPlaceholder(_type);
+}
+
 void ITexture::Unbind(int slot) {
 	glBindTextureUnit(slot, 0);
 }
@@ -55,6 +64,11 @@ void ITexture::__StaticInit()
 	glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &__limits.MAX_TEXTURE_IMAGE_UNITS);
 	glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &__limits.MAX_ANISOTROPY);
 
+	// S3TC is an extension, so we need to ask if it's there. BC5 and BC7 are core in 4.2
+	GLint s3tcSupported = GL_FALSE;
+	glGetInternalformativ(GL_TEXTURE_2D, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, GL_INTERNALFORMAT_SUPPORTED, 1, &s3tcSupported);
+	__limits.SUPPORTS_S3TC = s3tcSupported == GL_TRUE;
+
 	// Enable seamless cube maps (we'll need this later!)
 	glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
 
@@ -65,10 +79,33 @@ void ITexture::__StaticInit()
 	LOG_INFO("\t3D Size:    {}", __limits.MAX_3D_TEXTURE_SIZE);
 	LOG_INFO("\tUnits (FS): {}", __limits.MAX_TEXTURE_IMAGE_UNITS);
 	LOG_INFO("\tMax Aniso.: {}", __limits.MAX_ANISOTROPY);
+	LOG_INFO("\tS3TC:       {}", __limits.SUPPORTS_S3TC);
 
 	__isStaticInit = true;
 }
 
+GLuint ITexture::__GetPlaceholder(TextureType type) {
+	auto it = __placeholders.find(type);
+	if (it != __placeholders.end()) {
+		return it->second;
+	}
+
+	// Only 2D and cube textures are loaded from files, everything else just gets unbound
+	GLuint handle = 0;
+	if (type == TextureType::_2D || type == TextureType::Cubemap) {
+		// A single mid-grey texel, so that objects are still visible while they load
+		// Note that for cubemaps this allocates and clears all 6 faces
+		static const glm::vec4 color = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f);
+		glCreateTextures((GLenum)type, 1, &handle);
+		glTextureStorage2D(handle, 1, GL_RGBA8, 1, 1);
+		glTextureParameteri(handle, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTextureParameteri(handle, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glClearTexImage(handle, 0, GL_RGBA, GL_FLOAT, &color.x);
+	}
+	__placeholders[type] = handle;
+	return handle;
+}
+
 ITexture::Limits ITexture::GetLimits() {
 	__StaticInit();
 	return __limits;
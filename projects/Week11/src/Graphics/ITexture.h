@@ -2,6 +2,7 @@
 #include <memory>
 #include <glad/glad.h>
 #include <cstdint>
+#include <unordered_map>
 #include <Graphics/TextureEnums.h>
 #include <GLM/glm.hpp>
 #include "Utils/ResourceManager/IResource.h"
@@ -29,6 +30,8 @@ public:
 		int   MAX_3D_TEXTURE_SIZE;
 		int   MAX_TEXTURE_IMAGE_UNITS;
 		float MAX_ANISOTROPY;
+		// True if the driver can sample BC1 and BC3 (S3TC) textures
+		bool  SUPPORTS_S3TC;
 	};
 	
 	/// <summary>
@@ -37,7 +40,8 @@ public:
 	virtual ~ITexture();
 
 	/// <summary>
-	/// Binds this texture to the given texture slot
+	/// Binds this texture to the given texture slot. If the texture is still loading,
+	/// a placeholder texture of the same type is bound instead
 	/// </summary>
 	/// <param name="slot">The slot to bind, 0 &lt;= slot &lt; MAX_TEXTURE_UNITS</param>
 	virtual void Bind(int slot);
@@ -47,6 +51,17 @@ public:
 	/// <param name="slot">The slot to unbind, 0 &lt;= slot &lt; MAX_TEXTURE_UNITS</param>
 	static void Unbind(int slot);
 
+	/// <summary>
+	/// Gets the handle that should be bound when using this texture, this is the
+	/// placeholder texture while the texture is still loading. This also marks the
+	/// texture as used this frame, see TextureStreamer
+	/// </summary>
+	GLuint GetBindHandle() const;
+	/// <summary>
+	/// Gets the last frame that this texture was bound on, or 0 if it has never been bound
+	/// </summary>
+	uint32_t GetLastUsedFrame() const { return _lastUsedFrame; }
+
 	/// <summary>
 	/// Clears the first level of this texture to a solid color, note this only works for color texture types!
 	/// </summary>
@@ -63,6 +78,7 @@ protected:
 
 	GLuint _handle;    // The OpenGL handle for this textureW
 	TextureType _type; // The type for this texture, mainly used for debugging
+	mutable uint32_t _lastUsedFrame; // The frame this texture was last bound on, from TextureStreamer::GetFrame
 
 // STATIC SECTION
 private:
@@ -71,6 +87,10 @@ private:
 
 	static void __StaticInit();
 
+	// 1x1 textures to bind in place of textures that are still loading, keyed by texture type
+	static std::unordered_map<TextureType, GLuint> __placeholders;
+	static GLuint __GetPlaceholder(TextureType type);
+
 public:
 	/// <summary>
 	/// Gets the driver texture limits for the current renderer
@@ -3,26 +3,81 @@
 #include <fstream>
 #include <sstream>
 #include <filesystem>
+#include <GLFW/glfw3.h>
 
 #include "Utils/FileHelpers.h"
+#include "Utils/ChunkedFile.h"
+#include "Utils/JobSystem.h"
+
+// glad was not generated with KHR_parallel_shader_compile, so we load it ourselves. The
+// ARB version of the extension uses the same values
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+// Chunk ID and version for our program binary cache files, bump the version if the
+// format changes to invalidate old caches
+static const uint32_t PROGRAM_CACHE_CHUNK   = MakeFourCC("PROG");
+static const uint32_t PROGRAM_CACHE_VERSION = 1;
+
+// The order we hash parts in, so that the hash doesn't depend on map ordering
+static const ShaderPartType HASHED_PART_ORDER[] = {
+	ShaderPartType::Vertex,
+	ShaderPartType::TessControl,
+	ShaderPartType::TessEval,
+	ShaderPartType::Geometry,
+	ShaderPartType::Fragment
+};
+
+// The define that selects each ShaderVariant in fragments/surface_output.glsl, indexed by variant
+static const char* VARIANT_DEFINES[] = {
+	"",
+	"SURFACE_GBUFFER",
+	"SURFACE_DEPTH_ONLY"
+};
 
 Shader::Shader() : 
 	IResource(),
 	// We zero out all of our members so we don't have garbage data in our class
-	_handle(0)
+	_handle(0),
+	_cacheKey(0),
+	_cachedBinary(),
+	_cachedBinaryFormat(GL_NONE),
+	_isLinking(false),
+	_supportsVariants(false),
+	_variantDefine(),
+	_variants(),
+	_variantState(ResourceLoadState::Pending),
+	_hasRequestedVariants(false)
 {
+	__InitDriverInfo();
 	_handle = glCreateProgram();
 }
 
 Shader::Shader(const std::unordered_map<ShaderPartType, std::string>& filePaths) :
 	IResource(),
-	_handle(0)
+	_handle(0),
+	_cacheKey(0),
+	_cachedBinary(),
+	_cachedBinaryFormat(GL_NONE),
+	_isLinking(false),
+	_supportsVariants(false),
+	_variantDefine(),
+	_variants(),
+	_variantState(ResourceLoadState::Pending),
+	_hasRequestedVariants(false)
 {
+	__InitDriverInfo();
 	_handle = glCreateProgram();
 	for (auto& [type, path] : filePaths) {
-		LoadShaderPartFromFile(path.c_str(), type);
+		_fileSourceMap[type] = { path, true };
 	}
-	Link();
+	// We go through the same steps as a deferred load so we can use the binary cache,
+	// we just don't get to do anything while the program compiles
+	_LoadDeferred();
+	_FinishDeferredLoad();
+	_PollDeferredLoad(true);
 }
 
 Shader::~Shader() {
@@ -33,13 +88,42 @@ Shader::~Shader() {
 }
 
 bool Shader::LoadShaderPart(const char* source, ShaderPartType type) {
+	GLuint handle = _CompilePart(source, type);
+
+	if (!_CheckPart(handle)) {
+		// Delete the broken shader result
+		glDeleteShader(handle);
+		return false;
+	}
+
+	// If we're overwriting, warn and clean up the old program before we store
+	if (_handles[type] != 0) {
+		LOG_WARN("Another shader has been attached to this slot, overwriting");
+		glDeleteShader(_handles[type]);
+	}
+	_handles[type] = handle;
+
+	// Store info about where we got this data from
+	_fileSourceMap[type].IsFilePath = false;
+	_fileSourceMap[type].Source = source;
+	if (type == ShaderPartType::Fragment) {
+		_supportsVariants = std::string(source).find(VARIANT_PRAGMA) != std::string::npos;
+	}
+
+	return true;
+}
+
+GLuint Shader::_CompilePart(const char* source, ShaderPartType type) {
 	// Creates a new shader part (VS, FS, GS, etc...)
 	GLuint handle = glCreateShader((GLenum)type);
 
 	// Load the GLSL source and compile it
 	glShaderSource(handle, 1, &source, nullptr);
 	glCompileShader(handle);
+	return handle;
+}
 
+bool Shader::_CheckPart(GLuint handle) {
 	// Get the compilation status for the shader part
 	GLint status = 0;
 	glGetShaderiv(handle, GL_COMPILE_STATUS, &status);
@@ -60,24 +144,7 @@ bool Shader::LoadShaderPart(const char* source, ShaderPartType type) {
 
 		// Clean up our log memory
 		delete[] log;
-
-		// Delete the broken shader result
-		glDeleteShader(handle);
-		handle = 0;
-
-		return false;
-	}
-
-	// If we're overwriting, warn and clean up the old program before we store
-	if (_handles[type] != 0) {
-		LOG_WARN("Another shader has been attached to this slot, overwriting");
-		glDeleteShader(_handles[type]);
 	}
-	_handles[type] = handle;
-
-	// Store info about where we got this data from
-	_fileSourceMap[type].IsFilePath = false;
-	_fileSourceMap[type].Source = source;
 
 	return status != GL_FALSE;
 }
@@ -103,6 +170,11 @@ bool Shader::LoadShaderPartFromFile(const char* path, ShaderPartType type) {
 }
 
 bool Shader::Link() {
+	_StartLink();
+	return _FinishLink();
+}
+
+void Shader::_StartLink() {
 	LOG_ASSERT(_handles[ShaderPartType::Vertex] != 0 && _handles[ShaderPartType::Fragment] != 0, "Must attach both a vertex and fragment shader!");
 
 	LOG_TRACE("Starting shader link:");
@@ -114,25 +186,29 @@ bool Shader::Link() {
 		}
 	}
 
+	// We need to ask for this before linking if we want to cache the binary
+	if (_cacheKey != 0) {
+		glProgramParameteri(_handle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+
 	// Perform linking
 	glLinkProgram(_handle);
+}
 
-	// Remove shader parts to save space (we can do this since we only needed the shader parts to compile an actual shader program)
-	for (auto& [type, id] : _handles) { 
-		if (id != 0) {
-			glDetachShader(_handle, id);
-			glDeleteShader(id);
-		}
-	}
-	// Remove all the handles so we don't accidentally use them
-	_handles.clear();
-
+bool Shader::_FinishLink() {
 	GLint status = 0;
 	glGetProgramiv(_handle, GL_LINK_STATUS, &status);
 
 	// If linking failed, figure out why
 	if (status == GL_FALSE)
 	{
+		// Parts that were compiled in the background haven't been checked yet
+		for (auto& [type, id] : _handles) {
+			if (id != 0 && !_CheckPart(id)) {
+				LOG_ERROR("Source File: {}", _fileSourceMap[type].IsFilePath ? _fileSourceMap[type].Source : "<from source>");
+			}
+		}
+
 		// Get the length of the log
 		GLint length = 0;
 		glGetProgramiv(_handle, GL_INFO_LOG_LENGTH, &length);
@@ -150,9 +226,23 @@ bool Shader::Link() {
 		LOG_TRACE("Linking complete, starting introspection");
 	}
 
+	// Remove shader parts to save space (we can do this since we only needed the shader parts to compile an actual shader program)
+	for (auto& [type, id] : _handles) { 
+		if (id != 0) {
+			glDetachShader(_handle, id);
+			glDeleteShader(id);
+		}
+	}
+	// Remove all the handles so we don't accidentally use them
+	_handles.clear();
+
 	// Perform our uniform introspection to see what uniforms are in the shader
 	_Introspect();
 
+	if (status != GL_FALSE && _cacheKey != 0) {
+		_WriteCachedBinary();
+	}
+
 	return status != GL_FALSE;
 }
 
@@ -319,6 +409,8 @@ nlohmann::json Shader::ToJson() const {
 }
 
 Shader::Sptr Shader::FromJson(const nlohmann::json& data) {
+	// We only record where the parts come from here, the resource manager will read
+	// the files in the background and then compile and link the program
 	Shader::Sptr result = std::make_shared<Shader>();
 	for (auto& [key, blob] : data.items()) {
 		// Get the shader part type from the key
@@ -327,19 +419,297 @@ Shader::Sptr Shader::FromJson(const nlohmann::json& data) {
 		if (type != ShaderPartType::Unknown) {
 			// If it has a file, we load from file
 			if (blob.contains("path")) {
-				result->LoadShaderPartFromFile(blob["path"].get<std::string>().c_str(), type);
+				result->_fileSourceMap[type] = { blob["path"].get<std::string>(), true };
 			}
 			// Otherwise we see if there's a source and load that instead
 			else if (blob.contains("source")) {
-				result->LoadShaderPart(blob["source"].get<std::string>().c_str(), type);
+				result->_fileSourceMap[type] = { blob["source"].get<std::string>(), false };
 			}
 			// Otherwise do nothing
 		}
 	}
-	result->Link();
+	result->_loadState = ResourceLoadState::Pending;
 	return result;
 }
 
+bool Shader::_LoadDeferred() {
+	for (auto& [type, part] : _fileSourceMap) {
+		if (part.IsFilePath) {
+			// Make sure that the file exists before we try reading
+			if (std::filesystem::exists(part.Source)) {
+				_pendingSources[type] = FileHelpers::ReadResolveIncludes(part.Source);
+			} else {
+				LOG_WARN("Could not open file at \"{}\"", part.Source);
+			}
+		} else if (!_variantDefine.empty()) {
+			// Variants modify their sources, so inline sources need a copy as well
+			_pendingSources[type] = part.Source;
+		}
+	}
+
+	// Lit shaders mark themselves as supporting variants, see fragments/surface_output.glsl
+	auto fragment = _pendingSources.find(ShaderPartType::Fragment);
+	auto fragmentPart = _fileSourceMap.find(ShaderPartType::Fragment);
+	if (fragment != _pendingSources.end()) {
+		_supportsVariants = fragment->second.find(VARIANT_PRAGMA) != std::string::npos;
+		if (!_variantDefine.empty()) {
+			__InsertDefine(fragment->second, _variantDefine);
+		}
+	} else if (fragmentPart != _fileSourceMap.end() && !fragmentPart->second.IsFilePath) {
+		_supportsVariants = fragmentPart->second.Source.find(VARIANT_PRAGMA) != std::string::npos;
+	}
+
+	if (__SupportsProgramBinaries) {
+		_cacheKey = _HashSources();
+		_ReadCachedBinary();
+	}
+	return true;
+}
+
+void Shader::_FinishDeferredLoad() {
+	// If the driver takes our cached binary, we don't need to compile anything
+	if (_LinkFromCachedBinary()) {
+		_pendingSources.clear();
+		return;
+	}
+
+	// We don't check the parts here, so that the driver can compile them in the background.
+	// Any errors will be reported once linking is done
+	for (auto& [type, part] : _fileSourceMap) {
+		auto it = _pendingSources.find(type);
+		if (it != _pendingSources.end()) {
+			_handles[type] = _CompilePart(it->second.c_str(), type);
+		} else if (!part.IsFilePath) {
+			_handles[type] = _CompilePart(part.Source.c_str(), type);
+		}
+	}
+	_pendingSources.clear();
+
+	_StartLink();
+	_isLinking = true;
+}
+
+bool Shader::_PollDeferredLoad(bool wait) {
+	if (!_isLinking) {
+		return true;
+	}
+	// Without the extension, there's no way to check without waiting
+	if (!wait && __SupportsParallelCompile) {
+		GLint isComplete = GL_FALSE;
+		glGetProgramiv(_handle, GL_COMPLETION_STATUS_KHR, &isComplete);
+		if (isComplete == GL_FALSE) {
+			return false;
+		}
+	}
+	_isLinking = false;
+	_FinishLink();
+	return true;
+}
+
+Shader* Shader::GetVariant(ShaderVariant variant) {
+	if (variant == ShaderVariant::Forward) {
+		return this;
+	}
+	if (!_supportsVariants || !IsReady()) {
+		return nullptr;
+	}
+
+	// Start compiling every variant at once, the driver can work on them in parallel
+	if (!_hasRequestedVariants) {
+		_hasRequestedVariants = true;
+		for (int ix = 1; ix < VARIANT_COUNT; ix++) {
+			Sptr result = std::make_shared<Shader>();
+			result->_fileSourceMap = _fileSourceMap;
+			result->_variantDefine = VARIANT_DEFINES[ix];
+			result->_LoadDeferred();
+			result->_FinishDeferredLoad();
+			_variants[ix] = result;
+		}
+	}
+
+	if (_variantState == ResourceLoadState::Pending) {
+		bool isDone = true;
+		for (int ix = 1; ix < VARIANT_COUNT; ix++) {
+			isDone &= _variants[ix]->_PollDeferredLoad(false);
+		}
+		if (!isDone) {
+			return nullptr;
+		}
+
+		_variantState = ResourceLoadState::Ready;
+		for (int ix = 1; ix < VARIANT_COUNT; ix++) {
+			GLint status = GL_FALSE;
+			glGetProgramiv(_variants[ix]->_handle, GL_LINK_STATUS, &status);
+			if (status == GL_FALSE) {
+				LOG_WARN("Variant {} of shader failed to link, it will only be drawn with forward shading", VARIANT_DEFINES[ix]);
+				_variantState = ResourceLoadState::Failed;
+			}
+		}
+	}
+
+	return _variantState == ResourceLoadState::Ready ? _variants[*variant].get() : nullptr;
+}
+
+void Shader::__InsertDefine(std::string& source, const std::string& define) {
+	// The #version directive has to come first, so we go on the line after it
+	size_t version = source.find("#version");
+	size_t lineEnd = version != std::string::npos ? source.find('\n', version) : std::string::npos;
+	if (lineEnd != std::string::npos) {
+		source.insert(lineEnd + 1, "#define " + define + "\n");
+	} else {
+		source.insert(0, "#define " + define + "\n");
+	}
+}
+
+uint64_t Shader::_HashSources() const {
+	// 64 bit FNV-1a, we only need to spot changes so this doesn't need to be fancy
+	uint64_t hash = 14695981039346656037ull;
+	auto hashBytes = [&hash](const void* data, size_t size) {
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+		for (size_t ix = 0; ix < size; ix++) {
+			hash ^= bytes[ix];
+			hash *= 1099511628211ull;
+		}
+	};
+
+	hashBytes(__DriverInfo.data(), __DriverInfo.size());
+	for (ShaderPartType type : HASHED_PART_ORDER) {
+		auto part = _fileSourceMap.find(type);
+		if (part == _fileSourceMap.end()) {
+			continue;
+		}
+		const std::string* source = &part->second.Source;
+		auto it = _pendingSources.find(type);
+		if (it != _pendingSources.end()) {
+			source = &it->second;
+		} else if (part->second.IsFilePath) {
+			continue;
+		}
+		// Hash the type and length as well, so parts can't run into each other
+		uint64_t header[2] = { static_cast<uint64_t>(type), source->size() };
+		hashBytes(header, sizeof(header));
+		hashBytes(source->data(), source->size());
+	}
+	// 0 means we don't cache, so make sure we can never end up there
+	return hash != 0 ? hash : 1;
+}
+
+void Shader::_ReadCachedBinary() {
+	std::string path = _GetCachePath();
+	if (!std::filesystem::exists(path)) {
+		return;
+	}
+
+	ChunkedFileReader::Sptr file = ChunkedFileReader::Open(path);
+	if (file == nullptr) {
+		return;
+	}
+
+	uint32_t version = 0;
+	BinaryReader data = file->GetChunk(PROGRAM_CACHE_CHUNK, &version);
+	if (version != PROGRAM_CACHE_VERSION) {
+		return;
+	}
+
+	uint64_t hash = data.Read<uint64_t>();
+	uint32_t format = data.Read<uint32_t>();
+	BinaryReader binary = data.ReadBlob();
+	if (!data.IsValid() || hash != _cacheKey || binary.GetSize() == 0) {
+		return;
+	}
+
+	_cachedBinaryFormat = static_cast<GLenum>(format);
+	_cachedBinary.assign(binary.GetData(), binary.GetData() + binary.GetSize());
+}
+
+bool Shader::_LinkFromCachedBinary() {
+	if (_cachedBinary.empty()) {
+		return false;
+	}
+
+	glProgramBinary(_handle, _cachedBinaryFormat, _cachedBinary.data(), static_cast<GLsizei>(_cachedBinary.size()));
+	_cachedBinary.clear();
+	_cachedBinary.shrink_to_fit();
+
+	GLint status = 0;
+	glGetProgramiv(_handle, GL_LINK_STATUS, &status);
+	// Drivers may reject binaries even if the driver info matches, we'll just compile it instead
+	if (status == GL_FALSE) {
+		LOG_TRACE("Cached program binary was rejected, compiling from source");
+		return false;
+	}
+
+	LOG_TRACE("Loaded program from binary cache, starting introspection");
+	_Introspect();
+	return true;
+}
+
+void Shader::_WriteCachedBinary() {
+	GLint length = 0;
+	glGetProgramiv(_handle, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) {
+		return;
+	}
+
+	std::vector<uint8_t> binary(length);
+	GLenum format = GL_NONE;
+	glGetProgramBinary(_handle, length, nullptr, &format, binary.data());
+
+	// File I/O can happen in the background, we have everything we need
+	BinaryWriter data;
+	data.Write<uint64_t>(_cacheKey);
+	data.Write<uint32_t>(static_cast<uint32_t>(format));
+	data.WriteBlob(binary);
+	std::shared_ptr<ChunkedFileWriter> file = std::make_shared<ChunkedFileWriter>();
+	file->AddChunk(PROGRAM_CACHE_CHUNK, PROGRAM_CACHE_VERSION, data.Release());
+
+	JobSystem::Schedule([file, path = _GetCachePath()]() {
+		std::error_code error;
+		std::filesystem::create_directories(BINARY_CACHE_DIRECTORY, error);
+		if (!file->Save(path)) {
+			LOG_WARN("Failed to write shader cache \"{}\"", path);
+		}
+	});
+}
+
+std::string Shader::_GetCachePath() const {
+	std::stringstream stream;
+	stream << BINARY_CACHE_DIRECTORY << std::hex << _cacheKey << BINARY_EXTENSION;
+	return stream.str();
+}
+
+void Shader::__InitDriverInfo() {
+	if (!__DriverInfo.empty()) {
+		return;
+	}
+
+	auto getString = [](GLenum name) {
+		const GLubyte* value = glGetString(name);
+		return value != nullptr ? std::string(reinterpret_cast<const char*>(value)) : std::string();
+	};
+	__DriverInfo = getString(GL_VENDOR) + "|" + getString(GL_RENDERER) + "|" + getString(GL_VERSION);
+
+	GLint numFormats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+	__SupportsProgramBinaries = numFormats > 0;
+
+	// Let the driver compile on as many threads as it wants
+	PFNGLMAXSHADERCOMPILERTHREADSKHRPROC maxCompilerThreads = nullptr;
+	if (glfwExtensionSupported("GL_KHR_parallel_shader_compile")) {
+		maxCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+	} else if (glfwExtensionSupported("GL_ARB_parallel_shader_compile")) {
+		maxCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)glfwGetProcAddress("glMaxShaderCompilerThreadsARB");
+	}
+	if (maxCompilerThreads != nullptr) {
+		maxCompilerThreads(0xFFFFFFFF);
+		__SupportsParallelCompile = true;
+	}
+
+	LOG_INFO("Program binary cache is {}, parallel shader compiling is {}",
+		__SupportsProgramBinaries ? "enabled" : "disabled",
+		__SupportsParallelCompile ? "enabled" : "disabled");
+}
+
 void Shader::_Introspect() {
 	_IntrospectUniforms();
 	_IntrospectUnifromBlocks();
@@ -382,6 +752,11 @@ void Shader::_IntrospectUniforms() {
 		e.Location = props[3];
 		e.ArraySize = props[2];
 
+		// For samplers, we grab the texture unit it's bound to (either via layout(binding=N) or 0 by default)
+		if (GetShaderDataTypeCode(e.Type) == ShaderDataTypecode::Texture) {
+			glGetUniformiv(_handle, e.Location, &e.Binding);
+		}
+
 		// If this is an array, we need to trim the [] off the name
 		if (e.ArraySize > 1) {
 			e.Name = e.Name.substr(0, e.Name.find('['));
@@ -449,17 +824,21 @@ void Shader::_IntrospectUnifromBlocks() {
 				GL_NAME_LENGTH,
 				GL_TYPE,
 				GL_ARRAY_SIZE,
-				GL_OFFSET
+				GL_OFFSET,
+				GL_ARRAY_STRIDE,
+				GL_MATRIX_STRIDE
 			};
 			// Query data from the program
-			int props[4];
-			glGetProgramResourceiv(_handle, GL_UNIFORM, activeVars[v], 4, pNames, 4, NULL, props);
+			int props[6];
+			glGetProgramResourceiv(_handle, GL_UNIFORM, activeVars[v], 6, pNames, 6, NULL, props);
 
-			// Store properties into the UniformInfo
+			// Store properties into the UniformInfo, for block uniforms location is the offset into the block
 			UniformInfo var = UniformInfo();
 			var.Type = FromGLShaderDataType(props[1]);
 			var.Location = props[3];
 			var.ArraySize = props[2];
+			var.ArrayStride = props[4];
+			var.MatrixStride = props[5];
 
 			// Get the uniform name
 			var.Name.resize(props[0] - 1);
@@ -490,6 +869,17 @@ void Shader::BindUniformBlockToSlot(const std::string& name, int uboSlot)
 	}
 }
 
+bool Shader::FindUniformBlock(const std::string& name, UniformBlockInfo* out) {
+	auto it = _uniformBlocks.find(name);
+	if (it != _uniformBlocks.end()) {
+		if (out != nullptr) {
+			*out = it->second;
+		}
+		return true;
+	}
+	return false;
+}
+
 bool Shader::FindUniform(const std::string& name, UniformInfo* out) {
 	for (auto& [key, uniform] : _uniforms) {
 		if (uniform.Name == name) {
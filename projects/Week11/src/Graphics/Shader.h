@@ -3,6 +3,7 @@
 #include <memory>
 #include <string>               // for std::string
 #include <unordered_map>        // for std::unordered_map
+#include <vector>
 #include <GLM/glm.hpp>          // for our GLM types
 #include <GLM/gtc/type_ptr.hpp> // for glm::value_ptr
 #include <Logging.h>            // for the logging functions
@@ -21,14 +22,39 @@ ENUM(ShaderPartType, GLint,
 	 Unknown      = GL_NONE // Usually good practice to have an "unknown" or "none" state for enums
 );
 
+// The ways that a lit shader can be compiled, see fragments/surface_output.glsl
+ENUM(ShaderVariant, int,
+	 Forward      = 0, // Lights fragments as they are drawn, this is the shader itself
+	 GBuffer      = 1, // Writes surfaces into the G-buffer, to be lit later by deferred shading
+	 DepthOnly    = 2  // Writes nothing but depth, for depth pre-passes
+);
+
 /// <summary>
 /// This class will wrap around an OpenGL shader program
+/// 
+/// Shaders loaded from a manifest keep a cache of their linked program binaries,
+/// keyed by a hash of their source and the driver, so that later runs can skip compiling.
+/// When the driver supports KHR_parallel_shader_compile, they are also compiled in
+/// the background so that many shaders can be compiled at the same time
+///
+/// Lit shaders that write their output through fragments/surface_output.glsl can also be
+/// compiled as other variants (see ShaderVariant and GetVariant), which lets the same
+/// material be drawn into the G-buffer or a depth pre-pass
 /// </summary>
 class Shader final : public IResource
 {
 public:
 	typedef std::shared_ptr<Shader> Sptr;
 
+	// The folder that linked program binaries are cached in
+	inline static const std::string BINARY_CACHE_DIRECTORY = "cache/shaders/";
+	// The extension for cached program binaries
+	inline static const std::string BINARY_EXTENSION = ".bin";
+	// The number of values in ShaderVariant
+	inline static const int VARIANT_COUNT = 3;
+	// Fragment shaders that contain this support being compiled as any variant
+	inline static const std::string VARIANT_PRAGMA = "#pragma surface_variants";
+
 	static inline Sptr Create() {
 		return std::make_shared<Shader>();
 	}
@@ -45,14 +71,23 @@ public:
 	struct UniformInfo {
 		ShaderDataType Type;
 		int            ArraySize;
+		// The uniform location, or the byte offset for uniforms within a block
 		int            Location;
 		std::string    Name;
+		// For samplers, the texture unit the shader has the sampler bound to
+		int            Binding;
+		// For uniforms within a block, the distance between array elements and matrix columns in bytes
+		int            ArrayStride;
+		int            MatrixStride;
 
 		UniformInfo() :
 			Type(ShaderDataType::None),
 			ArraySize(0),
 			Location(-1),
-			Name("") {}
+			Name(""),
+			Binding(-1),
+			ArrayStride(0),
+			MatrixStride(0) {}
 	};
 
 	/// <summary>
@@ -78,6 +113,10 @@ public:
 	/// </summary>
 	Shader();
 
+	/// <summary>
+	/// Creates a new shader from the given files, compiles and links it right away
+	/// (or loads it from the binary cache)
+	/// </summary>
 	Shader(const std::unordered_map<ShaderPartType, std::string>& filePaths);
 
 	// Note, we don't need to make this virtual since this class is marked final (basically it can't be used as a base class)
@@ -118,11 +157,32 @@ public:
 	/// </summary>
 	GLuint GetHandle() const { return _handle; }
 
+	/// <summary>
+	/// Returns true if this shader's fragment stage was written with fragments/surface_output.glsl,
+	/// and can be compiled as any ShaderVariant
+	/// </summary>
+	bool SupportsVariants() const { return _supportsVariants; }
+	/// <summary>
+	/// Gets a variant of this shader. The first time a variant is requested, all of them are compiled
+	/// in the background, and none are handed out until all of them are ready. That way every render
+	/// pass that uses variants will agree on which shaders can be drawn with them
+	/// </summary>
+	/// <param name="variant">The variant to get, Forward is always this shader</param>
+	/// <returns>The variant, or nullptr if this shader has no variants or they aren't ready yet</returns>
+	Shader* GetVariant(ShaderVariant variant);
+
 	virtual nlohmann::json ToJson() const override;
 	static Shader::Sptr FromJson(const nlohmann::json& data);
 
 public:
 	bool FindUniform(const std::string& name, UniformInfo* out);
+	/// <summary>
+	/// Finds a uniform block by name, including the layout of all of it's uniforms
+	/// </summary>
+	/// <param name="name">The name of the block in the shader</param>
+	/// <param name="out">If not null, will receive the block info</param>
+	/// <returns>True if the block exists and is active in the program</returns>
+	bool FindUniformBlock(const std::string& name, UniformBlockInfo* out);
 
 	void SetUniformMatrix(int location, const glm::mat3* value, int count = 1, bool transposed = false);
 	void SetUniformMatrix(int location, const glm::mat4* value, int count = 1, bool transposed = false);
@@ -200,6 +260,96 @@ protected:
 	};
 	std::unordered_map<ShaderPartType, ShaderSource> _fileSourceMap;
 
+	// Sources that have been read by _LoadDeferred, waiting to be compiled
+	std::unordered_map<ShaderPartType, std::string> _pendingSources;
+
+	// Hash of our sources and the driver, used to find our program in the binary cache. 0 if
+	// this program should not be cached
+	uint64_t             _cacheKey;
+	// A program binary that _LoadDeferred found in the cache, empty if there was none
+	std::vector<uint8_t> _cachedBinary;
+	GLenum               _cachedBinaryFormat;
+	// True while our program is being compiled and linked in the background
+	bool                 _isLinking;
+
+	// True if our fragment source contains VARIANT_PRAGMA
+	bool                 _supportsVariants;
+	// For variants, the preprocessor define that is added to the top of the fragment stage
+	std::string          _variantDefine;
+	// Our variants, created the first time one is requested. Pending while they compile,
+	// and Failed if any of them did not link
+	Sptr                 _variants[VARIANT_COUNT];
+	ResourceLoadState    _variantState;
+	bool                 _hasRequestedVariants;
+
+	// Identifies the driver, since program binaries can only be used by the driver that made them
+	inline static std::string __DriverInfo = "";
+	inline static bool __SupportsProgramBinaries = false;
+	inline static bool __SupportsParallelCompile = false;
+
+	/// <summary>
+	/// Reads and resolves includes for all file based shader parts
+	/// </summary>
+	virtual bool _LoadDeferred() override;
+	/// <summary>
+	/// Compiles all the shader parts and links the program
+	/// </summary>
+	virtual void _FinishDeferredLoad() override;
+	/// <summary>
+	/// Checks if our program has finished linking in the background, and finishes it if so
+	/// </summary>
+	virtual bool _PollDeferredLoad(bool wait) override;
+
+	/// <summary>
+	/// Creates and compiles a shader part, without checking if it succeeded. Checking right
+	/// away would force the driver to finish compiling it
+	/// </summary>
+	GLuint _CompilePart(const char* source, ShaderPartType type);
+	/// <summary>
+	/// Checks the compile status of a shader part, and logs any errors
+	/// </summary>
+	/// <returns>True if the part compiled successfully</returns>
+	bool _CheckPart(GLuint handle);
+	/// <summary>
+	/// Attaches our parts and starts linking the program
+	/// </summary>
+	void _StartLink();
+	/// <summary>
+	/// Waits for linking to finish, then cleans up our parts and introspects the program
+	/// </summary>
+	/// <returns>True if the program linked</returns>
+	bool _FinishLink();
+
+	/// <summary>
+	/// Hashes the sources of all our parts along with the driver info, must be called
+	/// after the sources have been read
+	/// </summary>
+	uint64_t _HashSources() const;
+	/// <summary>
+	/// Reads our program binary from the cache, if it exists
+	/// </summary>
+	void _ReadCachedBinary();
+	/// <summary>
+	/// Tries to use the binary we read from the cache for our program
+	/// </summary>
+	/// <returns>True if the driver accepted the binary, and the program is ready to use</returns>
+	bool _LinkFromCachedBinary();
+	/// <summary>
+	/// Saves our linked program to the cache, the file is written in the background
+	/// </summary>
+	void _WriteCachedBinary();
+	std::string _GetCachePath() const;
+
+	/// <summary>
+	/// Collects the driver info and enables parallel compiling if we can, only does
+	/// anything the first time it is called. Must be called on the main thread
+	/// </summary>
+	static void __InitDriverInfo();
+	/// <summary>
+	/// Adds a #define on the line after the #version directive of a shader's source
+	/// </summary>
+	static void __InsertDefine(std::string& source, const std::string& define);
+
 	/// <summary>
 	/// Performs program introspection, where we examine the uniforms that
 	/// the program contains
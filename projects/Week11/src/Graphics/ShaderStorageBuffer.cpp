@@ -0,0 +1,57 @@
+#include "ShaderStorageBuffer.h"
+#include "Logging.h"
+
+ShaderStorageBuffer::ShaderStorageBuffer(BufferUsage usage) :
+	IBuffer(BufferType::ShaderStorage, usage),
+	_capacity(0)
+{ }
+
+void ShaderStorageBuffer::Reserve(size_t sizeInBytes) {
+	if (sizeInBytes > _capacity) {
+		// Grow geometrically so that we don't re-allocate every time an object is added
+		size_t newCapacity = _capacity == 0 ? sizeInBytes : _capacity;
+		while (newCapacity < sizeInBytes) {
+			newCapacity *= 2;
+		}
+		glNamedBufferData(_handle, newCapacity, nullptr, (GLenum)_usage);
+		_capacity = newCapacity;
+	}
+}
+
+void ShaderStorageBuffer::UpdateData(const void* data, size_t sizeInBytes) {
+	if (sizeInBytes == 0) {
+		return;
+	}
+	// Re-specifying the storage orphans the old data store, so the driver can hand us fresh
+	// memory instead of waiting for draws that are still reading from the old contents
+	if (sizeInBytes > _capacity) {
+		Reserve(sizeInBytes);
+	} else {
+		glNamedBufferData(_handle, _capacity, nullptr, (GLenum)_usage);
+	}
+	glNamedBufferSubData(_handle, 0, sizeInBytes, data);
+
+	_elementSize = 1;
+	_elementCount = sizeInBytes;
+}
+
+void ShaderStorageBuffer::Bind(int slot) const {
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, slot, _handle);
+}
+
+void ShaderStorageBuffer::BindRange(int slot, size_t offset, size_t size) const {
+	LOG_ASSERT(offset % GetOffsetAlignment() == 0, "SSBO offset is not aligned to GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT");
+	LOG_ASSERT(offset + size <= _capacity, "SSBO range exceeds the bounds of the buffer");
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, slot, _handle, offset, size);
+}
+
+size_t ShaderStorageBuffer::GetOffsetAlignment() {
+	// Only query the driver once, glGet calls can stall the pipeline
+	if (__OffsetAlignment == 0) {
+		glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &__OffsetAlignment);
+		if (__OffsetAlignment <= 0) {
+			__OffsetAlignment = 256;
+		}
+	}
+	return static_cast<size_t>(__OffsetAlignment);
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "IBuffer.h"
+#include <memory>
+
+/// <summary>
+/// A shader storage buffer (SSBO) is a buffer of arbitrary size that shaders can
+/// read from (and write to), which makes it ideal for arrays of per-instance data
+/// that would not fit in a uniform buffer
+/// </summary>
+/// <see>https://www.khronos.org/opengl/wiki/Shader_Storage_Buffer_Object</see>
+class ShaderStorageBuffer : public IBuffer
+{
+public:
+	typedef std::shared_ptr<ShaderStorageBuffer> Sptr;
+
+	static inline Sptr Create(BufferUsage usage = BufferUsage::DynamicDraw) {
+		return std::make_shared<ShaderStorageBuffer>(usage);
+	}
+
+	/// <summary>
+	/// Creates a new shader storage buffer with the given usage, data will need to be uploaded before use
+	/// </summary>
+	/// <param name="usage">The usage hint for the buffer, default is GL_DYNAMIC_DRAW</param>
+	ShaderStorageBuffer(BufferUsage usage = BufferUsage::DynamicDraw);
+	virtual ~ShaderStorageBuffer() = default;
+
+	/// <summary>
+	/// Makes sure this buffer can hold at least the given number of bytes, re-allocating
+	/// the buffer if it is too small. Note that re-allocating will discard the contents
+	/// </summary>
+	/// <param name="sizeInBytes">The minimum size of the buffer, in bytes</param>
+	void Reserve(size_t sizeInBytes);
+
+	/// <summary>
+	/// Replaces the start of this buffer with the given data, growing the buffer if the
+	/// data would not fit. The old contents are orphaned, so this will not stall on
+	/// draw calls that are still using the buffer
+	/// </summary>
+	/// <param name="data">The data to copy into the buffer</param>
+	/// <param name="sizeInBytes">The number of bytes to copy</param>
+	void UpdateData(const void* data, size_t sizeInBytes);
+
+	/// <summary>
+	/// Gets the number of bytes that this buffer has allocated
+	/// </summary>
+	size_t GetCapacity() const { return _capacity; }
+
+	/// <summary>
+	/// Binds the entire buffer to the given SSBO binding slot
+	/// </summary>
+	/// <param name="slot">The binding slot to bind to</param>
+	void Bind(int slot) const;
+	/// <summary>
+	/// Binds a region of the buffer to the given SSBO binding slot, the offset must be
+	/// a multiple of GetOffsetAlignment()
+	/// </summary>
+	/// <param name="slot">The binding slot to bind to</param>
+	/// <param name="offset">The offset into the buffer in bytes</param>
+	/// <param name="size">The size of the region to bind in bytes</param>
+	void BindRange(int slot, size_t offset, size_t size) const;
+
+	/// <summary>
+	/// Gets the minimum alignment in bytes for offsets passed to BindRange
+	/// </summary>
+	static size_t GetOffsetAlignment();
+
+protected:
+	size_t _capacity;
+
+	inline static GLint __OffsetAlignment = 0;
+};
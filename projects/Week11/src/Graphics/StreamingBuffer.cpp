@@ -0,0 +1,176 @@
+#include "StreamingBuffer.h"
+#include "ShaderStorageBuffer.h"
+#include "Logging.h"
+#include <cstring>
+
+// We never read from the mapped memory, and coherent mapping means we don't need to flush
+static const GLbitfield STREAMING_MAP_FLAGS = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+StreamingBuffer::StreamingBuffer(BufferType type, size_t frameCapacity) :
+	IBuffer(type, BufferUsage::StreamDraw),
+	_mapped(nullptr),
+	_frameCapacity(0),
+	_alignment(__GetAlignmentForType(type)),
+	_frameIndex(0),
+	_cursor(0),
+	_fences(),
+	_retired()
+{
+	_CreateStorage(frameCapacity);
+}
+
+StreamingBuffer::~StreamingBuffer() {
+	for (int ix = 0; ix < FRAME_COUNT; ix++) {
+		if (_fences[ix] != nullptr) {
+			glDeleteSync(_fences[ix]);
+		}
+	}
+	for (RetiredBuffer& buffer : _retired) {
+		glDeleteSync(buffer.Fence);
+		glDeleteBuffers(1, &buffer.Handle);
+	}
+	// Deleting the buffer in IBuffer's destructor will unmap it for us
+}
+
+StreamingBuffer::Allocation StreamingBuffer::Allocate(size_t sizeInBytes) {
+	size_t start = (_cursor + _alignment - 1) / _alignment * _alignment;
+	if (start + sizeInBytes > _frameCapacity) {
+		_Grow(sizeInBytes);
+		start = 0;
+	}
+	_cursor = start + sizeInBytes;
+
+	Allocation result;
+	result.Offset = _frameIndex * _frameCapacity + start;
+	result.Data   = _mapped + result.Offset;
+	result.Size   = sizeInBytes;
+	result.Buffer = _handle;
+	return result;
+}
+
+StreamingBuffer::Allocation StreamingBuffer::Push(const void* data, size_t sizeInBytes) {
+	Allocation result = Allocate(sizeInBytes);
+	memcpy(result.Data, data, sizeInBytes);
+	return result;
+}
+
+void StreamingBuffer::Shrink(Allocation& allocation, size_t sizeInBytes) {
+	LOG_ASSERT(allocation.Buffer == _handle && allocation.Offset + allocation.Size == _frameIndex * _frameCapacity + _cursor, "Only the most recent allocation can be shrunk");
+	LOG_ASSERT(sizeInBytes <= allocation.Size, "Allocations can only be shrunk, not grown");
+	_cursor -= allocation.Size - sizeInBytes;
+	allocation.Size = sizeInBytes;
+}
+
+void StreamingBuffer::BindRange(int slot, const Allocation& allocation) const {
+	BindRange(slot, allocation, 0, allocation.Size);
+}
+
+void StreamingBuffer::BindRange(int slot, const Allocation& allocation, size_t offset, size_t size) const {
+	LOG_ASSERT(_type == BufferType::Uniform || _type == BufferType::ShaderStorage, "Only uniform and shader storage buffers can be bound to a slot");
+	LOG_ASSERT((allocation.Offset + offset) % _alignment == 0, "Streaming buffer range is not aligned to the buffer's offset alignment");
+	LOG_ASSERT(offset + size <= allocation.Size, "Range exceeds the bounds of the allocation");
+	glBindBufferRange((GLenum)_type, slot, allocation.Buffer, allocation.Offset + offset, size);
+}
+
+void StreamingBuffer::NextFrame() {
+	// Fence off everything that has been issued using this frame's region
+	_fences[_frameIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	// Move to the next region, making sure the GPU is done with it. With 3 frames in
+	// flight this will almost never actually have to wait
+	_frameIndex = (_frameIndex + 1) % FRAME_COUNT;
+	_cursor = 0;
+	if (_fences[_frameIndex] != nullptr) {
+		__WaitAndDelete(_fences[_frameIndex]);
+	}
+
+	// Clean up any buffers we've grown out of, once the GPU is done with them
+	for (size_t ix = 0; ix < _retired.size(); ix++) {
+		GLenum status = glClientWaitSync(_retired[ix].Fence, 0, 0);
+		if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+			glDeleteSync(_retired[ix].Fence);
+			glDeleteBuffers(1, &_retired[ix].Handle);
+			_retired.erase(_retired.begin() + ix);
+			ix--;
+		}
+	}
+}
+
+void StreamingBuffer::LoadData(const void*, size_t, size_t) {
+	LOG_ASSERT(false, "Streaming buffers can not be re-specified, use Allocate or Push instead");
+}
+
+void StreamingBuffer::_CreateStorage(size_t frameCapacity) {
+	// Keep each region aligned, so that region offsets are valid binding offsets
+	_frameCapacity = (frameCapacity + _alignment - 1) / _alignment * _alignment;
+
+	size_t totalSize = _frameCapacity * FRAME_COUNT;
+	glNamedBufferStorage(_handle, totalSize, nullptr, STREAMING_MAP_FLAGS);
+	_mapped = static_cast<uint8_t*>(glMapNamedBufferRange(_handle, 0, totalSize, STREAMING_MAP_FLAGS));
+	LOG_ASSERT(_mapped != nullptr, "Failed to persistently map streaming buffer");
+
+	_elementSize = 1;
+	_elementCount = totalSize;
+}
+
+void StreamingBuffer::_Grow(size_t minFrameCapacity) {
+	size_t newCapacity = _frameCapacity * 2;
+	while (newCapacity < minFrameCapacity) {
+		newCapacity *= 2;
+	}
+	LOG_WARN("Streaming buffer ran out of space, growing from {} to {} bytes per frame", _frameCapacity, newCapacity);
+
+	// Buffer storage is immutable, so we need a new buffer. The old one may still be in
+	// use by the GPU (and by allocations made earlier this frame), so we keep it around
+	// until a fence tells us it's safe to delete
+	RetiredBuffer retired;
+	retired.Handle = _handle;
+	retired.Fence  = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	_retired.push_back(retired);
+
+	// The retired fence covers everything issued so far, so we don't need the per-frame ones
+	for (int ix = 0; ix < FRAME_COUNT; ix++) {
+		if (_fences[ix] != nullptr) {
+			glDeleteSync(_fences[ix]);
+			_fences[ix] = nullptr;
+		}
+	}
+
+	glCreateBuffers(1, &_handle);
+	_CreateStorage(newCapacity);
+	_frameIndex = 0;
+	_cursor = 0;
+}
+
+void StreamingBuffer::__WaitAndDelete(GLsync& fence) {
+	while (true) {
+		GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); // 1ms
+		if (status != GL_TIMEOUT_EXPIRED) {
+			break;
+		}
+	}
+	glDeleteSync(fence);
+	fence = nullptr;
+}
+
+size_t StreamingBuffer::__GetAlignmentForType(BufferType type) {
+	switch (type) {
+		case BufferType::Uniform:
+		{
+			// Only query the driver once, glGet calls can stall the pipeline
+			static GLint alignment = 0;
+			if (alignment == 0) {
+				glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+				if (alignment <= 0) {
+					alignment = 256;
+				}
+			}
+			return static_cast<size_t>(alignment);
+		}
+		case BufferType::ShaderStorage:
+			return ShaderStorageBuffer::GetOffsetAlignment();
+		default:
+			// Enough for any vertex or index element
+			return 16;
+	}
+}
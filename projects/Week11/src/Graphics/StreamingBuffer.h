@@ -0,0 +1,150 @@
+#pragma once
+#include "IBuffer.h"
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+/// <summary>
+/// A buffer for data that is re-written every frame (per-frame and per-draw uniforms,
+/// instance data, debug geometry, etc...)
+///
+/// The buffer is allocated once with glNamedBufferStorage and stays persistently mapped,
+/// so uploading is just a memcpy into the mapped memory. It is split into FRAME_COUNT
+/// regions, and each frame hands out aligned sub-allocations from the next region. A fence
+/// is placed at the end of every frame, and we only wait on it when we come back around
+/// to that region, so the CPU never overwrites data the GPU may still be reading and we
+/// never stall on in-flight draws the way glNamedBufferSubData can
+/// </summary>
+class StreamingBuffer : public IBuffer
+{
+public:
+	typedef std::shared_ptr<StreamingBuffer> Sptr;
+
+	// The number of frames of data we keep in flight
+	inline static const int FRAME_COUNT = 3;
+
+	/// <summary>
+	/// A region of the buffer that has been handed out for the current frame
+	/// </summary>
+	struct Allocation {
+		// Pointer to the mapped memory for this allocation, write only!
+		uint8_t* Data   = nullptr;
+		// The offset of the allocation from the start of the buffer, in bytes
+		size_t   Offset = 0;
+		// The size of the allocation in bytes
+		size_t   Size   = 0;
+		// The GL buffer the allocation lives in. If the streaming buffer grows, allocations made
+		// before that still point at the old buffer, which is kept alive until the GPU is done with it
+		GLuint   Buffer = 0;
+	};
+
+	static inline Sptr Create(BufferType type, size_t frameCapacity = 64 * 1024) {
+		return std::make_shared<StreamingBuffer>(type, frameCapacity);
+	}
+
+	/// <summary>
+	/// Creates a new streaming buffer
+	/// </summary>
+	/// <param name="type">The type of buffer, determines the alignment of allocations</param>
+	/// <param name="frameCapacity">The number of bytes that can be allocated each frame before the buffer needs to grow</param>
+	StreamingBuffer(BufferType type, size_t frameCapacity = 64 * 1024);
+	virtual ~StreamingBuffer();
+
+	/// <summary>
+	/// Allocates a region of the buffer for this frame, aligned to the buffer type's offset
+	/// alignment. The contents of the region are undefined, and must be written before
+	/// being used. If the frame runs out of space the buffer will grow
+	/// </summary>
+	/// <param name="sizeInBytes">The size of the region to allocate</param>
+	Allocation Allocate(size_t sizeInBytes);
+	/// <summary>
+	/// Allocates a region of the buffer and copies the given data into it
+	/// </summary>
+	Allocation Push(const void* data, size_t sizeInBytes);
+	/// <summary>
+	/// Allocates a region of the buffer and copies the value into it
+	/// </summary>
+	template <typename T>
+	Allocation Push(const T& value) {
+		return Push(&value, sizeof(T));
+	}
+	/// <summary>
+	/// Gives back the unused end of the most recent allocation, so that it can be handed out
+	/// again this frame. This lets callers allocate for the worst case and only keep what they wrote
+	/// </summary>
+	/// <param name="allocation">The allocation to shrink, must be the last one made</param>
+	/// <param name="sizeInBytes">The new size of the allocation</param>
+	void Shrink(Allocation& allocation, size_t sizeInBytes);
+
+	/// <summary>
+	/// Binds an allocation to an indexed binding point (only valid for uniform and shader storage buffers)
+	/// </summary>
+	/// <param name="slot">The binding slot to bind to</param>
+	/// <param name="allocation">The allocation to bind</param>
+	void BindRange(int slot, const Allocation& allocation) const;
+	/// <summary>
+	/// Binds a sub-range of an allocation to an indexed binding point
+	/// </summary>
+	/// <param name="slot">The binding slot to bind to</param>
+	/// <param name="allocation">The allocation to bind from</param>
+	/// <param name="offset">The offset into the allocation in bytes, must be aligned to GetOffsetAlignment</param>
+	/// <param name="size">The number of bytes to bind</param>
+	void BindRange(int slot, const Allocation& allocation, size_t offset, size_t size) const;
+
+	/// <summary>
+	/// Marks the end of the frame, must be called once per frame after all the draws that
+	/// use this frame's allocations have been issued. Allocations from previous frames
+	/// must not be used after this
+	/// </summary>
+	void NextFrame();
+
+	/// <summary>
+	/// Gets the number of bytes that can be allocated in a single frame
+	/// </summary>
+	size_t GetFrameCapacity() const { return _frameCapacity; }
+	/// <summary>
+	/// Gets the alignment that allocations will be given, based on the buffer type
+	/// </summary>
+	size_t GetOffsetAlignment() const { return _alignment; }
+
+private:
+	// Data is written with Allocate, the storage is immutable so we can't re-specify it. An override
+	// can't be deleted, so instead it's private to catch misuse at compile time, and asserts if it's
+	// called through an IBuffer
+	virtual void LoadData(const void*, size_t, size_t) override;
+
+protected:
+	uint8_t* _mapped;
+	size_t   _frameCapacity;
+	size_t   _alignment;
+	// The region we are currently allocating from, and our position in that region
+	int      _frameIndex;
+	size_t   _cursor;
+	// Fences placed at the end of the last frame that used each region, or nullptr
+	GLsync   _fences[FRAME_COUNT];
+
+	// When we grow, the old buffer can't be deleted until the GPU is done with it
+	struct RetiredBuffer {
+		GLuint Handle;
+		GLsync Fence;
+	};
+	std::vector<RetiredBuffer> _retired;
+
+	/// <summary>
+	/// Creates and maps the storage for the buffer
+	/// </summary>
+	void _CreateStorage(size_t frameCapacity);
+	/// <summary>
+	/// Replaces the buffer with a larger one, the old buffer is retired until the GPU is done with it
+	/// </summary>
+	void _Grow(size_t minFrameCapacity);
+
+	/// <summary>
+	/// Waits for a fence to be signalled, then deletes it and sets it to nullptr
+	/// </summary>
+	static void __WaitAndDelete(GLsync& fence);
+	/// <summary>
+	/// Gets the offset alignment required to bind ranges of the given buffer type
+	/// </summary>
+	static size_t __GetAlignmentForType(BufferType type);
+};
@@ -1,8 +1,8 @@
 #include "Texture2D.h"
-#include <stb_image.h>
 #include <Logging.h>
 #include "GLM/glm.hpp"
 #include "Utils/JsonGlmHelpers.h"
+#include "Graphics/TextureStreamer.h"
 
 /// <summary>
 /// Get the number of mipmap levels required for a texture of the given size
@@ -23,6 +23,7 @@ nlohmann::json Texture2D::ToJson() const {
 		{ "filter_mag",       ~_description.MagnificationFilter },
 		{ "anisotropic",       _description.MaxAnisotropic },
 		{ "generate_mipmaps",  _description.GenerateMipMaps },
+		{ "compression",      ~_description.Compression },
 	};
 }
 
@@ -36,21 +37,53 @@ Texture2D::Sptr Texture2D::FromJson(const nlohmann::json& data)
 	descr.MagnificationFilter = JsonParseEnum(MagFilter, data, "filter_mag", MagFilter::Linear);
 	descr.MaxAnisotropic      = JsonGet(data, "anisotropic", 0.0f);
 	descr.GenerateMipMaps     = JsonGet(data, "generate_mipmaps", false);
-	return std::make_shared<Texture2D>(descr);
+	descr.Compression         = JsonParseEnum(TextureCompression, data, "compression", TextureCompression::Auto);
+
+	// Create the texture without a file so that nothing is loaded yet, the resource
+	// manager will decode the image in the background and then finish the load
+	std::string filename = descr.Filename;
+	descr.Filename = "";
+	Texture2D::Sptr result = std::make_shared<Texture2D>(descr);
+	result->_description.Filename = filename;
+	if (!filename.empty()) {
+		result->_loadState = ResourceLoadState::Pending;
+	}
+	return result;
 }
 
-Texture2D::Texture2D(const Texture2DDescription& description) : ITexture(TextureType::_2D) {
+Texture2D::Texture2D(const Texture2DDescription& description) :
+	ITexture(TextureType::_2D),
+	_residentLevel(0),
+	_tailLevel(0)
+{
 	_description = description;
 	_SetTextureParams();
 	_LoadDataFromFile();
 }
 
-Texture2D::Texture2D(const std::string& filePath) : ITexture(TextureType::_2D) {
+Texture2D::Texture2D(const std::string& filePath) :
+	ITexture(TextureType::_2D),
+	_residentLevel(0),
+	_tailLevel(0)
+{
 	_description.Filename = filePath;
 	_SetTextureParams();
 	_LoadDataFromFile();
 }
 
+Texture2D::~Texture2D() {
+	// Make sure the streamer doesn't try to touch us after we're gone
+	TextureStreamer::Unregister(this);
+}
+
+size_t Texture2D::GetMemorySize(uint32_t firstLevel) const {
+	size_t result = 0;
+	for (size_t ix = firstLevel; ix < _levelData.Levels.size(); ix++) {
+		result += _levelData.Levels[ix].Size;
+	}
+	return result;
+}
+
 void Texture2D::SetMinFilter(MinFilter value) {
 	_description.MinificationFilter = value;
 	glTextureParameteri(_handle, GL_TEXTURE_MIN_FILTER, *_description.MinificationFilter);
@@ -66,7 +99,8 @@ void Texture2D::SetAnisoLevel(float value) {
 		_description.MaxAnisotropic = glm::clamp(value, 1.0f, ITexture::GetLimits().MAX_ANISOTROPY);
 		glTextureParameterf(_handle, GL_TEXTURE_MAX_ANISOTROPY, _description.MaxAnisotropic);
 
-		if (_description.GenerateMipMaps) {
+		// Textures loaded from files already have all their mips
+		if (_description.GenerateMipMaps && _levelData.Levels.empty()) {
 			glGenerateTextureMipmap(_handle);
 		}
 	}
@@ -76,6 +110,8 @@ void Texture2D::LoadData(uint32_t width, uint32_t height, PixelFormat format, Pi
 	// Ensure the rectangle we're setting is within the bounds of the image
 	LOG_ASSERT((width + offsetX) <= _description.Width, "Pixel bounds are outside of the X extents of the image!");
 	LOG_ASSERT((height + offsetY) <= _description.Height, "Pixel bounds are outside of the Y extents of the image!");
+	// Streamed textures may not have level 0 in memory, and compressed ones can't take texels directly
+	LOG_ASSERT(_levelData.Levels.empty(), "Cannot load data into a texture that was loaded from a file!");
 
 	// Align the data store to the size of a single component to ensure we don't get weirdness with images that aren't RGBA
 	// See https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glPixelStore.xhtml
@@ -94,52 +130,78 @@ void Texture2D::LoadData(uint32_t width, uint32_t height, PixelFormat format, Pi
 void Texture2D::_LoadDataFromFile() {
 	LOG_ASSERT(_description.Width + _description.Height == 0, "This texture has already been configured with a size! Cannot re-allocate memory!");
 
-	if (!_description.Filename.empty()) {
-		// Variables that will store properties about our image
-		int width, height, numChannels;
-		const int targetChannels = GetTexelComponentCount(_description.FormatHint);
-
-		// Use STBI to load the image
-		stbi_set_flip_vertically_on_load(true);
-		uint8_t* data = stbi_load(_description.Filename.c_str(), &width, &height, &numChannels, targetChannels);
-
-		// If we could not load any data, warn and return null
-		if (data == nullptr) {
-			LOG_WARN("STBI Failed to load image from \"{}\"", _description.Filename);
-			return ;
-		}
+	if (!_description.Filename.empty() && _LoadLevels()) {
+		_UploadLevels();
+	}
+}
 
-		// We should estimate a good format for our data
+bool Texture2D::_LoadLevels() {
+	TextureCache::Settings settings(
+		_description.Compression,
+		_description.GenerateMipMaps,
+		GetTexelComponentCount(_description.FormatHint),
+		ITexture::GetLimits().SUPPORTS_S3TC
+	);
+	return TextureCache::Load({ _description.Filename }, settings, _levelData);
+}
 
-		// numChannels will store the number of channels in the image on disk, if we overrode that we should use the override value
-		if (targetChannels != 0)
-			numChannels = targetChannels;
+void Texture2D::_UploadLevels() {
+	// Update our description to match what we loaded
+	_description.Format = _levelData.Format;
+	_description.Width  = _levelData.Levels[0].Width;
+	_description.Height = _levelData.Levels[0].Height;
+
+	// We start with only the smallest levels, the streamer will bring in the rest once we get drawn
+	uint32_t levelCount = GetLevelCount();
+	_tailLevel = 0;
+	while (_tailLevel + 1 < levelCount && glm::max(_levelData.Levels[_tailLevel].Width, _levelData.Levels[_tailLevel].Height) > TextureStreamer::RESIDENT_TAIL_SIZE) {
+		_tailLevel++;
+	}
+	// Nothing is resident yet, so every level gets uploaded
+	_residentLevel = levelCount;
+	_SetResidentLevel(_tailLevel);
 
-		// We'll determine a recommended format for the image based on number of channels
-		// We hinted that we wanted a certain number of channels, but we're not guaranteed
-		// that all those channels exist (ex: loading an RGB image but requesting RGBA)
-		InternalFormat internal_format = GetInternalFormatForChannels8(numChannels);
-		PixelFormat    image_format = GetPixelFormatForChannels(numChannels);
+	if (_tailLevel > 0) {
+		TextureStreamer::Register(this);
+	}
+}
 
-		// This is one of those poorly documented things in OpenGL
-		if ((numChannels * width) % 4 != 0) {
-			LOG_WARN("The alignment of a horizontal line is not a multiple of 4, this will require a call to glPixelStorei(GL_PACK_ALIGNMENT)");
+void Texture2D::_SetResidentLevel(uint32_t level) {
+	LOG_ASSERT(level < GetLevelCount(), "Level {} is out of range!", level);
+	const TextureCache::LevelData& base = _levelData.Levels[level];
+
+	// Immutable storage can't be resized, so we make a new texture with just the levels we want
+	GLuint handle = 0;
+	glCreateTextures(GL_TEXTURE_2D, 1, &handle);
+	glTextureStorage2D(handle, GetLevelCount() - level, (GLenum)_levelData.Format, base.Width, base.Height);
+
+	// Rows of uncompressed images are tightly packed in the cache
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (uint32_t ix = level; ix < GetLevelCount(); ix++) {
+		const TextureCache::LevelData& data = _levelData.Levels[ix];
+		if (ix >= _residentLevel) {
+			glCopyImageSubData(_handle, GL_TEXTURE_2D, ix - _residentLevel, 0, 0, 0, handle, GL_TEXTURE_2D, ix - level, 0, 0, 0, data.Width, data.Height, 1);
+		} else if (_levelData.IsCompressed()) {
+			glCompressedTextureSubImage2D(handle, ix - level, 0, 0, data.Width, data.Height, (GLenum)_levelData.Format, (GLsizei)data.Size, data.Data);
+		} else {
+			glTextureSubImage2D(handle, ix - level, 0, 0, data.Width, data.Height, (GLenum)_levelData.PixelLayout, GL_UNSIGNED_BYTE, data.Data);
 		}
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
-		// Update our description to match what we loaded
-		_description.Format = internal_format;
-		_description.Width = width;
-		_description.Height = height;
-
-		// Allocates our memory
-		_SetTextureParams();
+	// Materials look up our handle every time they are applied, so we can just swap it out
+	glDeleteTextures(1, &_handle);
+	_handle = handle;
+	_residentLevel = level;
+	_ApplySamplerParams();
+}
 
-		// Upload data to our texture
-		LoadData(width, height, image_format, PixelType::UByte, data);
+bool Texture2D::_LoadDeferred() {
+	return _LoadLevels();
+}
 
-		// We now have data in the image, we can clear the STBI data
-		stbi_image_free(data);
-	}
+void Texture2D::_FinishDeferredLoad() {
+	_UploadLevels();
 }
 
 void Texture2D::_SetTextureParams() {
@@ -155,14 +217,18 @@ void Texture2D::_SetTextureParams() {
 		// Allocates the memory for our texture
 		glTextureStorage2D(_handle, layers, (GLenum)_description.Format, _description.Width, _description.Height);
 
-		glTextureParameteri(_handle, GL_TEXTURE_WRAP_S, (GLenum)_description.HorizontalWrap);
-		glTextureParameteri(_handle, GL_TEXTURE_WRAP_T, (GLenum)_description.VerticalWrap);
-		glTextureParameteri(_handle, GL_TEXTURE_MIN_FILTER, (GLenum)_description.MinificationFilter);
-		glTextureParameteri(_handle, GL_TEXTURE_MAG_FILTER, (GLenum)_description.MagnificationFilter);
-		glTextureParameterf(_handle, GL_TEXTURE_MAX_ANISOTROPY, _description.MaxAnisotropic);
+		_ApplySamplerParams();
 	}
 }
 
+void Texture2D::_ApplySamplerParams() {
+	glTextureParameteri(_handle, GL_TEXTURE_WRAP_S, (GLenum)_description.HorizontalWrap);
+	glTextureParameteri(_handle, GL_TEXTURE_WRAP_T, (GLenum)_description.VerticalWrap);
+	glTextureParameteri(_handle, GL_TEXTURE_MIN_FILTER, (GLenum)_description.MinificationFilter);
+	glTextureParameteri(_handle, GL_TEXTURE_MAG_FILTER, (GLenum)_description.MagnificationFilter);
+	glTextureParameterf(_handle, GL_TEXTURE_MAX_ANISOTROPY, _description.MaxAnisotropic);
+}
+
 Texture2D::Sptr Texture2D::LoadFromFile(const std::string& path, const Texture2DDescription& description, bool forceRgba) {
 	// Create a copy of the description and change filename to the path
 	Texture2DDescription desc = description;
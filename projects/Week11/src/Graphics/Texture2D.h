@@ -1,5 +1,6 @@
 #pragma once
 #include "ITexture.h"
+#include "Utils/TextureCache.h"
 
 /// <summary>
 /// Describes all parameters we can manipulate with our 2D Textures
@@ -56,6 +57,12 @@ struct Texture2DDescription {
 	/// </summary>
 	PixelFormat    FormatHint;
 
+	/// <summary>
+	/// How the texture should be compressed when it is loaded from a file, default Auto.
+	/// The converted image is cached next to the file, see TextureCache
+	/// </summary>
+	TextureCompression Compression;
+
 	Texture2DDescription() :
 		Width(0), Height(0),
 		Format(InternalFormat::Unknown),
@@ -66,7 +73,8 @@ struct Texture2DDescription {
 		MaxAnisotropic(-1.0f), // max aniso by default
 		GenerateMipMaps(true),
 		Filename(""),
-		FormatHint(PixelFormat::RGBA)
+		FormatHint(PixelFormat::RGBA),
+		Compression(TextureCompression::Auto)
 	{ }
 };
 
@@ -81,7 +89,7 @@ public:
 	Texture2D& operator=(Texture2D&& other) = delete;
 
 	// Make sure we mark our destructor as virtual so base class is called
-	virtual ~Texture2D() = default;
+	virtual ~Texture2D();
 
 public:
 	Texture2D(const std::string& filePath);
@@ -142,12 +150,63 @@ public:
 	/// </summary>
 	const Texture2DDescription& GetDescription() const { return _description; }
 
+	/// <summary>
+	/// Gets the number of mip levels that were loaded from the texture's file, or 0 if
+	/// the texture was not loaded from a file
+	/// </summary>
+	uint32_t GetLevelCount() const { return static_cast<uint32_t>(_levelData.Levels.size()); }
+	/// <summary>
+	/// Gets the most detailed mip level that is in video memory, levels between this and
+	/// the tail level are streamed in and out by the TextureStreamer
+	/// </summary>
+	uint32_t GetResidentLevel() const { return _residentLevel; }
+	/// <summary>
+	/// Gets the most detailed mip level that is always kept in video memory
+	/// </summary>
+	uint32_t GetTailLevel() const { return _tailLevel; }
+	/// <summary>
+	/// Gets the video memory needed to store the given level and all of the levels below it, in bytes
+	/// </summary>
+	size_t GetMemorySize(uint32_t firstLevel) const;
+
 	virtual nlohmann::json ToJson() const override;
 	static Texture2D::Sptr FromJson(const nlohmann::json& data);
 
 protected:
+	friend class TextureStreamer;
+
 	Texture2DDescription _description;
 
+	// The levels loaded from the texture cache by _LoadDeferred, these stay mapped so that
+	// levels can be streamed back in after they are evicted
+	TextureCache::TextureData _levelData;
+	// The most detailed level in video memory, level 0 of our GL texture is this level
+	uint32_t _residentLevel;
+	// The most detailed level that is always resident
+	uint32_t _tailLevel;
+
+	/// <summary>
+	/// Loads the image file specified in the description through the texture cache, this
+	/// does not touch OpenGL, so it can be called from any thread
+	/// </summary>
+	/// <returns>True if the image was loaded, false if otherwise</returns>
+	bool _LoadLevels();
+	/// <summary>
+	/// Uploads the tail of the loaded levels, and hands the texture over to the TextureStreamer
+	/// if it has more levels to stream in. Will overwrite description size and format
+	/// </summary>
+	void _UploadLevels();
+	/// <summary>
+	/// Recreates the texture's storage so that the given level is the most detailed level in
+	/// video memory. Levels that are already resident are copied over on the GPU, and new levels
+	/// are uploaded from the texture cache
+	/// </summary>
+	/// <param name="level">The new most detailed level, must be less than GetLevelCount()</param>
+	void _SetResidentLevel(uint32_t level);
+
+	virtual bool _LoadDeferred() override;
+	virtual void _FinishDeferredLoad() override;
+
 	/// <summary>
 	/// Loads this texture from the file specified in the description
 	/// Will overwrite description size
@@ -157,6 +216,10 @@ protected:
 	/// Allocates our texture's memory and sets sampling / filtering parameters
 	/// </summary>
 	void _SetTextureParams();
+	/// <summary>
+	/// Sets the sampling / filtering parameters from our description on our texture
+	/// </summary>
+	void _ApplySamplerParams();
 
 public:
 	static Texture2D::Sptr LoadFromFile(const std::string& path, const Texture2DDescription& description = Texture2DDescription(), bool forceRgba = true);
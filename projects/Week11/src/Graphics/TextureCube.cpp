@@ -1,6 +1,5 @@
 #include "Graphics/TextureCube.h"
 #include <filesystem>
-#include "stb_image.h"
 #include "Utils/JsonGlmHelpers.h"
 
 TextureCube::TextureCube(const std::string& baseFilename) :
@@ -26,11 +25,17 @@ TextureCube::TextureCube(const TextureCubeDescription& description) :
 	_LoadFromDescription();
 }
 
+TextureCube::TextureCube() :
+	ITexture(TextureType::Cubemap),
+	_description(TextureCubeDescription())
+{ }
+
 nlohmann::json TextureCube::ToJson() const
 {
 	nlohmann::json result;
 	result["filter_min"] = ~_description.MinificationFilter;
 	result["filter_mag"] = ~_description.MagnificationFilter;
+	result["compression"] = ~_description.Compression;
 	
 	if (!_description.FaceFileNames.empty()) {
 		result["face_filenames"] = nlohmann::json();
@@ -49,6 +54,7 @@ TextureCube::Sptr TextureCube::FromJson(const nlohmann::json& data)
 	TextureCubeDescription descr = TextureCubeDescription();
 	descr.MinificationFilter  = JsonParseEnum(MinFilter, data, "filter_min", MinFilter::NearestMipNearest);
 	descr.MagnificationFilter = JsonParseEnum(MagFilter, data, "filter_mag", MagFilter::Linear);
+	descr.Compression         = JsonParseEnum(TextureCompression, data, "compression", TextureCompression::Auto);
 	descr.Filename       = JsonGet<std::string>(data, "base_filename", "");
 	if (data.contains("face_filenames") && data["face_filenames"].is_object()) {
 		for (auto& [key, value] : data["face_filenames"].items()) {
@@ -58,10 +64,34 @@ TextureCube::Sptr TextureCube::FromJson(const nlohmann::json& data)
 			}
 		}
 	}
-	return std::make_shared<TextureCube>(descr);
+
+	// Constructor is protected, so we can't use make_shared. We only resolve the face
+	// names here, the resource manager will decode the images in the background and
+	// then finish the load
+	TextureCube::Sptr result(new TextureCube());
+	result->_description = descr;
+	if (result->_ResolveFaceFilenames()) {
+		result->_loadState = ResourceLoadState::Pending;
+	} else {
+		LOG_ERROR("TextureCube was not given 6 faces, aborting load");
+		result->_loadState = ResourceLoadState::Failed;
+	}
+	return result;
 }
 
 void TextureCube::_LoadFromDescription()
+{
+	// If we don't have 6 faces for our cube, something has gone horribly wrong (or the files don't exist)
+	if (!_ResolveFaceFilenames()) {
+		LOG_ERROR("TextureCube was not given 6 faces, aborting load");
+		return;
+	}
+
+	// Load all the images into the texture
+	_LoadImages(_description.FaceFileNames);
+}
+
+bool TextureCube::_ResolveFaceFilenames()
 {
 	// If we weren't passed face filenames but WERE passed a base filename, try and get the 6 face files
 	if (_description.FaceFileNames.empty() && !_description.Filename.empty()) {
@@ -88,100 +118,85 @@ void TextureCube::_LoadFromDescription()
 		}
 	}
 
-	// If we don't have 6 faces for our cube, something has gone horribly wrong (or the files don't exist)
-	if (_description.FaceFileNames.size() != 6) {
-		LOG_ERROR("TextureCube was not given 6 faces, aborting load");
-		return;
-	}
-
-	// Load all the images into the texture
-	_LoadImages(_description.FaceFileNames);
+	return _description.FaceFileNames.size() == 6;
 }
 
 void TextureCube::_LoadImages(const std::unordered_map<CubeMapFace, std::string>& faceFilenames)
 {
-	// Will store all of our texture data, back to back in memory
-	uint8_t* datastore = nullptr;
-	// The size of a single face's texture, in bytes
-	size_t textureDataSize = 0;
-
-	// The number of channels that we're expecting
-	int numChannels = 0;
+	TextureCache::TextureData levels;
+	if (_LoadLevels(faceFilenames, levels)) {
+		_UploadLevels(levels);
+	}
+}
 
-	// Load all 6 faces
+bool TextureCube::_LoadLevels(const std::unordered_map<CubeMapFace, std::string>& faceFilenames, TextureCache::TextureData& result) const
+{
+	// The cache stores the faces in the same order as the GL face indices
+	std::vector<std::string> sources;
 	for (int ix = 0; ix < 6; ix++) {
-		CubeMapFace face = (CubeMapFace)ix;
-		
-		const std::string& filename = _description.FaceFileNames[face];
-		int fileWidth, fileHeight, fileNumChannels;
-
-		// Use STBI to load the image
-		stbi_set_flip_vertically_on_load(true);
-		uint8_t* data = stbi_load(filename.c_str(), &fileWidth, &fileHeight, &fileNumChannels, 0);
-
-		// If we could not load any data, warn and return null
-		if (data == nullptr) {
-			if (data != nullptr) { delete[] datastore; }
-			LOG_ERROR("STBI Failed to load image from \"{}\"", filename);
-			return;
-		}
-		// If the texture is not square, warn and abort
-		if (fileWidth != fileHeight) {
-			if (data != nullptr) { delete[] datastore; }
-			LOG_ERROR("Image loaded from \"{}\" was not square", filename);
-			stbi_image_free(data);
-			return;
-		}
-		// If the dataStore is empty, this is the first texture we loaded
-		if (datastore == nullptr) {
-			// Store the size and number of channels
-			_description.Size = fileWidth;
-			numChannels = fileNumChannels;
-
-			// Get the format and pixel format for the number of channels
-			_description.Format = GetInternalFormatForChannels8(numChannels);
-			_description.FormatHint = GetPixelFormatForChannels(numChannels);
-
-			// Determine how many bytes we'll need to store a single face worth of data
-			textureDataSize = ((size_t)_description.Size * _description.Size * GetTexelSize(_description.FormatHint, PixelType::Byte));
-
-			// This is one of those poorly documented things in OpenGL
-			if ((GetTexelSize(_description.FormatHint, PixelType::Byte) * _description.Size) % 4 != 0) {
-				LOG_WARN("The alignment of a horizontal line is not a multiple of 4, this will require a call to glPixelStorei(GL_PACK_ALIGNMENT)");
-			}
+		sources.push_back(faceFilenames.at((CubeMapFace)ix));
+	}
 
-			// Allocate the data store for our image data
-			datastore = new uint8_t[textureDataSize * 6];
-		}
-		// If this is NOT the first image, and it does not match previous images, abort
-		else if (fileWidth != _description.Size || fileNumChannels != numChannels) {
-			delete[] datastore;
-			LOG_WARN("Image \"{}\" did not match size or format of texture cube", filename);
-			stbi_image_free(data);
-			return;
-		}
+	// We only need mips if our filter is going to sample them
+	bool usesMipMaps = _description.MinificationFilter != MinFilter::Nearest && _description.MinificationFilter != MinFilter::Linear;
+	TextureCache::Settings settings(_description.Compression, usesMipMaps, 0, ITexture::GetLimits().SUPPORTS_S3TC);
+	if (!TextureCache::Load(sources, settings, result)) {
+		return false;
+	}
 
-		// Copy the data we loaded into the corresponding location in the data store
-		memcpy(datastore + textureDataSize * ix, data, textureDataSize);
-		stbi_image_free(data);
+	// If the texture is not square, warn and abort
+	if (result.Levels[0].Width != result.Levels[0].Height) {
+		LOG_ERROR("Images loaded from \"{}\" were not square", sources[0]);
+		result = TextureCache::TextureData();
+		return false;
 	}
+	return true;
+}
+
+void TextureCube::_UploadLevels(TextureCache::TextureData& levels)
+{
+	// Get the format and pixel format from what we loaded
+	_description.Size = levels.Levels[0].Width;
+	_description.Format = levels.Format;
+	_description.FormatHint = levels.PixelLayout;
 
 	// Allocate memory and set up initial parameters
-	_SetTextureParams();
+	_SetTextureParams(static_cast<uint32_t>(levels.Levels.size()));
+
+	// Rows of uncompressed images are tightly packed in the cache
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	// Every level holds all 6 faces back to back, so each level is a single upload (note that
+	// the custom enum tools let us convert to base type [GLenum] with the * operator)
+	for (uint32_t ix = 0; ix < levels.Levels.size(); ix++) {
+		const TextureCache::LevelData& level = levels.Levels[ix];
+		if (levels.IsCompressed()) {
+			glCompressedTextureSubImage3D(_handle, ix, 0, 0, 0, level.Width, level.Height, 6, *levels.Format, (GLsizei)level.Size, level.Data);
+		} else {
+			glTextureSubImage3D(_handle, ix, 0, 0, 0, level.Width, level.Height, 6, *levels.PixelLayout, *PixelType::UByte, level.Data);
+		}
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
-	// Set our pixel alignment to a single byte so we don't get banding
-	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	// Release the CPU copy of the image
+	levels = TextureCache::TextureData();
+}
 
-	// Upload our data to our image (note that the custom enum tools let us convert to base type [GLenum] with the * operator)
-	glTextureSubImage3D(_handle, 0, 0, 0, 0, _description.Size, _description.Size, 6, *_description.FormatHint, *PixelType::UByte, datastore);
-	delete[] datastore;
+bool TextureCube::_LoadDeferred()
+{
+	return _LoadLevels(_description.FaceFileNames, _pendingLevels);
+}
+
+void TextureCube::_FinishDeferredLoad()
+{
+	_UploadLevels(_pendingLevels);
 }
 
-void TextureCube::_SetTextureParams(){
+void TextureCube::_SetTextureParams(uint32_t levelCount){
 	// Make sure the size is greater than zero and that we have a format specified before trying to set parameters
 	if (_description.Size > 0 && _description.Format != InternalFormat::Unknown) {
 		// Allocates the memory for our texture
-		glTextureStorage2D(_handle, 1, (GLenum)_description.Format, _description.Size, _description.Size);
+		glTextureStorage2D(_handle, levelCount, (GLenum)_description.Format, _description.Size, _description.Size);
 
 		// Set up our texture parameters
 		glTextureParameteri(_handle, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
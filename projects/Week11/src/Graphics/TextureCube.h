@@ -1,6 +1,8 @@
 #pragma once
 #include <EnumToString.h>
+#include <vector>
 #include "ITexture.h"
+#include "Utils/TextureCache.h"
 /*
 0 	GL_TEXTURE_CUBE_MAP_POSITIVE_X
 1 	GL_TEXTURE_CUBE_MAP_NEGATIVE_X
@@ -59,6 +61,12 @@ struct TextureCubeDescription {
 	/// </summary>
 	PixelFormat    FormatHint;
 
+	/// <summary>
+	/// How the faces should be compressed when they are loaded, default Auto.
+	/// The converted faces are cached next to the first face, see TextureCache
+	/// </summary>
+	TextureCompression Compression;
+
 	/// <summary>
 	/// Creates a default (empty) cubemap description
 	/// </summary>
@@ -68,7 +76,8 @@ struct TextureCubeDescription {
 		MinificationFilter(MinFilter::NearestMipLinear),
 		MagnificationFilter(MagFilter::Linear),
 		Filename(""),
-		FormatHint(PixelFormat::RGBA)
+		FormatHint(PixelFormat::RGBA),
+		Compression(TextureCompression::Auto)
 	{ }
 };
 
@@ -119,11 +128,43 @@ public:
 protected:
 	TextureCubeDescription _description;
 
+	// The faces loaded by _LoadDeferred, waiting for _FinishDeferredLoad
+	TextureCache::TextureData _pendingLevels;
+
+	/// <summary>
+	/// Creates a cubemap without loading anything, used for deferred loading
+	/// </summary>
+	TextureCube();
+
 	virtual void _LoadFromDescription();
 	virtual void _LoadImages(const std::unordered_map<CubeMapFace, std::string>& faceFilenames);
 
+	/// <summary>
+	/// Fills in the face filenames from the base filename if they were not provided
+	/// </summary>
+	/// <returns>True if we have all 6 faces, false if otherwise</returns>
+	bool _ResolveFaceFilenames();
+	/// <summary>
+	/// Loads the 6 face images through the texture cache, with a full mip chain if our
+	/// minification filter uses mips. This does not touch OpenGL, so it can be called from
+	/// any thread
+	/// </summary>
+	/// <param name="faceFilenames">The paths to the images for each face</param>
+	/// <param name="result">The levels to populate</param>
+	/// <returns>True if all the faces were loaded, and match in size and format</returns>
+	bool _LoadLevels(const std::unordered_map<CubeMapFace, std::string>& faceFilenames, TextureCache::TextureData& result) const;
+	/// <summary>
+	/// Allocates storage for and uploads every level of the faces, then releases the
+	/// levels. Will overwrite description size and format
+	/// </summary>
+	void _UploadLevels(TextureCache::TextureData& levels);
+
+	virtual bool _LoadDeferred() override;
+	virtual void _FinishDeferredLoad() override;
+
 	/// <summary>
 	/// Allocates our texture's memory and sets sampling / filtering parameters
 	/// </summary>
-	void _SetTextureParams();
+	/// <param name="levelCount">The number of mip levels to allocate</param>
+	void _SetTextureParams(uint32_t levelCount = 1);
 };
\ No newline at end of file
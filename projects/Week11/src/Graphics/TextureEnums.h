@@ -5,6 +5,12 @@
 #include "Logging.h"
 #include "glad/glad.h"
 
+// S3TC (BC1-BC3) is an extension that every desktop driver supports, but our GL loader does not include it
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT  0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
 /// <summary>
 /// The types of texture we will support in our framework
 /// </summary>
@@ -34,10 +40,47 @@ ENUM(InternalFormat, GLint,
 	RGBA8        = GL_RGBA8,
 	SRGBA        = GL_SRGB8_ALPHA8,
 	RGBA16       = GL_RGBA16,
-	RGB32AF      = GL_RGBA32F
+	RGB32AF      = GL_RGBA32F,
+	// Block compressed formats, these can only be loaded from compressed data (see TextureCompressor)
+	BC1          = GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+	BC3          = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT,
+	BC5          = GL_COMPRESSED_RG_RGTC2,
+	BC7          = GL_COMPRESSED_RGBA_BPTC_UNORM
 	// Note: There are sized internal formats but there is a LOT of them
 );
 
+// How textures loaded from files should be compressed on the GPU, see TextureCompressor
+ENUM(TextureCompression, int,
+	// Keep the image uncompressed
+	None = 0,
+	// BC5 for two channel images, BC7 for images with alpha, and BC1 for everything else
+	Auto = 1,
+	// 4 bits per texel RGB, no alpha
+	BC1  = 2,
+	// 8 bits per texel RGBA, with smooth alpha
+	BC3  = 3,
+	// 8 bits per texel, red and green only. Best for normal maps
+	BC5  = 4,
+	// 8 bits per texel RGBA, highest quality
+	BC7  = 5
+);
+
+/*
+ * Gets the size of a single 4x4 block in the given compressed format, or 0 if the format is not block compressed
+ */
+constexpr size_t GetCompressedBlockSize(InternalFormat format) {
+	switch (format) {
+		case InternalFormat::BC1:
+			return 8;
+		case InternalFormat::BC3:
+		case InternalFormat::BC5:
+		case InternalFormat::BC7:
+			return 16;
+		default:
+			return 0;
+	}
+}
+
 // The layout of the input pixel data
 ENUM(PixelFormat, GLint,
     Unknown      = GL_NONE,
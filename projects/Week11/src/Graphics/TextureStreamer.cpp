@@ -0,0 +1,113 @@
+#include "Graphics/TextureStreamer.h"
+
+#include <algorithm>
+
+#include "Graphics/Texture2D.h"
+
+std::vector<Texture2D*> TextureStreamer::__textures;
+uint32_t TextureStreamer::__frame = 1;
+size_t   TextureStreamer::__budget = TextureStreamer::DEFAULT_BUDGET;
+size_t   TextureStreamer::__uploadBudget = TextureStreamer::DEFAULT_UPLOAD_BUDGET;
+TextureStreamer::Stats TextureStreamer::__stats;
+
+void TextureStreamer::Register(Texture2D* texture) {
+	if (std::find(__textures.begin(), __textures.end(), texture) == __textures.end()) {
+		__textures.push_back(texture);
+	}
+}
+
+void TextureStreamer::Unregister(Texture2D* texture) {
+	auto it = std::find(__textures.begin(), __textures.end(), texture);
+	if (it != __textures.end()) {
+		*it = __textures.back();
+		__textures.pop_back();
+	}
+}
+
+void TextureStreamer::__SetResidentLevel(Texture2D* texture, uint32_t level, size_t& residentBytes) {
+	size_t before = texture->GetMemorySize(texture->GetResidentLevel());
+	texture->_SetResidentLevel(level);
+	size_t after = texture->GetMemorySize(level);
+
+	residentBytes = residentBytes - before + after;
+	if (after > before) {
+		__stats.UploadedBytes += after - before;
+	} else {
+		__stats.EvictedBytes += before - after;
+	}
+}
+
+void TextureStreamer::Update() {
+	__frame++;
+	__stats.UploadedBytes = 0;
+	__stats.EvictedBytes = 0;
+
+	size_t residentBytes = 0;
+	for (Texture2D* texture : __textures) {
+		residentBytes += texture->GetMemorySize(texture->GetResidentLevel());
+	}
+
+	// Textures that haven't been drawn in a while give back everything but their tail
+	for (Texture2D* texture : __textures) {
+		if (texture->GetResidentLevel() < texture->GetTailLevel() && __frame - texture->GetLastUsedFrame() > EVICT_AFTER_FRAMES) {
+			__SetResidentLevel(texture, texture->GetTailLevel(), residentBytes);
+		}
+	}
+
+	// Most recently drawn first, so those get new levels first and the back of the list is evicted first
+	std::vector<Texture2D*> order = __textures;
+	std::stable_sort(order.begin(), order.end(), [](Texture2D* a, Texture2D* b) {
+		return a->GetLastUsedFrame() > b->GetLastUsedFrame();
+	});
+
+	// If the budget has shrunk, drop the most detailed levels from the oldest textures until we fit
+	size_t oldest = order.size();
+	while (residentBytes > __budget && oldest > 0) {
+		Texture2D* texture = order[oldest - 1];
+		if (texture->GetResidentLevel() < texture->GetTailLevel()) {
+			__SetResidentLevel(texture, texture->GetResidentLevel() + 1, residentBytes);
+		} else {
+			oldest--;
+		}
+	}
+
+	// Stream in one more level for each texture that's been drawn recently
+	oldest = order.size();
+	for (size_t ix = 0; ix < order.size() && ix < oldest; ix++) {
+		Texture2D* texture = order[ix];
+		if (__frame - texture->GetLastUsedFrame() > EVICT_AFTER_FRAMES) {
+			break;
+		}
+		if (texture->GetResidentLevel() == 0) {
+			continue;
+		}
+
+		uint32_t level = texture->GetResidentLevel() - 1;
+		size_t cost = texture->GetMemorySize(level) - texture->GetMemorySize(level + 1);
+		if (__stats.UploadedBytes > 0 && __stats.UploadedBytes + cost > __uploadBudget) {
+			break;
+		}
+
+		// Make room by evicting levels from textures that were drawn less recently than this one,
+		// textures drawn in the same frame are never evicted for each other so that we can't thrash
+		while (residentBytes + cost > __budget && oldest > ix + 1) {
+			Texture2D* victim = order[oldest - 1];
+			if (victim->GetLastUsedFrame() < texture->GetLastUsedFrame() && victim->GetResidentLevel() < victim->GetTailLevel()) {
+				__SetResidentLevel(victim, victim->GetResidentLevel() + 1, residentBytes);
+			} else {
+				oldest--;
+			}
+		}
+		if (residentBytes + cost > __budget) {
+			break;
+		}
+
+		__SetResidentLevel(texture, level, residentBytes);
+	}
+
+	__stats.ResidentBytes = residentBytes;
+	__stats.TextureCount = static_cast<uint32_t>(__textures.size());
+	__stats.StreamingCount = static_cast<uint32_t>(std::count_if(__textures.begin(), __textures.end(), [](Texture2D* texture) {
+		return texture->GetResidentLevel() > 0;
+	}));
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+class Texture2D;
+
+/// <summary>
+/// Decides which mip levels of file backed 2D textures are kept in video memory. Textures
+/// start out with only their smallest levels (the tail) resident, then the textures that
+/// were drawn most recently get their more detailed levels uploaded, one level per texture
+/// per frame, until they are fully resident or the upload budget for the frame runs out
+///
+/// When the resident textures would go over the memory budget, levels are evicted from the
+/// textures that were drawn least recently. Textures that haven't been drawn in a while
+/// drop back to their tail, even if we are under budget
+/// </summary>
+class TextureStreamer {
+public:
+	// The default amount of video memory that streamed textures can use, in bytes
+	inline static const size_t   DEFAULT_BUDGET = 512 * 1024 * 1024;
+	// The default number of bytes of texture data that can be uploaded in a single frame
+	inline static const size_t   DEFAULT_UPLOAD_BUDGET = 16 * 1024 * 1024;
+	// Mip levels that are this size or smaller are always resident, so there's always something to draw
+	inline static const uint32_t RESIDENT_TAIL_SIZE = 128;
+	// Textures that have not been drawn for this many frames are evicted down to their tail
+	inline static const uint32_t EVICT_AFTER_FRAMES = 300;
+
+	/// <summary>
+	/// Statistics about the streamed textures, updated every frame
+	/// </summary>
+	struct Stats {
+		// The video memory used by all streamed textures, in bytes
+		size_t   ResidentBytes  = 0;
+		// The number of bytes uploaded during the last update
+		size_t   UploadedBytes  = 0;
+		// The number of bytes evicted during the last update
+		size_t   EvictedBytes   = 0;
+		// The number of textures being managed
+		uint32_t TextureCount   = 0;
+		// The number of textures that do not have all of their levels resident
+		uint32_t StreamingCount = 0;
+	};
+
+	/// <summary>
+	/// Moves on to the next frame, then evicts and uploads texture levels based on when
+	/// textures were last drawn. Should be called once per frame, after rendering
+	/// </summary>
+	static void Update();
+
+	/// <summary>
+	/// Gets the index of the current frame, textures record this when they are bound
+	/// </summary>
+	static uint32_t GetFrame() { return __frame; }
+
+	/// <summary>
+	/// Sets the amount of video memory that streamed textures can use, in bytes. Note that
+	/// the tails of textures are always resident, so this is a soft limit
+	/// </summary>
+	static void SetBudget(size_t bytes) { __budget = bytes; }
+	static size_t GetBudget() { return __budget; }
+
+	/// <summary>
+	/// Sets the number of bytes of texture data that can be uploaded each frame. At least
+	/// one level is uploaded per frame, even if it is larger than the budget
+	/// </summary>
+	static void SetUploadBudget(size_t bytes) { __uploadBudget = bytes; }
+	static size_t GetUploadBudget() { return __uploadBudget; }
+
+	/// <summary>
+	/// Gets the statistics from the last update
+	/// </summary>
+	static const Stats& GetStats() { return __stats; }
+
+	/// <summary>
+	/// Starts managing the levels for a texture, the texture must unregister itself before it is destroyed
+	/// </summary>
+	static void Register(Texture2D* texture);
+	/// <summary>
+	/// Stops managing the levels for a texture, does nothing if the texture was not registered
+	/// </summary>
+	static void Unregister(Texture2D* texture);
+
+protected:
+	TextureStreamer() = default;
+	~TextureStreamer() = default;
+
+	static std::vector<Texture2D*> __textures;
+	static uint32_t __frame;
+	static size_t   __budget;
+	static size_t   __uploadBudget;
+	static Stats    __stats;
+
+	/// <summary>
+	/// Changes the most detailed resident level of a texture, and updates the running total of resident memory
+	/// </summary>
+	static void __SetResidentLevel(Texture2D* texture, uint32_t level, size_t& residentBytes);
+};
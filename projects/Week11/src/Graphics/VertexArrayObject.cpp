@@ -8,7 +8,9 @@ VertexArrayObject::VertexArrayObject() :
 	_handle(0),
 	_vertexCount(0),
 	_elementCount(0),
-	_vertexBuffers(std::vector<VertexBufferBinding>())
+	_vertexBuffers(std::vector<VertexBufferBinding>()),
+	_constantBuffers(std::vector<ConstantBinding>()),
+	_bounds(BoundingBox())
 {
 	glCreateVertexArrays(1, &_handle);
 }
@@ -62,6 +64,38 @@ void VertexArrayObject::AddVertexBuffer(const VertexBuffer::Sptr& buffer, const
 	Unbind();
 }
 
+void VertexArrayObject::SetConstantAttribute(GLuint slot, const glm::vec4& value) {
+	VertexBuffer::Sptr buffer = VertexBuffer::Create();
+	buffer->LoadData(&value, 1);
+	_BindConstantAttribute(slot, buffer);
+}
+
+VertexArrayObject::Sptr VertexArrayObject::CreateWithIndices(const IndexBuffer::Sptr& ibo) const {
+	VertexArrayObject::Sptr result = VertexArrayObject::Create();
+	for (const VertexBufferBinding& binding : _vertexBuffers) {
+		result->AddVertexBuffer(binding.Buffer, binding.Attributes);
+	}
+	for (const ConstantBinding& binding : _constantBuffers) {
+		result->_BindConstantAttribute(binding.Slot, binding.Buffer);
+	}
+	result->SetIndexBuffer(ibo);
+	result->SetVDecl(_vDecl);
+	result->SetBounds(_bounds);
+	return result;
+}
+
+void VertexArrayObject::_BindConstantAttribute(GLuint slot, const VertexBuffer::Sptr& buffer) {
+	_constantBuffers.push_back({ slot, buffer });
+
+	// With separate attribute formats, a stride of 0 really means every vertex reads the
+	// same element (unlike glVertexAttribPointer, where it means tightly packed). We use the
+	// slot as the binding index, which is what glVertexAttribPointer does for our other buffers
+	glEnableVertexArrayAttrib(_handle, slot);
+	glVertexArrayAttribFormat(_handle, slot, 4, GL_FLOAT, GL_FALSE, 0);
+	glVertexArrayAttribBinding(_handle, slot, slot);
+	glVertexArrayVertexBuffer(_handle, slot, buffer->GetHandle(), 0, 0);
+}
+
 void VertexArrayObject::Draw(DrawMode mode) {
 	Bind();
 	if (_indexBuffer == nullptr) {
@@ -72,6 +106,14 @@ void VertexArrayObject::Draw(DrawMode mode) {
 	Unbind();
 }
 
+void VertexArrayObject::DrawInstanced(uint32_t instanceCount, DrawMode mode) {
+	if (_indexBuffer == nullptr) {
+		glDrawArraysInstanced((GLenum)mode, 0, _elementCount, instanceCount);
+	} else {
+		glDrawElementsInstanced((GLenum)mode, _elementCount, (GLenum)_indexBuffer->GetElementType(), nullptr, instanceCount);
+	}
+}
+
 void VertexArrayObject::Bind() {
 	glBindVertexArray(_handle);
 }
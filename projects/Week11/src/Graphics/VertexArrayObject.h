@@ -3,10 +3,12 @@
 #include <cstdint>
 #include <vector>
 #include <memory>
+#include <GLM/glm.hpp>
 #include <EnumToString.h>
 
 #include "VertexBuffer.h"
 #include "IndexBuffer.h"
+#include "Utils/Bounds.h"
 
 /// <summary>
 /// We'll use this just to make it more clear what the intended usage of an attribute is in our code!
@@ -44,6 +46,9 @@ ENUM(AttributeType, GLenum,
 	UInt    = GL_UNSIGNED_INT,
 	Float   = GL_FLOAT,
 	Double  = GL_DOUBLE,
+	Half    = GL_HALF_FLOAT,
+	Int2101010  = GL_INT_2_10_10_10_REV,          // Packed signed 10-10-10-2, size must be 4
+	UInt2101010 = GL_UNSIGNED_INT_2_10_10_10_REV, // Packed unsigned 10-10-10-2, size must be 4
 	Unknown = GL_NONE
 );
 
@@ -126,6 +131,11 @@ public:
 		VertexBuffer::Sptr Buffer;
 		std::vector<BufferAttribute> Attributes;
 	};
+	// A single element buffer feeding a constant attribute
+	struct ConstantBinding {
+		GLuint             Slot;
+		VertexBuffer::Sptr Buffer;
+	};
 	
 public:
 	/// <summary>
@@ -151,6 +161,20 @@ public:
 	/// <param name="buffer">The buffer to add (note, does not take ownership, you will still need to delete later)</param>
 	/// <param name="attributes">A list of vertex attributes that will be fed by this buffer</param>
 	void AddVertexBuffer(const VertexBuffer::Sptr& buffer, const std::vector<BufferAttribute>& attributes);
+	/// <summary>
+	/// Feeds an attribute with the same value for every vertex, this lets meshes skip storing
+	/// attributes that never change (ex: vertex colors that are all white)
+	/// </summary>
+	/// <param name="slot">The input slot to the vertex shader that will receive the value</param>
+	/// <param name="value">The value to give to every vertex</param>
+	void SetConstantAttribute(GLuint slot, const glm::vec4& value);
+	/// <summary>
+	/// Creates a new VAO that reads from the same vertex buffers and constant attributes as this
+	/// one, but with a different index buffer. Levels of detail use this to share their vertices
+	/// </summary>
+	/// <param name="ibo">The index buffer for the new VAO</param>
+	/// <returns>A new VAO sharing this one's vertex data</returns>
+	Sptr CreateWithIndices(const IndexBuffer::Sptr& ibo) const;
 
 	/// <summary>
 	/// Gets the buffer binding that has an attribute with the given usage
@@ -161,6 +185,14 @@ public:
 	const VertexBufferBinding* GetBufferBinding(AttribUsage usage);
 
 	void Draw(DrawMode mode = DrawMode::TriangleList);
+	/// <summary>
+	/// Draws multiple instances of this VAO with a single draw call, shaders can use
+	/// gl_InstanceID to fetch per-instance data. Note that unlike Draw, this expects the
+	/// VAO to already be bound, so that batches of the same mesh do not re-bind it
+	/// </summary>
+	/// <param name="instanceCount">The number of instances to draw</param>
+	/// <param name="mode">The primitive mode to draw with</param>
+	void DrawInstanced(uint32_t instanceCount, DrawMode mode = DrawMode::TriangleList);
 
 	/// <summary>
 	/// Binds this VAO as the source of data for draw operations
@@ -179,20 +211,37 @@ public:
 	void SetVDecl(const VertexDeclaration& vDecl);
 	const VertexDeclaration& GetVDecl();
 
+	/// <summary>
+	/// Sets the object space bounds of the mesh, these should be set by whatever
+	/// creates the mesh, since the vertex data may not be available later
+	/// </summary>
+	void SetBounds(const BoundingBox& bounds) { _bounds = bounds; }
+	/// <summary>
+	/// Gets the object space bounds of the mesh, will be invalid if they were never set
+	/// </summary>
+	const BoundingBox& GetBounds() const { return _bounds; }
+
 protected:
 	
 	// The index buffer bound to this VAO
 	IndexBuffer::Sptr _indexBuffer;
 	// The vertex buffers bound to this VAO
 	std::vector<VertexBufferBinding> _vertexBuffers;
+	// Single element buffers that feed constant attributes
+	std::vector<ConstantBinding> _constantBuffers;
 
 	// Stores a const pointer to one of the vertex declarations
 	// defined in VertexTypes.cpp
 	VertexDeclaration _vDecl;
 
+	// The object space bounds of the mesh, used for culling
+	BoundingBox _bounds;
+
 	uint32_t _vertexCount;
 	uint32_t _elementCount;
 
+	void _BindConstantAttribute(GLuint slot, const VertexBuffer::Sptr& buffer);
+
 	// The underlying OpenGL handle that this class is wrapping around
 	GLuint _handle;
 };
@@ -6,6 +6,8 @@ VertexPosNormCol* VPNC = nullptr;
 VertexPosNormTex* VPNT = nullptr;
 VertexPosNormTexCol* VPNTC = nullptr;
 VertexPosNormTexColTangents* VPNTCT = nullptr;
+VertexPacked* VP = nullptr;
+VertexPackedColor* VPC8 = nullptr;
 
 const std::vector<BufferAttribute> VertexPosCol::V_DECL = {
 	BufferAttribute(0, 3, AttributeType::Float, sizeof(VertexPosCol), (size_t)&VPC->Position, AttribUsage::Position),
@@ -35,4 +37,13 @@ const std::vector<BufferAttribute> VertexPosNormTexColTangents::V_DECL ={
 	BufferAttribute(4, 3, AttributeType::Float, sizeof(VertexPosNormTexColTangents), (size_t)&VPNTCT->Tangent, AttribUsage::Tangent),
 	BufferAttribute(5, 3, AttributeType::Float, sizeof(VertexPosNormTexColTangents), (size_t)&VPNTCT->BiTangent, AttribUsage::BiTangent)
 };
+const std::vector<BufferAttribute> VertexPacked::V_DECL ={
+	BufferAttribute(0, 3, AttributeType::Float, sizeof(VertexPacked), (size_t)&VP->Position, AttribUsage::Position),
+	BufferAttribute(2, 4, AttributeType::Int2101010, sizeof(VertexPacked), (size_t)&VP->Normal, AttribUsage::Normal, true),
+	BufferAttribute(3, 2, AttributeType::Half, sizeof(VertexPacked), (size_t)&VP->UV, AttribUsage::Texture),
+	BufferAttribute(4, 4, AttributeType::Int2101010, sizeof(VertexPacked), (size_t)&VP->Tangent, AttribUsage::Tangent, true)
+};
+const std::vector<BufferAttribute> VertexPackedColor::V_DECL ={
+	BufferAttribute(1, 4, AttributeType::UByte, sizeof(VertexPackedColor), (size_t)&VPC8->Color, AttribUsage::Color, true)
+};
 #pragma warning(pop)
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <GLM/glm.hpp>
+#include <GLM/gtc/packing.hpp>
 #include "VertexArrayObject.h"
 
 
@@ -101,5 +102,53 @@ struct VertexPosNormTexColTangents {
 		BiTangent(glm::vec3(0.0f)) 
 	{}
 
+	static const std::vector<BufferAttribute> V_DECL;
+};
+
+/// <summary>
+/// A compact version of VertexPosNormTexColTangents, 24 bytes instead of 76. Normals and
+/// tangents are stored as signed normalized 10-10-10-2 values, with the tangent's w holding
+/// the sign of the bitangent (shaders rebuild it with cross(normal, tangent) * w), and UVs are
+/// stored as half floats. Colors are not stored, they go in a separate VertexPackedColor
+/// buffer, or a constant attribute if they are the same across the whole mesh
+/// </summary>
+struct VertexPacked {
+	glm::vec3 Position;
+	uint32_t  Normal;
+	uint32_t  Tangent;
+	uint32_t  UV;
+
+	VertexPacked() : Position(glm::vec3(0.0f)), Normal(0), Tangent(0), UV(0) {}
+	VertexPacked(const VertexPosNormTexColTangents& vertex) :
+		Position(vertex.Position),
+		Normal(0),
+		Tangent(0),
+		UV(glm::packHalf2x16(vertex.UV))
+	{
+		glm::vec3 normal = glm::length(vertex.Normal) > 0.0f ? glm::normalize(vertex.Normal) : glm::vec3(0.0f, 0.0f, 1.0f);
+		// Make the tangent perpendicular to the normal, picking any perpendicular if it's missing or degenerate
+		glm::vec3 tangent = vertex.Tangent - normal * glm::dot(normal, vertex.Tangent);
+		if (!(glm::dot(tangent, tangent) > 1e-12f)) {
+			tangent = glm::cross(normal, glm::abs(normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f));
+		}
+		tangent = glm::normalize(tangent);
+		float handedness = glm::dot(glm::cross(normal, tangent), vertex.BiTangent) < 0.0f ? -1.0f : 1.0f;
+
+		Normal  = glm::packSnorm3x10_1x2(glm::vec4(normal, 0.0f));
+		Tangent = glm::packSnorm3x10_1x2(glm::vec4(tangent, handedness));
+	}
+
+	static const std::vector<BufferAttribute> V_DECL;
+};
+
+/// <summary>
+/// Per vertex colors for meshes using VertexPacked, stored as normalized bytes
+/// </summary>
+struct VertexPackedColor {
+	uint32_t Color;
+
+	VertexPackedColor() : Color(0xFFFFFFFF) {}
+	VertexPackedColor(const glm::vec4& color) : Color(glm::packUnorm4x8(color)) {}
+
 	static const std::vector<BufferAttribute> V_DECL;
 };
\ No newline at end of file
@@ -0,0 +1,192 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+#include <GLM/glm.hpp>
+#include <GLM/gtc/quaternion.hpp>
+#include <Logging.h>
+
+#include "Utils/GUID.hpp"
+
+/// <summary>
+/// Helper for building up a block of binary data. All values are written in
+/// the native (little-endian on all our targets) byte order, with no padding
+/// between them
+/// </summary>
+class BinaryWriter {
+public:
+	BinaryWriter() : _data() { }
+
+	/// <summary>
+	/// Writes a trivially copyable value (ints, floats, glm types, POD structs)
+	/// </summary>
+	template <typename T>
+	void Write(const T& value) {
+		static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types can be written directly");
+		WriteBytes(&value, sizeof(T));
+	}
+
+	/// <summary>
+	/// Writes a GUID as it's 16 raw bytes
+	/// </summary>
+	void WriteGuid(const Guid& value) {
+		WriteBytes(value.bytes(), 16);
+	}
+
+	/// <summary>
+	/// Writes a length-prefixed string (not null terminated)
+	/// </summary>
+	void WriteString(std::string_view value) {
+		Write<uint32_t>(static_cast<uint32_t>(value.size()));
+		WriteBytes(value.data(), value.size());
+	}
+
+	/// <summary>
+	/// Writes a length-prefixed blob of bytes
+	/// </summary>
+	void WriteBlob(const std::vector<uint8_t>& value) {
+		Write<uint32_t>(static_cast<uint32_t>(value.size()));
+		WriteBytes(value.data(), value.size());
+	}
+
+	/// <summary>
+	/// Copies raw bytes into the stream
+	/// </summary>
+	void WriteBytes(const void* data, size_t size) {
+		if (size == 0) return;
+		size_t offset = _data.size();
+		_data.resize(offset + size);
+		memcpy(_data.data() + offset, data, size);
+	}
+
+	/// <summary>
+	/// Overwrites a value that has already been written, handy for patching in
+	/// sizes or counts once they are known
+	/// </summary>
+	/// <param name="offset">The offset in bytes of the value to overwrite</param>
+	/// <param name="value">The new value</param>
+	template <typename T>
+	void WriteAt(size_t offset, const T& value) {
+		static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types can be written directly");
+		LOG_ASSERT(offset + sizeof(T) <= _data.size(), "Attempted to write past the end of a binary stream");
+		memcpy(_data.data() + offset, &value, sizeof(T));
+	}
+
+	/// <summary>
+	/// Removes all data from the stream, but keeps the memory allocated so that
+	/// the writer can be re-used without re-allocating
+	/// </summary>
+	void Clear() { _data.clear(); }
+
+	/// <summary>
+	/// Gets the current number of bytes in the stream
+	/// </summary>
+	size_t GetSize() const { return _data.size(); }
+
+	/// <summary>
+	/// Gets the data that has been written so far
+	/// </summary>
+	const std::vector<uint8_t>& GetData() const { return _data; }
+	/// <summary>
+	/// Moves the written data out of the writer, leaving it empty
+	/// </summary>
+	std::vector<uint8_t> Release() { return std::move(_data); }
+
+protected:
+	std::vector<uint8_t> _data;
+};
+
+/// <summary>
+/// Reads values sequentially from a block of binary data written by a BinaryWriter.
+/// The reader does not own it's memory, so the data (for instance a memory mapped
+/// file) must outlive the reader and anything pointing into it
+///
+/// Reading past the end of the data will flag the reader as invalid and return
+/// zero-initialized values, rather than reading out of bounds
+/// </summary>
+class BinaryReader {
+public:
+	BinaryReader() : _data(nullptr), _size(0), _cursor(0), _isValid(false) { }
+	BinaryReader(const uint8_t* data, size_t size) : _data(data), _size(size), _cursor(0), _isValid(data != nullptr || size == 0) { }
+
+	/// <summary>
+	/// Reads a trivially copyable value. We memcpy rather than casting the pointer,
+	/// since the data is not guaranteed to be aligned
+	/// </summary>
+	template <typename T>
+	T Read() {
+		static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types can be read directly");
+		T result{};
+		const uint8_t* src = ReadBytes(sizeof(T));
+		if (src != nullptr) {
+			memcpy(&result, src, sizeof(T));
+		}
+		return result;
+	}
+
+	/// <summary>
+	/// Reads a GUID stored as 16 raw bytes
+	/// </summary>
+	Guid ReadGuid() {
+		const uint8_t* src = ReadBytes(16);
+		if (src == nullptr) {
+			return Guid();
+		}
+		unsigned char bytes[16];
+		memcpy(bytes, src, 16);
+		return Guid::FromBytes(bytes);
+	}
+
+	/// <summary>
+	/// Reads a length-prefixed string, the result points directly into the
+	/// underlying data and is only valid as long as it is
+	/// </summary>
+	std::string_view ReadString() {
+		uint32_t length = Read<uint32_t>();
+		const uint8_t* src = ReadBytes(length);
+		return src == nullptr ? std::string_view() : std::string_view(reinterpret_cast<const char*>(src), length);
+	}
+
+	/// <summary>
+	/// Reads a length-prefixed blob of bytes, returning a reader over the blob's contents
+	/// </summary>
+	BinaryReader ReadBlob() {
+		uint32_t length = Read<uint32_t>();
+		const uint8_t* src = ReadBytes(length);
+		return src == nullptr ? BinaryReader() : BinaryReader(src, length);
+	}
+
+	/// <summary>
+	/// Advances the reader by the given number of bytes, returning a pointer to the
+	/// start of the bytes that were skipped, or nullptr if there was not enough data.
+	/// Reading past the end is expected for truncated or corrupt files, so it only marks
+	/// the reader as invalid, callers check IsValid and fall back
+	/// </summary>
+	const uint8_t* ReadBytes(size_t size) {
+		if (!_isValid || size > _size - _cursor) {
+			_isValid = false;
+			return nullptr;
+		}
+		const uint8_t* result = _data + _cursor;
+		_cursor += size;
+		return result;
+	}
+
+	const uint8_t* GetData() const { return _data; }
+	size_t GetSize() const { return _size; }
+	size_t GetRemaining() const { return _size - _cursor; }
+
+	/// <summary>
+	/// Returns true if all reads so far have been within the bounds of the data
+	/// </summary>
+	bool IsValid() const { return _isValid; }
+
+protected:
+	const uint8_t* _data;
+	size_t         _size;
+	size_t         _cursor;
+	bool           _isValid;
+};
@@ -0,0 +1,365 @@
+#include "Utils/BoundingVolumeHierarchy.h"
+#include <algorithm>
+#include <Logging.h>
+
+BoundingVolumeHierarchy::BoundingVolumeHierarchy(float margin) :
+	_nodes(),
+	_root(NULL_NODE),
+	_freeList(NULL_NODE),
+	_proxyCount(0),
+	_margin(margin)
+{ }
+
+int BoundingVolumeHierarchy::CreateProxy(const BoundingBox& box, void* userData) {
+	int proxyId = _AllocateNode();
+	Node& node = _nodes[proxyId];
+	node.Box = box;
+	node.Box.Inflate(_margin);
+	node.UserData = userData;
+	node.Height = 0;
+
+	_InsertLeaf(proxyId);
+	_proxyCount++;
+	return proxyId;
+}
+
+void BoundingVolumeHierarchy::DestroyProxy(int proxyId) {
+	LOG_ASSERT(proxyId >= 0 && proxyId < (int)_nodes.size() && _nodes[proxyId].IsLeaf() && _nodes[proxyId].Height == 0, "Invalid proxy ID");
+	_RemoveLeaf(proxyId);
+	_FreeNode(proxyId);
+	_proxyCount--;
+}
+
+bool BoundingVolumeHierarchy::MoveProxy(int proxyId, const BoundingBox& box) {
+	LOG_ASSERT(proxyId >= 0 && proxyId < (int)_nodes.size() && _nodes[proxyId].IsLeaf() && _nodes[proxyId].Height == 0, "Invalid proxy ID");
+
+	// Still inside our fat box, nothing to do
+	if (_nodes[proxyId].Box.Contains(box)) {
+		return false;
+	}
+
+	_RemoveLeaf(proxyId);
+	_nodes[proxyId].Box = box;
+	_nodes[proxyId].Box.Inflate(_margin);
+	_InsertLeaf(proxyId);
+	return true;
+}
+
+void* BoundingVolumeHierarchy::GetUserData(int proxyId) const {
+	return _nodes[proxyId].UserData;
+}
+
+const BoundingBox& BoundingVolumeHierarchy::GetFatBounds(int proxyId) const {
+	return _nodes[proxyId].Box;
+}
+
+void BoundingVolumeHierarchy::Query(const Frustum& frustum, const std::function<void(void*)>& callback) const {
+	if (_root == NULL_NODE) {
+		return;
+	}
+
+	std::vector<int> stack;
+	stack.reserve(64);
+	std::vector<int> collectStack;
+	stack.push_back(_root);
+
+	while (!stack.empty()) {
+		int index = stack.back();
+		stack.pop_back();
+		const Node& node = _nodes[index];
+
+		Frustum::TestResult result = frustum.Test(node.Box);
+		if (result == Frustum::TestResult::Outside) {
+			continue;
+		}
+		// Everything below this node is visible, we can skip the rest of the tests
+		if (result == Frustum::TestResult::Inside || node.IsLeaf()) {
+			_CollectLeaves(index, callback, collectStack);
+			continue;
+		}
+		stack.push_back(node.Left);
+		stack.push_back(node.Right);
+	}
+}
+
+void BoundingVolumeHierarchy::Query(const BoundingBox& box, const std::function<void(void*)>& callback) const {
+	if (_root == NULL_NODE) {
+		return;
+	}
+
+	std::vector<int> stack;
+	stack.reserve(64);
+	stack.push_back(_root);
+
+	while (!stack.empty()) {
+		int index = stack.back();
+		stack.pop_back();
+		const Node& node = _nodes[index];
+
+		if (!node.Box.Intersects(box)) {
+			continue;
+		}
+		if (node.IsLeaf()) {
+			callback(node.UserData);
+		} else {
+			stack.push_back(node.Left);
+			stack.push_back(node.Right);
+		}
+	}
+}
+
+int BoundingVolumeHierarchy::GetHeight() const {
+	return _root == NULL_NODE ? 0 : _nodes[_root].Height;
+}
+
+void BoundingVolumeHierarchy::Clear() {
+	_nodes.clear();
+	_root = NULL_NODE;
+	_freeList = NULL_NODE;
+	_proxyCount = 0;
+}
+
+int BoundingVolumeHierarchy::_AllocateNode() {
+	int index;
+	if (_freeList == NULL_NODE) {
+		index = static_cast<int>(_nodes.size());
+		_nodes.emplace_back();
+	} else {
+		index = _freeList;
+		_freeList = _nodes[index].Parent;
+	}
+
+	Node& node = _nodes[index];
+	node = Node();
+	node.Height = 0;
+	return index;
+}
+
+void BoundingVolumeHierarchy::_FreeNode(int node) {
+	_nodes[node].Parent = _freeList;
+	_nodes[node].Height = -1;
+	_nodes[node].UserData = nullptr;
+	_freeList = node;
+}
+
+void BoundingVolumeHierarchy::_InsertLeaf(int leaf) {
+	if (_root == NULL_NODE) {
+		_root = leaf;
+		_nodes[_root].Parent = NULL_NODE;
+		return;
+	}
+
+	// Walk down the tree to find the best sibling for the leaf, using the increase in
+	// surface area as the cost of descending into each child
+	BoundingBox leafBox = _nodes[leaf].Box;
+	int index = _root;
+	while (!_nodes[index].IsLeaf()) {
+		const Node& node = _nodes[index];
+		int left  = node.Left;
+		int right = node.Right;
+
+		float area = node.Box.GetSurfaceArea();
+		float combinedArea = BoundingBox::Union(node.Box, leafBox).GetSurfaceArea();
+
+		// Cost of creating a new parent for this node and the leaf
+		float cost = 2.0f * combinedArea;
+		// Minimum cost of pushing the leaf further down the tree
+		float inheritanceCost = 2.0f * (combinedArea - area);
+
+		auto childCost = [&](int child) {
+			const Node& childNode = _nodes[child];
+			float unionArea = BoundingBox::Union(leafBox, childNode.Box).GetSurfaceArea();
+			return childNode.IsLeaf() ?
+				unionArea + inheritanceCost :
+				(unionArea - childNode.Box.GetSurfaceArea()) + inheritanceCost;
+		};
+		float costLeft  = childCost(left);
+		float costRight = childCost(right);
+
+		if (cost < costLeft && cost < costRight) {
+			break;
+		}
+		index = costLeft < costRight ? left : right;
+	}
+	int sibling = index;
+
+	// Create a new parent for the sibling and the leaf (note that this may re-allocate our nodes)
+	int oldParent = _nodes[sibling].Parent;
+	int newParent = _AllocateNode();
+	_nodes[newParent].Parent = oldParent;
+	_nodes[newParent].Box    = BoundingBox::Union(leafBox, _nodes[sibling].Box);
+	_nodes[newParent].Height = _nodes[sibling].Height + 1;
+	_nodes[newParent].Left   = sibling;
+	_nodes[newParent].Right  = leaf;
+	_nodes[sibling].Parent   = newParent;
+	_nodes[leaf].Parent      = newParent;
+
+	if (oldParent != NULL_NODE) {
+		if (_nodes[oldParent].Left == sibling) {
+			_nodes[oldParent].Left = newParent;
+		} else {
+			_nodes[oldParent].Right = newParent;
+		}
+	} else {
+		_root = newParent;
+	}
+
+	_Refit(_nodes[leaf].Parent);
+}
+
+void BoundingVolumeHierarchy::_RemoveLeaf(int leaf) {
+	if (leaf == _root) {
+		_root = NULL_NODE;
+		return;
+	}
+
+	int parent      = _nodes[leaf].Parent;
+	int grandParent = _nodes[parent].Parent;
+	int sibling     = _nodes[parent].Left == leaf ? _nodes[parent].Right : _nodes[parent].Left;
+
+	// The sibling takes the parent's place
+	if (grandParent != NULL_NODE) {
+		if (_nodes[grandParent].Left == parent) {
+			_nodes[grandParent].Left = sibling;
+		} else {
+			_nodes[grandParent].Right = sibling;
+		}
+		_nodes[sibling].Parent = grandParent;
+		_FreeNode(parent);
+		_Refit(grandParent);
+	} else {
+		_root = sibling;
+		_nodes[sibling].Parent = NULL_NODE;
+		_FreeNode(parent);
+	}
+}
+
+void BoundingVolumeHierarchy::_Refit(int index) {
+	while (index != NULL_NODE) {
+		index = _Balance(index);
+
+		Node& node = _nodes[index];
+		node.Height = 1 + std::max(_nodes[node.Left].Height, _nodes[node.Right].Height);
+		node.Box    = BoundingBox::Union(_nodes[node.Left].Box, _nodes[node.Right].Box);
+
+		index = node.Parent;
+	}
+}
+
+int BoundingVolumeHierarchy::_Balance(int iA) {
+	Node& a = _nodes[iA];
+	if (a.IsLeaf() || a.Height < 2) {
+		return iA;
+	}
+
+	int iB = a.Left;
+	int iC = a.Right;
+	Node& b = _nodes[iB];
+	Node& c = _nodes[iC];
+	int balance = c.Height - b.Height;
+
+	// Rotate C up
+	if (balance > 1) {
+		int iF = c.Left;
+		int iG = c.Right;
+		Node& f = _nodes[iF];
+		Node& g = _nodes[iG];
+
+		// Swap A and C
+		c.Left = iA;
+		c.Parent = a.Parent;
+		a.Parent = iC;
+
+		// A's old parent should point to C
+		if (c.Parent != NULL_NODE) {
+			if (_nodes[c.Parent].Left == iA) {
+				_nodes[c.Parent].Left = iC;
+			} else {
+				_nodes[c.Parent].Right = iC;
+			}
+		} else {
+			_root = iC;
+		}
+
+		// Keep the taller of F and G under C
+		if (f.Height > g.Height) {
+			c.Right = iF;
+			a.Right = iG;
+			g.Parent = iA;
+			a.Box = BoundingBox::Union(b.Box, g.Box);
+			c.Box = BoundingBox::Union(a.Box, f.Box);
+			a.Height = 1 + std::max(b.Height, g.Height);
+			c.Height = 1 + std::max(a.Height, f.Height);
+		} else {
+			c.Right = iG;
+			a.Right = iF;
+			f.Parent = iA;
+			a.Box = BoundingBox::Union(b.Box, f.Box);
+			c.Box = BoundingBox::Union(a.Box, g.Box);
+			a.Height = 1 + std::max(b.Height, f.Height);
+			c.Height = 1 + std::max(a.Height, g.Height);
+		}
+		return iC;
+	}
+
+	// Rotate B up
+	if (balance < -1) {
+		int iD = b.Left;
+		int iE = b.Right;
+		Node& d = _nodes[iD];
+		Node& e = _nodes[iE];
+
+		// Swap A and B
+		b.Left = iA;
+		b.Parent = a.Parent;
+		a.Parent = iB;
+
+		// A's old parent should point to B
+		if (b.Parent != NULL_NODE) {
+			if (_nodes[b.Parent].Left == iA) {
+				_nodes[b.Parent].Left = iB;
+			} else {
+				_nodes[b.Parent].Right = iB;
+			}
+		} else {
+			_root = iB;
+		}
+
+		// Keep the taller of D and E under B
+		if (d.Height > e.Height) {
+			b.Right = iD;
+			a.Left = iE;
+			e.Parent = iA;
+			a.Box = BoundingBox::Union(c.Box, e.Box);
+			b.Box = BoundingBox::Union(a.Box, d.Box);
+			a.Height = 1 + std::max(c.Height, e.Height);
+			b.Height = 1 + std::max(a.Height, d.Height);
+		} else {
+			b.Right = iE;
+			a.Left = iD;
+			d.Parent = iA;
+			a.Box = BoundingBox::Union(c.Box, d.Box);
+			b.Box = BoundingBox::Union(a.Box, e.Box);
+			a.Height = 1 + std::max(c.Height, d.Height);
+			b.Height = 1 + std::max(a.Height, e.Height);
+		}
+		return iB;
+	}
+
+	return iA;
+}
+
+void BoundingVolumeHierarchy::_CollectLeaves(int node, const std::function<void(void*)>& callback, std::vector<int>& stack) const {
+	stack.clear();
+	stack.push_back(node);
+	while (!stack.empty()) {
+		const Node& current = _nodes[stack.back()];
+		stack.pop_back();
+		if (current.IsLeaf()) {
+			callback(current.UserData);
+		} else {
+			stack.push_back(current.Left);
+			stack.push_back(current.Right);
+		}
+	}
+}
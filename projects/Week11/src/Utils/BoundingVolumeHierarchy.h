@@ -0,0 +1,135 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <functional>
+#include "Utils/Bounds.h"
+
+/// <summary>
+/// A dynamic bounding volume hierarchy, used to quickly find objects within a region
+/// (for instance, everything inside the camera's frustum)
+///
+/// Objects are stored as proxies with a "fat" bounding box that is slightly larger than
+/// the object, so that small movements don't require the tree to be updated. When an
+/// object does move out of it's fat box, it is removed and re-inserted, and the tree is
+/// re-balanced with rotations along the way, similar to Box2D's b2DynamicTree
+///
+/// Nodes are stored in a flat array and referenced by index, proxy IDs are the index of
+/// the leaf node and stay valid until the proxy is destroyed
+/// </summary>
+class BoundingVolumeHierarchy {
+public:
+	typedef std::shared_ptr<BoundingVolumeHierarchy> Sptr;
+
+	// Index used to indicate no node
+	inline static const int NULL_NODE = -1;
+
+	static inline Sptr Create(float margin = 0.1f) {
+		return std::make_shared<BoundingVolumeHierarchy>(margin);
+	}
+
+	/// <summary>
+	/// Creates a new empty tree
+	/// </summary>
+	/// <param name="margin">The amount to grow proxy boxes by, so that small movements don't update the tree</param>
+	BoundingVolumeHierarchy(float margin = 0.1f);
+	~BoundingVolumeHierarchy() = default;
+
+	BoundingVolumeHierarchy(const BoundingVolumeHierarchy& other) = delete;
+	BoundingVolumeHierarchy(BoundingVolumeHierarchy&& other) = delete;
+	BoundingVolumeHierarchy& operator=(const BoundingVolumeHierarchy& other) = delete;
+	BoundingVolumeHierarchy& operator=(BoundingVolumeHierarchy&& other) = delete;
+
+	/// <summary>
+	/// Adds a new object to the tree
+	/// </summary>
+	/// <param name="box">The world space bounds of the object</param>
+	/// <param name="userData">A pointer that will be passed back when the object is found by a query</param>
+	/// <returns>The ID of the proxy, used to move or remove it</returns>
+	int CreateProxy(const BoundingBox& box, void* userData);
+	/// <summary>
+	/// Removes an object from the tree
+	/// </summary>
+	void DestroyProxy(int proxyId);
+	/// <summary>
+	/// Updates the bounds of an object, only modifying the tree if the object has
+	/// moved outside of it's fat bounding box
+	/// </summary>
+	/// <returns>True if the tree was modified</returns>
+	bool MoveProxy(int proxyId, const BoundingBox& box);
+
+	/// <summary>
+	/// Gets the user data for a proxy
+	/// </summary>
+	void* GetUserData(int proxyId) const;
+	/// <summary>
+	/// Gets the fat bounding box for a proxy
+	/// </summary>
+	const BoundingBox& GetFatBounds(int proxyId) const;
+
+	/// <summary>
+	/// Finds all objects that may be visible within the given frustum. Subtrees that are
+	/// entirely inside the frustum are collected without testing each object
+	/// </summary>
+	/// <param name="frustum">The frustum to test against</param>
+	/// <param name="callback">Invoked with the user data of every object that may be visible</param>
+	void Query(const Frustum& frustum, const std::function<void(void*)>& callback) const;
+	/// <summary>
+	/// Finds all objects whose fat bounds overlap the given box
+	/// </summary>
+	/// <param name="box">The box to test against</param>
+	/// <param name="callback">Invoked with the user data of every overlapping object</param>
+	void Query(const BoundingBox& box, const std::function<void(void*)>& callback) const;
+
+	/// <summary>
+	/// Gets the number of objects in the tree
+	/// </summary>
+	int GetProxyCount() const { return _proxyCount; }
+	/// <summary>
+	/// Gets the height of the tree, where a single leaf has a height of 0
+	/// </summary>
+	int GetHeight() const;
+
+	/// <summary>
+	/// Removes all objects from the tree
+	/// </summary>
+	void Clear();
+
+protected:
+	struct Node {
+		BoundingBox Box;
+		void*       UserData = nullptr;
+		// The parent node, or the next free node when this node is on the free list
+		int         Parent   = NULL_NODE;
+		int         Left     = NULL_NODE;
+		int         Right    = NULL_NODE;
+		// Leaves have a height of 0, free nodes have a height of -1
+		int         Height   = -1;
+
+		bool IsLeaf() const { return Left == NULL_NODE; }
+	};
+
+	std::vector<Node> _nodes;
+	int               _root;
+	int               _freeList;
+	int               _proxyCount;
+	float             _margin;
+
+	int  _AllocateNode();
+	void _FreeNode(int node);
+
+	void _InsertLeaf(int leaf);
+	void _RemoveLeaf(int leaf);
+	/// <summary>
+	/// Performs a left or right rotation if node A is imbalanced
+	/// </summary>
+	/// <returns>The index of the new root of the subtree</returns>
+	int _Balance(int a);
+	/// <summary>
+	/// Walks from the given node to the root, refitting boxes and rebalancing
+	/// </summary>
+	void _Refit(int node);
+	/// <summary>
+	/// Invokes the callback on every leaf below the given node, without any tests
+	/// </summary>
+	void _CollectLeaves(int node, const std::function<void(void*)>& callback, std::vector<int>& stack) const;
+};
@@ -0,0 +1,175 @@
+#include "Utils/Bounds.h"
+#include <limits>
+#include <algorithm>
+
+// SSE is always available on x64, and on x86 builds when /arch:SSE or higher is set
+#if defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1) || defined(__SSE__)
+#define BOUNDS_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+BoundingBox::BoundingBox() :
+	Min(glm::vec3(std::numeric_limits<float>::max())),
+	Max(glm::vec3(std::numeric_limits<float>::lowest()))
+{ }
+
+BoundingBox::BoundingBox(const glm::vec3& min, const glm::vec3& max) :
+	Min(min),
+	Max(max)
+{ }
+
+float BoundingBox::GetSurfaceArea() const {
+	glm::vec3 size = Max - Min;
+	return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+void BoundingBox::Expand(const glm::vec3& point) {
+	Min = glm::min(Min, point);
+	Max = glm::max(Max, point);
+}
+
+void BoundingBox::Inflate(float amount) {
+	Min -= glm::vec3(amount);
+	Max += glm::vec3(amount);
+}
+
+bool BoundingBox::Contains(const BoundingBox& other) const {
+	return
+		Min.x <= other.Min.x && Min.y <= other.Min.y && Min.z <= other.Min.z &&
+		Max.x >= other.Max.x && Max.y >= other.Max.y && Max.z >= other.Max.z;
+}
+
+bool BoundingBox::Intersects(const BoundingBox& other) const {
+	return
+		Min.x <= other.Max.x && Max.x >= other.Min.x &&
+		Min.y <= other.Max.y && Max.y >= other.Min.y &&
+		Min.z <= other.Max.z && Max.z >= other.Min.z;
+}
+
+BoundingBox BoundingBox::Transformed(const glm::mat4& transform) const {
+	if (!IsValid()) {
+		return BoundingBox();
+	}
+
+	// Transform the center, then project the extents onto each world axis (Arvo's method),
+	// this is much cheaper than transforming all 8 corners
+	glm::vec3 center  = glm::vec3(transform * glm::vec4(GetCenter(), 1.0f));
+	glm::vec3 extents = GetExtents();
+	glm::vec3 worldExtents =
+		glm::abs(glm::vec3(transform[0])) * extents.x +
+		glm::abs(glm::vec3(transform[1])) * extents.y +
+		glm::abs(glm::vec3(transform[2])) * extents.z;
+	return BoundingBox(center - worldExtents, center + worldExtents);
+}
+
+BoundingBox BoundingBox::Union(const BoundingBox& a, const BoundingBox& b) {
+	return BoundingBox(glm::min(a.Min, b.Min), glm::max(a.Max, b.Max));
+}
+
+BoundingBox BoundingBox::FromVertices(const void* vertices, size_t vertexCount, size_t stride, size_t positionOffset) {
+	BoundingBox result;
+	const uint8_t* data = static_cast<const uint8_t*>(vertices) + positionOffset;
+	for (size_t ix = 0; ix < vertexCount; ix++) {
+		result.Expand(*reinterpret_cast<const glm::vec3*>(data + ix * stride));
+	}
+	return result;
+}
+
+Frustum::Frustum() :
+	_normalX(), _normalY(), _normalZ(), _distance()
+{ }
+
+Frustum::Frustum(const glm::mat4& viewProjection) :
+	Frustum()
+{
+	// Gribb-Hartmann plane extraction, GLM matrices are column major so we grab the rows manually
+	glm::vec4 rows[4];
+	for (int ix = 0; ix < 4; ix++) {
+		rows[ix] = glm::vec4(viewProjection[0][ix], viewProjection[1][ix], viewProjection[2][ix], viewProjection[3][ix]);
+	}
+	glm::vec4 planes[6] = {
+		rows[3] + rows[0], // Left
+		rows[3] - rows[0], // Right
+		rows[3] + rows[1], // Bottom
+		rows[3] - rows[1], // Top
+		rows[3] + rows[2], // Near
+		rows[3] - rows[2]  // Far
+	};
+
+	for (int ix = 0; ix < 8; ix++) {
+		// Pad out the last group by repeating planes, which won't change the result
+		glm::vec4 plane = planes[ix % 6];
+		plane /= glm::length(glm::vec3(plane));
+		_normalX[ix]  = plane.x;
+		_normalY[ix]  = plane.y;
+		_normalZ[ix]  = plane.z;
+		_distance[ix] = plane.w;
+	}
+}
+
+Frustum::TestResult Frustum::Test(const BoundingBox& box) const {
+	if (!box.IsValid()) {
+		return TestResult::Outside;
+	}
+
+	// For each plane, d is the distance from the plane to the center of the box, and r is
+	// the box's extents projected onto the plane normal. If d + r < 0, the box is entirely
+	// behind the plane, and if d - r < 0 then the box straddles the plane
+	glm::vec3 center  = box.GetCenter();
+	glm::vec3 extents = box.GetExtents();
+	bool isIntersecting = false;
+
+#ifdef BOUNDS_USE_SSE
+	const __m128 cx = _mm_set1_ps(center.x);
+	const __m128 cy = _mm_set1_ps(center.y);
+	const __m128 cz = _mm_set1_ps(center.z);
+	const __m128 ex = _mm_set1_ps(extents.x);
+	const __m128 ey = _mm_set1_ps(extents.y);
+	const __m128 ez = _mm_set1_ps(extents.z);
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	const __m128 zero = _mm_setzero_ps();
+
+	for (int ix = 0; ix < 8; ix += 4) {
+		__m128 nx = _mm_load_ps(_normalX + ix);
+		__m128 ny = _mm_load_ps(_normalY + ix);
+		__m128 nz = _mm_load_ps(_normalZ + ix);
+		__m128 w  = _mm_load_ps(_distance + ix);
+
+		__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, cx), _mm_mul_ps(ny, cy)), _mm_add_ps(_mm_mul_ps(nz, cz), w));
+		__m128 r = _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(_mm_andnot_ps(signMask, nx), ex),
+			_mm_mul_ps(_mm_andnot_ps(signMask, ny), ey)),
+			_mm_mul_ps(_mm_andnot_ps(signMask, nz), ez));
+
+		if (_mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(d, r), zero)) != 0) {
+			return TestResult::Outside;
+		}
+		if (_mm_movemask_ps(_mm_cmplt_ps(_mm_sub_ps(d, r), zero)) != 0) {
+			isIntersecting = true;
+		}
+	}
+#else
+	for (int ix = 0; ix < 6; ix++) {
+		float d = _normalX[ix] * center.x + _normalY[ix] * center.y + _normalZ[ix] * center.z + _distance[ix];
+		float r = std::abs(_normalX[ix]) * extents.x + std::abs(_normalY[ix]) * extents.y + std::abs(_normalZ[ix]) * extents.z;
+		if (d + r < 0.0f) {
+			return TestResult::Outside;
+		}
+		if (d - r < 0.0f) {
+			isIntersecting = true;
+		}
+	}
+#endif
+
+	return isIntersecting ? TestResult::Intersecting : TestResult::Inside;
+}
+
+bool Frustum::Intersects(const glm::vec3& center, float radius) const {
+	for (int ix = 0; ix < 6; ix++) {
+		float d = _normalX[ix] * center.x + _normalY[ix] * center.y + _normalZ[ix] * center.z + _distance[ix];
+		if (d < -radius) {
+			return false;
+		}
+	}
+	return true;
+}
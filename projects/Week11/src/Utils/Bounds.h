@@ -0,0 +1,117 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <GLM/glm.hpp>
+
+/// <summary>
+/// An axis aligned bounding box, stored as a minimum and maximum corner. A default
+/// constructed box is empty (invalid), and will become valid once a point is added
+/// </summary>
+struct BoundingBox {
+	glm::vec3 Min;
+	glm::vec3 Max;
+
+	BoundingBox();
+	BoundingBox(const glm::vec3& min, const glm::vec3& max);
+
+	/// <summary>
+	/// Returns true if this box contains at least one point
+	/// </summary>
+	bool IsValid() const { return Min.x <= Max.x && Min.y <= Max.y && Min.z <= Max.z; }
+
+	glm::vec3 GetCenter() const { return (Min + Max) * 0.5f; }
+	/// <summary>
+	/// Gets the half size of the box along each axis
+	/// </summary>
+	glm::vec3 GetExtents() const { return (Max - Min) * 0.5f; }
+	/// <summary>
+	/// Gets the radius of the sphere centered on the box that encloses it
+	/// </summary>
+	float GetRadius() const { return glm::length(GetExtents()); }
+	/// <summary>
+	/// Gets the surface area of the box, used as the cost metric when building trees
+	/// </summary>
+	float GetSurfaceArea() const;
+
+	/// <summary>
+	/// Grows the box to include the given point
+	/// </summary>
+	void Expand(const glm::vec3& point);
+	/// <summary>
+	/// Grows the box by the given amount in every direction
+	/// </summary>
+	void Inflate(float amount);
+
+	/// <summary>
+	/// Returns true if the other box is entirely inside this one
+	/// </summary>
+	bool Contains(const BoundingBox& other) const;
+	/// <summary>
+	/// Returns true if the two boxes overlap
+	/// </summary>
+	bool Intersects(const BoundingBox& other) const;
+
+	/// <summary>
+	/// Gets the axis aligned box that encloses this box after it has been transformed
+	/// </summary>
+	/// <param name="transform">The affine transformation to apply</param>
+	BoundingBox Transformed(const glm::mat4& transform) const;
+
+	/// <summary>
+	/// Gets the box that encloses both of the given boxes
+	/// </summary>
+	static BoundingBox Union(const BoundingBox& a, const BoundingBox& b);
+
+	/// <summary>
+	/// Calculates the bounds of a set of vertices, using the vec3 position stored at the
+	/// given offset in each vertex
+	/// </summary>
+	/// <param name="vertices">Pointer to the first vertex</param>
+	/// <param name="vertexCount">The number of vertices</param>
+	/// <param name="stride">The size of a single vertex in bytes</param>
+	/// <param name="positionOffset">The offset of the position within the vertex in bytes</param>
+	static BoundingBox FromVertices(const void* vertices, size_t vertexCount, size_t stride, size_t positionOffset = 0);
+};
+
+/// <summary>
+/// A view frustum, represented as 6 planes facing inwards. Planes are stored in
+/// structure-of-arrays form so that boxes can be tested against 4 planes at a time
+/// </summary>
+class Frustum {
+public:
+	/// <summary>
+	/// The result of testing a volume against the frustum
+	/// </summary>
+	enum class TestResult {
+		Outside,
+		Intersecting,
+		Inside
+	};
+
+	Frustum();
+	/// <summary>
+	/// Extracts the frustum planes from a view projection matrix
+	/// </summary>
+	Frustum(const glm::mat4& viewProjection);
+
+	/// <summary>
+	/// Tests a bounding box against the frustum, may report boxes that are just outside
+	/// a corner of the frustum as intersecting, which is fine for culling
+	/// </summary>
+	TestResult Test(const BoundingBox& box) const;
+	/// <summary>
+	/// Returns true if any part of the box may be visible
+	/// </summary>
+	bool Intersects(const BoundingBox& box) const { return Test(box) != TestResult::Outside; }
+	/// <summary>
+	/// Returns true if any part of the sphere may be visible
+	/// </summary>
+	bool Intersects(const glm::vec3& center, float radius) const;
+
+protected:
+	// 6 planes, padded out to 8 so we can always process them in groups of 4
+	alignas(16) float _normalX[8];
+	alignas(16) float _normalY[8];
+	alignas(16) float _normalZ[8];
+	alignas(16) float _distance[8];
+};
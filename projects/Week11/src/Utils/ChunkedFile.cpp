@@ -0,0 +1,145 @@
+#include "Utils/ChunkedFile.h"
+#include <fstream>
+#include <Logging.h>
+
+namespace ChunkedFile {
+	bool IsChunkedFile(const uint8_t* data, size_t size) {
+		if (data == nullptr || size < sizeof(FileHeader)) {
+			return false;
+		}
+		uint32_t magic;
+		memcpy(&magic, data, sizeof(uint32_t));
+		return magic == MAGIC;
+	}
+
+	bool IsChunkedFile(const std::string& path) {
+		std::ifstream in(path, std::ios::in | std::ios::binary);
+		if (!in) {
+			return false;
+		}
+		uint32_t magic = 0;
+		in.read(reinterpret_cast<char*>(&magic), sizeof(uint32_t));
+		return in.gcount() == sizeof(uint32_t) && magic == MAGIC;
+	}
+}
+
+// Rounds a value up to the next multiple of CHUNK_ALIGNMENT
+static uint64_t AlignChunkOffset(uint64_t offset) {
+	return (offset + ChunkedFile::CHUNK_ALIGNMENT - 1) & ~(uint64_t)(ChunkedFile::CHUNK_ALIGNMENT - 1);
+}
+
+void ChunkedFileWriter::AddChunk(uint32_t id, uint32_t version, std::vector<uint8_t>&& data) {
+	_chunks.push_back({ id, version, std::move(data) });
+}
+
+bool ChunkedFileWriter::Save(const std::string& path) const {
+	ChunkedFile::FileHeader header;
+	header.Magic      = ChunkedFile::MAGIC;
+	header.Version    = ChunkedFile::VERSION;
+	header.Reserved   = 0;
+	header.ChunkCount = static_cast<uint32_t>(_chunks.size());
+	header.Reserved2  = 0;
+
+	// Lay out the chunk table, payloads start after the table
+	std::vector<ChunkedFile::ChunkHeader> table(_chunks.size());
+	uint64_t offset = AlignChunkOffset(sizeof(ChunkedFile::FileHeader) + sizeof(ChunkedFile::ChunkHeader) * table.size());
+	for (size_t ix = 0; ix < _chunks.size(); ix++) {
+		table[ix].Id      = _chunks[ix].Id;
+		table[ix].Version = _chunks[ix].Version;
+		table[ix].Offset  = offset;
+		table[ix].Size    = _chunks[ix].Data.size();
+		offset = AlignChunkOffset(offset + table[ix].Size);
+	}
+
+	std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!out) {
+		LOG_ERROR("Could not open file '{}' for writing", path);
+		return false;
+	}
+
+	static const char padding[ChunkedFile::CHUNK_ALIGNMENT] = { 0 };
+	uint64_t written = 0;
+	auto pad = [&](uint64_t target) {
+		out.write(padding, static_cast<std::streamsize>(target - written));
+		written = target;
+	};
+
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	out.write(reinterpret_cast<const char*>(table.data()), sizeof(ChunkedFile::ChunkHeader) * table.size());
+	written = sizeof(header) + sizeof(ChunkedFile::ChunkHeader) * table.size();
+
+	for (size_t ix = 0; ix < _chunks.size(); ix++) {
+		pad(table[ix].Offset);
+		out.write(reinterpret_cast<const char*>(_chunks[ix].Data.data()), _chunks[ix].Data.size());
+		written += _chunks[ix].Data.size();
+	}
+
+	if (!out) {
+		LOG_ERROR("Failed to write to file '{}'", path);
+		return false;
+	}
+	return true;
+}
+
+ChunkedFileReader::Sptr ChunkedFileReader::Open(const std::string& path) {
+	MemoryMappedFile::Sptr file = MemoryMappedFile::Open(path);
+	if (file == nullptr) {
+		return nullptr;
+	}
+
+	if (!ChunkedFile::IsChunkedFile(file->GetData(), file->GetSize())) {
+		LOG_ERROR("File '{}' is not a binary chunked file", path);
+		return nullptr;
+	}
+
+	ChunkedFile::FileHeader header;
+	memcpy(&header, file->GetData(), sizeof(header));
+	if (header.Version > ChunkedFile::VERSION) {
+		LOG_ERROR("File '{}' has version {}, but we only support up to version {}", path, header.Version, ChunkedFile::VERSION);
+		return nullptr;
+	}
+
+	// Make sure the chunk table and all the chunks are within the file, so we don't have
+	// to bounds check every time we look up a chunk
+	size_t tableEnd = sizeof(header) + sizeof(ChunkedFile::ChunkHeader) * (size_t)header.ChunkCount;
+	if (tableEnd > file->GetSize()) {
+		LOG_ERROR("File '{}' is truncated", path);
+		return nullptr;
+	}
+	const ChunkedFile::ChunkHeader* chunks = reinterpret_cast<const ChunkedFile::ChunkHeader*>(file->GetData() + sizeof(header));
+	for (uint32_t ix = 0; ix < header.ChunkCount; ix++) {
+		if (chunks[ix].Offset > file->GetSize() || chunks[ix].Size > file->GetSize() - chunks[ix].Offset) {
+			LOG_ERROR("Chunk {} in file '{}' is out of bounds", ix, path);
+			return nullptr;
+		}
+	}
+
+	// Constructor is protected, so we can't use make_shared
+	Sptr result(new ChunkedFileReader());
+	result->_file       = file;
+	result->_chunks     = chunks;
+	result->_chunkCount = header.ChunkCount;
+	result->_version    = header.Version;
+	return result;
+}
+
+bool ChunkedFileReader::HasChunk(uint32_t id) const {
+	for (uint32_t ix = 0; ix < _chunkCount; ix++) {
+		if (_chunks[ix].Id == id) {
+			return true;
+		}
+	}
+	return false;
+}
+
+BinaryReader ChunkedFileReader::GetChunk(uint32_t id, uint32_t* version) const {
+	for (uint32_t ix = 0; ix < _chunkCount; ix++) {
+		if (_chunks[ix].Id == id) {
+			if (version != nullptr) {
+				*version = _chunks[ix].Version;
+			}
+			return BinaryReader(_file->GetData() + _chunks[ix].Offset, static_cast<size_t>(_chunks[ix].Size));
+		}
+	}
+	return BinaryReader();
+}
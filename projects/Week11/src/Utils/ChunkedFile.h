@@ -0,0 +1,130 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+
+#include "Utils/BinaryStream.h"
+#include "Utils/MemoryMappedFile.h"
+
+/// <summary>
+/// Builds a four character code from a string literal, ex: MakeFourCC("SCNE")
+/// </summary>
+constexpr uint32_t MakeFourCC(const char(&id)[5]) {
+	return (uint32_t)(uint8_t)id[0] | ((uint32_t)(uint8_t)id[1] << 8) | ((uint32_t)(uint8_t)id[2] << 16) | ((uint32_t)(uint8_t)id[3] << 24);
+}
+
+/// <summary>
+/// Our binary files are made up of a header, a table of chunks, then the chunk
+/// payloads themselves:
+///
+///    FileHeader    { Magic = "OTRB", Version, ChunkCount }
+///    ChunkHeader[] { Id, Version, Offset, Size }
+///    payloads      (each aligned to CHUNK_ALIGNMENT from the start of the file)
+///
+/// Every chunk is versioned independently, so a reader can skip chunks it does not
+/// know about, and a chunk's layout can change without bumping the whole format
+/// </summary>
+namespace ChunkedFile {
+	constexpr uint32_t MAGIC           = MakeFourCC("OTRB");
+	constexpr uint16_t VERSION         = 1;
+	constexpr size_t   CHUNK_ALIGNMENT = 8;
+
+	struct FileHeader {
+		uint32_t Magic;
+		uint16_t Version;
+		uint16_t Reserved;
+		uint32_t ChunkCount;
+		uint32_t Reserved2;
+	};
+
+	struct ChunkHeader {
+		uint32_t Id;
+		uint32_t Version;
+		uint64_t Offset;
+		uint64_t Size;
+	};
+
+	/// <summary>
+	/// Checks whether the given data starts with our binary file magic number,
+	/// used to decide whether to take the binary or the JSON path when loading
+	/// </summary>
+	bool IsChunkedFile(const uint8_t* data, size_t size);
+	/// <summary>
+	/// Checks whether the file at the given path starts with our binary file magic number
+	/// </summary>
+	bool IsChunkedFile(const std::string& path);
+}
+
+/// <summary>
+/// Collects chunks in memory, then writes them out to a chunked binary file
+/// </summary>
+class ChunkedFileWriter {
+public:
+	ChunkedFileWriter() : _chunks() { }
+
+	/// <summary>
+	/// Adds a chunk to the file, chunks are written in the order they are added
+	/// </summary>
+	/// <param name="id">The four character code of the chunk</param>
+	/// <param name="version">The version of the chunk's layout</param>
+	/// <param name="data">The payload of the chunk</param>
+	void AddChunk(uint32_t id, uint32_t version, std::vector<uint8_t>&& data);
+
+	/// <summary>
+	/// Writes the header, chunk table, and all chunks to the given file
+	/// </summary>
+	/// <param name="path">The path of the file to write</param>
+	/// <returns>True if the file was written successfully</returns>
+	bool Save(const std::string& path) const;
+
+protected:
+	struct Chunk {
+		uint32_t             Id;
+		uint32_t             Version;
+		std::vector<uint8_t> Data;
+	};
+	std::vector<Chunk> _chunks;
+};
+
+/// <summary>
+/// Reads chunks from a chunked binary file, the file is memory mapped and
+/// chunks are read in-place without copying
+/// </summary>
+class ChunkedFileReader {
+public:
+	typedef std::shared_ptr<ChunkedFileReader> Sptr;
+
+	/// <summary>
+	/// Opens and validates a chunked file
+	/// </summary>
+	/// <param name="path">The path of the file to open</param>
+	/// <returns>The reader, or nullptr if the file does not exist or is not a valid chunked file</returns>
+	static Sptr Open(const std::string& path);
+
+	/// <summary>
+	/// Returns true if the file contains a chunk with the given ID
+	/// </summary>
+	bool HasChunk(uint32_t id) const;
+
+	/// <summary>
+	/// Gets a reader for the first chunk with the given ID
+	/// </summary>
+	/// <param name="id">The four character code of the chunk to find</param>
+	/// <param name="version">Receives the version of the chunk, can be nullptr</param>
+	/// <returns>A reader over the chunk, which is invalid if the chunk does not exist</returns>
+	BinaryReader GetChunk(uint32_t id, uint32_t* version = nullptr) const;
+
+	/// <summary>
+	/// Gets the version of the container format
+	/// </summary>
+	uint16_t GetVersion() const { return _version; }
+
+protected:
+	ChunkedFileReader() : _file(nullptr), _chunks(nullptr), _chunkCount(0), _version(0) { }
+
+	MemoryMappedFile::Sptr          _file;
+	const ChunkedFile::ChunkHeader* _chunks;
+	uint32_t                        _chunkCount;
+	uint16_t                        _version;
+};
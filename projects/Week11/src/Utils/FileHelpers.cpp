@@ -5,6 +5,9 @@
 
 #include "Utils/StringUtils.h"
 
+std::mutex FileHelpers::_includeCacheMutex;
+std::unordered_map<std::string, std::string> FileHelpers::_includeCache;
+
 std::string FileHelpers::ReadFile(const std::string& filename) {
 	std::string result;
 	std::ifstream in(filename, std::ios::in | std::ios::binary); // ifstream closes itself due to RAII
@@ -31,9 +34,32 @@ std::string FileHelpers::ReadFile(const std::string& filename) {
 	return result;
 }
 
-std::string FileHelpers::ReadResolveIncludes(const std::string& filename, std::vector<std::string> resolvedPaths) {
-	// Read the entire file contents for processing
+std::string FileHelpers::ReadResolveIncludes(const std::string& filename) {
+	std::unordered_set<std::string> resolvedPaths;
+	return _ResolveIncludes(filename, ReadFile(filename), resolvedPaths);
+}
+
+void FileHelpers::ClearIncludeCache() {
+	std::lock_guard<std::mutex> lock(_includeCacheMutex);
+	_includeCache.clear();
+}
+
+std::string FileHelpers::_ReadInclude(const std::string& filename) {
+	{
+		std::lock_guard<std::mutex> lock(_includeCacheMutex);
+		auto it = _includeCache.find(filename);
+		if (it != _includeCache.end()) {
+			return it->second;
+		}
+	}
+	// Read outside of the lock, if two threads race to read the same file they'll get the same result
 	std::string result = ReadFile(filename);
+	std::lock_guard<std::mutex> lock(_includeCacheMutex);
+	_includeCache[filename] = result;
+	return result;
+}
+
+std::string FileHelpers::_ResolveIncludes(const std::string& filename, std::string result, std::unordered_set<std::string>& resolvedPaths) {
 	// Determine where the file we just read resides on the filesystem
 	const std::filesystem::path folder = std::filesystem::path(filename).parent_path();
 
@@ -72,19 +98,18 @@ std::string FileHelpers::ReadResolveIncludes(const std::string& filename, std::v
 		// Get a lexically normal path (ie with the ../ parts resolved)
 		target = target.lexically_normal();
 
-		// If we haven't included the file yet, include it now
-		if (std::find(resolvedPaths.begin(), resolvedPaths.end(), target.string()) == resolvedPaths.end()) {
+		// If we haven't included the file yet, include it now. We mark it as included first
+		// so that files including each other can't recurse forever
+		if (resolvedPaths.insert(target.string()).second) {
 
 			// Make sure file exists, then load and resolve it's includes
 			LOG_ASSERT(std::filesystem::exists(target), "File does not exist");
-			std::string replacement = FileHelpers::ReadResolveIncludes(target.string(), resolvedPaths);
+			std::string replacement = _ResolveIncludes(target.string(), _ReadInclude(target.string()), resolvedPaths);
 
 			// Inject result into our string
 			result.replace(seek, eol - seek, replacement);
 			// Look for more includes!
 			seek = result.find(includeToken, seek + replacement.length());
-
-			resolvedPaths.push_back(target.string());
 		}
 		// File already included, remove the line and continue seeking
 		else {
@@ -2,6 +2,9 @@
 
 #include <string>
 #include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <mutex>
 
 class FileHelpers {
 public:
@@ -15,12 +18,18 @@ public:
 
 	/// <summary>
 	/// Reads the entire contents of a file, and will also recursively include
-	/// any other files needed as indicated by a #include fileName on a line
+	/// any other files needed as indicated by a #include fileName on a line.
+	/// Each file is only included once. Included files are cached, since many
+	/// files share the same includes. This is safe to call from any thread
 	/// </summary>
 	/// <param name="filename">The path of the file to load</param>
-	/// <param name="resolvedPaths">The list of paths that have already been included</param>
 	/// <returns>The entire contents of the file, with includes resolved, stored in a string</returns>
-	static std::string ReadResolveIncludes(const std::string& filename, std::vector<std::string> resolvedPaths = std::vector<std::string>());
+	static std::string ReadResolveIncludes(const std::string& filename);
+	/// <summary>
+	/// Forgets all the included files cached by ReadResolveIncludes, so that
+	/// changes on disk will be picked up
+	/// </summary>
+	static void ClearIncludeCache();
 
 	/// <summary>
 	/// Helper for writing the contents of a string into a file
@@ -29,4 +38,18 @@ public:
 	/// <param name="contents">The contents of the file to write</param>
 	/// <param name="append">True if contents should be appended to end of existing files</param>
 	static void WriteContentsToFile(const std::string& filename, const std::string& contents, bool append = false);
+
+protected:
+	static std::mutex _includeCacheMutex;
+	// Maps lexically normal paths to the contents of included files
+	static std::unordered_map<std::string, std::string> _includeCache;
+
+	/// <summary>
+	/// Resolves all the includes in the contents of a file, skipping any files that are already in resolvedPaths
+	/// </summary>
+	static std::string _ResolveIncludes(const std::string& filename, std::string contents, std::unordered_set<std::string>& resolvedPaths);
+	/// <summary>
+	/// Reads an included file, using the cached copy if there is one
+	/// </summary>
+	static std::string _ReadInclude(const std::string& filename);
 };
\ No newline at end of file
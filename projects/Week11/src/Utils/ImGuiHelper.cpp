@@ -11,6 +11,7 @@
 #include "imgui_internal.h"
 
 #include <Logging.h>
+#include "Utils/Profiler.h"
 
 #include <GLM/glm.hpp>
 
@@ -85,6 +86,7 @@ void ImGuiHelper::StartFrame() {
 }
 
 void ImGuiHelper::EndFrame() {
+	PROFILE_GPU_SCOPE("ImGui");
 	LOG_ASSERT(_window != nullptr, "You must initialize ImGuiHelper before use!");
 
 	// Make sure ImGui knows how big our window is
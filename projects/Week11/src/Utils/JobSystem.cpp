@@ -0,0 +1,208 @@
+#include "Utils/JobSystem.h"
+#include <algorithm>
+#include <Logging.h>
+
+std::vector<std::thread> JobSystem::_workers;
+std::deque<JobSystem::Job> JobSystem::_jobs;
+std::mutex JobSystem::_mutex;
+std::condition_variable JobSystem::_jobAdded;
+std::condition_variable JobSystem::_idle;
+uint32_t JobSystem::_outstanding = 0;
+bool JobSystem::_isRunning = false;
+std::vector<std::unique_ptr<JobSystem::WorkQueue>> JobSystem::_queues;
+std::atomic<uint32_t> JobSystem::_queuedTasks(0);
+thread_local uint32_t JobSystem::_threadIndex = JobSystem::EXTERNAL_THREAD_INDEX;
+
+void JobSystem::Init(uint32_t numWorkers) {
+	LOG_ASSERT(!_isRunning, "Job system has already been initialized!");
+
+	if (numWorkers == 0) {
+		// Leave a hardware thread for the main thread, hardware_concurrency may return 0 if it can't tell
+		uint32_t hardwareThreads = std::thread::hardware_concurrency();
+		numWorkers = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	// The queues need to exist before any worker can try to steal from them. We have one for
+	// the main thread, one per worker, and one shared by any threads we don't own
+	_queues.clear();
+	for (uint32_t ix = 0; ix <= numWorkers + 1; ix++) {
+		_queues.push_back(std::make_unique<WorkQueue>());
+	}
+	_threadIndex = 0;
+
+	_isRunning = true;
+	_workers.reserve(numWorkers);
+	for (uint32_t ix = 0; ix < numWorkers; ix++) {
+		_workers.emplace_back(&JobSystem::_WorkerMain, ix + 1);
+	}
+	LOG_INFO("Started job system with {} worker threads", numWorkers);
+}
+
+void JobSystem::Shutdown() {
+	if (!_isRunning) {
+		return;
+	}
+
+	WaitIdle();
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_isRunning = false;
+	}
+	_jobAdded.notify_all();
+
+	for (std::thread& worker : _workers) {
+		worker.join();
+	}
+	_workers.clear();
+	_queues.clear();
+}
+
+void JobSystem::Schedule(Job&& job) {
+	bool queued = false;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_isRunning) {
+			_jobs.push_back(std::move(job));
+			_outstanding++;
+			queued = true;
+		}
+	}
+
+	if (queued) {
+		_jobAdded.notify_one();
+	}
+	// No workers, run it ourselves
+	else {
+		job();
+	}
+}
+
+void JobSystem::WaitIdle() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	_idle.wait(lock, []() { return _outstanding == 0; });
+}
+
+void JobSystem::Run(Counter& counter, Job&& job) {
+	// No workers, run it ourselves
+	if (!_isRunning) {
+		job();
+		return;
+	}
+
+	counter.Pending.fetch_add(1, std::memory_order_relaxed);
+	WorkQueue& queue = *_queues[_GetOwnQueueIndex()];
+	{
+		std::lock_guard<std::mutex> lock(queue.Mutex);
+		queue.Tasks.push_back(Task{ std::move(job), &counter });
+	}
+	_queuedTasks.fetch_add(1);
+
+	// Workers check _queuedTasks while holding _mutex before they sleep, so taking the lock
+	// here means we can't slip the notify in between their check and their wait
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+	}
+	_jobAdded.notify_one();
+}
+
+void JobSystem::Wait(Counter& counter) {
+	while (counter.Pending.load(std::memory_order_acquire) > 0) {
+		// Rather than blocking, help out with whatever is queued. If there's nothing to take,
+		// our remaining jobs are already running on other threads
+		if (!_TryRunTask()) {
+			std::this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::ParallelFor(size_t count, size_t batchSize, const std::function<void(size_t start, size_t end)>& func) {
+	if (count == 0) {
+		return;
+	}
+	batchSize = std::max(batchSize, (size_t)1);
+
+	// We wait before returning, so the jobs can safely reference func
+	Counter counter;
+	for (size_t start = 0; start < count; start += batchSize) {
+		size_t end = std::min(start + batchSize, count);
+		Run(counter, [&func, start, end]() { func(start, end); });
+	}
+	Wait(counter);
+}
+
+uint32_t JobSystem::GetWorkerCount() {
+	return static_cast<uint32_t>(_workers.size());
+}
+
+uint32_t JobSystem::GetThreadIndex() {
+	return _threadIndex;
+}
+
+void JobSystem::_WorkerMain(uint32_t threadIndex) {
+	_threadIndex = threadIndex;
+	while (true) {
+		// Short jobs come first, since someone is waiting on them
+		if (_TryRunTask()) {
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(_mutex);
+		_jobAdded.wait(lock, []() { return !_jobs.empty() || _queuedTasks.load() > 0 || !_isRunning; });
+		if (_queuedTasks.load() > 0) {
+			continue;
+		}
+		if (_jobs.empty()) {
+			// Only exits once the queue has been drained
+			return;
+		}
+
+		Job job = std::move(_jobs.front());
+		_jobs.pop_front();
+
+		lock.unlock();
+		job();
+		lock.lock();
+
+		_outstanding--;
+		if (_outstanding == 0) {
+			_idle.notify_all();
+		}
+	}
+}
+
+size_t JobSystem::_GetOwnQueueIndex() {
+	return _threadIndex == EXTERNAL_THREAD_INDEX ? _queues.size() - 1 : _threadIndex;
+}
+
+bool JobSystem::_TryRunTask() {
+	if (_queuedTasks.load() == 0) {
+		return false;
+	}
+
+	Task task{ nullptr, nullptr };
+	size_t queueCount = _queues.size();
+	size_t ownIndex = _GetOwnQueueIndex();
+	for (size_t ix = 0; ix < queueCount && task.Owner == nullptr; ix++) {
+		// Start with our own queue, then try the others in turn so that thieves spread out
+		WorkQueue& queue = *_queues[(ownIndex + ix) % queueCount];
+		std::lock_guard<std::mutex> lock(queue.Mutex);
+		if (queue.Tasks.empty()) {
+			continue;
+		}
+		if (ix == 0) {
+			task = std::move(queue.Tasks.back());
+			queue.Tasks.pop_back();
+		} else {
+			task = std::move(queue.Tasks.front());
+			queue.Tasks.pop_front();
+		}
+		_queuedTasks.fetch_sub(1);
+	}
+
+	if (task.Owner == nullptr) {
+		return false;
+	}
+	task.Func();
+	task.Owner->Pending.fetch_sub(1, std::memory_order_release);
+	return true;
+}
@@ -0,0 +1,141 @@
+#pragma once
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <atomic>
+#include <memory>
+
+/// <summary>
+/// A small pool of worker threads that run jobs in the background, used for
+/// work that does not need the OpenGL context (file I/O, image decoding,
+/// mesh parsing, etc...)
+///
+/// There are two kinds of jobs. Background jobs (Schedule) go into a shared
+/// queue and may take a long time, nobody waits on them directly. Short jobs
+/// (Run and ParallelFor) are used to split up work within a frame, they go into
+/// a queue owned by the thread that started them, and idle threads steal from
+/// the other queues. Threads that the job system does not own (ex: the physics
+/// thread) share a single extra queue, so they never touch the main thread's.
+/// A thread waiting on short jobs runs queued jobs itself rather than blocking,
+/// so waiting from inside a job is safe
+///
+/// Jobs must not make any GL calls, since the context is only current on the
+/// main thread. Results that need to be uploaded should be handed back to the
+/// main thread (see ResourceManager::ProcessPendingLoads)
+/// </summary>
+class JobSystem {
+public:
+	typedef std::function<void()> Job;
+
+	/// <summary>
+	/// Tracks a batch of short jobs started with Run, so that the caller can wait for them to finish.
+	/// Must outlive all of the jobs that were started with it
+	/// </summary>
+	struct Counter {
+		std::atomic<uint32_t> Pending{ 0 };
+	};
+
+	JobSystem() = delete;
+
+	/// <summary>
+	/// Starts up the worker threads, the calling thread is treated as the main thread
+	/// </summary>
+	/// <param name="numWorkers">The number of worker threads to start, or 0 to use one less than the number of hardware threads</param>
+	static void Init(uint32_t numWorkers = 0);
+	/// <summary>
+	/// Waits for all queued jobs to finish, then stops the worker threads
+	/// </summary>
+	static void Shutdown();
+
+	/// <summary>
+	/// Adds a job to the queue, it will be run by the next free worker. If the
+	/// job system has not been initialized, the job is run immediately on the
+	/// calling thread
+	/// </summary>
+	/// <param name="job">The job to run</param>
+	static void Schedule(Job&& job);
+
+	/// <summary>
+	/// Blocks the calling thread until all queued jobs have finished
+	/// </summary>
+	static void WaitIdle();
+
+	/// <summary>
+	/// Adds a short job to the calling thread's queue, where it may be stolen by any idle
+	/// thread. If the job system has not been initialized, the job is run immediately
+	/// </summary>
+	/// <param name="counter">The counter to add the job to, use Wait to wait for all the jobs in the counter</param>
+	/// <param name="job">The job to run</param>
+	static void Run(Counter& counter, Job&& job);
+	/// <summary>
+	/// Runs queued jobs on the calling thread until all the jobs in the counter have finished
+	/// </summary>
+	static void Wait(Counter& counter);
+	/// <summary>
+	/// Splits the range [0, count) into batches and runs them across all threads,
+	/// returning once every batch has finished. The calling thread helps out
+	/// </summary>
+	/// <param name="count">The number of items to process</param>
+	/// <param name="batchSize">The number of items to process in each job</param>
+	/// <param name="func">The function to invoke with the start and end (exclusive) of each batch</param>
+	static void ParallelFor(size_t count, size_t batchSize, const std::function<void(size_t start, size_t end)>& func);
+
+	/// <summary>
+	/// Gets the number of worker threads in the pool
+	/// </summary>
+	static uint32_t GetWorkerCount();
+	/// <summary>
+	/// Gets the index of the calling thread, 0 for the main thread, 1 to GetWorkerCount() for
+	/// the workers, and EXTERNAL_THREAD_INDEX for any threads not owned by the job system
+	/// </summary>
+	static uint32_t GetThreadIndex();
+
+	// The thread index of threads that were not started by the job system
+	inline static const uint32_t EXTERNAL_THREAD_INDEX = (uint32_t)-1;
+
+protected:
+	// A short job, and the counter to notify when it is done
+	struct Task {
+		Job      Func;
+		Counter* Owner;
+	};
+
+	// A queue of short jobs owned by a single thread. The owner pushes and pops at the
+	// back, other threads steal from the front so they take the oldest (usually largest) work
+	struct WorkQueue {
+		std::mutex       Mutex;
+		std::deque<Task> Tasks;
+	};
+
+	static std::vector<std::thread> _workers;
+	static std::deque<Job>          _jobs;
+	static std::mutex               _mutex;
+	// Signalled when a job is added, or when the workers should exit
+	static std::condition_variable  _jobAdded;
+	// Signalled when a job finishes and there is no more work to do
+	static std::condition_variable  _idle;
+	// The number of jobs that are queued or currently running
+	static uint32_t                 _outstanding;
+	static bool                     _isRunning;
+
+	// One queue per thread, index 0 belongs to the main thread, and the last queue is
+	// shared by all the threads that the job system does not own
+	static std::vector<std::unique_ptr<WorkQueue>> _queues;
+	// The number of short jobs waiting in any queue, so sleeping workers know when to wake
+	static std::atomic<uint32_t>    _queuedTasks;
+	static thread_local uint32_t    _threadIndex;
+
+	static void _WorkerMain(uint32_t threadIndex);
+	/// <summary>
+	/// Gets the index of the queue that the calling thread pushes short jobs to
+	/// </summary>
+	static size_t _GetOwnQueueIndex();
+	/// <summary>
+	/// Pops a short job from our own queue, or steals one from another thread, and runs it
+	/// </summary>
+	/// <returns>True if a job was run, false if all the queues were empty</returns>
+	static bool _TryRunTask();
+};
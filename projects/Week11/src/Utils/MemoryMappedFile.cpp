@@ -0,0 +1,108 @@
+#include "Utils/MemoryMappedFile.h"
+#include <Logging.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MemoryMappedFile::MemoryMappedFile() :
+	_data(nullptr),
+	_size(0),
+	#ifdef _WIN32
+	_fileHandle(INVALID_HANDLE_VALUE),
+	_mappingHandle(nullptr)
+	#else
+	_fileDescriptor(-1)
+	#endif
+{ }
+
+MemoryMappedFile::~MemoryMappedFile() {
+	#ifdef _WIN32
+	if (_data != nullptr) {
+		UnmapViewOfFile(_data);
+	}
+	if (_mappingHandle != nullptr) {
+		CloseHandle(_mappingHandle);
+	}
+	if (_fileHandle != INVALID_HANDLE_VALUE) {
+		CloseHandle(_fileHandle);
+	}
+	#else
+	if (_data != nullptr) {
+		munmap(const_cast<uint8_t*>(_data), _size);
+	}
+	if (_fileDescriptor != -1) {
+		close(_fileDescriptor);
+	}
+	#endif
+}
+
+MemoryMappedFile::Sptr MemoryMappedFile::Open(const std::string& path) {
+	// Constructor is protected, so we can't use make_shared
+	Sptr result(new MemoryMappedFile());
+
+	#ifdef _WIN32
+	result->_fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (result->_fileHandle == INVALID_HANDLE_VALUE) {
+		LOG_ERROR("Could not open file '{}'", path);
+		return nullptr;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(result->_fileHandle, &size)) {
+		LOG_ERROR("Could not get the size of file '{}'", path);
+		return nullptr;
+	}
+	result->_size = static_cast<size_t>(size.QuadPart);
+
+	// Windows will not let us map an empty file, but that's still a valid (empty) result
+	if (result->_size == 0) {
+		return result;
+	}
+
+	result->_mappingHandle = CreateFileMappingA(result->_fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (result->_mappingHandle == nullptr) {
+		LOG_ERROR("Could not create a file mapping for '{}'", path);
+		return nullptr;
+	}
+
+	result->_data = static_cast<const uint8_t*>(MapViewOfFile(result->_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+	if (result->_data == nullptr) {
+		LOG_ERROR("Could not map view of file '{}'", path);
+		return nullptr;
+	}
+	#else
+	result->_fileDescriptor = open(path.c_str(), O_RDONLY);
+	if (result->_fileDescriptor == -1) {
+		LOG_ERROR("Could not open file '{}'", path);
+		return nullptr;
+	}
+
+	struct stat info;
+	if (fstat(result->_fileDescriptor, &info) != 0) {
+		LOG_ERROR("Could not get the size of file '{}'", path);
+		return nullptr;
+	}
+	result->_size = static_cast<size_t>(info.st_size);
+
+	if (result->_size == 0) {
+		return result;
+	}
+
+	void* data = mmap(nullptr, result->_size, PROT_READ, MAP_PRIVATE, result->_fileDescriptor, 0);
+	if (data == MAP_FAILED) {
+		LOG_ERROR("Could not map file '{}'", path);
+		return nullptr;
+	}
+	result->_data = static_cast<const uint8_t*>(data);
+	#endif
+
+	return result;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <string>
+#include <memory>
+#include <cstdint>
+
+/// <summary>
+/// Provides read-only access to the contents of a file by mapping it into our
+/// address space, rather than copying it into a string. Pages are only loaded
+/// by the OS as they are touched, so opening a large file is very cheap
+/// </summary>
+class MemoryMappedFile {
+public:
+	typedef std::shared_ptr<MemoryMappedFile> Sptr;
+
+	// We'll disallow moving and copying, since we own OS handles
+	MemoryMappedFile(const MemoryMappedFile& other) = delete;
+	MemoryMappedFile(MemoryMappedFile&& other) = delete;
+	MemoryMappedFile& operator=(const MemoryMappedFile& other) = delete;
+	MemoryMappedFile& operator=(MemoryMappedFile&& other) = delete;
+
+	~MemoryMappedFile();
+
+	/// <summary>
+	/// Maps the given file into memory for reading
+	/// </summary>
+	/// <param name="path">The path of the file to map</param>
+	/// <returns>The mapped file, or nullptr if the file could not be opened</returns>
+	static Sptr Open(const std::string& path);
+
+	/// <summary>
+	/// Gets a pointer to the start of the file's contents
+	/// </summary>
+	const uint8_t* GetData() const { return _data; }
+	/// <summary>
+	/// Gets the size of the file in bytes
+	/// </summary>
+	size_t GetSize() const { return _size; }
+
+protected:
+	MemoryMappedFile();
+
+	const uint8_t* _data;
+	size_t         _size;
+
+	#ifdef _WIN32
+	void* _fileHandle;
+	void* _mappingHandle;
+	#else
+	int   _fileDescriptor;
+	#endif
+};
@@ -1,6 +1,8 @@
 #pragma once
 #include <vector>
+#include <cstddef>
 #include "Graphics/VertexArrayObject.h"
+#include "Utils/MeshOptimizer.h"
 
 /// <summary>
 /// A utility class that lets us add vertices and indices, then bake it into a final mesh, using interleaved
@@ -127,7 +129,13 @@ public:
 		IndexBuffer::Sptr ebo = nullptr;
 		if (_indices.size() > 0) {
 			ebo = IndexBuffer::Create();
-			ebo->LoadData(GetIndexDataPtr(), _indices.size());
+			// Use 16 bit indices when they fit, to halve our index bandwidth
+			if (MeshOptimizer::CanUseShortIndices(_vertices.size())) {
+				std::vector<uint16_t> shortIndices = MeshOptimizer::ToShortIndices(_indices);
+				ebo->LoadData(shortIndices.data(), shortIndices.size());
+			} else {
+				ebo->LoadData(GetIndexDataPtr(), _indices.size());
+			}
 		}
 
 		// Create VAO and attach the buffers
@@ -138,6 +146,9 @@ public:
 		// Store our vertex type in the VAO's vertex declaration
 		result->SetVDecl(VertType::V_DECL);
 
+		// Calculate the bounds while we still have the vertices on hand
+		result->SetBounds(BoundingBox::FromVertices(_vertices.data(), _vertices.size(), sizeof(VertType), offsetof(VertType, Position)));
+
 		return result;
 	}
 	
@@ -78,4 +78,51 @@ nlohmann::json MeshBuilderParam::ToJson() const {
 		result["params"][key] = GlmToJson(value);
 	}
 	return result;
-}
\ No newline at end of file
+}
+
+VertexArrayObject::Sptr MeshFactory::BakePacked(const MeshBuilder<VertexPosNormTexColTangents>& mesh) {
+	const std::vector<VertexPosNormTexColTangents>& source = mesh._vertices;
+
+	std::vector<VertexPacked> vertices;
+	vertices.reserve(source.size());
+	bool isColorConstant = true;
+	for (const VertexPosNormTexColTangents& vertex : source) {
+		vertices.emplace_back(vertex);
+		isColorConstant &= vertex.Color == source[0].Color;
+	}
+
+	VertexBuffer::Sptr vbo = VertexBuffer::Create();
+	vbo->LoadData(vertices.data(), vertices.size());
+
+	VertexArrayObject::Sptr result = VertexArrayObject::Create();
+	result->AddVertexBuffer(vbo, VertexPacked::V_DECL);
+
+	// Most meshes are a single color, so we don't need to store it per vertex
+	if (isColorConstant) {
+		result->SetConstantAttribute(1, source.size() > 0 ? source[0].Color : glm::vec4(1.0f));
+	} else {
+		std::vector<VertexPackedColor> colors;
+		colors.reserve(source.size());
+		for (const VertexPosNormTexColTangents& vertex : source) {
+			colors.emplace_back(vertex.Color);
+		}
+		VertexBuffer::Sptr colorVbo = VertexBuffer::Create();
+		colorVbo->LoadData(colors.data(), colors.size());
+		result->AddVertexBuffer(colorVbo, VertexPackedColor::V_DECL);
+	}
+
+	if (mesh._indices.size() > 0) {
+		IndexBuffer::Sptr ebo = IndexBuffer::Create();
+		if (MeshOptimizer::CanUseShortIndices(vertices.size())) {
+			std::vector<uint16_t> shortIndices = MeshOptimizer::ToShortIndices(mesh._indices);
+			ebo->LoadData(shortIndices.data(), shortIndices.size());
+		} else {
+			ebo->LoadData(mesh._indices.data(), mesh._indices.size());
+		}
+		result->SetIndexBuffer(ebo);
+	}
+
+	result->SetVDecl(VertexPacked::V_DECL);
+	result->SetBounds(BoundingBox::FromVertices(source.data(), source.size(), sizeof(VertexPosNormTexColTangents), offsetof(VertexPosNormTexColTangents, Position)));
+	return result;
+}
@@ -156,6 +156,37 @@ public:
 	template <typename Vertex>
 	static void CalculateTBN(MeshBuilder<Vertex>& mesh);
 
+	/// <summary>
+	/// Runs all of the MeshOptimizer passes on a mesh, reordering it's triangles for the vertex
+	/// cache and overdraw, then reordering it's vertices in the order they are used. This should
+	/// be done once the mesh is complete (after CalculateTBN)
+	/// </summary>
+	/// <typeparam name="Vertex">The type of vertex the mesh consists of</typeparam>
+	/// <param name="mesh">The mesh to manipulate</param>
+	template <typename Vertex>
+	static void Optimize(MeshBuilder<Vertex>& mesh);
+
+	/// <summary>
+	/// Bakes a mesh using the compact VertexPacked layout instead of it's full vertices. Colors
+	/// are stored in a second buffer if they differ between vertices, otherwise they are fed
+	/// to the shader as a constant. Call Optimize first to reorder the mesh
+	/// </summary>
+	/// <param name="mesh">The mesh to bake</param>
+	/// <returns>A VertexArrayObject using packed vertices</returns>
+	static VertexArrayObject::Sptr BakePacked(const MeshBuilder<VertexPosNormTexColTangents>& mesh);
+	/// <summary>
+	/// Generates levels of detail for a mesh with MeshSimplifier, and bakes them into VAOs that share
+	/// the vertex buffers of the full detail mesh. May return fewer levels than requested (or none),
+	/// if the mesh can't be simplified any further
+	/// </summary>
+	/// <param name="mesh">The mesh that was baked</param>
+	/// <param name="baked">The VAO that was baked from the mesh</param>
+	/// <param name="lodCount">The largest number of levels to generate</param>
+	/// <param name="reduction">The fraction of triangles each level keeps from the level before it</param>
+	/// <returns>The VAOs for each level, from most to least detailed</returns>
+	template <typename Vertex>
+	static std::vector<VertexArrayObject::Sptr> BakeLods(const MeshBuilder<Vertex>& mesh, const VertexArrayObject::Sptr& baked, int lodCount, float reduction);
+
 protected:	
 	MeshFactory() = default;
 	~MeshFactory() = default;
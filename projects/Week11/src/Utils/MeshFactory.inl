@@ -10,6 +10,8 @@
 #include "MeshFactory.h"
 #include "Utils/JsonGlmHelpers.h"
 #include "Graphics/VertexParamMap.h"
+#include "Utils/MeshOptimizer.h"
+#include "Utils/MeshSimplifier.h"
 
 #define M_PI 3.14159265359f
 
@@ -616,4 +618,57 @@ void MeshFactory::CalculateTBN(MeshBuilder<Vertex>& mesh)
 		vMap.SetBiTangent(v2, glm::normalize((vMap.GetBiTangent(v1) + bitangent) / 2.0f));
 		vMap.SetBiTangent(v3, glm::normalize((vMap.GetBiTangent(v1) + bitangent) / 2.0f));
 	}
-}
\ No newline at end of file
+}
+
+template <typename Vertex>
+void MeshFactory::Optimize(MeshBuilder<Vertex>& mesh)
+{
+	VertexParamMap vMap = VertexParamMap(Vertex::V_DECL);
+	if (vMap.PositionOffset == -1) {
+		LOG_WARN("Vertex type does not have a position attribute, aborting Optimize");
+		return;
+	}
+	if (mesh._indices.size() == 0 || mesh._vertices.size() == 0) {
+		LOG_WARN("Mesh does not have indices, aborting Optimize");
+		return;
+	}
+
+	// Triangle order first, since the overdraw pass needs to know where the cache is empty
+	MeshOptimizer::OptimizeVertexCache(mesh._indices, mesh._vertices.size());
+	const uint8_t* positions = reinterpret_cast<const uint8_t*>(mesh._vertices.data()) + vMap.PositionOffset;
+	MeshOptimizer::OptimizeOverdraw(mesh._indices, positions, mesh._vertices.size(), sizeof(Vertex));
+
+	// Then put the vertices in the order that the triangles use them
+	std::vector<uint32_t> remap = MeshOptimizer::OptimizeVertexFetch(mesh._indices, mesh._vertices.size());
+	std::vector<Vertex> vertices;
+	vertices.reserve(remap.size());
+	for (uint32_t oldIndex : remap) {
+		vertices.push_back(mesh._vertices[oldIndex]);
+	}
+	mesh._vertices.swap(vertices);
+}
+
+template <typename Vertex>
+std::vector<VertexArrayObject::Sptr> MeshFactory::BakeLods(const MeshBuilder<Vertex>& mesh, const VertexArrayObject::Sptr& baked, int lodCount, float reduction)
+{
+	std::vector<VertexArrayObject::Sptr> result;
+	if (lodCount <= 0 || mesh._indices.size() == 0 || baked == nullptr) {
+		return result;
+	}
+
+	const uint8_t* positions = reinterpret_cast<const uint8_t*>(mesh._vertices.data()) + offsetof(Vertex, Position);
+	std::vector<std::vector<uint32_t>> lods = MeshSimplifier::BuildLodChain(
+		mesh._indices, positions, mesh._vertices.size(), sizeof(Vertex), lodCount, reduction);
+	for (const std::vector<uint32_t>& lod : lods) {
+		// Match the index format of the full mesh, see MeshBuilder::Bake
+		IndexBuffer::Sptr ebo = IndexBuffer::Create();
+		if (MeshOptimizer::CanUseShortIndices(mesh._vertices.size())) {
+			std::vector<uint16_t> shortIndices = MeshOptimizer::ToShortIndices(lod);
+			ebo->LoadData(shortIndices.data(), shortIndices.size());
+		} else {
+			ebo->LoadData(lod.data(), lod.size());
+		}
+		result.push_back(baked->CreateWithIndices(ebo));
+	}
+	return result;
+}
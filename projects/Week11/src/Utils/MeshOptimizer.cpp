@@ -0,0 +1,262 @@
+#include "Utils/MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <GLM/glm.hpp>
+
+// Tuning values from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+static const size_t FORSYTH_CACHE_SIZE     = 32;
+static const float  FORSYTH_DECAY_POWER    = 1.5f;
+static const float  FORSYTH_LAST_TRI_SCORE = 0.75f;
+static const float  FORSYTH_VALENCE_SCALE  = 2.0f;
+static const float  FORSYTH_VALENCE_POWER  = 0.5f;
+
+// Scores a vertex based on it's position in the cache (-1 if it's not in the cache) and how many triangles still use it
+static float ScoreVertex(int cachePosition, uint32_t remainingTris) {
+	if (remainingTris == 0) {
+		return -1.0f;
+	}
+
+	float score = 0.0f;
+	if (cachePosition >= 0) {
+		// The vertices of the last triangle get a fixed score, so we don't favour one of it's edges
+		if (cachePosition < 3) {
+			score = FORSYTH_LAST_TRI_SCORE;
+		} else {
+			float scale = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+			score = std::pow(1.0f - (cachePosition - 3) * scale, FORSYTH_DECAY_POWER);
+		}
+	}
+	// Favour vertices with only a few triangles left, so that we don't leave lone triangles behind
+	score += FORSYTH_VALENCE_SCALE * std::pow(static_cast<float>(remainingTris), -FORSYTH_VALENCE_POWER);
+	return score;
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount) {
+	size_t triCount = indices.size() / 3;
+	if (triCount == 0 || vertexCount == 0) {
+		return;
+	}
+
+	// Build a flat list of the triangles that use each vertex
+	std::vector<uint32_t> remaining(vertexCount, 0);
+	for (uint32_t index : indices) {
+		remaining[index]++;
+	}
+	std::vector<uint32_t> adjacencyStart(vertexCount + 1, 0);
+	for (size_t ix = 0; ix < vertexCount; ix++) {
+		adjacencyStart[ix + 1] = adjacencyStart[ix] + remaining[ix];
+	}
+	std::vector<uint32_t> adjacency(triCount * 3);
+	{
+		std::vector<uint32_t> cursor(adjacencyStart.begin(), adjacencyStart.end() - 1);
+		for (uint32_t tri = 0; tri < triCount; tri++) {
+			for (size_t corner = 0; corner < 3; corner++) {
+				adjacency[cursor[indices[tri * 3 + corner]]++] = tri;
+			}
+		}
+	}
+
+	std::vector<int>   cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (size_t ix = 0; ix < vertexCount; ix++) {
+		vertexScore[ix] = ScoreVertex(-1, remaining[ix]);
+	}
+
+	std::vector<float> triScore(triCount);
+	std::vector<bool>  isEmitted(triCount, false);
+	int64_t bestTri = 0;
+	for (size_t tri = 0; tri < triCount; tri++) {
+		triScore[tri] = vertexScore[indices[tri * 3]] + vertexScore[indices[tri * 3 + 1]] + vertexScore[indices[tri * 3 + 2]];
+		if (triScore[tri] > triScore[bestTri]) {
+			bestTri = tri;
+		}
+	}
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+
+	// The cache holds an extra 3 entries while it's being updated, these get pushed out
+	uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+	uint32_t newCache[FORSYTH_CACHE_SIZE + 3];
+	size_t   cacheSize = 0;
+	size_t   scanCursor = 0;
+
+	while (bestTri >= 0) {
+		isEmitted[bestTri] = true;
+		const uint32_t* tri = &indices[bestTri * 3];
+
+		// Emit the triangle, and remove it from it's vertices' lists of remaining triangles
+		for (size_t corner = 0; corner < 3; corner++) {
+			uint32_t vertex = tri[corner];
+			result.push_back(vertex);
+
+			uint32_t* begin = &adjacency[adjacencyStart[vertex]];
+			uint32_t* end   = begin + remaining[vertex];
+			*std::find(begin, end, static_cast<uint32_t>(bestTri)) = *(end - 1);
+			remaining[vertex]--;
+		}
+
+		// The triangle's vertices move to the front of the cache, everything else shifts back
+		size_t newCacheSize = 0;
+		for (size_t corner = 0; corner < 3; corner++) {
+			newCache[newCacheSize++] = tri[corner];
+		}
+		for (size_t ix = 0; ix < cacheSize; ix++) {
+			uint32_t vertex = cache[ix];
+			if (vertex != tri[0] && vertex != tri[1] && vertex != tri[2]) {
+				newCache[newCacheSize++] = vertex;
+			}
+		}
+
+		// Update the scores of every vertex that moved (including the ones that fell out), and
+		// pass the change on to their triangles
+		for (size_t ix = 0; ix < newCacheSize; ix++) {
+			uint32_t vertex = newCache[ix];
+			cachePosition[vertex] = ix < FORSYTH_CACHE_SIZE ? static_cast<int>(ix) : -1;
+
+			float score = ScoreVertex(cachePosition[vertex], remaining[vertex]);
+			float delta = score - vertexScore[vertex];
+			vertexScore[vertex] = score;
+			for (uint32_t adj = adjacencyStart[vertex]; adj < adjacencyStart[vertex] + remaining[vertex]; adj++) {
+				triScore[adjacency[adj]] += delta;
+			}
+		}
+
+		// The next triangle is almost always one that uses a vertex in the cache
+		bestTri = -1;
+		float bestScore = -1.0f;
+		cacheSize = std::min(newCacheSize, FORSYTH_CACHE_SIZE);
+		for (size_t ix = 0; ix < cacheSize; ix++) {
+			uint32_t vertex = newCache[ix];
+			cache[ix] = vertex;
+			for (uint32_t adj = adjacencyStart[vertex]; adj < adjacencyStart[vertex] + remaining[vertex]; adj++) {
+				if (triScore[adjacency[adj]] > bestScore) {
+					bestScore = triScore[adjacency[adj]];
+					bestTri = adjacency[adj];
+				}
+			}
+		}
+
+		// Nothing left near the cache, so we move on to the next triangle we haven't emitted
+		if (bestTri < 0) {
+			while (scanCursor < triCount && isEmitted[scanCursor]) {
+				scanCursor++;
+			}
+			bestTri = scanCursor < triCount ? static_cast<int64_t>(scanCursor) : -1;
+		}
+	}
+
+	indices.swap(result);
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::vector<uint32_t>& indices, const void* positions, size_t vertexCount, size_t stride) {
+	size_t triCount = indices.size() / 3;
+	if (triCount == 0 || vertexCount == 0) {
+		return;
+	}
+
+	const uint8_t* positionData = reinterpret_cast<const uint8_t*>(positions);
+	auto getPosition = [&](uint32_t index) {
+		glm::vec3 result;
+		memcpy(&result, positionData + index * stride, sizeof(glm::vec3));
+		return result;
+	};
+
+	// Simulate a FIFO cache with timestamps, a vertex is in the cache if it was added less than
+	// FIFO_CACHE_SIZE misses ago. A triangle that misses on all of it's vertices is where we can
+	// start a new cluster, since moving it won't cost us any cache hits
+	std::vector<uint32_t> clusterStarts;
+	std::vector<uint32_t> timestamps(vertexCount, 0);
+	uint32_t time = static_cast<uint32_t>(FIFO_CACHE_SIZE) + 1;
+	for (size_t tri = 0; tri < triCount; tri++) {
+		int misses = 0;
+		for (size_t corner = 0; corner < 3; corner++) {
+			uint32_t vertex = indices[tri * 3 + corner];
+			if (time - timestamps[vertex] > FIFO_CACHE_SIZE) {
+				timestamps[vertex] = time++;
+				misses++;
+			}
+		}
+		if (tri == 0 || misses == 3) {
+			clusterStarts.push_back(static_cast<uint32_t>(tri));
+		}
+	}
+	if (clusterStarts.size() < 2) {
+		return;
+	}
+	clusterStarts.push_back(static_cast<uint32_t>(triCount));
+
+	// Find the area weighted center and normal of each cluster, and of the whole mesh
+	size_t clusterCount = clusterStarts.size() - 1;
+	std::vector<glm::vec3> clusterCenters(clusterCount, glm::vec3(0.0f));
+	std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3(0.0f));
+	glm::vec3 meshCenter = glm::vec3(0.0f);
+	float meshArea = 0.0f;
+	for (size_t cluster = 0; cluster < clusterCount; cluster++) {
+		float clusterArea = 0.0f;
+		for (size_t tri = clusterStarts[cluster]; tri < clusterStarts[cluster + 1]; tri++) {
+			glm::vec3 a = getPosition(indices[tri * 3]);
+			glm::vec3 b = getPosition(indices[tri * 3 + 1]);
+			glm::vec3 c = getPosition(indices[tri * 3 + 2]);
+			glm::vec3 normal = glm::cross(b - a, c - a);
+			float area = glm::length(normal);
+
+			clusterCenters[cluster] += (a + b + c) * (area / 3.0f);
+			clusterNormals[cluster] += normal;
+			clusterArea += area;
+		}
+		meshCenter += clusterCenters[cluster];
+		meshArea += clusterArea;
+		clusterCenters[cluster] = clusterArea > 0.0f ? clusterCenters[cluster] / clusterArea : getPosition(indices[clusterStarts[cluster] * 3]);
+	}
+	if (meshArea > 0.0f) {
+		meshCenter /= meshArea;
+	}
+
+	// Clusters facing away from the center are on the outside of the mesh, and should be drawn first
+	std::vector<float> sortKeys(clusterCount, 0.0f);
+	for (size_t cluster = 0; cluster < clusterCount; cluster++) {
+		float length = glm::length(clusterNormals[cluster]);
+		if (length > 0.0f) {
+			sortKeys[cluster] = glm::dot(clusterCenters[cluster] - meshCenter, clusterNormals[cluster] / length);
+		}
+	}
+	std::vector<uint32_t> order(clusterCount);
+	for (uint32_t ix = 0; ix < clusterCount; ix++) {
+		order[ix] = ix;
+	}
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+	for (uint32_t cluster : order) {
+		result.insert(result.end(), indices.begin() + clusterStarts[cluster] * 3, indices.begin() + clusterStarts[cluster + 1] * 3);
+	}
+	indices.swap(result);
+}
+
+std::vector<uint32_t> MeshOptimizer::OptimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount) {
+	const uint32_t UNUSED = static_cast<uint32_t>(-1);
+
+	std::vector<uint32_t> remap(vertexCount, UNUSED);
+	std::vector<uint32_t> result;
+	result.reserve(vertexCount);
+	for (uint32_t& index : indices) {
+		if (remap[index] == UNUSED) {
+			remap[index] = static_cast<uint32_t>(result.size());
+			result.push_back(index);
+		}
+		index = remap[index];
+	}
+	return result;
+}
+
+std::vector<uint16_t> MeshOptimizer::ToShortIndices(const std::vector<uint32_t>& indices) {
+	std::vector<uint16_t> result(indices.size());
+	for (size_t ix = 0; ix < indices.size(); ix++) {
+		result[ix] = static_cast<uint16_t>(indices[ix]);
+	}
+	return result;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/// <summary>
+/// Post-bake optimizations for indexed triangle meshes. These don't change what a mesh
+/// looks like, only the order that triangles and vertices are stored in, so that the GPU
+/// can draw them with fewer vertex shader invocations, less overdraw and more cache
+/// friendly vertex fetches. The passes should be run in the order they are declared in,
+/// MeshFactory::Optimize will run all of them on a MeshBuilder
+/// </summary>
+class MeshOptimizer {
+public:
+	// The size of the FIFO cache we simulate when looking for cluster boundaries, this is
+	// about what most GPUs have these days
+	inline static const size_t FIFO_CACHE_SIZE = 16;
+	// The largest vertex count that can use 16 bit indices
+	inline static const size_t MAX_SHORT_INDEX_VERTICES = 65536;
+
+	/// <summary>
+	/// Reorders triangles so that vertices are re-used while they are still in the post
+	/// transform cache, using Tom Forsyth's linear-speed vertex cache optimization
+	/// </summary>
+	/// <param name="indices">The triangle list to reorder</param>
+	/// <param name="vertexCount">The number of vertices the indices refer to</param>
+	static void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+	/// <summary>
+	/// Splits the triangle list into clusters at points where the vertex cache is effectively
+	/// empty anyways, then sorts the clusters so that ones facing away from the center of the
+	/// mesh are drawn first. Those are the most likely to occlude the rest of the mesh, so this
+	/// cuts down on overdraw without hurting the cache. Should be run after OptimizeVertexCache
+	/// </summary>
+	/// <param name="indices">The triangle list to reorder</param>
+	/// <param name="positions">A pointer to the position of the first vertex</param>
+	/// <param name="vertexCount">The number of vertices the indices refer to</param>
+	/// <param name="stride">The distance between positions, in bytes</param>
+	static void OptimizeOverdraw(std::vector<uint32_t>& indices, const void* positions, size_t vertexCount, size_t stride);
+	/// <summary>
+	/// Renumbers vertices in the order that the indices first use them, so that vertex
+	/// fetches walk through the vertex buffer in order. Unused vertices are dropped
+	/// </summary>
+	/// <param name="indices">The triangle list, will be rewritten to use the new vertex order</param>
+	/// <param name="vertexCount">The number of vertices the indices refer to</param>
+	/// <returns>For each new vertex, the index of the old vertex it should be copied from</returns>
+	static std::vector<uint32_t> OptimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount);
+
+	/// <summary>
+	/// Returns true if a mesh with the given number of vertices can use 16 bit indices
+	/// </summary>
+	static bool CanUseShortIndices(size_t vertexCount) { return vertexCount <= MAX_SHORT_INDEX_VERTICES; }
+	/// <summary>
+	/// Converts indices to 16 bits, the caller must make sure that they fit (see CanUseShortIndices)
+	/// </summary>
+	static std::vector<uint16_t> ToShortIndices(const std::vector<uint32_t>& indices);
+
+protected:
+	MeshOptimizer() = default;
+	~MeshOptimizer() = default;
+};
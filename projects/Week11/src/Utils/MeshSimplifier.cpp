@@ -0,0 +1,350 @@
+#include "Utils/MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <GLM/glm.hpp>
+
+#include "Utils/MeshOptimizer.h"
+
+/// <summary>
+/// A symmetric 4x4 matrix that measures the sum of squared distances from a point to a set
+/// of planes. We keep the total weight of the planes as well, so that the error can be
+/// turned back into an average distance
+/// </summary>
+struct Quadric {
+	double A2, AB, AC, AD, B2, BC, BD, C2, CD, D2;
+	double Weight;
+
+	Quadric() : A2(0), AB(0), AC(0), AD(0), B2(0), BC(0), BD(0), C2(0), CD(0), D2(0), Weight(0) {}
+
+	// Creates the quadric for the plane ax + by + cz + d = 0, scaled by weight
+	static Quadric FromPlane(const glm::dvec3& normal, double d, double weight) {
+		Quadric result;
+		result.A2 = normal.x * normal.x * weight;
+		result.AB = normal.x * normal.y * weight;
+		result.AC = normal.x * normal.z * weight;
+		result.AD = normal.x * d * weight;
+		result.B2 = normal.y * normal.y * weight;
+		result.BC = normal.y * normal.z * weight;
+		result.BD = normal.y * d * weight;
+		result.C2 = normal.z * normal.z * weight;
+		result.CD = normal.z * d * weight;
+		result.D2 = d * d * weight;
+		result.Weight = weight;
+		return result;
+	}
+
+	Quadric& operator +=(const Quadric& other) {
+		A2 += other.A2; AB += other.AB; AC += other.AC; AD += other.AD;
+		B2 += other.B2; BC += other.BC; BD += other.BD;
+		C2 += other.C2; CD += other.CD;
+		D2 += other.D2;
+		Weight += other.Weight;
+		return *this;
+	}
+
+	// Gets the weighted average of the squared distances from the point to our planes
+	double Evaluate(const glm::vec3& point) const {
+		double x = point.x, y = point.y, z = point.z;
+		double error =
+			A2 * x * x + 2.0 * AB * x * y + 2.0 * AC * x * z + 2.0 * AD * x +
+			B2 * y * y + 2.0 * BC * y * z + 2.0 * BD * y +
+			C2 * z * z + 2.0 * CD * z +
+			D2;
+		return Weight > 0.0 ? std::abs(error) / Weight : 0.0;
+	}
+};
+
+// Collapses that turn a triangle's normal by more than this (as a cosine) are rejected
+static const float MIN_NORMAL_COSINE = 0.25f;
+
+// A candidate for collapsing the vertex From onto the vertex To
+struct Collapse {
+	uint32_t From;
+	uint32_t To;
+	double   Error;
+};
+
+std::vector<uint32_t> MeshSimplifier::Simplify(const std::vector<uint32_t>& sourceIndices, const void* positions, size_t vertexCount, size_t stride,
+											   size_t targetIndexCount, float maxError, float* resultError) {
+	std::vector<uint32_t> indices = sourceIndices;
+	if (resultError != nullptr) {
+		*resultError = 0.0f;
+	}
+	if (indices.size() <= targetIndexCount || vertexCount == 0) {
+		return indices;
+	}
+
+	const uint8_t* positionData = reinterpret_cast<const uint8_t*>(positions);
+	std::vector<glm::vec3> vertices(vertexCount);
+	for (size_t ix = 0; ix < vertexCount; ix++) {
+		memcpy(&vertices[ix], positionData + ix * stride, sizeof(glm::vec3));
+	}
+
+	// Errors are measured relative to the size of the mesh, so that the limits work at any scale
+	glm::vec3 min = vertices[indices[0]], max = vertices[indices[0]];
+	for (uint32_t index : indices) {
+		min = glm::min(min, vertices[index]);
+		max = glm::max(max, vertices[index]);
+	}
+	double scale = glm::length(max - min);
+	if (scale <= 0.0) {
+		return indices;
+	}
+	double maxErrorSq = (maxError * scale) * (maxError * scale);
+
+	// Lock any vertex that shares it's position with another one, moving one side of a seam
+	// would tear the mesh open
+	std::vector<bool> isLocked(vertexCount, false);
+	{
+		std::vector<uint32_t> order(vertexCount);
+		for (uint32_t ix = 0; ix < vertexCount; ix++) {
+			order[ix] = ix;
+		}
+		auto lessThan = [&](uint32_t a, uint32_t b) {
+			const glm::vec3& pa = vertices[a];
+			const glm::vec3& pb = vertices[b];
+			if (pa.x != pb.x) return pa.x < pb.x;
+			if (pa.y != pb.y) return pa.y < pb.y;
+			return pa.z < pb.z;
+		};
+		std::sort(order.begin(), order.end(), lessThan);
+		for (size_t ix = 1; ix < vertexCount; ix++) {
+			if (vertices[order[ix]] == vertices[order[ix - 1]]) {
+				isLocked[order[ix]] = true;
+				isLocked[order[ix - 1]] = true;
+			}
+		}
+	}
+
+	// Lock the vertices of any edge that is not shared by exactly two triangles, these are
+	// the borders of the mesh (and any non-manifold bits we'd rather not touch)
+	{
+		std::vector<uint64_t> edges;
+		edges.reserve(indices.size());
+		for (size_t ix = 0; ix < indices.size(); ix += 3) {
+			for (size_t corner = 0; corner < 3; corner++) {
+				uint32_t a = indices[ix + corner];
+				uint32_t b = indices[ix + (corner + 1) % 3];
+				edges.push_back(((uint64_t)std::min(a, b) << 32) | std::max(a, b));
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+		for (size_t start = 0, end = 0; start < edges.size(); start = end) {
+			while (end < edges.size() && edges[end] == edges[start]) {
+				end++;
+			}
+			if (end - start != 2) {
+				isLocked[edges[start] >> 32] = true;
+				isLocked[edges[start] & 0xFFFFFFFF] = true;
+			}
+		}
+	}
+
+	// Every vertex starts with the planes of the triangles around it, weighted by area so
+	// that tiny triangles don't dominate the error
+	std::vector<Quadric> quadrics(vertexCount);
+	for (size_t ix = 0; ix < indices.size(); ix += 3) {
+		glm::dvec3 a = vertices[indices[ix]];
+		glm::dvec3 b = vertices[indices[ix + 1]];
+		glm::dvec3 c = vertices[indices[ix + 2]];
+		glm::dvec3 normal = glm::cross(b - a, c - a);
+		double area = glm::length(normal);
+		if (area <= 0.0) {
+			continue;
+		}
+		normal /= area;
+		Quadric plane = Quadric::FromPlane(normal, -glm::dot(normal, a), area);
+		quadrics[indices[ix]] += plane;
+		quadrics[indices[ix + 1]] += plane;
+		quadrics[indices[ix + 2]] += plane;
+	}
+
+	std::vector<uint32_t> adjacencyStart(vertexCount + 1);
+	std::vector<uint32_t> adjacency;
+	std::vector<uint32_t> remap(vertexCount);
+	std::vector<bool>     isTouched(vertexCount);
+	std::vector<uint32_t> neighbourStamp(vertexCount, 0);
+	uint32_t stamp = 0;
+	std::vector<Collapse> collapses;
+	double error = 0.0;
+
+	// We collapse in passes, each one collapsing as many independent edges as it can. This is
+	// much simpler than keeping a priority queue up to date as the mesh changes
+	while (indices.size() > targetIndexCount) {
+		size_t triCount = indices.size() / 3;
+
+		// Build the list of triangles around each vertex
+		std::fill(adjacencyStart.begin(), adjacencyStart.end(), 0);
+		for (uint32_t index : indices) {
+			adjacencyStart[index + 1]++;
+		}
+		for (size_t ix = 0; ix < vertexCount; ix++) {
+			adjacencyStart[ix + 1] += adjacencyStart[ix];
+		}
+		adjacency.resize(indices.size());
+		{
+			std::vector<uint32_t> cursor(adjacencyStart.begin(), adjacencyStart.end() - 1);
+			for (uint32_t tri = 0; tri < triCount; tri++) {
+				for (size_t corner = 0; corner < 3; corner++) {
+					adjacency[cursor[indices[tri * 3 + corner]]++] = tri;
+				}
+			}
+		}
+
+		// Interior edges show up once in each winding, so we only need to look at one of them.
+		// Border edges only show up once, but they are locked anyways
+		collapses.clear();
+		for (size_t ix = 0; ix < indices.size(); ix += 3) {
+			for (size_t corner = 0; corner < 3; corner++) {
+				uint32_t a = indices[ix + corner];
+				uint32_t b = indices[ix + (corner + 1) % 3];
+				if (a > b || (isLocked[a] && isLocked[b])) {
+					continue;
+				}
+				Quadric combined = quadrics[a];
+				combined += quadrics[b];
+				double errorAB = isLocked[a] ? HUGE_VAL : combined.Evaluate(vertices[b]);
+				double errorBA = isLocked[b] ? HUGE_VAL : combined.Evaluate(vertices[a]);
+				Collapse collapse = errorAB <= errorBA ? Collapse{ a, b, errorAB } : Collapse{ b, a, errorBA };
+				if (collapse.Error <= maxErrorSq) {
+					collapses.push_back(collapse);
+				}
+			}
+		}
+		if (collapses.empty()) {
+			break;
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.Error < b.Error; });
+
+		for (uint32_t ix = 0; ix < vertexCount; ix++) {
+			remap[ix] = ix;
+		}
+		std::fill(isTouched.begin(), isTouched.end(), false);
+
+		size_t remainingTris = triCount;
+		size_t collapseCount = 0;
+		for (const Collapse& collapse : collapses) {
+			if (remainingTris * 3 <= targetIndexCount) {
+				break;
+			}
+			uint32_t from = collapse.From;
+			uint32_t to = collapse.To;
+			// Each vertex only gets involved in one collapse per pass, so that the triangles
+			// we check below are still accurate
+			if (isTouched[from] || isTouched[to]) {
+				continue;
+			}
+
+			// The edge must only be shared by two triangles, and the two vertices must only
+			// share the two neighbours across those triangles. Otherwise the collapse would
+			// fold the surface onto itself
+			stamp += 2;
+			uint32_t sharedTris = 0;
+			for (uint32_t adj = adjacencyStart[from]; adj < adjacencyStart[from + 1]; adj++) {
+				const uint32_t* tri = &indices[adjacency[adj] * 3];
+				if (tri[0] == to || tri[1] == to || tri[2] == to) {
+					sharedTris++;
+				}
+				for (size_t corner = 0; corner < 3; corner++) {
+					neighbourStamp[tri[corner]] = stamp;
+				}
+			}
+			uint32_t sharedNeighbours = 0;
+			for (uint32_t adj = adjacencyStart[to]; adj < adjacencyStart[to + 1]; adj++) {
+				const uint32_t* tri = &indices[adjacency[adj] * 3];
+				for (size_t corner = 0; corner < 3; corner++) {
+					uint32_t vertex = tri[corner];
+					if (vertex != from && vertex != to && neighbourStamp[vertex] == stamp) {
+						neighbourStamp[vertex] = stamp + 1;
+						sharedNeighbours++;
+					}
+				}
+			}
+			if (sharedTris != 2 || sharedNeighbours != 2) {
+				continue;
+			}
+
+			// Make sure none of the triangles that are left would flip over, or turn far enough to
+			// become a sliver standing on it's edge
+			bool isFlipped = false;
+			for (uint32_t adj = adjacencyStart[from]; adj < adjacencyStart[from + 1] && !isFlipped; adj++) {
+				const uint32_t* tri = &indices[adjacency[adj] * 3];
+				if (tri[0] == to || tri[1] == to || tri[2] == to) {
+					continue;
+				}
+				// Rotate the triangle so that the vertex we're moving comes first
+				size_t corner = tri[0] == from ? 0 : (tri[1] == from ? 1 : 2);
+				const glm::vec3& b = vertices[tri[(corner + 1) % 3]];
+				const glm::vec3& c = vertices[tri[(corner + 2) % 3]];
+				glm::vec3 oldNormal = glm::cross(b - vertices[from], c - vertices[from]);
+				glm::vec3 newNormal = glm::cross(b - vertices[to], c - vertices[to]);
+				isFlipped = glm::dot(oldNormal, newNormal) <= MIN_NORMAL_COSINE * glm::length(oldNormal) * glm::length(newNormal);
+			}
+			if (isFlipped) {
+				continue;
+			}
+
+			// Everything around the vertex we moved is now out of date for this pass
+			for (uint32_t adj = adjacencyStart[from]; adj < adjacencyStart[from + 1]; adj++) {
+				const uint32_t* tri = &indices[adjacency[adj] * 3];
+				isTouched[tri[0]] = true;
+				isTouched[tri[1]] = true;
+				isTouched[tri[2]] = true;
+			}
+			quadrics[to] += quadrics[from];
+			remap[from] = to;
+			remainingTris -= sharedTris;
+			error = std::max(error, collapse.Error);
+			collapseCount++;
+		}
+		if (collapseCount == 0) {
+			break;
+		}
+
+		// Apply the collapses, dropping the triangles that collapsed down to a line
+		size_t writeIx = 0;
+		for (size_t ix = 0; ix < indices.size(); ix += 3) {
+			uint32_t a = remap[indices[ix]];
+			uint32_t b = remap[indices[ix + 1]];
+			uint32_t c = remap[indices[ix + 2]];
+			if (a != b && b != c && c != a) {
+				indices[writeIx++] = a;
+				indices[writeIx++] = b;
+				indices[writeIx++] = c;
+			}
+		}
+		indices.resize(writeIx);
+	}
+
+	if (resultError != nullptr) {
+		*resultError = static_cast<float>(std::sqrt(error) / scale);
+	}
+	return indices;
+}
+
+std::vector<std::vector<uint32_t>> MeshSimplifier::BuildLodChain(const std::vector<uint32_t>& indices, const void* positions, size_t vertexCount, size_t stride,
+																 int lodCount, float reduction, float maxError) {
+	std::vector<std::vector<uint32_t>> result;
+	const std::vector<uint32_t>* parent = &indices;
+	for (int level = 0; level < lodCount; level++) {
+		size_t parentTris = parent->size() / 3;
+		if (parentTris < MIN_LOD_TRIANGLES) {
+			break;
+		}
+
+		// Let the error grow with each level, the coarser levels are only drawn when they are small on screen
+		size_t targetTris = std::max(static_cast<size_t>(parentTris * reduction), MIN_LOD_TRIANGLES);
+		float levelError = maxError * (level + 1) / lodCount;
+		std::vector<uint32_t> lod = Simplify(*parent, positions, vertexCount, stride, targetTris * 3, levelError);
+		if (lod.size() / 3 > parentTris * (1.0f - MIN_LOD_REDUCTION)) {
+			break;
+		}
+
+		MeshOptimizer::OptimizeVertexCache(lod, vertexCount);
+		result.push_back(std::move(lod));
+		parent = &result.back();
+	}
+	return result;
+}
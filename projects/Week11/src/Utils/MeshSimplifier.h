@@ -0,0 +1,59 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/// <summary>
+/// Reduces the triangle count of indexed meshes for levels of detail, using quadric error
+/// metric edge collapses (Garland and Heckbert). Edges always collapse onto one of their
+/// existing vertices, so the simplified indices can be drawn with the original vertex buffer
+/// and no attributes need to be interpolated.
+///
+/// Vertices on open borders, and vertices that share a position with another vertex (UV or
+/// normal seams) are never moved, so the silhouette and texture layout are preserved
+/// </summary>
+class MeshSimplifier {
+public:
+	// Meshes (or levels) with fewer triangles than this are not worth simplifying any further
+	inline static const size_t MIN_LOD_TRIANGLES = 64;
+	// A level has to remove at least this fraction of it's parent's triangles to be kept
+	inline static const float  MIN_LOD_REDUCTION = 0.2f;
+	// The default largest error allowed when building a LOD chain, as a fraction of the mesh's size
+	inline static const float  DEFAULT_MAX_ERROR = 0.05f;
+
+	/// <summary>
+	/// Collapses edges in order of increasing error until the mesh reaches the target
+	/// index count, or no collapse is under the error limit
+	/// </summary>
+	/// <param name="indices">The triangle list to simplify</param>
+	/// <param name="positions">A pointer to the position of the first vertex</param>
+	/// <param name="vertexCount">The number of vertices the indices refer to</param>
+	/// <param name="stride">The distance between positions, in bytes</param>
+	/// <param name="targetIndexCount">The number of indices to aim for</param>
+	/// <param name="maxError">The largest distance that the surface may move, as a fraction of the mesh's size</param>
+	/// <param name="resultError">If not null, receives the error of the result, in the same units as maxError</param>
+	/// <returns>The simplified triangle list, which uses the same vertices as the input</returns>
+	static std::vector<uint32_t> Simplify(const std::vector<uint32_t>& indices, const void* positions, size_t vertexCount, size_t stride,
+										  size_t targetIndexCount, float maxError, float* resultError = nullptr);
+
+	/// <summary>
+	/// Builds a chain of levels of detail, where each level is simplified from the one
+	/// before it. The chain stops early if a level can't be reduced far enough to be worth
+	/// drawing, so it may have fewer than lodCount levels. Each level is optimized for the
+	/// vertex cache (see MeshOptimizer::OptimizeVertexCache)
+	/// </summary>
+	/// <param name="indices">The triangle list of the full detail mesh, this is not part of the result</param>
+	/// <param name="positions">A pointer to the position of the first vertex</param>
+	/// <param name="vertexCount">The number of vertices the indices refer to</param>
+	/// <param name="stride">The distance between positions, in bytes</param>
+	/// <param name="lodCount">The maximum number of levels to generate</param>
+	/// <param name="reduction">The fraction of triangles each level should keep from the level before it</param>
+	/// <param name="maxError">The largest error allowed for the last level, as a fraction of the mesh's size</param>
+	/// <returns>The triangle lists for each level, from most to least detailed</returns>
+	static std::vector<std::vector<uint32_t>> BuildLodChain(const std::vector<uint32_t>& indices, const void* positions, size_t vertexCount, size_t stride,
+															 int lodCount, float reduction, float maxError = DEFAULT_MAX_ERROR);
+
+protected:
+	MeshSimplifier() = default;
+	~MeshSimplifier() = default;
+};
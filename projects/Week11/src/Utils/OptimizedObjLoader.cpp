@@ -0,0 +1,496 @@
+#include "Utils/OptimizedObjLoader.h"
+
+#include <charconv>
+#include <filesystem>
+#include <cstring>
+#include <GLFW/glfw3.h>
+#include <Logging.h>
+
+#include "Utils/MeshBuilder.h"
+#include "Utils/MeshFactory.h"
+#include "Utils/MeshOptimizer.h"
+#include "Utils/MeshSimplifier.h"
+#include "Utils/MemoryMappedFile.h"
+#include "Utils/ChunkedFile.h"
+
+// Chunk IDs and versions for our mesh cache files, bump the version if the
+// vertex layout or parser output changes to invalidate old caches
+static const uint32_t MESH_CACHE_HEADER   = MakeFourCC("MESH");
+static const uint32_t MESH_CACHE_VERTICES = MakeFourCC("VERT");
+static const uint32_t MESH_CACHE_INDICES  = MakeFourCC("INDX");
+static const uint32_t MESH_CACHE_LODS     = MakeFourCC("LODS");
+static const uint32_t MESH_CACHE_VERSION  = 3;
+
+// Stored at the start of the MESH chunk, used to make sure the cache matches the source file
+struct MeshCacheHeader {
+	uint64_t SourceSize;
+	int64_t  SourceTime;
+	uint32_t VertexStride;
+	uint32_t VertexCount;
+	uint32_t IndexCount;
+	uint32_t IndexSize;
+	uint32_t HasTangents;
+	uint32_t LodCount;
+	float    LodReduction;
+};
+
+// Holds the packed vertices and indices for a freshly parsed mesh
+struct PackedMeshStorage {
+	std::vector<VertexPacked> Vertices;
+	std::vector<uint32_t>     Indices;
+	std::vector<uint16_t>     ShortIndices;
+	// The indices for each level of detail, in the same format as the mesh's indices
+	std::vector<std::vector<uint32_t>> LodIndices;
+	std::vector<std::vector<uint16_t>> LodShortIndices;
+};
+
+/// <summary>
+/// Maps a combination of OBJ attribute indices (position, uv, normal) to an index in
+/// our vertex list. Uses linear probing over a flat power of two sized table, which
+/// is far cheaper than a node based std::unordered_map for millions of lookups
+/// </summary>
+class ObjVertexTable {
+public:
+	ObjVertexTable(size_t expectedVertices) : _slots(), _mask(0) {
+		size_t capacity = 64;
+		while (capacity < expectedVertices * 2) {
+			capacity *= 2;
+		}
+		_slots.assign(capacity, EMPTY);
+		_mask = capacity - 1;
+	}
+
+	/// <summary>
+	/// Finds the vertex with the given attribute indices, adding it to keys if it does not exist
+	/// </summary>
+	/// <param name="key">The 1-based attribute indices, 0 for attributes that are missing</param>
+	/// <param name="keys">The list of unique vertices, index of each is the vertex index</param>
+	/// <returns>The index of the vertex</returns>
+	uint32_t FindOrAdd(const glm::ivec3& key, std::vector<glm::ivec3>& keys) {
+		// Keep the load factor under 50% so probe sequences stay short
+		if ((keys.size() + 1) * 2 > _slots.size()) {
+			_Grow(keys);
+		}
+		size_t ix = _Hash(key) & _mask;
+		while (true) {
+			uint32_t slot = _slots[ix];
+			if (slot == EMPTY) {
+				uint32_t result = static_cast<uint32_t>(keys.size());
+				_slots[ix] = result;
+				keys.push_back(key);
+				return result;
+			}
+			if (keys[slot] == key) {
+				return slot;
+			}
+			ix = (ix + 1) & _mask;
+		}
+	}
+
+protected:
+	inline static const uint32_t EMPTY = (uint32_t)-1;
+
+	std::vector<uint32_t> _slots;
+	size_t                _mask;
+
+	static size_t _Hash(const glm::ivec3& key) {
+		// Pack the indices together, then use the murmur3 finalizer to spread the bits
+		const uint64_t mask = (1ull << 21) - 1;
+		uint64_t h = (((uint64_t)key.x & mask) << 42) | (((uint64_t)key.y & mask) << 21) | ((uint64_t)key.z & mask);
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdull;
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53ull;
+		h ^= h >> 33;
+		return static_cast<size_t>(h);
+	}
+
+	void _Grow(const std::vector<glm::ivec3>& keys) {
+		_slots.assign(_slots.size() * 2, EMPTY);
+		_mask = _slots.size() - 1;
+		for (uint32_t vertIx = 0; vertIx < keys.size(); vertIx++) {
+			size_t ix = _Hash(keys[vertIx]) & _mask;
+			while (_slots[ix] != EMPTY) {
+				ix = (ix + 1) & _mask;
+			}
+			_slots[ix] = vertIx;
+		}
+	}
+};
+
+// Skips spaces and tabs, but not newlines
+static inline const char* SkipSpaces(const char* p, const char* end) {
+	while (p < end && (*p == ' ' || *p == '\t')) {
+		p++;
+	}
+	return p;
+}
+
+// Skips to the start of the next line
+static inline const char* SkipLine(const char* p, const char* end) {
+	const char* newline = static_cast<const char*>(memchr(p, '\n', end - p));
+	return newline != nullptr ? newline + 1 : end;
+}
+
+// Parses a float after any leading whitespace, leaves the value at 0 if there isn't one
+static inline const char* ParseFloat(const char* p, const char* end, float& result) {
+	p = SkipSpaces(p, end);
+	// from_chars does not accept a leading plus sign
+	if (p < end && *p == '+') {
+		p++;
+	}
+	std::from_chars_result parsed = std::from_chars(p, end, result);
+	if (parsed.ec != std::errc()) {
+		result = 0.0f;
+		return p;
+	}
+	return parsed.ptr;
+}
+
+// Parses an integer with no leading whitespace, leaves the value at 0 if there isn't one
+static inline const char* ParseInt(const char* p, const char* end, int& result) {
+	result = 0;
+	std::from_chars_result parsed = std::from_chars(p, end, result);
+	return parsed.ec != std::errc() ? p : parsed.ptr;
+}
+
+// Converts an OBJ index (1-based, or negative to index from the end) to a 1-based index, with 0 being missing
+static inline int ResolveIndex(int index, size_t count) {
+	return index < 0 ? static_cast<int>(count) + 1 + index : index;
+}
+
+// Gets the cache validation info for a source file
+static bool GetSourceInfo(const std::string& filename, uint64_t& size, int64_t& time) {
+	std::error_code error;
+	size = std::filesystem::file_size(filename, error);
+	if (error) {
+		return false;
+	}
+	time = static_cast<int64_t>(std::filesystem::last_write_time(filename, error).time_since_epoch().count());
+	return !error;
+}
+
+VertexArrayObject::Sptr OptimizedObjLoader::LoadFromFile(const std::string& filename, bool calcTangents) {
+	MeshData data;
+	if (!LoadMeshData(filename, data, calcTangents)) {
+		return nullptr;
+	}
+	return Upload(data);
+}
+
+VertexArrayObject::Sptr OptimizedObjLoader::Upload(const MeshData& data) {
+	VertexBuffer::Sptr vbo = VertexBuffer::Create();
+	vbo->LoadData(data.VertexData, sizeof(VertexType), data.VertexCount);
+
+	IndexBuffer::Sptr ebo = nullptr;
+	if (data.IndexCount > 0) {
+		ebo = IndexBuffer::Create();
+		ebo->LoadData(data.IndexData, GetIndexTypeSize(data.IndexFormat), data.IndexCount, data.IndexFormat);
+	}
+
+	VertexArrayObject::Sptr result = VertexArrayObject::Create();
+	result->AddVertexBuffer(vbo, VertexType::V_DECL);
+	// OBJ files don't have vertex colors, so we feed white to the shader instead of storing it
+	result->SetConstantAttribute(1, glm::vec4(1.0f));
+	result->SetIndexBuffer(ebo);
+	result->SetVDecl(VertexType::V_DECL);
+	result->SetBounds(BoundingBox::FromVertices(data.VertexData, data.VertexCount, sizeof(VertexType), offsetof(VertexType, Position)));
+	return result;
+}
+
+std::vector<VertexArrayObject::Sptr> OptimizedObjLoader::UploadLods(const MeshData& data, const VertexArrayObject::Sptr& mesh) {
+	std::vector<VertexArrayObject::Sptr> result;
+	result.reserve(data.Lods.size());
+	for (const LodData& lod : data.Lods) {
+		IndexBuffer::Sptr ebo = IndexBuffer::Create();
+		ebo->LoadData(lod.IndexData, GetIndexTypeSize(data.IndexFormat), lod.IndexCount, data.IndexFormat);
+		result.push_back(mesh->CreateWithIndices(ebo));
+	}
+	return result;
+}
+
+bool OptimizedObjLoader::LoadMeshData(const std::string& filename, MeshData& result, bool calcTangents, const LodSettings& lods) {
+	// glfwGetTime is safe to call from any thread
+	float startTime = static_cast<float>(glfwGetTime());
+
+	if (_LoadFromCache(filename, calcTangents, lods, result)) {
+		LOG_TRACE("Loaded cached mesh for \"{}\" in {} seconds", filename, static_cast<float>(glfwGetTime()) - startTime);
+		return true;
+	}
+
+	MemoryMappedFile::Sptr file = MemoryMappedFile::Open(filename);
+	if (file == nullptr) {
+		return false;
+	}
+	const char* begin = reinterpret_cast<const char*>(file->GetData());
+	const char* end   = begin + file->GetSize();
+
+	// Do a quick pass over the file to count our attributes, so that we only need to allocate once
+	size_t numPositions = 0, numNormals = 0, numUvs = 0, numFaces = 0;
+	for (const char* p = begin; p < end; p = SkipLine(p, end)) {
+		p = SkipSpaces(p, end);
+		if (p + 1 >= end) break;
+		if (p[0] == 'v') {
+			if (p[1] == ' ' || p[1] == '\t') numPositions++;
+			else if (p[1] == 'n') numNormals++;
+			else if (p[1] == 't') numUvs++;
+		} else if (p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+			numFaces++;
+		}
+	}
+
+	std::vector<glm::vec3>  positions;
+	std::vector<glm::vec3>  normals;
+	std::vector<glm::vec2>  uvs;
+	std::vector<glm::ivec3> vertices;
+	std::vector<uint32_t>   indices;
+	positions.reserve(numPositions);
+	normals.reserve(numNormals);
+	uvs.reserve(numUvs);
+	// Assume mostly triangles, and that most vertices are shared by a couple of faces
+	vertices.reserve(numFaces * 2);
+	indices.reserve(numFaces * 3);
+
+	ObjVertexTable vertexTable(numFaces * 2);
+
+	// Stores the vertex indices for the current face, so we can triangulate polygons as a fan
+	std::vector<uint32_t> faceVerts;
+	faceVerts.reserve(8);
+
+	for (const char* p = begin; p < end; p = SkipLine(p, end)) {
+		p = SkipSpaces(p, end);
+		if (p + 1 >= end) break;
+
+		if (p[0] == 'v') {
+			glm::vec3 value(0.0f);
+			if (p[1] == ' ' || p[1] == '\t') {
+				p = ParseFloat(p + 1, end, value.x);
+				p = ParseFloat(p, end, value.y);
+				p = ParseFloat(p, end, value.z);
+				positions.push_back(value);
+			} else if (p[1] == 'n') {
+				p = ParseFloat(p + 2, end, value.x);
+				p = ParseFloat(p, end, value.y);
+				p = ParseFloat(p, end, value.z);
+				normals.push_back(value);
+			} else if (p[1] == 't') {
+				p = ParseFloat(p + 2, end, value.x);
+				p = ParseFloat(p, end, value.y);
+				uvs.push_back(glm::vec2(value));
+			}
+		}
+		else if (p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+			faceVerts.clear();
+			p++;
+			while (true) {
+				p = SkipSpaces(p, end);
+				if (p >= end || *p == '\r' || *p == '\n' || *p == '#') {
+					break;
+				}
+
+				// Faces can be any of v, v/t, v//n, or v/t/n
+				glm::ivec3 key(0);
+				const char* start = p;
+				p = ParseInt(p, end, key.x);
+				if (p < end && *p == '/') {
+					p = ParseInt(p + 1, end, key.y);
+					if (p < end && *p == '/') {
+						p = ParseInt(p + 1, end, key.z);
+					}
+				}
+				// Bail on anything we don't understand, rather than looping forever
+				if (p == start) {
+					break;
+				}
+
+				key.x = ResolveIndex(key.x, positions.size());
+				key.y = ResolveIndex(key.y, uvs.size());
+				key.z = ResolveIndex(key.z, normals.size());
+				if (key.x <= 0 || key.x > (int)positions.size()) {
+					continue;
+				}
+
+				faceVerts.push_back(vertexTable.FindOrAdd(key, vertices));
+			}
+
+			// Triangulate the face as a fan around the first vertex
+			for (size_t ix = 2; ix < faceVerts.size(); ix++) {
+				indices.push_back(faceVerts[0]);
+				indices.push_back(faceVerts[ix - 1]);
+				indices.push_back(faceVerts[ix]);
+			}
+		}
+	}
+
+	// Build our final vertices from the unique attribute combinations
+	const glm::vec4 color = glm::vec4(1.0f);
+	MeshBuilder<VertexPosNormTexColTangents> mesh;
+	mesh.ReserveVertexSpace(vertices.size());
+	for (const glm::ivec3& key : vertices) {
+		mesh.AddVertex(
+			positions[key.x - 1],
+			key.z > 0 && key.z <= (int)normals.size() ? normals[key.z - 1] : glm::vec3(0.0f, 0.0f, 1.0f),
+			key.y > 0 && key.y <= (int)uvs.size() ? uvs[key.y - 1] : glm::vec2(0.0f),
+			color
+		);
+	}
+	mesh.ReserveIndexSpace(indices.size());
+	for (uint32_t index : indices) {
+		mesh.AddIndex(index);
+	}
+
+	if (calcTangents) {
+		MeshFactory::CalculateTBN(mesh);
+	}
+	if (mesh.GetIndexCount() > 0) {
+		MeshFactory::Optimize(mesh);
+	}
+
+	// Pack the vertices down, then simplify from the optimized mesh so that the levels
+	// of detail share it's vertex order
+	std::shared_ptr<PackedMeshStorage> storage = std::make_shared<PackedMeshStorage>();
+	const VertexPosNormTexColTangents* sourceVertices = reinterpret_cast<const VertexPosNormTexColTangents*>(mesh.GetVertexDataPtr());
+	storage->Vertices.assign(sourceVertices, sourceVertices + mesh.GetVertexCount());
+	const uint32_t* sourceIndices = reinterpret_cast<const uint32_t*>(mesh.GetIndexDataPtr());
+	storage->Indices.assign(sourceIndices, sourceIndices + mesh.GetIndexCount());
+	if (lods.Count > 0 && storage->Indices.size() > 0) {
+		storage->LodIndices = MeshSimplifier::BuildLodChain(storage->Indices, storage->Vertices.data(), storage->Vertices.size(), sizeof(VertexType), lods.Count, lods.Reduction);
+	}
+
+	// Shrink the indices if we can
+	IndexType indexFormat = IndexType::UInt;
+	if (MeshOptimizer::CanUseShortIndices(storage->Vertices.size())) {
+		storage->ShortIndices = MeshOptimizer::ToShortIndices(storage->Indices);
+		std::vector<uint32_t>().swap(storage->Indices);
+		for (const std::vector<uint32_t>& lod : storage->LodIndices) {
+			storage->LodShortIndices.push_back(MeshOptimizer::ToShortIndices(lod));
+		}
+		std::vector<std::vector<uint32_t>>().swap(storage->LodIndices);
+		indexFormat = IndexType::UShort;
+	}
+
+	const void* indexPtr = indexFormat == IndexType::UShort ? (const void*)storage->ShortIndices.data() : (const void*)storage->Indices.data();
+	uint32_t indexSize = static_cast<uint32_t>(GetIndexTypeSize(indexFormat));
+	std::vector<LodData> lodData;
+	for (const std::vector<uint32_t>& lod : storage->LodIndices) {
+		lodData.push_back({ lod.data(), static_cast<uint32_t>(lod.size()) });
+	}
+	for (const std::vector<uint16_t>& lod : storage->LodShortIndices) {
+		lodData.push_back({ lod.data(), static_cast<uint32_t>(lod.size()) });
+	}
+
+	// Write out the cache so that we never have to parse this file again
+	uint64_t sourceSize;
+	int64_t sourceTime;
+	if (GetSourceInfo(filename, sourceSize, sourceTime)) {
+		MeshCacheHeader header;
+		header.SourceSize   = sourceSize;
+		header.SourceTime   = sourceTime;
+		header.VertexStride = sizeof(VertexType);
+		header.VertexCount  = static_cast<uint32_t>(storage->Vertices.size());
+		header.IndexCount   = static_cast<uint32_t>(mesh.GetIndexCount());
+		header.IndexSize    = indexSize;
+		header.HasTangents  = calcTangents ? 1 : 0;
+		header.LodCount     = lods.Count;
+		header.LodReduction = lods.Reduction;
+
+		BinaryWriter headerData;
+		headerData.Write(header);
+		BinaryWriter vertexData;
+		vertexData.WriteBytes(storage->Vertices.data(), storage->Vertices.size() * sizeof(VertexType));
+		BinaryWriter indexData;
+		indexData.WriteBytes(indexPtr, mesh.GetIndexCount() * indexSize);
+		// Each level is stored as it's index count followed by it's indices
+		BinaryWriter lodIndexData;
+		lodIndexData.Write(static_cast<uint32_t>(lodData.size()));
+		for (const LodData& lod : lodData) {
+			lodIndexData.Write(lod.IndexCount);
+			lodIndexData.WriteBytes(lod.IndexData, lod.IndexCount * indexSize);
+		}
+
+		ChunkedFileWriter cache;
+		cache.AddChunk(MESH_CACHE_HEADER, MESH_CACHE_VERSION, headerData.Release());
+		cache.AddChunk(MESH_CACHE_VERTICES, MESH_CACHE_VERSION, vertexData.Release());
+		cache.AddChunk(MESH_CACHE_INDICES, MESH_CACHE_VERSION, indexData.Release());
+		cache.AddChunk(MESH_CACHE_LODS, MESH_CACHE_VERSION, lodIndexData.Release());
+		if (!cache.Save(filename + CACHE_EXTENSION)) {
+			LOG_WARN("Failed to write mesh cache for \"{}\"", filename);
+		}
+	}
+
+	LOG_TRACE("Loaded OBJ file \"{}\" in {} seconds ({} vertices, {} indices, {} LODs)", filename, static_cast<float>(glfwGetTime()) - startTime, storage->Vertices.size(), mesh.GetIndexCount(), lodData.size());
+
+	result.VertexData  = storage->Vertices.data();
+	result.VertexCount = static_cast<uint32_t>(storage->Vertices.size());
+	result.IndexData   = indexPtr;
+	result.IndexCount  = static_cast<uint32_t>(mesh.GetIndexCount());
+	result.IndexFormat = indexFormat;
+	result.Lods        = std::move(lodData);
+	result.Storage     = storage;
+	return true;
+}
+
+bool OptimizedObjLoader::_LoadFromCache(const std::string& filename, bool calcTangents, const LodSettings& lods, MeshData& result) {
+	std::string cachePath = filename + CACHE_EXTENSION;
+	if (!std::filesystem::exists(cachePath)) {
+		return false;
+	}
+
+	uint64_t sourceSize;
+	int64_t sourceTime;
+	if (!GetSourceInfo(filename, sourceSize, sourceTime)) {
+		return false;
+	}
+
+	ChunkedFileReader::Sptr cache = ChunkedFileReader::Open(cachePath);
+	if (cache == nullptr) {
+		return false;
+	}
+
+	uint32_t headerVersion = 0, vertexVersion = 0, indexVersion = 0, lodVersion = 0;
+	BinaryReader headerData   = cache->GetChunk(MESH_CACHE_HEADER, &headerVersion);
+	BinaryReader vertexData   = cache->GetChunk(MESH_CACHE_VERTICES, &vertexVersion);
+	BinaryReader indexData    = cache->GetChunk(MESH_CACHE_INDICES, &indexVersion);
+	BinaryReader lodIndexData = cache->GetChunk(MESH_CACHE_LODS, &lodVersion);
+	if (headerVersion != MESH_CACHE_VERSION || vertexVersion != MESH_CACHE_VERSION || indexVersion != MESH_CACHE_VERSION || lodVersion != MESH_CACHE_VERSION) {
+		return false;
+	}
+
+	MeshCacheHeader header = headerData.Read<MeshCacheHeader>();
+	if (!headerData.IsValid() ||
+		header.SourceSize != sourceSize ||
+		header.SourceTime != sourceTime ||
+		header.VertexStride != sizeof(VertexType) ||
+		(header.IndexSize != sizeof(uint16_t) && header.IndexSize != sizeof(uint32_t)) ||
+		header.HasTangents != (calcTangents ? 1u : 0u) ||
+		header.LodCount != lods.Count ||
+		header.LodReduction != lods.Reduction ||
+		vertexData.GetSize() != (size_t)header.VertexCount * header.VertexStride ||
+		indexData.GetSize() != (size_t)header.IndexCount * header.IndexSize) {
+		return false;
+	}
+
+	// The levels of detail point straight into the mapped file as well
+	uint32_t lodCount = lodIndexData.Read<uint32_t>();
+	if (!lodIndexData.IsValid() || lodCount > lods.Count) {
+		return false;
+	}
+	std::vector<LodData> lodData(lodCount);
+	for (LodData& lod : lodData) {
+		lod.IndexCount = lodIndexData.Read<uint32_t>();
+		if (!lodIndexData.IsValid() || (size_t)lod.IndexCount * header.IndexSize > lodIndexData.GetRemaining()) {
+			return false;
+		}
+		lod.IndexData = lodIndexData.ReadBytes(lod.IndexCount * header.IndexSize);
+	}
+
+	// The data is already in it's final layout, so we can upload straight from the mapped file
+	result.VertexData  = vertexData.GetData();
+	result.VertexCount = header.VertexCount;
+	result.IndexData   = indexData.GetData();
+	result.IndexCount  = header.IndexCount;
+	result.IndexFormat = header.IndexSize == sizeof(uint16_t) ? IndexType::UShort : IndexType::UInt;
+	result.Lods        = std::move(lodData);
+	result.Storage     = cache;
+	return true;
+}
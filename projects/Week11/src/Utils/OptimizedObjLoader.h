@@ -0,0 +1,106 @@
+#pragma once
+#include <string>
+
+#include "Graphics/VertexArrayObject.h"
+#include "Graphics/VertexTypes.h"
+
+/// <summary>
+/// A much faster drop-in replacement for ObjLoader::LoadFromFile
+///
+/// The OBJ file is memory mapped and parsed in place with std::from_chars, without
+/// any per-line strings or streams, and vertices are de-duplicated with an open
+/// addressing hash table. The resulting vertex and index data is written to a
+/// sidecar cache file (filename + CACHE_EXTENSION) that can be uploaded directly,
+/// so repeat loads of the same file skip parsing entirely. The cache is rebuilt
+/// whenever the OBJ file's size or modification time changes
+///
+/// Meshes are run through MeshFactory::Optimize and stored as VertexPacked, with
+/// 16 bit indices when the mesh is small enough. Levels of detail can be generated
+/// with MeshSimplifier, these are stored in the cache alongside the mesh
+/// </summary>
+class OptimizedObjLoader
+{
+public:
+	// The extension appended to the OBJ path to get the path of it's cache file
+	inline static const std::string CACHE_EXTENSION = ".mcache";
+
+	/// <summary>
+	/// Loads a mesh from an OBJ file, or it's cache if it is up to date
+	/// </summary>
+	/// <param name="filename">The path to the OBJ file to load</param>
+	/// <param name="calcTangents">True to calculate tangents and bitangents for the mesh</param>
+	/// <returns>The mesh, or nullptr if the file could not be loaded</returns>
+	static VertexArrayObject::Sptr LoadFromFile(const std::string& filename, bool calcTangents = true);
+
+	typedef VertexPacked VertexType;
+
+	/// <summary>
+	/// Controls how many levels of detail are generated for a mesh, and how much each is simplified
+	/// </summary>
+	struct LodSettings {
+		// The largest number of levels to generate, not including the full detail mesh
+		uint32_t Count;
+		// The fraction of triangles each level keeps from the level before it
+		float    Reduction;
+
+		LodSettings(uint32_t count = 0, float reduction = 0.5f) : Count(count), Reduction(reduction) {}
+	};
+
+	/// <summary>
+	/// The indices for one level of detail, these use the same vertices as the full mesh
+	/// </summary>
+	struct LodData {
+		const void*     IndexData  = nullptr;
+		uint32_t        IndexCount = 0;
+	};
+
+	/// <summary>
+	/// The CPU side result of loading an OBJ file, ready to be uploaded to OpenGL
+	/// </summary>
+	struct MeshData {
+		const void*     VertexData  = nullptr;
+		uint32_t        VertexCount = 0;
+		const void*     IndexData   = nullptr;
+		uint32_t        IndexCount  = 0;
+		IndexType       IndexFormat = IndexType::UInt;
+		// The levels of detail, from most to least detailed. Uses IndexFormat as well
+		std::vector<LodData> Lods;
+		// Keeps the memory behind VertexData and IndexData alive, this is either
+		// the mapped cache file or the mesh that was parsed
+		std::shared_ptr<const void> Storage;
+	};
+
+	/// <summary>
+	/// Loads the vertex and index data for an OBJ file (or it's cache) without touching
+	/// OpenGL, so this can be called from any thread. Use Upload on the thread owning
+	/// the GL context to turn the result into a mesh
+	/// </summary>
+	/// <param name="filename">The path to the OBJ file to load</param>
+	/// <param name="result">The mesh data to populate</param>
+	/// <param name="calcTangents">True to calculate tangents and bitangents for the mesh</param>
+	/// <param name="lods">The levels of detail to generate, the cache is rebuilt if these change</param>
+	/// <returns>True if the data was loaded, false if otherwise</returns>
+	static bool LoadMeshData(const std::string& filename, MeshData& result, bool calcTangents = true, const LodSettings& lods = LodSettings());
+	/// <summary>
+	/// Creates a VAO from mesh data returned by LoadMeshData
+	/// </summary>
+	static VertexArrayObject::Sptr Upload(const MeshData& data);
+	/// <summary>
+	/// Creates the VAOs for the levels of detail in the mesh data, these share the vertex
+	/// buffers of the mesh returned by Upload
+	/// </summary>
+	/// <param name="data">The mesh data returned by LoadMeshData</param>
+	/// <param name="mesh">The full detail mesh returned by Upload</param>
+	/// <returns>A VAO for each level of detail, from most to least detailed</returns>
+	static std::vector<VertexArrayObject::Sptr> UploadLods(const MeshData& data, const VertexArrayObject::Sptr& mesh);
+
+protected:
+	OptimizedObjLoader() = default;
+	~OptimizedObjLoader() = default;
+
+	/// <summary>
+	/// Attempts to load the mesh data from the cache for the given OBJ file
+	/// </summary>
+	/// <returns>True if the cache was loaded, false if it is missing or stale</returns>
+	static bool _LoadFromCache(const std::string& filename, bool calcTangents, const LodSettings& lods, MeshData& result);
+};
@@ -0,0 +1,131 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+/// <summary>
+/// A set of pointers using open addressing with linear probing over a flat power of two
+/// sized table. Items are also kept in a dense list, so iterating is as cheap as iterating
+/// a vector, and clearing keeps all the memory around for the next time the set is filled.
+/// This is for sets that are rebuilt often (ex: every physics step), where the node
+/// allocations of std::unordered_set would dominate
+///
+/// Removal is O(n), since it rebuilds the table
+/// </summary>
+template <typename T>
+class PointerHashSet {
+public:
+	PointerHashSet() : _items(), _slots(), _mask(0) { }
+
+	/// <summary>
+	/// Adds an item to the set
+	/// </summary>
+	/// <returns>True if the item was added, false if it was already in the set</returns>
+	bool Insert(T* item) {
+		// Keep the load factor under 50% so probe sequences stay short
+		if ((_items.size() + 1) * 2 > _slots.size()) {
+			_Rehash(std::max(_slots.size() * 2, (size_t)16));
+		}
+		size_t ix = _Hash(item) & _mask;
+		while (true) {
+			uint32_t slot = _slots[ix];
+			if (slot == EMPTY) {
+				_slots[ix] = static_cast<uint32_t>(_items.size());
+				_items.push_back(item);
+				return true;
+			}
+			if (_items[slot] == item) {
+				return false;
+			}
+			ix = (ix + 1) & _mask;
+		}
+	}
+
+	/// <summary>
+	/// Returns true if the item is in the set
+	/// </summary>
+	bool Contains(T* item) const {
+		if (_items.empty()) {
+			return false;
+		}
+		size_t ix = _Hash(item) & _mask;
+		while (true) {
+			uint32_t slot = _slots[ix];
+			if (slot == EMPTY) {
+				return false;
+			}
+			if (_items[slot] == item) {
+				return true;
+			}
+			ix = (ix + 1) & _mask;
+		}
+	}
+
+	/// <summary>
+	/// Removes an item from the set, note that this may change the order of the remaining items
+	/// </summary>
+	/// <returns>True if the item was removed, false if it was not in the set</returns>
+	bool Remove(T* item) {
+		auto it = std::find(_items.begin(), _items.end(), item);
+		if (it == _items.end()) {
+			return false;
+		}
+		*it = _items.back();
+		_items.pop_back();
+		_Rehash(_slots.size());
+		return true;
+	}
+
+	/// <summary>
+	/// Removes all items from the set, without releasing any memory
+	/// </summary>
+	void Clear() {
+		if (!_items.empty()) {
+			std::fill(_slots.begin(), _slots.end(), EMPTY);
+			_items.clear();
+		}
+	}
+
+	/// <summary>
+	/// Swaps the contents of this set with another, this is O(1)
+	/// </summary>
+	void Swap(PointerHashSet& other) {
+		_items.swap(other._items);
+		_slots.swap(other._slots);
+		std::swap(_mask, other._mask);
+	}
+
+	size_t Size() const { return _items.size(); }
+	bool IsEmpty() const { return _items.empty(); }
+
+	typename std::vector<T*>::const_iterator begin() const { return _items.begin(); }
+	typename std::vector<T*>::const_iterator end() const { return _items.end(); }
+
+protected:
+	inline static const uint32_t EMPTY = 0xFFFFFFFF;
+
+	// The items in the set, in the order they were added
+	std::vector<T*>       _items;
+	// Indices into _items, or EMPTY
+	std::vector<uint32_t> _slots;
+	size_t                _mask;
+
+	static size_t _Hash(T* item) {
+		// Pointers are aligned, so the low bits carry no information. A multiply mixes the
+		// higher bits down into the ones we use to pick a slot
+		uint64_t value = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(item)) * 0x9E3779B97F4A7C15ull;
+		return static_cast<size_t>(value ^ (value >> 32));
+	}
+
+	void _Rehash(size_t capacity) {
+		_slots.assign(capacity, EMPTY);
+		_mask = capacity - 1;
+		for (uint32_t ix = 0; ix < _items.size(); ix++) {
+			size_t slot = _Hash(_items[ix]) & _mask;
+			while (_slots[slot] != EMPTY) {
+				slot = (slot + 1) & _mask;
+			}
+			_slots[slot] = ix;
+		}
+	}
+};
@@ -0,0 +1,436 @@
+#include "Utils/Profiler.h"
+
+#include <chrono>
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <algorithm>
+#include <json.hpp>
+#include <Logging.h>
+
+#include "Utils/ImGuiHelper.h"
+
+bool                            Profiler::_isInitialized = false;
+bool                            Profiler::_isPaused = false;
+uint64_t                        Profiler::_frameIndex = 0;
+Profiler::FrameData             Profiler::_currentFrame;
+std::mutex                      Profiler::_eventMutex;
+std::deque<Profiler::FrameData> Profiler::_history;
+Profiler::GpuFrame              Profiler::_gpuFrames[Profiler::GPU_FRAME_LATENCY];
+std::vector<uint32_t>           Profiler::_gpuScopeStack;
+int                             Profiler::_selectedFrame = -1;
+
+// A CPU scope that has been started but not yet ended
+struct OpenCpuScope {
+	const char* Name;
+	double      Start;
+};
+// Each thread keeps it's own stack of open scopes, so no locking is needed until a scope ends
+static thread_local std::vector<OpenCpuScope> t_openScopes;
+static thread_local uint32_t t_threadIndex = (uint32_t)-1;
+static std::atomic<uint32_t> s_nextThreadIndex{ 0 };
+
+void Profiler::Init() {
+	// Make sure the main thread is always thread 0
+	_GetThreadIndex();
+	_Now();
+	_isInitialized = true;
+}
+
+void Profiler::Cleanup() {
+	for (GpuFrame& frame : _gpuFrames) {
+		if (!frame.Queries.empty()) {
+			glDeleteQueries(static_cast<GLsizei>(frame.Queries.size()), frame.Queries.data());
+		}
+		frame = GpuFrame();
+	}
+	_history.clear();
+	_isInitialized = false;
+}
+
+void Profiler::BeginFrame() {
+	if (!_isInitialized) return;
+
+	{
+		std::lock_guard<std::mutex> lock(_eventMutex);
+		_currentFrame.FrameIndex = _frameIndex;
+		_currentFrame.Start      = _Now();
+	}
+
+	// Re-use the oldest set of GPU queries, reading it back first if the GPU has finished with it
+	GpuFrame& gpuFrame = _gpuFrames[_frameIndex % GPU_FRAME_LATENCY];
+	if (gpuFrame.IsPending) {
+		_ResolveGpuFrame(gpuFrame);
+	}
+	gpuFrame.FrameIndex  = _frameIndex;
+	gpuFrame.IsPending   = true;
+	gpuFrame.QueriesUsed = 0;
+	gpuFrame.Scopes.clear();
+	_gpuScopeStack.clear();
+
+	// The outermost GPU scope gives us the GPU time for the whole frame
+	BeginGpuScope("Frame");
+}
+
+void Profiler::EndFrame() {
+	if (!_isInitialized) return;
+
+	// Close anything left open, including the frame scope
+	while (!_gpuScopeStack.empty()) {
+		EndGpuScope();
+	}
+
+	std::lock_guard<std::mutex> lock(_eventMutex);
+	_currentFrame.CpuTime = _Now() - _currentFrame.Start;
+	if (!_isPaused) {
+		_history.push_back(std::move(_currentFrame));
+		while (_history.size() > MAX_HISTORY) {
+			_history.pop_front();
+			// Keep the selection pointing at the same frame
+			if (_selectedFrame > 0) {
+				_selectedFrame--;
+			}
+		}
+	}
+	_currentFrame = FrameData();
+	_frameIndex++;
+}
+
+void Profiler::BeginCpuScope(const char* name) {
+	if (!_isInitialized) return;
+	t_openScopes.push_back({ name, _Now() });
+}
+
+void Profiler::EndCpuScope() {
+	if (t_openScopes.empty()) return;
+
+	OpenCpuScope scope = t_openScopes.back();
+	t_openScopes.pop_back();
+
+	Event event;
+	event.Name        = scope.Name;
+	event.Depth       = static_cast<uint32_t>(t_openScopes.size());
+	event.ThreadIndex = _GetThreadIndex();
+	event.Start       = scope.Start;
+	event.Duration    = _Now() - scope.Start;
+
+	std::lock_guard<std::mutex> lock(_eventMutex);
+	_currentFrame.CpuEvents.push_back(event);
+}
+
+void Profiler::BeginGpuScope(const char* name) {
+	if (!_isInitialized) return;
+	LOG_ASSERT(_GetThreadIndex() == 0, "GPU scopes can only be used on the main thread");
+
+	GpuFrame& frame = _gpuFrames[_frameIndex % GPU_FRAME_LATENCY];
+	GpuScope scope;
+	scope.Name       = name;
+	scope.Depth      = static_cast<uint32_t>(_gpuScopeStack.size());
+	scope.BeginQuery = _IssueTimestamp(frame);
+	scope.EndQuery   = scope.BeginQuery;
+	_gpuScopeStack.push_back(static_cast<uint32_t>(frame.Scopes.size()));
+	frame.Scopes.push_back(scope);
+}
+
+void Profiler::EndGpuScope() {
+	if (_gpuScopeStack.empty()) return;
+
+	GpuFrame& frame = _gpuFrames[_frameIndex % GPU_FRAME_LATENCY];
+	frame.Scopes[_gpuScopeStack.back()].EndQuery = _IssueTimestamp(frame);
+	_gpuScopeStack.pop_back();
+}
+
+double Profiler::_Now() {
+	static const std::chrono::high_resolution_clock::time_point epoch = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - epoch).count();
+}
+
+uint32_t Profiler::_GetThreadIndex() {
+	if (t_threadIndex == (uint32_t)-1) {
+		t_threadIndex = s_nextThreadIndex++;
+	}
+	return t_threadIndex;
+}
+
+uint32_t Profiler::_IssueTimestamp(GpuFrame& frame) {
+	// Grow the query pool as needed, after the first few frames this never allocates
+	if (frame.QueriesUsed == frame.Queries.size()) {
+		GLuint query = 0;
+		glCreateQueries(GL_TIMESTAMP, 1, &query);
+		frame.Queries.push_back(query);
+	}
+	uint32_t index = frame.QueriesUsed++;
+	// We use timestamps rather than GL_TIME_ELAPSED, since elapsed queries can't be nested
+	glQueryCounter(frame.Queries[index], GL_TIMESTAMP);
+	return index;
+}
+
+void Profiler::_ResolveGpuFrame(GpuFrame& frame) {
+	frame.IsPending = false;
+	if (frame.Scopes.empty() || frame.QueriesUsed == 0) {
+		return;
+	}
+
+	// Timestamps complete in order, so if the last one is ready they all are. If the GPU
+	// is somehow more than GPU_FRAME_LATENCY frames behind, we drop the results instead of stalling
+	GLint available = 0;
+	glGetQueryObjectiv(frame.Queries[frame.QueriesUsed - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available) {
+		return;
+	}
+
+	// Find the frame the queries belong to, it may have been dropped from the history or skipped while paused
+	FrameData* target = nullptr;
+	for (auto it = _history.rbegin(); it != _history.rend(); it++) {
+		if (it->FrameIndex == frame.FrameIndex) {
+			target = &(*it);
+			break;
+		}
+	}
+	if (target == nullptr) {
+		return;
+	}
+
+	std::vector<GLuint64> timestamps(frame.QueriesUsed);
+	for (uint32_t ix = 0; ix < frame.QueriesUsed; ix++) {
+		glGetQueryObjectui64v(frame.Queries[ix], GL_QUERY_RESULT, &timestamps[ix]);
+	}
+
+	// GPU timestamps use their own clock, so we line the start of the GPU frame up with the start of the CPU frame
+	const GLuint64 base = timestamps[frame.Scopes[0].BeginQuery];
+	target->GpuEvents.clear();
+	target->GpuEvents.reserve(frame.Scopes.size());
+	for (const GpuScope& scope : frame.Scopes) {
+		Event event;
+		event.Name        = scope.Name;
+		event.Depth       = scope.Depth;
+		event.ThreadIndex = GPU_THREAD_INDEX;
+		event.Start       = target->Start + (timestamps[scope.BeginQuery] - base) / 1000000.0;
+		event.Duration    = (timestamps[scope.EndQuery] - timestamps[scope.BeginQuery]) / 1000000.0;
+		target->GpuEvents.push_back(event);
+	}
+	target->GpuTime = target->GpuEvents[0].Duration;
+}
+
+// Gets a display name for a thread index
+static std::string GetThreadName(uint32_t threadIndex) {
+	if (threadIndex == 0) return "Main";
+	if (threadIndex == Profiler::GPU_THREAD_INDEX) return "GPU";
+	return "Worker " + std::to_string(threadIndex);
+}
+
+void Profiler::DrawImGui() {
+	if (!ImGui::Begin("Profiler")) {
+		ImGui::End();
+		return;
+	}
+
+	bool paused = _isPaused;
+	if (ImGui::Checkbox("Pause", &paused)) {
+		SetPaused(paused);
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("Export CSV")) {
+		ExportCsv("profile.csv");
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("Export Chrome Trace")) {
+		ExportChromeTrace("profile.json");
+	}
+
+	if (_history.empty()) {
+		ImGui::End();
+		return;
+	}
+
+	// Summarize the whole history
+	std::vector<float> frameTimes;
+	frameTimes.reserve(_history.size());
+	double cpuTotal = 0.0, cpuMax = 0.0, gpuTotal = 0.0;
+	int gpuCount = 0;
+	for (const FrameData& frame : _history) {
+		frameTimes.push_back(static_cast<float>(frame.CpuTime));
+		cpuTotal += frame.CpuTime;
+		cpuMax = std::max(cpuMax, frame.CpuTime);
+		if (frame.GpuTime >= 0.0) {
+			gpuTotal += frame.GpuTime;
+			gpuCount++;
+		}
+	}
+	ImGui::Text("CPU: %.2f ms avg, %.2f ms max    GPU: %.2f ms avg", cpuTotal / _history.size(), cpuMax, gpuCount > 0 ? gpuTotal / gpuCount : 0.0);
+
+	// Frame time graph, clicking a frame selects it and pauses so it can be inspected
+	ImGui::PlotHistogram("##FrameTimes", frameTimes.data(), static_cast<int>(frameTimes.size()), 0, nullptr, 0.0f, std::max(33.3f, static_cast<float>(cpuMax)), ImVec2(-1.0f, 80.0f));
+	if (ImGui::IsItemClicked()) {
+		ImVec2 min = ImGui::GetItemRectMin();
+		ImVec2 max = ImGui::GetItemRectMax();
+		float t = (ImGui::GetIO().MousePos.x - min.x) / std::max(1.0f, max.x - min.x);
+		_selectedFrame = std::clamp(static_cast<int>(t * frameTimes.size()), 0, static_cast<int>(frameTimes.size()) - 1);
+		SetPaused(true);
+	}
+
+	if (_selectedFrame >= static_cast<int>(_history.size())) {
+		_selectedFrame = -1;
+	}
+	const FrameData& frame = _selectedFrame < 0 ? _history.back() : _history[_selectedFrame];
+	ImGui::Text("Frame %llu: CPU %.3f ms, GPU %.3f ms", (unsigned long long)frame.FrameIndex, frame.CpuTime, frame.GpuTime);
+	if (_selectedFrame >= 0) {
+		ImGui::SameLine();
+		if (ImGui::Button("Latest")) {
+			_selectedFrame = -1;
+			SetPaused(false);
+		}
+	}
+
+	ImGui::Separator();
+	_DrawTimeline(frame);
+	ImGui::Separator();
+
+	// Per-scope totals for the frame
+	struct ScopeTotals {
+		uint32_t Calls = 0;
+		double   Cpu   = 0.0;
+		double   Gpu   = 0.0;
+	};
+	std::map<std::string, ScopeTotals> totals;
+	for (const Event& event : frame.CpuEvents) {
+		ScopeTotals& total = totals[event.Name];
+		total.Calls++;
+		total.Cpu += event.Duration;
+	}
+	for (const Event& event : frame.GpuEvents) {
+		totals[event.Name].Gpu += event.Duration;
+	}
+
+	ImGui::Columns(4, "##ProfilerScopes");
+	ImGui::Text("Scope");     ImGui::NextColumn();
+	ImGui::Text("Calls");     ImGui::NextColumn();
+	ImGui::Text("CPU (ms)");  ImGui::NextColumn();
+	ImGui::Text("GPU (ms)");  ImGui::NextColumn();
+	ImGui::Separator();
+	for (auto& [name, total] : totals) {
+		ImGui::TextUnformatted(name.c_str()); ImGui::NextColumn();
+		ImGui::Text("%u", total.Calls);      ImGui::NextColumn();
+		ImGui::Text("%.3f", total.Cpu);      ImGui::NextColumn();
+		ImGui::Text("%.3f", total.Gpu);      ImGui::NextColumn();
+	}
+	ImGui::Columns(1);
+
+	ImGui::End();
+}
+
+void Profiler::_DrawTimeline(const FrameData& frame) {
+	// Work out which rows we need, each thread gets one row per depth level, with the GPU last
+	std::map<uint32_t, uint32_t> threadDepths;
+	double frameEnd = frame.Start + frame.CpuTime;
+	for (const Event& event : frame.CpuEvents) {
+		threadDepths[event.ThreadIndex] = std::max(threadDepths[event.ThreadIndex], event.Depth + 1);
+	}
+	for (const Event& event : frame.GpuEvents) {
+		threadDepths[event.ThreadIndex] = std::max(threadDepths[event.ThreadIndex], event.Depth + 1);
+		frameEnd = std::max(frameEnd, event.Start + event.Duration);
+	}
+	std::map<uint32_t, uint32_t> threadRows;
+	uint32_t rowCount = 0;
+	for (auto& [thread, depth] : threadDepths) {
+		threadRows[thread] = rowCount;
+		rowCount += depth;
+	}
+
+	const float labelWidth = 70.0f;
+	const float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+	const ImVec2 origin = ImGui::GetCursorScreenPos();
+	const float width = std::max(1.0f, ImGui::GetContentRegionAvail().x - labelWidth);
+	const double frameLength = std::max(frameEnd - frame.Start, 0.001);
+	ImDrawList* drawList = ImGui::GetWindowDrawList();
+
+	for (auto& [thread, row] : threadRows) {
+		drawList->AddText(ImVec2(origin.x, origin.y + row * rowHeight), ImGui::GetColorU32(ImGuiCol_Text), GetThreadName(thread).c_str());
+	}
+
+	auto drawEvent = [&](const Event& event) {
+		float row = static_cast<float>(threadRows[event.ThreadIndex] + event.Depth);
+		ImVec2 min = ImVec2(origin.x + labelWidth + static_cast<float>((event.Start - frame.Start) / frameLength) * width, origin.y + row * rowHeight);
+		ImVec2 max = ImVec2(std::max(min.x + 1.0f, origin.x + labelWidth + static_cast<float>((event.Start + event.Duration - frame.Start) / frameLength) * width), min.y + rowHeight - 1.0f);
+
+		// Color by name, so the same scope is always the same color
+		float hue = (std::hash<std::string>()(event.Name) % 360) / 360.0f;
+		drawList->AddRectFilled(min, max, ImColor::HSV(hue, 0.5f, 0.7f));
+		ImVec4 clip = ImVec4(min.x, min.y, max.x, max.y);
+		drawList->AddText(ImGui::GetFont(), ImGui::GetFontSize(), ImVec2(min.x + 2.0f, min.y), IM_COL32_WHITE, event.Name, nullptr, 0.0f, &clip);
+
+		if (ImGui::IsMouseHoveringRect(min, max)) {
+			ImGui::SetTooltip("%s\n%.3f ms", event.Name, event.Duration);
+		}
+	};
+	for (const Event& event : frame.CpuEvents) {
+		drawEvent(event);
+	}
+	for (const Event& event : frame.GpuEvents) {
+		drawEvent(event);
+	}
+
+	ImGui::Dummy(ImVec2(labelWidth + width, rowCount * rowHeight));
+}
+
+bool Profiler::ExportCsv(const std::string& path) {
+	std::ofstream file(path, std::ios::out | std::ios::trunc);
+	if (!file) {
+		LOG_ERROR("Could not open \"{}\" to export profiling data", path);
+		return false;
+	}
+
+	file << "frame,thread,name,depth,start_ms,duration_ms\n";
+	for (const FrameData& frame : _history) {
+		for (const std::vector<Event>* events : { &frame.CpuEvents, &frame.GpuEvents }) {
+			for (const Event& event : *events) {
+				file << frame.FrameIndex << "," << GetThreadName(event.ThreadIndex) << "," << event.Name << ","
+					<< event.Depth << "," << event.Start << "," << event.Duration << "\n";
+			}
+		}
+	}
+	LOG_INFO("Exported {} frames of profiling data to \"{}\"", _history.size(), path);
+	return true;
+}
+
+bool Profiler::ExportChromeTrace(const std::string& path) {
+	nlohmann::json events = nlohmann::json::array();
+
+	std::map<uint32_t, bool> threads;
+	for (const FrameData& frame : _history) {
+		for (const std::vector<Event>* events_ : { &frame.CpuEvents, &frame.GpuEvents }) {
+			for (const Event& event : *events_) {
+				threads[event.ThreadIndex] = true;
+				// Chrome traces use microseconds
+				events.push_back({
+					{ "name", event.Name },
+					{ "ph",   "X" },
+					{ "ts",   event.Start * 1000.0 },
+					{ "dur",  event.Duration * 1000.0 },
+					{ "pid",  0 },
+					{ "tid",  event.ThreadIndex },
+					{ "args", { { "frame", frame.FrameIndex } } }
+				});
+			}
+		}
+	}
+	// Metadata events so the rows get readable names
+	for (auto& [thread, _] : threads) {
+		events.push_back({
+			{ "name", "thread_name" },
+			{ "ph",   "M" },
+			{ "pid",  0 },
+			{ "tid",  thread },
+			{ "args", { { "name", GetThreadName(thread) } } }
+		});
+	}
+
+	std::ofstream file(path, std::ios::out | std::ios::trunc);
+	if (!file) {
+		LOG_ERROR("Could not open \"{}\" to export profiling data", path);
+		return false;
+	}
+	file << nlohmann::json({ { "traceEvents", events } }).dump();
+	LOG_INFO("Exported {} frames of profiling data to \"{}\"", _history.size(), path);
+	return true;
+}
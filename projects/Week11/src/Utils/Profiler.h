@@ -0,0 +1,182 @@
+#pragma once
+#include <glad/glad.h>
+#include <vector>
+#include <deque>
+#include <string>
+#include <mutex>
+#include <cstdint>
+
+/// <summary>
+/// A lightweight frame profiler. CPU time is measured with RAII scopes (see PROFILE_SCOPE),
+/// which can be used from any thread. GPU time is measured with pairs of GL timestamp
+/// queries (see PROFILE_GPU_SCOPE), kept in a ring of GPU_FRAME_LATENCY frames so that we
+/// only ever read back queries the GPU has already finished, and never stall on them
+///
+/// Events are collected per frame between BeginFrame and EndFrame, and the last
+/// MAX_HISTORY frames are kept around for the ImGui window and for exporting
+///
+/// NOTE: Scope names are stored by pointer, so they must be string literals (or otherwise
+/// outlive the profiler's history)
+/// </summary>
+class Profiler {
+public:
+	Profiler() = delete;
+
+	// The number of frames we keep around for display and export
+	inline static const size_t MAX_HISTORY = 300;
+	// The number of frames we wait before reading back GPU queries
+	inline static const size_t GPU_FRAME_LATENCY = 4;
+	// The thread index used for GPU events when exporting
+	inline static const uint32_t GPU_THREAD_INDEX = 1000;
+
+	/// <summary>
+	/// A single timed scope, all times are in milliseconds since the profiler was initialized
+	/// </summary>
+	struct Event {
+		const char* Name;
+		uint32_t    Depth;
+		uint32_t    ThreadIndex;
+		double      Start;
+		double      Duration;
+	};
+
+	/// <summary>
+	/// All the events recorded during a single frame
+	/// </summary>
+	struct FrameData {
+		uint64_t           FrameIndex = 0;
+		double             Start      = 0.0;
+		double             CpuTime    = 0.0;
+		// The GPU time for the frame, or negative if the queries were not available
+		double             GpuTime    = -1.0;
+		std::vector<Event> CpuEvents;
+		// GPU events are stored relative to the start of the CPU frame
+		std::vector<Event> GpuEvents;
+	};
+
+	/// <summary>
+	/// Sets up the profiler, must be called on the main thread after OpenGL has been loaded
+	/// </summary>
+	static void Init();
+	/// <summary>
+	/// Releases all GL queries held by the profiler
+	/// </summary>
+	static void Cleanup();
+
+	/// <summary>
+	/// Starts a new frame, should be called at the very start of the main loop
+	/// </summary>
+	static void BeginFrame();
+	/// <summary>
+	/// Finishes the current frame and moves it into the history
+	/// </summary>
+	static void EndFrame();
+
+	static void BeginCpuScope(const char* name);
+	static void EndCpuScope();
+	/// <summary>
+	/// Starts a GPU timing scope, only valid on the main thread!
+	/// </summary>
+	static void BeginGpuScope(const char* name);
+	static void EndGpuScope();
+
+	/// <summary>
+	/// Pausing stops new frames being added to the history, so a spike can be inspected
+	/// </summary>
+	static void SetPaused(bool value) { _isPaused = value; }
+	static bool IsPaused() { return _isPaused; }
+
+	/// <summary>
+	/// Gets the frames currently stored in the history, oldest first
+	/// </summary>
+	static const std::deque<FrameData>& GetHistory() { return _history; }
+
+	/// <summary>
+	/// Draws the profiler window, with a frame time graph, a timeline for the selected
+	/// frame and a summary of the time spent in each scope
+	/// </summary>
+	static void DrawImGui();
+
+	/// <summary>
+	/// Writes all events in the history to a CSV file, one row per event
+	/// </summary>
+	/// <returns>True if the file was written</returns>
+	static bool ExportCsv(const std::string& path);
+	/// <summary>
+	/// Writes all events in the history to a Chrome trace file, which can be opened
+	/// in chrome://tracing or https://ui.perfetto.dev
+	/// </summary>
+	/// <returns>True if the file was written</returns>
+	static bool ExportChromeTrace(const std::string& path);
+
+protected:
+	// A pair of timestamp queries surrounding a GPU scope
+	struct GpuScope {
+		const char* Name;
+		uint32_t    Depth;
+		uint32_t    BeginQuery;
+		uint32_t    EndQuery;
+	};
+	// All of the queries issued during a frame
+	struct GpuFrame {
+		uint64_t              FrameIndex = 0;
+		bool                  IsPending  = false;
+		std::vector<GLuint>   Queries;
+		uint32_t              QueriesUsed = 0;
+		std::vector<GpuScope> Scopes;
+	};
+
+	static bool                  _isInitialized;
+	static bool                  _isPaused;
+	static uint64_t              _frameIndex;
+	static FrameData             _currentFrame;
+	// Guards _currentFrame.CpuEvents, since CPU scopes may end on any thread
+	static std::mutex            _eventMutex;
+	static std::deque<FrameData> _history;
+
+	static GpuFrame              _gpuFrames[GPU_FRAME_LATENCY];
+	static std::vector<uint32_t> _gpuScopeStack;
+	// The frame selected in the ImGui window, or -1 to follow the latest frame
+	static int                   _selectedFrame;
+
+	static double _Now();
+	static uint32_t _GetThreadIndex();
+	static uint32_t _IssueTimestamp(GpuFrame& frame);
+	/// <summary>
+	/// Reads back the queries for a GPU frame if they are available, and attaches the
+	/// results to the matching frame in the history
+	/// </summary>
+	static void _ResolveGpuFrame(GpuFrame& frame);
+	static void _DrawTimeline(const FrameData& frame);
+};
+
+/// <summary>
+/// Times the CPU cost of the enclosing scope
+/// </summary>
+struct ProfileScope {
+	ProfileScope(const char* name) { Profiler::BeginCpuScope(name); }
+	~ProfileScope() { Profiler::EndCpuScope(); }
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+/// <summary>
+/// Times both the CPU and GPU cost of the enclosing scope, main thread only
+/// </summary>
+struct GpuProfileScope {
+	GpuProfileScope(const char* name) { Profiler::BeginCpuScope(name); Profiler::BeginGpuScope(name); }
+	~GpuProfileScope() { Profiler::EndGpuScope(); Profiler::EndCpuScope(); }
+	GpuProfileScope(const GpuProfileScope&) = delete;
+	GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+};
+
+// Define DISABLE_PROFILING to compile out all profiling scopes
+#ifndef DISABLE_PROFILING
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(__profileScope, __LINE__)(name)
+#define PROFILE_GPU_SCOPE(name) GpuProfileScope PROFILE_CONCAT(__gpuProfileScope, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_GPU_SCOPE(name)
+#endif
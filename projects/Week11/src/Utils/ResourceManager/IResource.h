@@ -1,9 +1,20 @@
 #pragma once
 #include "Utils/GUID.hpp"
 #include "json.hpp"
+#include <EnumToString.h>
 
 #include "Utils/TypeHelpers.h"
 
+/// <summary>
+/// The loading state of a resource. Resources loaded from a manifest may be created in
+/// the pending state, and finish loading in the background (see ResourceManager)
+/// </summary>
+ENUM(ResourceLoadState, int,
+	 Ready   = 0, // The resource is fully loaded and can be used
+	 Pending = 1, // The resource is still being loaded, and should be skipped or replaced with a placeholder
+	 Failed  = 2  // The resource could not be loaded
+);
+
 /// <summary>
 /// Base class for graphics that the resource manager may want to manage
 /// (ex: textures, models, shaders, materials, etc...)
@@ -32,6 +43,15 @@ public:
 
 	virtual void ResolveReferences() {};
 
+	/// <summary>
+	/// Gets the current loading state of this resource
+	/// </summary>
+	ResourceLoadState GetLoadState() const { return _loadState; }
+	/// <summary>
+	/// Returns true if this resource has finished loading and can be used
+	/// </summary>
+	bool IsReady() const { return _loadState == ResourceLoadState::Ready; }
+
 	/// <summary>
 	/// Converts this resource into it's JSON manifest format
 	/// Should contain all the data required to reconstruct the
@@ -41,8 +61,35 @@ public:
 	virtual nlohmann::json ToJson() const = 0;
 
 protected:
+	friend class ResourceManager;
+
 	Guid _guid;
-	IResource() : _guid(Guid::New()){}
+	// Only modified on the main thread, workers never touch this
+	ResourceLoadState _loadState;
+
+	IResource() : _guid(Guid::New()), _loadState(ResourceLoadState::Ready) {}
+
+	/// <summary>
+	/// Performs the CPU side of a deferred load (file I/O, decoding, parsing), for
+	/// resources that were created in the pending state. This is called on a worker
+	/// thread, so it must not make any GL calls or touch other resources
+	/// </summary>
+	/// <returns>True if the data was loaded, false if the load failed</returns>
+	virtual bool _LoadDeferred() { return true; }
+	/// <summary>
+	/// Finishes a deferred load on the main thread once _LoadDeferred has succeeded,
+	/// this is where data is uploaded to OpenGL. Any CPU side data that is no longer
+	/// needed should be released here
+	/// </summary>
+	virtual void _FinishDeferredLoad() {}
+	/// <summary>
+	/// Checks on resources that keep loading after _FinishDeferredLoad returns (ex: shaders that
+	/// the driver compiles in the background). The resource is marked as ready once this returns
+	/// true. Called on the main thread
+	/// </summary>
+	/// <param name="wait">True to block until the load has finished</param>
+	/// <returns>True if the resource has finished loading</returns>
+	virtual bool _PollDeferredLoad(bool wait) { return true; }
 };
 
 /// <summary>
@@ -3,10 +3,22 @@
 #include "Utils/ObjLoader.h"
 #include "Utils/FileHelpers.h"
 #include "Utils/StringUtils.h"
+#include "Utils/ChunkedFile.h"
+#include "Utils/JobSystem.h"
+#include "Utils/Profiler.h"
+
+#include <chrono>
+#include <algorithm>
 
 std::map<std::type_index, std::map<Guid, IResource::Sptr>> ResourceManager::_resources;
 std::map<std::string, std::function<Guid(const nlohmann::json&)>> ResourceManager::_typeLoaders;
 
+std::map<IResource*, std::shared_ptr<ResourceManager::PendingLoad>> ResourceManager::_pendingLoads;
+std::deque<std::shared_ptr<ResourceManager::PendingLoad>> ResourceManager::_completedLoads;
+std::mutex ResourceManager::_completedMutex;
+std::condition_variable ResourceManager::_loadCompleted;
+std::vector<std::shared_ptr<ResourceManager::PendingLoad>> ResourceManager::_finishingLoads;
+
 nlohmann::ordered_json ResourceManager::_manifest;
 
 void ResourceManager::Init() {
@@ -21,21 +33,249 @@ const nlohmann::json& ResourceManager::GetManifest() {
 	return _manifest;
 }
 
-void ResourceManager::LoadManifest(const std::string& path) {
-	std::string contents = FileHelpers::ReadFile(path);
-	nlohmann::ordered_json blob = nlohmann::ordered_json::parse(contents);
+void ResourceManager::LoadManifest(const std::string& path, bool waitForLoads) {
+	if (ChunkedFile::IsChunkedFile(path)) {
+		_LoadManifestBinary(path);
+	} else {
+		std::string contents = FileHelpers::ReadFile(path);
+		nlohmann::ordered_json blob = nlohmann::ordered_json::parse(contents);
 
-	for (auto& [typeName, items] : blob.items()) {
-		auto& func = _typeLoaders[typeName];
-		if (func) {
+		for (auto& [typeName, items] : blob.items()) {
+			auto& func = _typeLoaders[typeName];
+			if (func) {
+				for (auto& [guid, blob] : items.items()) {
+					func(blob);
+				}
+			}
+		}
+	}
+
+	if (waitForLoads) {
+		FinishPendingLoads();
+	}
+}
+
+void ResourceManager::ProcessPendingLoads(float maxMilliseconds) {
+	PROFILE_SCOPE("ResourceManager::ProcessPendingLoads");
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// Checking on loads that are finishing in the background is cheap, so this is outside the budget
+	auto finished = std::remove_if(_finishingLoads.begin(), _finishingLoads.end(), [](const std::shared_ptr<PendingLoad>& load) {
+		return _CompleteLoad(load, false);
+	});
+	_finishingLoads.erase(finished, _finishingLoads.end());
+
+	while (true) {
+		std::shared_ptr<PendingLoad> load;
+		{
+			std::lock_guard<std::mutex> lock(_completedMutex);
+			if (_completedLoads.empty()) {
+				break;
+			}
+			load = _completedLoads.front();
+			_completedLoads.pop_front();
+		}
+
+		_FinishLoad(load);
+
+		std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+		if (elapsed.count() >= maxMilliseconds) {
+			break;
+		}
+	}
+}
+
+void ResourceManager::EnsureLoaded(const IResource::Sptr& resource) {
+	if (resource == nullptr) {
+		return;
+	}
+	auto it = _pendingLoads.find(resource.get());
+	if (it == _pendingLoads.end()) {
+		return;
+	}
+	std::shared_ptr<PendingLoad> load = it->second;
+
+	if (!load->IsFinishing) {
+		_WaitForLoadDeferred(load);
+		_FinishLoad(load);
+	}
+
+	// The resource is still finishing in the background. Since we have to wait for it anyways,
+	// we start the others of the same type so they can finish alongside it
+	if (std::find(_finishingLoads.begin(), _finishingLoads.end(), load) != _finishingLoads.end()) {
+		_StartLoadsOfType(*resource);
+		_finishingLoads.erase(std::find(_finishingLoads.begin(), _finishingLoads.end(), load));
+		_CompleteLoad(load, true);
+	}
+}
+
+void ResourceManager::FinishPendingLoads() {
+	while (!_pendingLoads.empty()) {
+		// Start everything before we wait on anything, so that resources that finish in
+		// the background all get to work at the same time
+		std::vector<std::shared_ptr<PendingLoad>> loads;
+		for (auto& [key, load] : _pendingLoads) {
+			if (!load->IsFinishing) {
+				loads.push_back(load);
+			}
+		}
+		for (const std::shared_ptr<PendingLoad>& load : loads) {
+			_WaitForLoadDeferred(load);
+			_FinishLoad(load);
+		}
+
+		for (const std::shared_ptr<PendingLoad>& load : _finishingLoads) {
+			_CompleteLoad(load, true);
+		}
+		_finishingLoads.clear();
+	}
+}
+
+size_t ResourceManager::GetPendingLoadCount() {
+	return _pendingLoads.size();
+}
+
+void ResourceManager::_QueueLoad(const IResource::Sptr& resource) {
+	std::shared_ptr<PendingLoad> load = std::make_shared<PendingLoad>();
+	load->Resource = resource;
+	_pendingLoads[resource.get()] = load;
+
+	JobSystem::Schedule([load]() {
+		// The main thread already loaded this one via EnsureLoaded
+		if (load->IsClaimed.exchange(true)) {
+			return;
+		}
+		PROFILE_SCOPE("ResourceManager::LoadDeferred");
+		load->Succeeded = load->Resource->_LoadDeferred();
+		{
+			std::lock_guard<std::mutex> lock(_completedMutex);
+			_completedLoads.push_back(load);
+		}
+		_loadCompleted.notify_all();
+	});
+}
+
+void ResourceManager::_WaitForLoadDeferred(const std::shared_ptr<PendingLoad>& load) {
+	// No worker has gotten to this resource yet, rather than waiting behind the rest
+	// of the queue we just load it ourselves
+	if (!load->IsClaimed.exchange(true)) {
+		load->Succeeded = load->Resource->_LoadDeferred();
+		return;
+	}
+
+	// A worker is loading the resource, wait for it to show up in the completed list
+	std::unique_lock<std::mutex> lock(_completedMutex);
+	_loadCompleted.wait(lock, [&]() {
+		return std::find(_completedLoads.begin(), _completedLoads.end(), load) != _completedLoads.end();
+	});
+	_completedLoads.erase(std::find(_completedLoads.begin(), _completedLoads.end(), load));
+}
+
+void ResourceManager::_FinishLoad(const std::shared_ptr<PendingLoad>& load) {
+	if (load->Succeeded) {
+		load->Resource->_FinishDeferredLoad();
+		load->IsFinishing = true;
+		if (!_CompleteLoad(load, false)) {
+			_finishingLoads.push_back(load);
+		}
+	} else {
+		LOG_WARN("Failed to load resource {}", load->Resource->GetGUID().str());
+		load->Resource->_loadState = ResourceLoadState::Failed;
+		_pendingLoads.erase(load->Resource.get());
+	}
+}
+
+bool ResourceManager::_CompleteLoad(const std::shared_ptr<PendingLoad>& load, bool wait) {
+	if (!load->Resource->_PollDeferredLoad(wait)) {
+		return false;
+	}
+	load->Resource->_loadState = ResourceLoadState::Ready;
+	_pendingLoads.erase(load->Resource.get());
+	return true;
+}
+
+void ResourceManager::_StartLoadsOfType(const IResource& resource) {
+	std::vector<std::shared_ptr<PendingLoad>> loads;
+	for (auto& [key, load] : _pendingLoads) {
+		if (!load->IsFinishing && typeid(*load->Resource) == typeid(resource)) {
+			loads.push_back(load);
+		}
+	}
+	for (const std::shared_ptr<PendingLoad>& load : loads) {
+		_WaitForLoadDeferred(load);
+		_FinishLoad(load);
+	}
+}
+
+void ResourceManager::SaveManifest(const std::string& path) {
+	_UpdateManifest();
+	FileHelpers::WriteContentsToFile(path, _manifest.dump(1,'\t'));
+}
+
+void ResourceManager::SaveManifestBinary(const std::string& path) {
+	_UpdateManifest();
+	ConvertManifestToBinary(_manifest, path);
+}
+
+bool ResourceManager::ConvertManifestToBinary(const nlohmann::ordered_json& manifest, const std::string& path) {
+	BinaryWriter resources;
+	resources.Write<uint32_t>(static_cast<uint32_t>(manifest.size()));
+	for (auto& [typeName, items] : manifest.items()) {
+		resources.WriteString(typeName);
+		resources.Write<uint32_t>(items.is_object() ? static_cast<uint32_t>(items.size()) : 0);
+		if (items.is_object()) {
 			for (auto& [guid, blob] : items.items()) {
+				resources.WriteGuid(Guid(guid));
+				resources.WriteBlob(nlohmann::ordered_json::to_msgpack(blob));
+			}
+		}
+	}
+
+	ChunkedFileWriter file;
+	file.AddChunk(MakeFourCC("RSRC"), BINARY_MANIFEST_VERSION, resources.Release());
+	return file.Save(path);
+}
+
+void ResourceManager::_LoadManifestBinary(const std::string& path) {
+	ChunkedFileReader::Sptr file = ChunkedFileReader::Open(path);
+	if (file == nullptr) {
+		return;
+	}
+
+	uint32_t version = 0;
+	BinaryReader resources = file->GetChunk(MakeFourCC("RSRC"), &version);
+	if (!resources.IsValid() || version > BINARY_MANIFEST_VERSION) {
+		LOG_ERROR("Binary manifest '{}' is missing resources or is an unsupported version", path);
+		return;
+	}
+
+	uint32_t typeCount = resources.Read<uint32_t>();
+	for (uint32_t typeIx = 0; typeIx < typeCount && resources.IsValid(); typeIx++) {
+		std::string typeName(resources.ReadString());
+		uint32_t count = resources.Read<uint32_t>();
+
+		auto& func = _typeLoaders[typeName];
+		for (uint32_t ix = 0; ix < count && resources.IsValid(); ix++) {
+			Guid guid = resources.ReadGuid();
+			BinaryReader payload = resources.ReadBlob();
+			// Skip over the payloads for types we don't know how to load
+			if (func && payload.IsValid()) {
+				nlohmann::json blob = nlohmann::json::from_msgpack(payload.GetData(), payload.GetData() + payload.GetSize(), true, false);
+				if (blob.is_discarded()) {
+					LOG_WARN("Skipping corrupt {} resource {} in binary manifest '{}'", typeName, guid.str(), path);
+					continue;
+				}
 				func(blob);
 			}
 		}
 	}
+
+	if (!resources.IsValid()) {
+		LOG_ERROR("Binary manifest '{}' is corrupt, some resources may be missing", path);
+	}
 }
 
-void ResourceManager::SaveManifest(const std::string& path) {
+void ResourceManager::_UpdateManifest() {
 	// Update all resources in the manifest so they match their current representation
 	for (auto& [type, map] : _resources) {
 		for (auto& [guid, res] : map) {
@@ -43,10 +283,16 @@ void ResourceManager::SaveManifest(const std::string& path) {
 			_manifest[StringTools::SanitizeClassName(type.name())][guid.str()]["guid"] = res->GetGUID().str();
 		}
 	}
-	FileHelpers::WriteContentsToFile(path, _manifest.dump(1,'\t'));
 }
 
 void ResourceManager::Cleanup() {
+	// Make sure no workers are still using our resources, then drop anything that
+	// never got finished
+	JobSystem::WaitIdle();
+	_completedLoads.clear();
+	_finishingLoads.clear();
+	_pendingLoads.clear();
+
 	for (auto& [type, map] : _resources) {
 		map.clear();
 	}
@@ -3,6 +3,10 @@
 #include <json.hpp>
 #include <unordered_map>
 #include <typeindex>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
 
 #include "Graphics/Texture2D.h";
 #include "Graphics/VertexArrayObject.h";
@@ -76,6 +80,10 @@ public:
 			IResource::Sptr res = T::FromJson(data);
 			res->OverrideGUID(Guid(data["guid"]));
 			_resources[std::type_index(typeid(T))][res->GetGUID()] = res;
+			// Resources that defer their loading get finished in the background
+			if (res->GetLoadState() == ResourceLoadState::Pending) {
+				_QueueLoad(res);
+			}
 			return res->GetGUID();
 		};
 
@@ -116,15 +124,66 @@ public:
 	/// </summary>
 	static const nlohmann::json& GetManifest();
 	/// <summary>
-	/// Loads a manifest file into the resource manager
+	/// Loads a manifest file into the resource manager, the file may be either a
+	/// JSON manifest or a binary manifest (detected by the file's magic number)
+	///
+	/// Resources that support deferred loading (textures, meshes and shaders) are
+	/// returned in the pending state, and their file I/O and decoding is done on the
+	/// job system. They become ready once ProcessPendingLoads uploads them
+	/// </summary>
+	/// <param name="path">The path to the manifest file</param>
+	/// <param name="waitForLoads">True to block until all resources have finished loading</param>
+	static void LoadManifest(const std::string& path, bool waitForLoads = false);
+
+	/// <summary>
+	/// Finishes resources whose background loading has completed, by uploading their
+	/// data to OpenGL, and checks on resources that are still finishing on the GPU
+	/// (ex: shaders being compiled). Must be called on the main thread, usually once per frame
+	/// </summary>
+	/// <param name="maxMilliseconds">
+	/// The time budget for uploads, we stop once this is exceeded so that loading
+	/// does not cause large frame spikes. At least one resource is always finished
+	/// </param>
+	static void ProcessPendingLoads(float maxMilliseconds = 2.0f);
+	/// <summary>
+	/// Blocks until the given resource has finished loading, for resources that are
+	/// needed immediately (ex: a material needs it's shader to find uniforms). If no
+	/// worker has started on the resource yet, it is loaded on the calling thread
+	/// If the resource finishes on the GPU, other resources of the same type are started
+	/// before we wait, so that they can all be worked on at the same time
+	/// Must be called on the main thread
+	/// </summary>
+	/// <param name="resource">The resource to wait on, may be null</param>
+	static void EnsureLoaded(const IResource::Sptr& resource);
+	/// <summary>
+	/// Blocks until all pending resources have finished loading
+	/// </summary>
+	static void FinishPendingLoads();
+	/// <summary>
+	/// Gets the number of resources that are still waiting to be loaded
 	/// </summary>
-	/// <param name="path">The path to the JSON manifest file</param>
-	static void LoadManifest(const std::string& path);
+	static size_t GetPendingLoadCount();
 	/// <summary>
 	/// Saves the manifest to the given JSON file
 	/// </summary>
 	/// <param name="path">The path to the file to output</param>
 	static void SaveManifest(const std::string& path);
+	/// <summary>
+	/// Saves the manifest to the given binary file, see ConvertManifestToBinary
+	/// </summary>
+	/// <param name="path">The path to the file to output</param>
+	static void SaveManifestBinary(const std::string& path);
+
+	/// <summary>
+	/// Converts a JSON manifest into a binary manifest. The binary manifest is a chunked
+	/// file (see Utils/ChunkedFile.h) with a single RSRC chunk, which stores each type
+	/// name followed by it's resources as GUID + MessagePack encoded JSON pairs. Types are
+	/// kept in the same order as the JSON, so dependencies still load first
+	/// </summary>
+	/// <param name="manifest">The JSON manifest, as returned by GetManifest</param>
+	/// <param name="path">The path to the file to output</param>
+	/// <returns>True if the file was written successfully</returns>
+	static bool ConvertManifestToBinary(const nlohmann::ordered_json& manifest, const std::string& path);
 
 	/// <summary>
 	/// Releases all resources held by the resource manager
@@ -148,4 +207,62 @@ protected:
 	/// This allows us to register dependencies before the dependent resource
 	/// </summary>
 	static nlohmann::ordered_json _manifest;
+
+	inline static const uint32_t BINARY_MANIFEST_VERSION = 1;
+
+	/// <summary>
+	/// Tracks a resource that is being loaded in the background
+	/// </summary>
+	struct PendingLoad {
+		IResource::Sptr  Resource;
+		// Set by whichever thread performs the CPU side of the load, so that
+		// EnsureLoaded and the worker never both load the resource
+		std::atomic_bool IsClaimed{ false };
+		// Written by the loading thread before the load is marked as completed
+		bool             Succeeded = false;
+		// True once _FinishDeferredLoad has been called, and we're waiting on _PollDeferredLoad
+		bool             IsFinishing = false;
+	};
+	// All resources that have not been finished yet, only touched on the main thread
+	static std::map<IResource*, std::shared_ptr<PendingLoad>> _pendingLoads;
+	// Loads that have finished their CPU side work, and are waiting for the main thread
+	static std::deque<std::shared_ptr<PendingLoad>> _completedLoads;
+	static std::mutex _completedMutex;
+	static std::condition_variable _loadCompleted;
+	// Loads that are finishing in the background, and need to be polled
+	static std::vector<std::shared_ptr<PendingLoad>> _finishingLoads;
+
+	/// <summary>
+	/// Schedules the CPU side of a pending resource's load on the job system
+	/// </summary>
+	static void _QueueLoad(const IResource::Sptr& resource);
+	/// <summary>
+	/// Makes sure the CPU side of a load is done, either by doing it ourselves or by
+	/// waiting for the worker that claimed it
+	/// </summary>
+	static void _WaitForLoadDeferred(const std::shared_ptr<PendingLoad>& load);
+	/// <summary>
+	/// Finishes a load on the main thread. If the resource is done, it's removed from the
+	/// pending loads, otherwise it's added to the finishing loads
+	/// </summary>
+	static void _FinishLoad(const std::shared_ptr<PendingLoad>& load);
+	/// <summary>
+	/// Polls a finishing load, marking it as ready and removing it from the pending loads once it is done.
+	/// Does not remove it from the finishing loads
+	/// </summary>
+	/// <returns>True if the load has finished</returns>
+	static bool _CompleteLoad(const std::shared_ptr<PendingLoad>& load, bool wait);
+	/// <summary>
+	/// Starts finishing all pending loads with the same type as the given resource
+	/// </summary>
+	static void _StartLoadsOfType(const IResource& resource);
+
+	/// <summary>
+	/// Loads all resources from a binary manifest file
+	/// </summary>
+	static void _LoadManifestBinary(const std::string& path);
+	/// <summary>
+	/// Refreshes the manifest so it matches the current state of all resources
+	/// </summary>
+	static void _UpdateManifest();
 };
\ No newline at end of file
@@ -0,0 +1,266 @@
+#include "Utils/TextureCache.h"
+
+#include <filesystem>
+#include <algorithm>
+#include <GLFW/glfw3.h>
+#include <stb_image.h>
+#include <Logging.h>
+
+#include "Utils/TextureCompressor.h"
+#include "Utils/ChunkedFile.h"
+
+// Chunk IDs and versions for our texture cache files, bump the version if the
+// encoders or the level layout change to invalidate old caches
+static const uint32_t TEXTURE_CACHE_HEADER  = MakeFourCC("TEXH");
+static const uint32_t TEXTURE_CACHE_SOURCES = MakeFourCC("SRCS");
+static const uint32_t TEXTURE_CACHE_LEVELS  = MakeFourCC("LVLS");
+static const uint32_t TEXTURE_CACHE_DATA    = MakeFourCC("TEXD");
+static const uint32_t TEXTURE_CACHE_VERSION = 1;
+
+// Stored in the TEXH chunk, the settings the cache was built with and the layout of the result
+struct TextureCacheHeader {
+	uint32_t Format;
+	uint32_t PixelLayout;
+	uint32_t FaceCount;
+	uint32_t LevelCount;
+	uint32_t Compression;
+	uint32_t HasMipMaps;
+	int32_t  Channels;
+	uint32_t SupportsS3tc;
+};
+
+// Stored in the SRCS chunk once per source file, used to make sure the cache matches the sources
+struct TextureCacheSource {
+	uint64_t Size;
+	int64_t  Time;
+};
+
+// Stored in the LVLS chunk once per mip level, the offset is from the start of the TEXD chunk
+struct TextureCacheLevel {
+	uint64_t Offset;
+	uint64_t Size;
+	uint32_t Width;
+	uint32_t Height;
+};
+
+// Holds the levels for a freshly converted texture, when we couldn't map it's cache
+struct ConvertedTextureStorage {
+	std::vector<uint8_t> Data;
+};
+
+// Gets the cache validation info for a source file
+static bool GetSourceInfo(const std::string& filename, TextureCacheSource& result) {
+	std::error_code error;
+	result.Size = std::filesystem::file_size(filename, error);
+	if (error) {
+		return false;
+	}
+	result.Time = static_cast<int64_t>(std::filesystem::last_write_time(filename, error).time_since_epoch().count());
+	return !error;
+}
+
+bool TextureCache::Load(const std::vector<std::string>& sources, const Settings& settings, TextureData& result) {
+	if (sources.empty()) {
+		return false;
+	}
+
+	// glfwGetTime is safe to call from any thread
+	float startTime = static_cast<float>(glfwGetTime());
+
+	if (_LoadFromCache(sources, settings, result)) {
+		LOG_TRACE("Loaded cached texture for \"{}\" in {} seconds", sources[0], static_cast<float>(glfwGetTime()) - startTime);
+		return true;
+	}
+
+	// Decode every face, these all need to match in size and channel count
+	std::vector<std::vector<uint8_t>> faces;
+	faces.reserve(sources.size());
+	uint32_t width = 0, height = 0;
+	int channels = 0;
+	for (const std::string& source : sources) {
+		// Note that the flip flag is global in our version of STBI, but every loader sets it
+		// to true so it's safe for workers to race on it
+		stbi_set_flip_vertically_on_load(true);
+		int fileWidth, fileHeight, fileChannels;
+		uint8_t* data = stbi_load(source.c_str(), &fileWidth, &fileHeight, &fileChannels, settings.Channels);
+		if (data == nullptr) {
+			LOG_WARN("STBI Failed to load image from \"{}\"", source);
+			return false;
+		}
+		// fileChannels stores the number of channels in the image on disk, if we overrode that we should use the override value
+		if (settings.Channels != 0) {
+			fileChannels = settings.Channels;
+		}
+
+		if (faces.empty()) {
+			width = fileWidth;
+			height = fileHeight;
+			channels = fileChannels;
+		} else if ((uint32_t)fileWidth != width || (uint32_t)fileHeight != height || fileChannels != channels) {
+			LOG_WARN("Image \"{}\" did not match the size or format of \"{}\"", source, sources[0]);
+			stbi_image_free(data);
+			return false;
+		}
+
+		faces.emplace_back(data, data + (size_t)width * height * channels);
+		stbi_image_free(data);
+	}
+
+	// Block compressed images have to be made of whole blocks
+	TextureCompression compression = settings.Compression;
+	if (compression != TextureCompression::None && (width % 4 != 0 || height % 4 != 0)) {
+		LOG_WARN("Image \"{}\" is {}x{}, which is not a multiple of 4. It will not be compressed", sources[0], width, height);
+		compression = TextureCompression::None;
+	}
+	InternalFormat format = TextureCompressor::SelectFormat(compression, faces[0].data(), width, height, channels, settings.SupportsS3tc);
+	bool isCompressed = GetCompressedBlockSize(format) > 0;
+
+	// Build out all the levels, each face is compressed and then downsampled for the next level
+	uint32_t levelCount = settings.GenerateMipMaps ? TextureCompressor::GetMipCount(width, height) : 1;
+	std::vector<TextureCacheLevel> levels(levelCount);
+	std::shared_ptr<ConvertedTextureStorage> storage = std::make_shared<ConvertedTextureStorage>();
+	uint32_t levelWidth = width, levelHeight = height;
+	for (uint32_t level = 0; level < levelCount; level++) {
+		levels[level].Offset = storage->Data.size();
+		levels[level].Width  = levelWidth;
+		levels[level].Height = levelHeight;
+		for (std::vector<uint8_t>& face : faces) {
+			if (isCompressed) {
+				std::vector<uint8_t> blocks = TextureCompressor::Compress(face.data(), levelWidth, levelHeight, channels, format);
+				storage->Data.insert(storage->Data.end(), blocks.begin(), blocks.end());
+			} else {
+				storage->Data.insert(storage->Data.end(), face.begin(), face.end());
+			}
+			if (level + 1 < levelCount) {
+				face = TextureCompressor::Downsample(face.data(), levelWidth, levelHeight, channels);
+			}
+		}
+		levels[level].Size = storage->Data.size() - levels[level].Offset;
+
+		levelWidth = std::max(levelWidth / 2, 1u);
+		levelHeight = std::max(levelHeight / 2, 1u);
+	}
+
+	// Write out the cache so that we never have to convert these images again
+	std::vector<TextureCacheSource> sourceInfo(sources.size());
+	bool canCache = true;
+	bool isMapped = false;
+	for (size_t ix = 0; ix < sources.size(); ix++) {
+		canCache &= GetSourceInfo(sources[ix], sourceInfo[ix]);
+	}
+	if (canCache) {
+		TextureCacheHeader header;
+		header.Format       = static_cast<uint32_t>(*format);
+		header.PixelLayout  = static_cast<uint32_t>(*GetPixelFormatForChannels(channels));
+		header.FaceCount    = static_cast<uint32_t>(faces.size());
+		header.LevelCount   = levelCount;
+		header.Compression  = static_cast<uint32_t>(*settings.Compression);
+		header.HasMipMaps   = settings.GenerateMipMaps ? 1 : 0;
+		header.Channels     = settings.Channels;
+		header.SupportsS3tc = settings.SupportsS3tc ? 1 : 0;
+
+		BinaryWriter headerData;
+		headerData.Write(header);
+		BinaryWriter sourceData;
+		sourceData.Write(static_cast<uint32_t>(sourceInfo.size()));
+		sourceData.WriteBytes(sourceInfo.data(), sourceInfo.size() * sizeof(TextureCacheSource));
+		BinaryWriter levelData;
+		levelData.WriteBytes(levels.data(), levels.size() * sizeof(TextureCacheLevel));
+
+		ChunkedFileWriter cache;
+		cache.AddChunk(TEXTURE_CACHE_HEADER, TEXTURE_CACHE_VERSION, headerData.Release());
+		cache.AddChunk(TEXTURE_CACHE_SOURCES, TEXTURE_CACHE_VERSION, sourceData.Release());
+		cache.AddChunk(TEXTURE_CACHE_LEVELS, TEXTURE_CACHE_VERSION, levelData.Release());
+		cache.AddChunk(TEXTURE_CACHE_DATA, TEXTURE_CACHE_VERSION, std::vector<uint8_t>(storage->Data));
+		if (cache.Save(sources[0] + CACHE_EXTENSION)) {
+			// Prefer the mapped file, so that we don't keep a second copy of the texture in memory
+			isMapped = _LoadFromCache(sources, settings, result);
+		} else {
+			LOG_WARN("Failed to write texture cache for \"{}\"", sources[0]);
+		}
+	}
+
+	LOG_TRACE("Converted texture \"{}\" in {} seconds ({}x{}, {} levels, format {})", sources[0], static_cast<float>(glfwGetTime()) - startTime, width, height, levelCount, ~format);
+	if (isMapped) {
+		return true;
+	}
+
+	result.Format      = format;
+	result.PixelLayout = GetPixelFormatForChannels(channels);
+	result.FaceCount   = static_cast<uint32_t>(faces.size());
+	result.Levels.resize(levelCount);
+	for (uint32_t level = 0; level < levelCount; level++) {
+		result.Levels[level].Data   = storage->Data.data() + levels[level].Offset;
+		result.Levels[level].Size   = levels[level].Size;
+		result.Levels[level].Width  = levels[level].Width;
+		result.Levels[level].Height = levels[level].Height;
+	}
+	result.Storage = storage;
+	return true;
+}
+
+bool TextureCache::_LoadFromCache(const std::vector<std::string>& sources, const Settings& settings, TextureData& result) {
+	std::string cachePath = sources[0] + CACHE_EXTENSION;
+	if (!std::filesystem::exists(cachePath)) {
+		return false;
+	}
+
+	ChunkedFileReader::Sptr cache = ChunkedFileReader::Open(cachePath);
+	if (cache == nullptr) {
+		return false;
+	}
+
+	uint32_t headerVersion = 0, sourceVersion = 0, levelVersion = 0, dataVersion = 0;
+	BinaryReader headerData = cache->GetChunk(TEXTURE_CACHE_HEADER, &headerVersion);
+	BinaryReader sourceData = cache->GetChunk(TEXTURE_CACHE_SOURCES, &sourceVersion);
+	BinaryReader levelData  = cache->GetChunk(TEXTURE_CACHE_LEVELS, &levelVersion);
+	BinaryReader textureData = cache->GetChunk(TEXTURE_CACHE_DATA, &dataVersion);
+	if (headerVersion != TEXTURE_CACHE_VERSION || sourceVersion != TEXTURE_CACHE_VERSION || levelVersion != TEXTURE_CACHE_VERSION || dataVersion != TEXTURE_CACHE_VERSION) {
+		return false;
+	}
+
+	TextureCacheHeader header = headerData.Read<TextureCacheHeader>();
+	if (!headerData.IsValid() ||
+		header.FaceCount != sources.size() ||
+		header.LevelCount == 0 ||
+		header.Compression != static_cast<uint32_t>(*settings.Compression) ||
+		header.HasMipMaps != (settings.GenerateMipMaps ? 1u : 0u) ||
+		header.Channels != settings.Channels ||
+		header.SupportsS3tc != (settings.SupportsS3tc ? 1u : 0u) ||
+		levelData.GetSize() != header.LevelCount * sizeof(TextureCacheLevel)) {
+		return false;
+	}
+
+	// Every source needs to be unchanged since the cache was written
+	uint32_t sourceCount = sourceData.Read<uint32_t>();
+	if (!sourceData.IsValid() || sourceCount != sources.size()) {
+		return false;
+	}
+	for (const std::string& source : sources) {
+		TextureCacheSource expected = sourceData.Read<TextureCacheSource>();
+		TextureCacheSource actual;
+		if (!sourceData.IsValid() || !GetSourceInfo(source, actual) || actual.Size != expected.Size || actual.Time != expected.Time) {
+			return false;
+		}
+	}
+
+	// The levels point straight into the mapped file
+	std::vector<LevelData> levels(header.LevelCount);
+	for (LevelData& level : levels) {
+		TextureCacheLevel entry = levelData.Read<TextureCacheLevel>();
+		if (entry.Offset + entry.Size > textureData.GetSize()) {
+			return false;
+		}
+		level.Data   = textureData.GetData() + entry.Offset;
+		level.Size   = entry.Size;
+		level.Width  = entry.Width;
+		level.Height = entry.Height;
+	}
+
+	result.Format      = static_cast<InternalFormat>(header.Format);
+	result.PixelLayout = static_cast<PixelFormat>(header.PixelLayout);
+	result.FaceCount   = header.FaceCount;
+	result.Levels      = std::move(levels);
+	result.Storage     = cache;
+	return true;
+}
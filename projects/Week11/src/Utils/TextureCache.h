@@ -0,0 +1,91 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "Graphics/TextureEnums.h"
+
+/// <summary>
+/// Converts image files into a GPU ready sidecar cache (first source + CACHE_EXTENSION),
+/// with the full mip chain precomputed and (optionally) block compressed with
+/// TextureCompressor. Repeat loads map the cache and upload straight from it, so no
+/// images are decoded or compressed after the first run. The cache is rebuilt whenever
+/// any of the source files change size or modification time, or the settings change
+///
+/// Levels are stored from most to least detailed, and every level holds all of the
+/// texture's faces back to back, so a level can be uploaded (or streamed in) with a
+/// single call
+/// </summary>
+class TextureCache {
+public:
+	// The extension appended to the first source path to get the path of the cache file
+	inline static const std::string CACHE_EXTENSION = ".tcache";
+
+	/// <summary>
+	/// Controls how the source images are converted
+	/// </summary>
+	struct Settings {
+		// How the texture should be compressed, see TextureCompressor::SelectFormat
+		TextureCompression Compression;
+		// True to store the full mip chain, false to only store the base level
+		bool               GenerateMipMaps;
+		// The number of channels to decode the images with, or 0 to use the channels in the file
+		int                Channels;
+		// True if the driver supports BC1 and BC3, see ITexture::Limits
+		bool               SupportsS3tc;
+
+		Settings(TextureCompression compression = TextureCompression::Auto, bool mipmaps = true, int channels = 0, bool supportsS3tc = true) :
+			Compression(compression), GenerateMipMaps(mipmaps), Channels(channels), SupportsS3tc(supportsS3tc) {}
+	};
+
+	/// <summary>
+	/// A single mip level, with the data for every face back to back
+	/// </summary>
+	struct LevelData {
+		const void* Data   = nullptr;
+		size_t      Size   = 0;
+		uint32_t    Width  = 0;
+		uint32_t    Height = 0;
+	};
+
+	/// <summary>
+	/// The CPU side result of loading a texture, ready to be uploaded to OpenGL
+	/// </summary>
+	struct TextureData {
+		InternalFormat Format      = InternalFormat::Unknown;
+		// The layout of the data for uncompressed formats
+		PixelFormat    PixelLayout = PixelFormat::Unknown;
+		uint32_t       FaceCount   = 0;
+		// The mip levels, from most to least detailed
+		std::vector<LevelData> Levels;
+		// Keeps the memory behind the levels alive, this is either the mapped cache
+		// file or the images that were just converted
+		std::shared_ptr<const void> Storage;
+
+		/// <summary>
+		/// Returns true if the format is block compressed, and should be uploaded with glCompressedTextureSubImage*
+		/// </summary>
+		bool IsCompressed() const { return GetCompressedBlockSize(Format) > 0; }
+	};
+
+	/// <summary>
+	/// Loads a texture from it's cache, or converts the source images and writes the cache
+	/// if it is missing or stale. This does not touch OpenGL, so it can be called from any thread
+	/// </summary>
+	/// <param name="sources">The image files to load, one per face. All images must be the same size</param>
+	/// <param name="settings">Controls how the images are converted, the cache is rebuilt if these change</param>
+	/// <param name="result">The texture data to populate</param>
+	/// <returns>True if the data was loaded, false if otherwise</returns>
+	static bool Load(const std::vector<std::string>& sources, const Settings& settings, TextureData& result);
+
+protected:
+	TextureCache() = default;
+	~TextureCache() = default;
+
+	/// <summary>
+	/// Attempts to load the texture data from the cache for the given sources
+	/// </summary>
+	/// <returns>True if the cache was loaded, false if it is missing or stale</returns>
+	static bool _LoadFromCache(const std::vector<std::string>& sources, const Settings& settings, TextureData& result);
+};
@@ -0,0 +1,368 @@
+#include "Utils/TextureCompressor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <GLM/glm.hpp>
+#include <Logging.h>
+
+// A 4x4 block of texels, always expanded to RGBA
+typedef uint8_t TexelBlock[16][4];
+
+// The interpolation weights for BC7's 4 bit indices, out of 64
+static const int BC7_WEIGHTS_4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// Copies a block out of the image, repeating the edge texels for blocks that hang off the image
+static void ExtractBlock(const uint8_t* data, uint32_t width, uint32_t height, int channels, uint32_t blockX, uint32_t blockY, TexelBlock& result) {
+	for (uint32_t y = 0; y < 4; y++) {
+		uint32_t srcY = std::min(blockY * 4 + y, height - 1);
+		for (uint32_t x = 0; x < 4; x++) {
+			uint32_t srcX = std::min(blockX * 4 + x, width - 1);
+			const uint8_t* texel = data + ((size_t)srcY * width + srcX) * channels;
+			uint8_t* dest = result[y * 4 + x];
+			// Single channel images should still read back the same from the red channel
+			dest[0] = texel[0];
+			dest[1] = channels > 1 ? texel[1] : (channels == 1 ? texel[0] : 0);
+			dest[2] = channels > 2 ? texel[2] : (channels == 1 ? texel[0] : 0);
+			dest[3] = channels > 3 ? texel[3] : 255;
+		}
+	}
+}
+
+// Finds the two ends of the line that best fits the block's texels, using the first numChannels channels.
+// The ends are pulled in slightly, since the extremes are rarely worth representing exactly
+static void FitEndpoints(const TexelBlock& block, int numChannels, glm::vec4& high, glm::vec4& low) {
+	glm::vec4 mean = glm::vec4(0.0f);
+	for (int ix = 0; ix < 16; ix++) {
+		for (int c = 0; c < numChannels; c++) {
+			mean[c] += block[ix][c];
+		}
+	}
+	mean /= 16.0f;
+
+	float covariance[4][4] = {};
+	for (int ix = 0; ix < 16; ix++) {
+		glm::vec4 delta = glm::vec4(0.0f);
+		for (int c = 0; c < numChannels; c++) {
+			delta[c] = block[ix][c] - mean[c];
+		}
+		for (int a = 0; a < numChannels; a++) {
+			for (int b = 0; b < numChannels; b++) {
+				covariance[a][b] += delta[a] * delta[b];
+			}
+		}
+	}
+
+	// A few rounds of power iteration is plenty to find the principal axis
+	glm::vec4 axis = glm::vec4(0.0f);
+	for (int c = 0; c < numChannels; c++) {
+		axis[c] = 1.0f;
+	}
+	for (int iteration = 0; iteration < 4; iteration++) {
+		glm::vec4 next = glm::vec4(0.0f);
+		for (int a = 0; a < numChannels; a++) {
+			for (int b = 0; b < numChannels; b++) {
+				next[a] += covariance[a][b] * axis[b];
+			}
+		}
+		float length = glm::length(next);
+		if (length <= 0.0f) {
+			break;
+		}
+		axis = next / length;
+	}
+
+	float minProj = HUGE_VALF, maxProj = -HUGE_VALF;
+	for (int ix = 0; ix < 16; ix++) {
+		float proj = 0.0f;
+		for (int c = 0; c < numChannels; c++) {
+			proj += (block[ix][c] - mean[c]) * axis[c];
+		}
+		minProj = std::min(minProj, proj);
+		maxProj = std::max(maxProj, proj);
+	}
+	float inset = (maxProj - minProj) / 16.0f;
+	high = glm::clamp(mean + axis * (maxProj - inset), 0.0f, 255.0f);
+	low  = glm::clamp(mean + axis * (minProj + inset), 0.0f, 255.0f);
+}
+
+static uint16_t To565(const glm::vec4& color) {
+	uint16_t r = static_cast<uint16_t>((color.r * 31.0f + 127.5f) / 255.0f);
+	uint16_t g = static_cast<uint16_t>((color.g * 63.0f + 127.5f) / 255.0f);
+	uint16_t b = static_cast<uint16_t>((color.b * 31.0f + 127.5f) / 255.0f);
+	return (r << 11) | (g << 5) | b;
+}
+
+static glm::ivec3 From565(uint16_t color) {
+	int r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+	return glm::ivec3((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2));
+}
+
+// BC1: two 565 endpoints and a 2 bit index per texel
+static void EncodeBC1(const TexelBlock& block, uint8_t* out) {
+	glm::vec4 high, low;
+	FitEndpoints(block, 3, high, low);
+	uint16_t c0 = To565(high), c1 = To565(low);
+	// The 4 color mode is only used if the first endpoint is larger
+	if (c0 < c1) {
+		std::swap(c0, c1);
+	}
+
+	uint32_t indices = 0;
+	if (c0 != c1) {
+		glm::ivec3 palette[4];
+		palette[0] = From565(c0);
+		palette[1] = From565(c1);
+		palette[2] = (palette[0] * 2 + palette[1]) / 3;
+		palette[3] = (palette[0] + palette[1] * 2) / 3;
+		for (int ix = 0; ix < 16; ix++) {
+			glm::ivec3 texel = glm::ivec3(block[ix][0], block[ix][1], block[ix][2]);
+			int best = 0, bestError = INT32_MAX;
+			for (int entry = 0; entry < 4; entry++) {
+				glm::ivec3 delta = texel - palette[entry];
+				int error = delta.x * delta.x + delta.y * delta.y + delta.z * delta.z;
+				if (error < bestError) {
+					bestError = error;
+					best = entry;
+				}
+			}
+			indices |= static_cast<uint32_t>(best) << (ix * 2);
+		}
+	}
+
+	memcpy(out, &c0, 2);
+	memcpy(out + 2, &c1, 2);
+	memcpy(out + 4, &indices, 4);
+}
+
+// BC4: two 8 bit endpoints and a 3 bit index per texel, used for BC3's alpha and BC5's channels
+static void EncodeBC4(const TexelBlock& block, int channel, uint8_t* out) {
+	int high = 0, low = 255;
+	for (int ix = 0; ix < 16; ix++) {
+		high = std::max(high, (int)block[ix][channel]);
+		low = std::min(low, (int)block[ix][channel]);
+	}
+
+	uint64_t indices = 0;
+	if (high != low) {
+		// With the first endpoint larger, we get 6 values in between the endpoints
+		int palette[8];
+		palette[0] = high;
+		palette[1] = low;
+		for (int ix = 2; ix < 8; ix++) {
+			palette[ix] = ((8 - ix) * high + (ix - 1) * low) / 7;
+		}
+		for (int ix = 0; ix < 16; ix++) {
+			int value = block[ix][channel];
+			int best = 0, bestError = INT32_MAX;
+			for (int entry = 0; entry < 8; entry++) {
+				int error = std::abs(value - palette[entry]);
+				if (error < bestError) {
+					bestError = error;
+					best = entry;
+				}
+			}
+			indices |= static_cast<uint64_t>(best) << (ix * 3);
+		}
+	}
+
+	out[0] = static_cast<uint8_t>(high);
+	out[1] = static_cast<uint8_t>(low);
+	for (int ix = 0; ix < 6; ix++) {
+		out[2 + ix] = static_cast<uint8_t>(indices >> (ix * 8));
+	}
+}
+
+// Writes bits into a block, least significant bit first
+struct BlockBitWriter {
+	uint8_t* Data;
+	int      Cursor;
+
+	void Write(uint32_t value, int bits) {
+		for (int ix = 0; ix < bits; ix++, Cursor++) {
+			if ((value >> ix) & 1) {
+				Data[Cursor / 8] |= static_cast<uint8_t>(1 << (Cursor % 8));
+			}
+		}
+	}
+};
+
+// Quantizes a BC7 mode 6 endpoint to 7 bits per channel plus a shared low bit, picking whichever low bit fits best
+static void QuantizeBC7Endpoint(const glm::vec4& endpoint, glm::ivec4& quantized, int& pBit) {
+	int bestError = INT32_MAX;
+	for (int p = 0; p < 2; p++) {
+		glm::ivec4 candidate;
+		int error = 0;
+		for (int c = 0; c < 4; c++) {
+			candidate[c] = glm::clamp(static_cast<int>(std::round((endpoint[c] - p) / 2.0f)), 0, 127);
+			int delta = ((candidate[c] << 1) | p) - static_cast<int>(std::round(endpoint[c]));
+			error += delta * delta;
+		}
+		if (error < bestError) {
+			bestError = error;
+			quantized = candidate;
+			pBit = p;
+		}
+	}
+}
+
+// BC7 mode 6: a single RGBA subset with 7 bit + shared bit endpoints and a 4 bit index per texel
+static void EncodeBC7(const TexelBlock& block, uint8_t* out) {
+	glm::vec4 high, low;
+	FitEndpoints(block, 4, high, low);
+
+	glm::ivec4 endpoints[2];
+	int pBits[2];
+	QuantizeBC7Endpoint(high, endpoints[0], pBits[0]);
+	QuantizeBC7Endpoint(low, endpoints[1], pBits[1]);
+
+	glm::ivec4 e0 = (endpoints[0] << 1) | pBits[0];
+	glm::ivec4 e1 = (endpoints[1] << 1) | pBits[1];
+	glm::ivec4 palette[16];
+	for (int ix = 0; ix < 16; ix++) {
+		palette[ix] = ((64 - BC7_WEIGHTS_4[ix]) * e0 + BC7_WEIGHTS_4[ix] * e1 + 32) >> 6;
+	}
+
+	int indices[16];
+	for (int ix = 0; ix < 16; ix++) {
+		glm::ivec4 texel = glm::ivec4(block[ix][0], block[ix][1], block[ix][2], block[ix][3]);
+		int bestError = INT32_MAX;
+		for (int entry = 0; entry < 16; entry++) {
+			glm::ivec4 delta = texel - palette[entry];
+			int error = delta.x * delta.x + delta.y * delta.y + delta.z * delta.z + delta.w * delta.w;
+			if (error < bestError) {
+				bestError = error;
+				indices[ix] = entry;
+			}
+		}
+	}
+
+	// The first texel's index only gets 3 bits, so it's top bit must be 0. We can flip the
+	// endpoints (and all the indices) to make that true
+	if (indices[0] >= 8) {
+		std::swap(endpoints[0], endpoints[1]);
+		std::swap(pBits[0], pBits[1]);
+		for (int ix = 0; ix < 16; ix++) {
+			indices[ix] = 15 - indices[ix];
+		}
+	}
+
+	memset(out, 0, 16);
+	BlockBitWriter writer = { out, 0 };
+	writer.Write(1 << 6, 7);
+	for (int c = 0; c < 4; c++) {
+		writer.Write(endpoints[0][c], 7);
+		writer.Write(endpoints[1][c], 7);
+	}
+	writer.Write(pBits[0], 1);
+	writer.Write(pBits[1], 1);
+	writer.Write(indices[0], 3);
+	for (int ix = 1; ix < 16; ix++) {
+		writer.Write(indices[ix], 4);
+	}
+}
+
+uint32_t TextureCompressor::GetMipCount(uint32_t width, uint32_t height) {
+	uint32_t result = 1;
+	uint32_t size = std::max(width, height);
+	while (size > 1) {
+		size /= 2;
+		result++;
+	}
+	return result;
+}
+
+std::vector<uint8_t> TextureCompressor::Downsample(const uint8_t* data, uint32_t width, uint32_t height, int channels) {
+	uint32_t newWidth = std::max(width / 2, 1u);
+	uint32_t newHeight = std::max(height / 2, 1u);
+	std::vector<uint8_t> result((size_t)newWidth * newHeight * channels);
+	for (uint32_t y = 0; y < newHeight; y++) {
+		uint32_t y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+		for (uint32_t x = 0; x < newWidth; x++) {
+			uint32_t x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+			for (int c = 0; c < channels; c++) {
+				int sum =
+					data[((size_t)y0 * width + x0) * channels + c] + data[((size_t)y0 * width + x1) * channels + c] +
+					data[((size_t)y1 * width + x0) * channels + c] + data[((size_t)y1 * width + x1) * channels + c];
+				result[((size_t)y * newWidth + x) * channels + c] = static_cast<uint8_t>((sum + 2) / 4);
+			}
+		}
+	}
+	return result;
+}
+
+InternalFormat TextureCompressor::SelectFormat(TextureCompression compression, const uint8_t* data, uint32_t width, uint32_t height, int channels, bool supportsS3tc) {
+	switch (compression) {
+		case TextureCompression::None:
+			return GetInternalFormatForChannels8(channels);
+		case TextureCompression::BC1:
+			return supportsS3tc ? InternalFormat::BC1 : InternalFormat::BC7;
+		case TextureCompression::BC3:
+			return supportsS3tc ? InternalFormat::BC3 : InternalFormat::BC7;
+		case TextureCompression::BC5:
+			return InternalFormat::BC5;
+		case TextureCompression::BC7:
+			return InternalFormat::BC7;
+		case TextureCompression::Auto:
+		default:
+			break;
+	}
+
+	if (channels == 2) {
+		return InternalFormat::BC5;
+	}
+	// BC1 can't store alpha, so anything that actually uses it needs the bigger format
+	if (channels == 4) {
+		size_t texelCount = (size_t)width * height;
+		for (size_t ix = 0; ix < texelCount; ix++) {
+			if (data[ix * 4 + 3] != 255) {
+				return InternalFormat::BC7;
+			}
+		}
+	}
+	return supportsS3tc ? InternalFormat::BC1 : InternalFormat::BC7;
+}
+
+size_t TextureCompressor::GetLevelSize(InternalFormat format, uint32_t width, uint32_t height, int channels) {
+	size_t blockSize = GetCompressedBlockSize(format);
+	if (blockSize > 0) {
+		return (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+	}
+	return (size_t)width * height * channels;
+}
+
+std::vector<uint8_t> TextureCompressor::Compress(const uint8_t* data, uint32_t width, uint32_t height, int channels, InternalFormat format) {
+	size_t blockSize = GetCompressedBlockSize(format);
+	LOG_ASSERT(blockSize > 0, "Format {} is not block compressed!", format);
+
+	uint32_t blocksX = (width + 3) / 4;
+	uint32_t blocksY = (height + 3) / 4;
+	std::vector<uint8_t> result((size_t)blocksX * blocksY * blockSize);
+	uint8_t* out = result.data();
+
+	TexelBlock block;
+	for (uint32_t blockY = 0; blockY < blocksY; blockY++) {
+		for (uint32_t blockX = 0; blockX < blocksX; blockX++, out += blockSize) {
+			ExtractBlock(data, width, height, channels, blockX, blockY, block);
+			switch (format) {
+				case InternalFormat::BC1:
+					EncodeBC1(block, out);
+					break;
+				case InternalFormat::BC3:
+					EncodeBC4(block, 3, out);
+					EncodeBC1(block, out + 8);
+					break;
+				case InternalFormat::BC5:
+					EncodeBC4(block, 0, out);
+					EncodeBC4(block, 1, out + 8);
+					break;
+				case InternalFormat::BC7:
+					EncodeBC7(block, out);
+					break;
+				default:
+					break;
+			}
+		}
+	}
+	return result;
+}
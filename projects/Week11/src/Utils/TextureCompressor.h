@@ -0,0 +1,69 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "Graphics/TextureEnums.h"
+
+/// <summary>
+/// CPU side helpers for turning decoded 8 bit images into GPU ready data: building mip
+/// chains and encoding them into block compressed formats. None of this touches OpenGL,
+/// so it can all be run on worker threads.
+///
+/// The encoders favour speed over quality, since they run the first time a texture is
+/// loaded. They fit endpoints to the principal axis of each block and pick the nearest
+/// palette entry for every texel. BC7 only uses mode 6 (one RGBA subset with 4 bit indices)
+/// </summary>
+class TextureCompressor {
+public:
+	/// <summary>
+	/// Gets the number of mip levels in a full chain for an image of the given size
+	/// </summary>
+	static uint32_t GetMipCount(uint32_t width, uint32_t height);
+	/// <summary>
+	/// Halves an image with a box filter, the result follows OpenGL's mip sizes (rounded down, at least 1)
+	/// </summary>
+	/// <param name="data">The tightly packed source texels</param>
+	/// <param name="width">The width of the source image, in texels</param>
+	/// <param name="height">The height of the source image, in texels</param>
+	/// <param name="channels">The number of 8 bit channels per texel (1-4)</param>
+	/// <returns>The texels for the next mip level</returns>
+	static std::vector<uint8_t> Downsample(const uint8_t* data, uint32_t width, uint32_t height, int channels);
+
+	/// <summary>
+	/// Picks the internal format to store an image in, based on the requested compression
+	/// </summary>
+	/// <param name="compression">The compression that was requested</param>
+	/// <param name="data">The tightly packed texels of the full size image</param>
+	/// <param name="width">The width of the image, in texels</param>
+	/// <param name="height">The height of the image, in texels</param>
+	/// <param name="channels">The number of 8 bit channels per texel (1-4)</param>
+	/// <param name="supportsS3tc">True if the driver can sample BC1 and BC3, otherwise BC7 is used instead</param>
+	/// <returns>The format to compress into, or an uncompressed format if compression is None</returns>
+	static InternalFormat SelectFormat(TextureCompression compression, const uint8_t* data, uint32_t width, uint32_t height, int channels, bool supportsS3tc);
+
+	/// <summary>
+	/// Gets the number of bytes needed to store one level of an image in the given format
+	/// </summary>
+	/// <param name="format">The format of the image, may be compressed or uncompressed</param>
+	/// <param name="width">The width of the level, in texels</param>
+	/// <param name="height">The height of the level, in texels</param>
+	/// <param name="channels">The number of 8 bit channels, only used for uncompressed formats</param>
+	static size_t GetLevelSize(InternalFormat format, uint32_t width, uint32_t height, int channels);
+
+	/// <summary>
+	/// Encodes an image into a block compressed format. Texels past the edges of the image
+	/// are filled by repeating the edge, so any size of image can be encoded
+	/// </summary>
+	/// <param name="data">The tightly packed texels to encode</param>
+	/// <param name="width">The width of the image, in texels</param>
+	/// <param name="height">The height of the image, in texels</param>
+	/// <param name="channels">The number of 8 bit channels per texel (1-4)</param>
+	/// <param name="format">One of the BC formats, see GetCompressedBlockSize</param>
+	/// <returns>The encoded blocks, in rows from the bottom of the image</returns>
+	static std::vector<uint8_t> Compress(const uint8_t* data, uint32_t width, uint32_t height, int channels, InternalFormat format);
+
+protected:
+	TextureCompressor() = default;
+	~TextureCompressor() = default;
+};
@@ -0,0 +1,63 @@
+#include "Utils/WorkerThread.h"
+
+WorkerThread::WorkerThread() :
+	_thread(),
+	_mutex(),
+	_jobSubmitted(),
+	_jobFinished(),
+	_job(nullptr),
+	_isBusy(false),
+	_isRunning(true)
+{
+	// Start the thread last, so that everything it touches is already set up
+	_thread = std::thread(&WorkerThread::_ThreadMain, this);
+}
+
+WorkerThread::~WorkerThread() {
+	Wait();
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_isRunning = false;
+	}
+	_jobSubmitted.notify_one();
+	_thread.join();
+}
+
+void WorkerThread::Submit(Job&& job) {
+	Wait();
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_job = std::move(job);
+		_isBusy.store(true, std::memory_order_release);
+	}
+	_jobSubmitted.notify_one();
+}
+
+void WorkerThread::Wait() {
+	// Fast path, most callers just want to make sure the thread is not touching shared state
+	if (!_isBusy.load(std::memory_order_acquire)) {
+		return;
+	}
+	std::unique_lock<std::mutex> lock(_mutex);
+	_jobFinished.wait(lock, [this]() { return !_isBusy.load(std::memory_order_relaxed); });
+}
+
+void WorkerThread::_ThreadMain() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (true) {
+		_jobSubmitted.wait(lock, [this]() { return _job != nullptr || !_isRunning; });
+		if (_job == nullptr) {
+			return;
+		}
+
+		Job job = std::move(_job);
+		_job = nullptr;
+
+		lock.unlock();
+		job();
+		lock.lock();
+
+		_isBusy.store(false, std::memory_order_release);
+		_jobFinished.notify_all();
+	}
+}
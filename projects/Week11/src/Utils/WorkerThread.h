@@ -0,0 +1,61 @@
+#pragma once
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+
+/// <summary>
+/// A single dedicated thread that runs one job at a time. This is for long running
+/// work that happens every frame and should not have to compete with background
+/// loads for the job system's workers (ex: stepping the physics world while the
+/// main thread renders)
+/// </summary>
+class WorkerThread {
+public:
+	typedef std::shared_ptr<WorkerThread> Sptr;
+	typedef std::function<void()> Job;
+
+	static inline Sptr Create() {
+		return std::make_shared<WorkerThread>();
+	}
+
+	WorkerThread();
+	/// <summary>
+	/// Waits for the current job to finish, then stops the thread
+	/// </summary>
+	~WorkerThread();
+
+	WorkerThread(const WorkerThread& other) = delete;
+	WorkerThread(WorkerThread&& other) = delete;
+	WorkerThread& operator=(const WorkerThread& other) = delete;
+	WorkerThread& operator=(WorkerThread&& other) = delete;
+
+	/// <summary>
+	/// Starts running a job on the thread, waiting for the previous job to finish first
+	/// </summary>
+	/// <param name="job">The job to run</param>
+	void Submit(Job&& job);
+	/// <summary>
+	/// Blocks until the current job (if any) has finished. This is very cheap when the thread is idle
+	/// </summary>
+	void Wait();
+	/// <summary>
+	/// Returns true if a job has been submitted and has not finished yet
+	/// </summary>
+	bool IsBusy() const { return _isBusy.load(std::memory_order_acquire); }
+
+protected:
+	std::thread             _thread;
+	std::mutex              _mutex;
+	// Signalled when a job is submitted, or when the thread should exit
+	std::condition_variable _jobSubmitted;
+	// Signalled when the current job finishes
+	std::condition_variable _jobFinished;
+	Job                     _job;
+	std::atomic<bool>       _isBusy;
+	bool                    _isRunning;
+
+	void _ThreadMain();
+};
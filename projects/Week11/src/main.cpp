@@ -26,7 +26,9 @@
 #include "Graphics/Shader.h"
 #include "Graphics/Texture2D.h"
 #include "Graphics/TextureCube.h"
+#include "Graphics/TextureStreamer.h"
 #include "Graphics/VertexTypes.h"
+#include "Graphics/StreamingBuffer.h"
 
 // Utilities
 #include "Utils/MeshBuilder.h"
@@ -38,11 +40,16 @@
 #include "Utils/JsonGlmHelpers.h"
 #include "Utils/StringUtils.h"
 #include "Utils/GlmDefines.h"
+#include "Utils/JobSystem.h"
+#include "Utils/Profiler.h"
+#include "Utils/ChunkedFile.h"
 
 // Gameplay
 #include "Gameplay/Material.h"
 #include "Gameplay/GameObject.h"
 #include "Gameplay/Scene.h"
+#include "Gameplay/RenderQueue.h"
+#include "Gameplay/DeferredShading.h"
 
 // Components
 #include "Gameplay/Components/IComponent.h"
@@ -173,16 +180,45 @@ bool DrawSaveLoadImGui(Scene::Sptr& scene, std::string& path) {
 		ResourceManager::SaveManifest(newFilename);
 	}
 	ImGui::SameLine();
+	// Save the scene and manifest as binary files beside the JSON ones, these are much faster to load
+	if (ImGui::Button("Save Binary")) {
+		scene->SaveBinary(std::filesystem::path(path).replace_extension(".bin").string());
+
+		std::string newFilename = std::filesystem::path(path).stem().string() + "-manifest.bin";
+		ResourceManager::SaveManifestBinary(newFilename);
+	}
+	ImGui::SameLine();
+	// Convert the JSON scene and manifest on disk to binary, without loading them
+	if (ImGui::Button("Convert")) {
+		std::string manifestName = std::filesystem::path(path).stem().string() + "-manifest";
+		if (std::filesystem::exists(path) && std::filesystem::exists(manifestName + ".json")) {
+			nlohmann::json sceneBlob = nlohmann::json::parse(FileHelpers::ReadFile(path));
+			Scene::ConvertJsonToBinary(sceneBlob, std::filesystem::path(path).replace_extension(".bin").string());
+
+			nlohmann::ordered_json manifestBlob = nlohmann::ordered_json::parse(FileHelpers::ReadFile(manifestName + ".json"));
+			ResourceManager::ConvertManifestToBinary(manifestBlob, manifestName + ".bin");
+		} else {
+			LOG_WARN("Could not find \"{}\" or \"{}.json\" to convert", path, manifestName);
+		}
+	}
+	ImGui::SameLine();
 	// Load scene from file button
 	if (ImGui::Button("Load")) {
-		// Since it's a reference to a ptr, this will
-		// overwrite the existing scene!
-		scene = nullptr;
-
-		std::string newFilename = std::filesystem::path(path).stem().string() + "-manifest.json";
+		// Binary scenes are saved with a binary manifest
+		std::string newFilename = std::filesystem::path(path).stem().string() +
+			(ChunkedFile::IsChunkedFile(path) ? "-manifest.bin" : "-manifest.json");
 		ResourceManager::LoadManifest(newFilename);
-		scene = Scene::Load(path);
 
+		// Binary scenes can fail to load (ex: a truncated file), in which case we keep the old scene
+		Scene::Sptr loaded = Scene::Load(path);
+		if (loaded == nullptr) {
+			LOG_ERROR("Failed to load scene from \"{}\", keeping the current scene", path);
+			return false;
+		}
+
+		// Since it's a reference to a ptr, this will
+		// overwrite the existing scene!
+		scene = loaded;
 		return true;
 	}
 	return false;
@@ -203,6 +239,7 @@ bool DrawLightImGui(const Scene::Sptr& scene, const char* title, int ix) {
 		isEdited |= ImGui::DragFloat3("Pos", &light.Position.x, 0.01f);
 		isEdited |= ImGui::ColorEdit3("Col", &light.Color.r);
 		isEdited |= ImGui::DragFloat("Range", &light.Range, 0.1f);
+		isEdited |= ImGui::Checkbox("Cast Shadows", &light.CastShadows);
 
 		result = ImGui::Button("Delete");
 	}
@@ -304,6 +341,11 @@ void CreateScene() {
 		leafTex->SetMinFilter(MinFilter::Nearest);
 		leafTex->SetMagFilter(MagFilter::Nearest);
 
+		// Normal maps only need their red and green channels, the shaders rebuild z
+		Texture2DDescription normalMapDesc;
+		normalMapDesc.Filename = "textures/normal_map.png";
+		normalMapDesc.Compression = TextureCompression::BC5;
+
 
 		// Here we'll load in the cubemap, as well as a special shader to handle drawing the skybox
 		TextureCube::Sptr testCubemap = ResourceManager::CreateAsset<TextureCube>("cubemaps/ocean/ocean.jpg");
@@ -326,33 +368,33 @@ void CreateScene() {
 		Material::Sptr boxMaterial = ResourceManager::CreateAsset<Material>(basicShader);
 		{
 			boxMaterial->Name = "Box";
-			boxMaterial->Set("u_Material.Diffuse", boxTexture);
-			boxMaterial->Set("u_Material.Shininess", 0.1f);
+			boxMaterial->Set("s_Diffuse", boxTexture);
+			boxMaterial->Set("u_Shininess", 0.1f);
 		}
 
 		// This will be the reflective material, we'll make the whole thing 90% reflective
 		Material::Sptr monkeyMaterial = ResourceManager::CreateAsset<Material>(reflectiveShader);
 		{
 			monkeyMaterial->Name = "Monkey";
-			monkeyMaterial->Set("u_Material.Diffuse", monkeyTex);
-			monkeyMaterial->Set("u_Material.Shininess", 0.5f);
+			monkeyMaterial->Set("s_Diffuse", monkeyTex);
+			monkeyMaterial->Set("u_Shininess", 0.5f);
 		}
 
 		// This will be the reflective material, we'll make the whole thing 90% reflective
 		Material::Sptr testMaterial = ResourceManager::CreateAsset<Material>(specShader);
 		{
 			testMaterial->Name = "Box-Specular";
-			testMaterial->Set("u_Material.Diffuse", boxTexture);
-			testMaterial->Set("u_Material.Specular", boxSpec);
+			testMaterial->Set("s_Diffuse", boxTexture);
+			testMaterial->Set("s_Specular", boxSpec);
 		}
 
 		// Our foliage vertex shader material
 		Material::Sptr foliageMaterial = ResourceManager::CreateAsset<Material>(foliageShader);
 		{
 			foliageMaterial->Name = "Foliage Shader";
-			foliageMaterial->Set("u_Material.Diffuse", leafTex);
-			foliageMaterial->Set("u_Material.Shininess", 0.1f);
-			foliageMaterial->Set("u_Material.Threshold", 0.1f);
+			foliageMaterial->Set("s_Diffuse", leafTex);
+			foliageMaterial->Set("u_Shininess", 0.1f);
+			foliageMaterial->Set("u_Threshold", 0.1f);
 
 			foliageMaterial->Set("u_WindDirection", glm::vec3(1.0f, 1.0f, 0.0f));
 			foliageMaterial->Set("u_WindStrength",  0.5f);
@@ -364,9 +406,9 @@ void CreateScene() {
 		Material::Sptr toonMaterial = ResourceManager::CreateAsset<Material>(toonShader);
 		{
 			toonMaterial->Name = "Toon";
-			toonMaterial->Set("u_Material.Diffuse", boxTexture);
-			toonMaterial->Set("u_Material.Shininess", 0.1f);
-			toonMaterial->Set("u_Material.Steps", 8);
+			toonMaterial->Set("s_Diffuse", boxTexture);
+			toonMaterial->Set("u_Shininess", 0.1f);
+			toonMaterial->Set("u_Steps", 8);
 		}
 
 		/////////////// NEW MATERIALS ////////////////////
@@ -374,26 +416,26 @@ void CreateScene() {
 		Material::Sptr displacementTest = ResourceManager::CreateAsset<Material>(displacementShader);
 		{
 			Texture2D::Sptr displacementMap = ResourceManager::CreateAsset<Texture2D>("textures/displacement_map.png");
-			Texture2D::Sptr normalMap       = ResourceManager::CreateAsset<Texture2D>("textures/normal_map.png");
+			Texture2D::Sptr normalMap       = ResourceManager::CreateAsset<Texture2D>(normalMapDesc);
 			Texture2D::Sptr diffuseMap      = ResourceManager::CreateAsset<Texture2D>("textures/bricks_diffuse.png");
 
 			displacementTest->Name = "Displacement Map";
-			displacementTest->Set("u_Material.Diffuse", diffuseMap);   
+			displacementTest->Set("s_Diffuse", diffuseMap);   
 			displacementTest->Set("s_Heightmap", displacementMap);
 			displacementTest->Set("s_NormalMap", normalMap);  
-			displacementTest->Set("u_Material.Shininess", 0.5f); 
+			displacementTest->Set("u_Shininess", 0.5f); 
 			displacementTest->Set("u_Scale", 0.1f);   
 		}
 
 		Material::Sptr normalmapMat = ResourceManager::CreateAsset<Material>(tangentSpaceMapping);
 		{
-			Texture2D::Sptr normalMap       = ResourceManager::CreateAsset<Texture2D>("textures/normal_map.png");
+			Texture2D::Sptr normalMap       = ResourceManager::CreateAsset<Texture2D>(normalMapDesc);
 			Texture2D::Sptr diffuseMap      = ResourceManager::CreateAsset<Texture2D>("textures/bricks_diffuse.png");
 
 			normalmapMat->Name = "Tangent Space Normal Map";
-			normalmapMat->Set("u_Material.Diffuse", diffuseMap);
+			normalmapMat->Set("s_Diffuse", diffuseMap);
 			normalmapMat->Set("s_NormalMap", normalMap);
-			normalmapMat->Set("u_Material.Shininess", 0.5f);
+			normalmapMat->Set("u_Shininess", 0.5f);
 			normalmapMat->Set("u_Scale", 0.1f);
 		}
 
@@ -403,9 +445,9 @@ void CreateScene() {
 			Texture2D::Sptr grass = ResourceManager::CreateAsset<Texture2D>("textures/terrain/grass.png");
 
 			multiTextureMat->Name = "Multitexturing";
-			multiTextureMat->Set("u_Material.DiffuseA", sand);
-			multiTextureMat->Set("u_Material.DiffuseB", grass); 
-			multiTextureMat->Set("u_Material.Shininess", 0.5f);
+			multiTextureMat->Set("s_DiffuseA", sand);
+			multiTextureMat->Set("s_DiffuseB", grass); 
+			multiTextureMat->Set("u_Shininess", 0.5f);
 			multiTextureMat->Set("u_Scale", 0.1f); 
 		}
 
@@ -414,6 +456,7 @@ void CreateScene() {
 		scene->Lights[0].Position = glm::vec3(0.0f, 1.0f, 3.0f);
 		scene->Lights[0].Color = glm::vec3(1.0f, 1.0f, 1.0f);
 		scene->Lights[0].Range = 100.0f;
+		scene->Lights[0].CastShadows = true;
 
 		scene->Lights[1].Position = glm::vec3(1.0f, 0.0f, 3.0f);
 		scene->Lights[1].Color = glm::vec3(0.2f, 0.8f, 0.1f);
@@ -421,6 +464,10 @@ void CreateScene() {
 		scene->Lights[2].Position = glm::vec3(0.0f, 1.0f, 3.0f);
 		scene->Lights[2].Color = glm::vec3(1.0f, 0.2f, 0.1f);
 
+		// A low sun, so that we get some long shadows
+		scene->Sun.Direction = glm::vec3(-0.5f, -0.3f, -0.8f);
+		scene->Sun.Color = glm::vec3(0.6f, 0.55f, 0.5f);
+
 		// We'll create a mesh that is a simple plane that we can resize later
 		MeshResource::Sptr planeMesh = ResourceManager::CreateAsset<MeshResource>();
 		planeMesh->AddParam(MeshBuilderParam::CreatePlane(ZERO, UNIT_Z, UNIT_X, glm::vec2(1.0f)));
@@ -639,6 +686,12 @@ int main() {
 	// Initialize our ImGui helper
 	ImGuiHelper::Init(window);
 
+	// Set up our profiler, this needs GL to be loaded for it's timer queries
+	Profiler::Init();
+
+	// Start up our worker threads, used for loading resources in the background
+	JobSystem::Init();
+
 	// Initialize our resource manager
 	ResourceManager::Init();
 
@@ -649,16 +702,17 @@ int main() {
 	ResourceManager::RegisterType<Material>();
 	ResourceManager::RegisterType<MeshResource>();
 
-	// Register all of our component types so we can load them from files
-	ComponentManager::RegisterType<Camera>();
-	ComponentManager::RegisterType<RenderComponent>();
-	ComponentManager::RegisterType<RigidBody>();
-	ComponentManager::RegisterType<TriggerVolume>();
-	ComponentManager::RegisterType<RotatingBehaviour>();
-	ComponentManager::RegisterType<JumpBehaviour>();
-	ComponentManager::RegisterType<MaterialSwapBehaviour>();
-	ComponentManager::RegisterType<TriggerVolumeEnterBehaviour>();
-	ComponentManager::RegisterType<SimpleCameraControl>();
+	// Register all of our component types so we can load them from files. The access tells the scene
+	// which types can be updated in parallel, anything that reads input from GLFW has to stay on the main thread
+	ComponentManager::RegisterType<Camera>(ComponentAccess::NoUpdate());
+	ComponentManager::RegisterType<RenderComponent>(ComponentAccess::NoUpdate());
+	ComponentManager::RegisterType<RigidBody>(ComponentAccess::NoUpdate());
+	ComponentManager::RegisterType<TriggerVolume>(ComponentAccess::NoUpdate());
+	ComponentManager::RegisterType<RotatingBehaviour>(ComponentAccess::Parallel(ComponentAccessFlags::None, ComponentAccessFlags::Transform));
+	ComponentManager::RegisterType<JumpBehaviour>(ComponentAccess::MainThread());
+	ComponentManager::RegisterType<MaterialSwapBehaviour>(ComponentAccess::NoUpdate());
+	ComponentManager::RegisterType<TriggerVolumeEnterBehaviour>(ComponentAccess::NoUpdate());
+	ComponentManager::RegisterType<SimpleCameraControl>(ComponentAccess::MainThread());
 
 	// GL states, we'll enable depth testing and backface fulling
 	glEnable(GL_DEPTH_TEST);
@@ -680,29 +734,23 @@ int main() {
 		glm::vec4 u_CameraPos;
 		// The time in seconds since the start of the application
 		float u_Time;
+		// std140 rounds the block size up to a multiple of 16 bytes, and we bind exactly
+		// sizeof(FrameLevelUniforms) bytes, so we need to pad it out
+		float _padding[3];
 	};
-	// This uniform buffer will hold all our frame level uniforms, to be shared between shaders
-	UniformBuffer<FrameLevelUniforms>::Sptr frameUniforms = std::make_shared<UniformBuffer<FrameLevelUniforms>>(BufferUsage::DynamicDraw);
+	// This streaming buffer will hold all our frame level uniforms, to be shared between shaders
+	// It's persistently mapped and triple buffered, so updating it is just a memcpy
+	StreamingBuffer::Sptr frameUniforms = StreamingBuffer::Create(BufferType::Uniform, 4 * 1024);
 	// The slot that we'll bind our frame level UBO to
 	const int FRAME_UBO_BINDING = 0;
 
-	// Structure for our isntance-level uniforms, matches layout from
-	// fragments/frame_uniforms.glsl
-	// For use with a UBO.
-	struct InstanceLevelUniforms {
-		// Complete MVP
-		glm::mat4 u_ModelViewProjection;
-		// Just the model transform, we'll do worldspace lighting
-		glm::mat4 u_Model;
-		// Normal Matrix for transforming normals
-		glm::mat4 u_NormalMatrix;
-	};
-
-	// This uniform buffer will hold all our instance level uniforms, to be shared between shaders
-	UniformBuffer<InstanceLevelUniforms>::Sptr instanceUniforms = std::make_shared<UniformBuffer<InstanceLevelUniforms>>(BufferUsage::DynamicDraw);
-
-	// The slot that we'll bind our instance level UBO to
-	const int INSTANCE_UBO_BINDING = 1;
+	// The render queue will collect, sort and batch all our objects, and handles
+	// uploading the instance level uniforms (see fragments/frame_uniforms.glsl)
+	RenderQueue::Sptr renderQueue = RenderQueue::Create();
+	// Draws the queue with forward or deferred shading, optionally with a depth pre-pass
+	DeferredShading::Sptr deferredShading = DeferredShading::Create();
+	// Re-used every frame to collect the objects that survive frustum culling
+	std::vector<RenderComponent*> visibleRenderables;
 
 	////////////////////////////////
 	///// SCENE CREATION MOVED /////
@@ -721,13 +769,19 @@ int main() {
 	BulletDebugMode physicsDebugMode = BulletDebugMode::None;
 	float playbackSpeed = 1.0f;
 
-	nlohmann::json editorSceneState;
+	// Stores the editor state of the scene while we are in play mode, re-used between toggles
+	Scene::Snapshot editorSceneState;
 
 	///// Game loop /////
 	while (!glfwWindowShouldClose(window)) {
+		Profiler::BeginFrame();
 		glfwPollEvents();
 		ImGuiHelper::StartFrame();
 
+		// Upload any resources that have finished loading in the background, anything
+		// still loading will be skipped or drawn with placeholders
+		ResourceManager::ProcessPendingLoads();
+
 		// Calculate the time since our last frame (dt)
 		double thisFrame = glfwGetTime();
 		float dt = static_cast<float>(thisFrame - lastFrame);
@@ -735,6 +789,9 @@ int main() {
 		// Draw our material properties window!
 		DrawMaterialsWindow();
 
+		// Draw the profiler, showing timings from previous frames
+		Profiler::DrawImGui();
+
 		// Showcasing how to use the imGui library!
 		bool isDebugWindowOpen = ImGui::Begin("Debugging");
 		if (isDebugWindowOpen) {
@@ -744,20 +801,16 @@ int main() {
 			if (ImGui::Button(buttonLabel)) {
 				// Save scene so it can be restored when exiting play mode
 				if (!scene->IsPlaying) {
-					editorSceneState = scene->ToJson();
+					scene->SaveSnapshot(editorSceneState);
 				}
 
 				// Toggle state
 				scene->IsPlaying = !scene->IsPlaying;
 
-				// If we've gone from playing to not playing, restore the state from before we started playing
+				// If we've gone from playing to not playing, restore the state from before we started playing.
+				// This is done in place, so the objects, components and physics world all stay alive
 				if (!scene->IsPlaying) {
-					scene = nullptr;
-					// We reload to scene from our cached state
-					scene = Scene::FromJson(editorSceneState);
-					// Don't forget to reset the scene's window and wake all the objects!
-					scene->Window = window;
-					scene->Awake();
+					scene->RestoreSnapshot(editorSceneState);
 				}
 			}
 
@@ -779,6 +832,40 @@ int main() {
 				scene->SetPhysicsDebugDrawMode(physicsDebugMode);
 			}
 			LABEL_LEFT(ImGui::SliderFloat, "Playback Speed:    ", &playbackSpeed, 0.0f, 10.0f);
+			// A rate of 0 steps physics once per frame on the main thread
+			int physicsRate = scene->GetPhysicsTimestep() > 0.0f ? (int)glm::round(1.0f / scene->GetPhysicsTimestep()) : 0;
+			if (LABEL_LEFT(ImGui::SliderInt, "Physics Rate (Hz): ", &physicsRate, 0, 240)) {
+				scene->SetPhysicsTimestep(physicsRate > 0 ? 1.0f / physicsRate : 0.0f);
+			}
+			Gameplay::Physics::PhysicsWorldSettings physicsSettings = scene->GetPhysicsSettings();
+			if (ImGui::Checkbox("Multithreaded Physics", &physicsSettings.IsMultithreaded)) {
+				scene->SetPhysicsSettings(physicsSettings);
+			}
+			ImGui::Checkbox("Frustum Culling", &scene->IsCullingEnabled);
+			ImGui::Checkbox("Parallel Update", &scene->IsParallelUpdateEnabled);
+			// Note that this is the result from the previous frame, since we cull after drawing the GUI
+			ImGui::Text("Visible: %d / %d", (int)visibleRenderables.size(), scene->GetCullableCount());
+			ImGui::Separator();
+			// Deferred shading lights each pixel once, no matter how many objects overlap it
+			bool isDeferred = deferredShading->IsDeferred();
+			if (ImGui::Checkbox("Deferred Shading", &isDeferred)) {
+				deferredShading->SetDeferred(isDeferred);
+			}
+			bool isPrepassEnabled = deferredShading->IsDepthPrepassEnabled();
+			if (ImGui::Checkbox("Depth Pre-pass", &isPrepassEnabled)) {
+				deferredShading->SetDepthPrepass(isPrepassEnabled);
+			}
+			const DeferredShading::Stats& shadingStats = deferredShading->GetStats();
+			ImGui::Text("Pre-pass: %d, deferred: %d, forward: %d", (int)shadingStats.PrepassItems, (int)shadingStats.DeferredItems, (int)shadingStats.ForwardItems);
+			ImGui::Separator();
+			if (ResourceManager::GetPendingLoadCount() > 0) {
+				ImGui::Text("Loading %d resources...", (int)ResourceManager::GetPendingLoadCount());
+				ImGui::Separator();
+			}
+			// Streaming stats are from the end of the last frame
+			const TextureStreamer::Stats& textureStats = TextureStreamer::GetStats();
+			ImGui::Text("Textures: %.1f / %.1f MB (%d / %d streaming)", textureStats.ResidentBytes / (1024.0f * 1024.0f), TextureStreamer::GetBudget() / (1024.0f * 1024.0f),
+						(int)textureStats.StreamingCount, (int)textureStats.TextureCount);
 			ImGui::Separator();
 		}
 
@@ -799,14 +886,36 @@ int main() {
 					ix--;
 				}
 			}
-			// As long as we don't have max lights, draw a button
-			// to add another one
-			if (scene->Lights.size() < scene->MAX_LIGHTS) {
-				if (ImGui::Button("Add Light")) {
-					scene->Lights.push_back(Light());
-					scene->SetupShaderAndLights();
-				}
+			// Draw a button to add another light
+			if (ImGui::Button("Add Light")) {
+				scene->Lights.push_back(Light());
+				scene->SetupShaderAndLights();
+			}
+			// Lights are sorted into clusters, so shading cost depends on how many lights overlap each cluster
+			const ClusteredLighting::Stats& lightStats = scene->GetLightingStats();
+			ImGui::Text("Visible lights: %d, max per cluster: %d", (int)lightStats.VisibleLights, (int)lightStats.MaxLightsPerCluster);
+			ImGui::Separator();
+
+			// The sun and the shadow settings
+			if (ImGui::CollapsingHeader("Sun")) {
+				ImGui::DragFloat3("Direction", &scene->Sun.Direction.x, 0.01f);
+				ImGui::ColorEdit3("Color", &scene->Sun.Color.r);
+				ImGui::Checkbox("Cast Shadows", &scene->Sun.CastShadows);
+			}
+			ShadowMapping::Sptr shadows = scene->GetShadowMapping();
+			float shadowDistance = shadows->GetShadowDistance();
+			if (LABEL_LEFT(ImGui::DragFloat, "Shadow Distance:   ", &shadowDistance, 0.5f, 1.0f, 500.0f)) {
+				shadows->SetShadowDistance(shadowDistance);
 			}
+			int faceBudget = shadows->GetFaceBudget();
+			if (LABEL_LEFT(ImGui::SliderInt, "Shadow Faces/Frame:", &faceBudget, 0, ShadowMapping::MAX_POINT_SHADOWS * 6)) {
+				shadows->SetFaceBudget(faceBudget);
+			}
+			// Shadow stats are from the last frame, since we render shadows after drawing the GUI
+			const ShadowMapping::Stats& shadowStats = shadows->GetStats();
+			ImGui::Text("Cascades cached: %d, updated: %d", (int)shadowStats.CascadesCached, (int)shadowStats.CascadesUpdated);
+			ImGui::Text("Shadowed lights: %d, faces: %d (%d pending)", (int)shadowStats.PointLights, (int)shadowStats.FacesRendered, (int)shadowStats.FacesPending);
+			ImGui::Text("Shadow casters drawn: %d", (int)shadowStats.CastersDrawn);
 			// Split lights from the objects in ImGui
 			ImGui::Separator();
 		}
@@ -831,34 +940,38 @@ int main() {
 			scene->DrawAllGameObjectGUIs();
 		}
 		
-		// The current material that is bound for rendering
-		Material::Sptr currentMat = nullptr;
-		Shader::Sptr shader = nullptr;
-
 		// Bind the skybox texture to a reserved texture slot
 		// See Material.h and Material.cpp for how we're reserving texture slots
 		TextureCube::Sptr environment = scene->GetSkyboxTexture();
 		if (environment) environment->Bind(0); 
 
 		// Here we'll bind all the UBOs to their corresponding slots
-		scene->PreRender();
-		frameUniforms->Bind(FRAME_UBO_BINDING);
-		instanceUniforms->Bind(INSTANCE_UBO_BINDING);
+		scene->PreRender(windowSize);
 
 		// Upload frame level uniforms
-		auto& frameData = frameUniforms->GetData();
+		FrameLevelUniforms frameData;
 		frameData.u_Projection = camera->GetProjection();
 		frameData.u_View = camera->GetView();
 		frameData.u_ViewProjection = camera->GetViewProjection();
 		frameData.u_CameraPos = glm::vec4(camera->GetGameObject()->GetPosition(), 1.0f);
 		frameData.u_Time = static_cast<float>(thisFrame);
-		frameUniforms->Update();
+		frameUniforms->BindRange(FRAME_UBO_BINDING, frameUniforms->Push(frameData));
+
+		// Find all the objects that the camera can see
+		visibleRenderables.clear();
+		scene->CullRenderables(viewProj, visibleRenderables);
 
-		// Render all our objects
-		ComponentManager::Each<RenderComponent>([&](const RenderComponent::Sptr& renderable) {
+		// Now that the culling tree is up to date, bring any stale shadow maps up to date
+		scene->RenderShadows();
+
+		// Collect all our visible objects into the render queue
+		glm::vec3 cameraPos = camera->GetGameObject()->GetPosition();
+		// Orthographic cameras don't shrink things with distance, so we keep them at full detail
+		float projectionScale = camera->GetOrthoEnabled() ? 0.0f : camera->GetProjection()[1][1];
+		for (RenderComponent* renderable : visibleRenderables) {
 			// Early bail if mesh not set
 			if (renderable->GetMesh() == nullptr) { 
-				return;
+				continue;
 			}
 
 			// If we don't have a material, try getting the scene's fallback material
@@ -867,33 +980,19 @@ int main() {
 				if (scene->DefaultMaterial != nullptr) {
 					renderable->SetMaterial(scene->DefaultMaterial);
 				} else {
-					return;
+					continue;
 				}
 			}
 
-			// If the material has changed, we need to bind the new shader and set up our material and frame data
-			// Note: This is a good reason why we should be sorting the render components in ComponentManager
-			if (renderable->GetMaterial() != currentMat) {
-				currentMat = renderable->GetMaterial();
-				shader = currentMat->GetShader();
+			// Distant objects use a simpler level of detail, chosen from how big they are on screen
+			const VertexArrayObject::Sptr& mesh = renderable->SelectLod(cameraPos, projectionScale);
 
-				shader->Bind();
-				currentMat->Apply();
-			}
+			// The queue will sort by shader, material and mesh, and batch identical objects together
+			renderQueue->Submit(renderable->GetMaterial(), mesh, renderable->GetGameObject()->GetTransform());
+		}
 
-			// Grab the game object so we can do some stuff with it
-			GameObject* object = renderable->GetGameObject();
-			 
-			// Use our uniform buffer for our instance level uniforms
-			auto& instanceData = instanceUniforms->GetData();
-			instanceData.u_Model = object->GetTransform();
-			instanceData.u_ModelViewProjection = viewProj * object->GetTransform();
-			instanceData.u_NormalMatrix = glm::mat3(glm::transpose(glm::inverse(object->GetTransform())));
-			instanceUniforms->Update();  
-
-			// Draw the object
-			renderable->GetMesh()->Draw();
-		});
+		// Draw everything we've collected, with whichever render path is selected
+		deferredShading->Render(renderQueue, viewProj, windowSize);
 
 		// Use our cubemap to draw our skybox
 		scene->DrawSkybox();
@@ -903,17 +1002,35 @@ int main() {
 
 		VertexArrayObject::Unbind();
 
+		// Let our streaming buffers know we're done with this frame's data
+		renderQueue->EndFrame();
+		scene->PostRender();
+		frameUniforms->NextFrame();
+		DebugDrawer::Get().NextFrame();
+		// Stream texture levels in and out based on what we just drew
+		TextureStreamer::Update();
+
 		lastFrame = thisFrame;
 		ImGuiHelper::EndFrame();
-		glfwSwapBuffers(window);
+		{
+			PROFILE_SCOPE("SwapBuffers");
+			glfwSwapBuffers(window);
+		}
+		Profiler::EndFrame();
 	}
 
 	// Clean up the ImGui library
 	ImGuiHelper::Cleanup();
 
+	// Release our profiler's queries
+	Profiler::Cleanup();
+
 	// Clean up the resource manager
 	ResourceManager::Cleanup();
 
+	// Stop our worker threads
+	JobSystem::Shutdown();
+
 	// Clean up the toolkit logger so we don't leak memory
 	Logger::Uninitialize();
 	return 0;